@@ -0,0 +1,611 @@
+#include "channel.h"
+#include "playlist-manager.h"
+#include "media-controller.h"
+#include "time-trigger.h"
+#include "frame-trigger.h"
+#include "utils/logger.h"
+#include <algorithm>
+#include <set>
+
+Channel::Channel(const std::string& name, size_t index)
+    : name_(name)
+    , index_(index)
+    , clock_(Clock::system())
+    , chained_slot_ms_(-1)
+{
+    auto status = std::make_shared<ChannelStatus>();
+    status->name = name_;
+    status_ = status;
+}
+
+Channel::~Channel() {
+    cleanup();
+}
+
+void Channel::set_clock(std::shared_ptr<Clock> clock) {
+    clock_ = clock ? clock : Clock::system();
+}
+
+bool Channel::initialize() {
+    LOG_INFO("Initializing channel " + name_);
+    
+    try {
+        playlist_manager_ = std::make_unique<PlaylistManager>();
+        playlist_manager_->set_channel(name_);
+        playlist_manager_->set_clock(clock_);
+        if (!playlist_manager_->initialize()) {
+            LOG_ERROR("Failed to initialize playlist manager for channel " + name_);
+            return false;
+        }
+        
+        media_controller_ = std::make_unique<MediaController>();
+        if (!media_controller_->initialize()) {
+            LOG_ERROR("Failed to initialize media controller for channel " + name_);
+            return false;
+        }
+        
+        time_trigger_ = std::make_unique<TimeTrigger>();
+        time_trigger_->set_channel(name_);
+        time_trigger_->set_playlist_manager(playlist_manager_.get());
+        time_trigger_->set_clock(clock_);
+        if (!time_trigger_->initialize()) {
+            LOG_ERROR("Failed to initialize time trigger for channel " + name_);
+            return false;
+        }
+        
+        return true;
+        
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception initializing channel " + name_ + ": " + std::string(e.what()));
+        return false;
+    }
+}
+
+void Channel::cleanup() {
+    disarm_items();
+    
+    time_trigger_.reset();
+    media_controller_.reset();
+    playlist_manager_.reset();
+}
+
+const std::string& Channel::get_name() const {
+    return name_;
+}
+
+size_t Channel::get_index() const {
+    return index_;
+}
+
+bool Channel::reload_schedules() {
+    uint64_t version = playlist_manager_->get_snapshot()->version;
+    playlist_manager_->reload_schedules();
+    time_trigger_->reload_schedule();
+    return playlist_manager_->get_snapshot()->version != version;
+}
+
+void Channel::refresh_schedule() {
+    time_trigger_->reload_schedule();
+}
+
+void Channel::arm_deadlines(DeadlineQueue& deadlines, int preroll_seconds, uint64_t join_since_ns) {
+    disarm_items();
+    
+    {
+        std::lock_guard<std::mutex> lock(status_mutex_);
+        chained_slot_ms_ = -1;
+    }
+    
+    try {
+        int32_t joined_ms = join_since_ns ? join_current_slot(deadlines, join_since_ns) : -1;
+        
+        armed_slots_ = time_trigger_->get_day_slots();
+        auto slots = time_trigger_->get_remaining_slots();
+        auto now = clock_->steady_now();
+        
+        for (const auto& slot : slots) {
+            if (slot.to_ms() != joined_ms) {
+                push_slot_deadlines(deadlines, slot, preroll_seconds, now);
+            }
+        }
+        
+        update_next_item();
+        
+        LOG_DEBUG("Channel " + name_ + " armed " + std::to_string(slots.size()) + " time slots");
+        
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception arming deadlines for channel " + name_ + ": " + std::string(e.what()));
+    }
+}
+
+void Channel::push_slot_deadlines(DeadlineQueue& deadlines, const TimeSlot& slot, int preroll_seconds,
+                                  Clock::SteadyTime now) {
+    Deadline trigger;
+    trigger.kind = Deadline::Kind::Trigger;
+    trigger.channel = index_;
+    trigger.scheduled_time = time_trigger_->get_slot_time(slot);
+    trigger.when = deadlines.to_steady_time(trigger.scheduled_time);
+    trigger.slot_ms = slot.to_ms();
+    
+    Deadline frame_arm = trigger;
+    frame_arm.kind = Deadline::Kind::FrameArm;
+    frame_arm.when = trigger.when - FRAME_ARM_LEAD;
+    
+    // Fall back to idle once every item of the slot has run its course.
+    // Items whose duration is not known (yet) stay on air until the next slot.
+    int64_t slot_ms = 0;
+    bool has_fixed_duration = true;
+    for (const auto& item_id : slot.item_ids) {
+        auto item = playlist_manager_->get_item(item_id);
+        if (item && item->trigger_mode == TriggerMode::Frame) {
+            frame_arm.item_ids.push_back(item_id);
+        } else {
+            trigger.item_ids.push_back(item_id);
+        }
+        
+        if (!item || item->get_duration_ms() <= 0) {
+            has_fixed_duration = false;
+        } else {
+            slot_ms = std::max(slot_ms, item->get_duration_ms());
+        }
+    }
+    
+    if (!trigger.item_ids.empty()) {
+        deadlines.push(trigger);
+    }
+    if (!frame_arm.item_ids.empty()) {
+        deadlines.push(frame_arm);
+    }
+    
+    // Warm up the slot's files ahead of time, unless the slot is already due
+    if (preroll_seconds > 0 && trigger.when > now) {
+        Deadline preroll = trigger;
+        preroll.kind = Deadline::Kind::Preroll;
+        preroll.when = std::max(now, trigger.when - std::chrono::seconds(preroll_seconds));
+        preroll.item_ids = slot.item_ids;
+        deadlines.push(preroll);
+    }
+    
+    if (has_fixed_duration && slot_ms > 0) {
+        Deadline idle = trigger;
+        idle.kind = Deadline::Kind::Idle;
+        idle.when = trigger.when + std::chrono::milliseconds(slot_ms);
+        idle.item_ids = slot.item_ids;
+        deadlines.push(idle);
+    }
+}
+
+void Channel::patch_deadlines(DeadlineQueue& deadlines, int preroll_seconds, FrameTrigger& frame_trigger) {
+    try {
+        // Untouched weekdays are shared across snapshots, so the same slots mean no change today
+        auto slots = time_trigger_->get_day_slots();
+        if (slots == armed_slots_) {
+            return;
+        }
+        
+        // Only slots still ahead are patched; anything started keeps running as armed
+        auto now = clock_->now();
+        auto steady_now = clock_->steady_now();
+        size_t replaced = deadlines.remove_if([this, now](const Deadline& deadline) {
+            return deadline.kind != Deadline::Kind::Rearm && deadline.channel == index_ &&
+                   deadline.scheduled_time > now;
+        });
+        
+        std::set<std::pair<int32_t, std::string>> upcoming;
+        size_t pushed = 0;
+        for (const auto& slot : *slots) {
+            if (time_trigger_->get_slot_time(slot) <= now) {
+                continue;
+            }
+            for (const auto& item_id : slot.item_ids) {
+                upcoming.emplace(slot.to_ms(), item_id);
+            }
+            push_slot_deadlines(deadlines, slot, preroll_seconds, steady_now);
+            pushed++;
+        }
+        
+        // Items armed for a slot they are no longer in must not fire, nor the
+        // old copy of one edited in place
+        std::set<std::string> modified;
+        for (const auto& pair : playlist_manager_->get_snapshot()->changes.modified) {
+            modified.insert(pair.first->id);
+        }
+        
+        bool disarm_prerolled = false;
+        if (armed_slots_) {
+            std::lock_guard<std::mutex> lock(status_mutex_);
+            for (const auto& slot : *armed_slots_) {
+                if (time_trigger_->get_slot_time(slot) <= now) {
+                    continue;
+                }
+                for (const auto& item_id : slot.item_ids) {
+                    if (modified.count(item_id) || !upcoming.count(std::make_pair(slot.to_ms(), item_id))) {
+                        frame_trigger.disarm(index_, item_id);
+                        disarm_prerolled = disarm_prerolled || armed_item_id_ == item_id;
+                    }
+                }
+            }
+        }
+        if (disarm_prerolled) {
+            disarm_items();
+        }
+        
+        armed_slots_ = slots;
+        update_next_item();
+        
+        LOG_DEBUG("Channel " + name_ + " patched " + std::to_string(pushed) + " upcoming time slots (" +
+                  std::to_string(replaced) + " deadlines replaced)");
+                  
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception patching deadlines for channel " + name_ + ": " + std::string(e.what()));
+    }
+}
+
+int32_t Channel::join_current_slot(DeadlineQueue& deadlines, uint64_t since_ns) {
+    // Returns the start of the slot taken care of, -1 when there was none
+    TimeSlot slot;
+    if (!time_trigger_->get_current_slot(slot)) {
+        return -1;
+    }
+    
+    auto slot_time = time_trigger_->get_slot_time(slot);
+    auto elapsed = clock_->now() - slot_time;
+    if (elapsed < JOIN_MIN_ELAPSED) {
+        return -1;
+    }
+    int64_t elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+    
+    std::lock_guard<std::mutex> lock(status_mutex_);
+    
+    int64_t slot_ms = 0;
+    bool has_fixed_duration = true;
+    size_t running = 0;
+    
+    for (const auto& item_id : slot.item_ids) {
+        auto item = playlist_manager_->get_item(item_id);
+        int64_t duration_ms = item ? item->get_duration_ms() : 0;
+        if (duration_ms <= 0) {
+            has_fixed_duration = false;
+        } else {
+            slot_ms = std::max(slot_ms, duration_ms);
+        }
+        
+        if (!item || (duration_ms > 0 && elapsed_ms >= duration_ms)) {
+            continue;
+        }
+        running++;
+        
+        // Still on air from before the scheduler was disabled
+        if (current_item_id_ == item_id) {
+            continue;
+        }
+        
+        LOG_INFO("[" + name_ + "] Joining item " + item_id + " in progress");
+        if (media_controller_->join_item(*item, elapsed_ms, since_ns)) {
+            mark_on_air(item_id);
+        }
+    }
+    
+    if (running == 0) {
+        // The whole slot is over, cover the rest of it with idle content
+        if (has_fixed_duration && current_item_id_ != "idle") {
+            execute_scheduled_item("idle");
+            mark_on_air("idle");
+        }
+    } else if (has_fixed_duration && slot_ms > 0) {
+        Deadline idle;
+        idle.kind = Deadline::Kind::Idle;
+        idle.channel = index_;
+        idle.scheduled_time = slot_time;
+        idle.when = deadlines.to_steady_time(slot_time) + std::chrono::milliseconds(slot_ms);
+        idle.slot_ms = slot.to_ms();
+        idle.item_ids = slot.item_ids;
+        deadlines.push(idle);
+    }
+    
+    return slot.to_ms();
+}
+
+void Channel::handle_deadline(const Deadline& deadline, FrameTrigger& frame_trigger) {
+    switch (deadline.kind) {
+    case Deadline::Kind::Trigger: {
+        int64_t wakeup_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            clock_->steady_now() - deadline.when).count();
+        {
+            std::lock_guard<std::mutex> lock(status_mutex_);
+            if (chained_slot_ms_ >= 0 && chained_slot_ms_ == deadline.slot_ms) {
+                // Already chained in when the previous item ended
+                chained_slot_ms_ = -1;
+            } else {
+                for (const auto& item_id : deadline.item_ids) {
+                    // Check if this item is already playing
+                    if (current_item_id_ != item_id) {
+                        execute_scheduled_item(item_id, wakeup_ns);
+                        mark_on_air(item_id);
+                    }
+                }
+            }
+        }
+        update_next_item();
+        break;
+    }
+    
+    case Deadline::Kind::Idle: {
+        std::lock_guard<std::mutex> lock(status_mutex_);
+        bool slot_on_air = std::find(deadline.item_ids.begin(), deadline.item_ids.end(),
+                                     current_item_id_) != deadline.item_ids.end();
+        if (slot_on_air) {
+            execute_scheduled_item("idle");
+            mark_on_air("idle");
+        }
+        break;
+    }
+    
+    case Deadline::Kind::Preroll:
+        for (const auto& item_id : deadline.item_ids) {
+            arm_scheduled_item(item_id);
+        }
+        break;
+    
+    case Deadline::Kind::FrameArm:
+        // The tick callback takes it from here and fires on the crossing frame.
+        // It only reveals and unpauses there, so the file is loaded now, on the
+        // UI queue, unless the pre-roll deadline already did.
+        for (const auto& item_id : deadline.item_ids) {
+            arm_scheduled_item(item_id);
+            frame_trigger.arm(index_, item_id, deadline.scheduled_time);
+        }
+        break;
+    
+    case Deadline::Kind::Rearm:
+        // Re-arming is global and handled by the event loop
+        break;
+    }
+}
+
+void Channel::on_frame_trigger(const std::string& item_id) {
+    // Runs on the OBS video thread
+    {
+        std::lock_guard<std::mutex> lock(status_mutex_);
+        if (current_item_id_ != item_id) {
+            execute_scheduled_item(item_id);
+            mark_on_air(item_id);
+        }
+    }
+    update_next_item();
+}
+
+void Channel::on_media_ended(const std::string& source_name) {
+    // Runs on the media thread of the source that ended
+    try {
+        TimeSlot slot;
+        if (!time_trigger_->get_next_slot(slot)) {
+            return;
+        }
+        
+        auto until_slot = time_trigger_->get_slot_time(slot) - clock_->now();
+        {
+            std::lock_guard<std::mutex> lock(status_mutex_);
+            
+            // Only the end of what is on air matters, not of a pre-rolled or idle file
+            auto current = playlist_manager_->get_item(current_item_id_);
+            if (!current || current->source != source_name || chained_slot_ms_ == slot.to_ms()) {
+                return;
+            }
+            
+            if (until_slot > CHAIN_WINDOW) {
+                LOG_DEBUG("[" + name_ + "] " + current_item_id_ + " ended ahead of the " + slot.to_string() +
+                          " slot, leaving it to its trigger");
+                return;
+            }
+            
+            // Frame-accurate items stay on their frame trigger
+            bool chained = false;
+            for (const auto& item_id : slot.item_ids) {
+                auto item = playlist_manager_->get_item(item_id);
+                if (!item || item->trigger_mode == TriggerMode::Frame) {
+                    continue;
+                }
+                
+                LOG_INFO("[" + name_ + "] " + current_item_id_ + " ended, chaining into " + item_id);
+                execute_scheduled_item(item_id);
+                mark_on_air(item_id);
+                chained = true;
+            }
+            
+            if (chained) {
+                chained_slot_ms_ = slot.to_ms();
+            }
+        }
+        update_next_item();
+        
+    } catch (const std::exception& e) {
+        LOG_ERROR("[" + name_ + "] Exception chaining after media end on " + source_name + ": " +
+                  std::string(e.what()));
+    }
+}
+
+void Channel::disarm_items() {
+    if (media_controller_) {
+        media_controller_->disarm_all();
+    }
+    
+    std::lock_guard<std::mutex> lock(status_mutex_);
+    armed_item_id_.clear();
+    publish_status();
+}
+
+std::shared_ptr<const ChannelStatus> Channel::get_status_snapshot() const {
+    return std::atomic_load(&status_);
+}
+
+ChannelStatus Channel::get_status() const {
+    return *get_status_snapshot();
+}
+
+std::string Channel::get_current_item() const {
+    return get_status_snapshot()->current_item;
+}
+
+std::string Channel::get_next_item() const {
+    return get_status_snapshot()->next_item;
+}
+
+std::string Channel::get_arming_state() const {
+    auto status = get_status_snapshot();
+    return status->armed_item.empty() ? "None" : "Armed: " + status->armed_item;
+}
+
+std::vector<StartLatencyRecord> Channel::get_start_latency_records() const {
+    if (!media_controller_) {
+        return {};
+    }
+    return media_controller_->get_start_latency_records();
+}
+
+std::vector<JoinRecord> Channel::get_join_records() const {
+    if (!media_controller_) {
+        return {};
+    }
+    return media_controller_->get_join_records();
+}
+
+std::vector<LatencyBreakdown> Channel::get_latency_histograms() const {
+    std::vector<LatencyBreakdown> breakdowns;
+    if (!media_controller_) {
+        return breakdowns;
+    }
+    
+    for (auto& pair : media_controller_->get_latency_histograms()) {
+        breakdowns.push_back(LatencyBreakdown{name_, pair.first, std::move(pair.second)});
+    }
+    return breakdowns;
+}
+
+CommandQueueStats Channel::get_command_queue_stats() const {
+    if (!media_controller_) {
+        return CommandQueueStats();
+    }
+    return media_controller_->get_command_queue_stats();
+}
+
+std::vector<AsRunEntry> Channel::get_as_run_log() const {
+    std::lock_guard<std::mutex> lock(as_run_mutex_);
+    return as_run_;
+}
+
+std::shared_ptr<const ScheduleSnapshot> Channel::get_schedule_snapshot() const {
+    if (!playlist_manager_) {
+        return std::make_shared<const ScheduleSnapshot>();
+    }
+    return playlist_manager_->get_snapshot();
+}
+
+PlaylistManager* Channel::get_playlist_manager() {
+    return playlist_manager_.get();
+}
+
+MediaController* Channel::get_media_controller() {
+    return media_controller_.get();
+}
+
+void Channel::execute_scheduled_item(const std::string& item_id, int64_t wakeup_ns) {
+    // Called with status_mutex_ held
+    try {
+        LOG_INFO("[" + name_ + "] Executing scheduled item: " + item_id);
+        
+        if (item_id == "idle") {
+            // Play default idle content
+            media_controller_->play_idle_content();
+            return;
+        }
+        
+        // Get item details from playlist manager
+        auto item = playlist_manager_->get_item(item_id);
+        if (!item) {
+            LOG_WARNING("[" + name_ + "] Scheduled item not found: " + item_id);
+            return;
+        }
+        
+        // Queue the media control actions (fires the pre-rolled copy if armed)
+        bool dispatched = media_controller_->execute_item(*item, wakeup_ns);
+        
+        if (armed_item_id_ == item_id) {
+            armed_item_id_.clear();
+        }
+        
+        if (dispatched) {
+            LOG_INFO("[" + name_ + "] Dispatched scheduled item: " + item_id);
+        }
+        
+    } catch (const std::exception& e) {
+        LOG_ERROR("[" + name_ + "] Failed to execute scheduled item " + item_id + ": " + std::string(e.what()));
+    }
+}
+
+void Channel::arm_scheduled_item(const std::string& item_id) {
+    try {
+        auto item = playlist_manager_->get_item(item_id);
+        if (!item) {
+            return;
+        }
+        
+        std::lock_guard<std::mutex> lock(status_mutex_);
+        
+        // Re-armed after a reload patched its slot
+        if (armed_item_id_ == item_id) {
+            return;
+        }
+        
+        // The on-air source cannot be pre-rolled without cutting what is playing,
+        // unless it has a twin to load into
+        auto current = playlist_manager_->get_item(current_item_id_);
+        if (current && current->source == item->source && !media_controller_->has_twin_source(item->source)) {
+            LOG_DEBUG("[" + name_ + "] Source " + item->source + " is on air, not pre-rolling " + item_id);
+            return;
+        }
+        
+        if (media_controller_->arm_item(*item)) {
+            armed_item_id_ = item_id;
+            publish_status();
+        }
+        
+    } catch (const std::exception& e) {
+        LOG_ERROR("[" + name_ + "] Failed to pre-roll item " + item_id + ": " + std::string(e.what()));
+    }
+}
+
+void Channel::update_next_item() {
+    try {
+        auto next_items = time_trigger_->get_next_items();
+        std::lock_guard<std::mutex> lock(status_mutex_);
+        next_item_id_ = next_items.empty() ? "None" : next_items[0];
+        publish_status();
+    } catch (const std::exception& e) {
+        LOG_ERROR("[" + name_ + "] Exception updating next item: " + std::string(e.what()));
+    }
+}
+
+void Channel::mark_on_air(const std::string& item_id) {
+    // Called with status_mutex_ held, after the item was executed
+    current_item_id_ = item_id;
+    last_trigger_time_ = clock_->now();
+    publish_status();
+    
+    std::lock_guard<std::mutex> lock(as_run_mutex_);
+    as_run_.push_back(AsRunEntry{name_, item_id, last_trigger_time_});
+    if (as_run_.size() > MAX_AS_RUN_ENTRIES) {
+        as_run_.erase(as_run_.begin(), as_run_.end() - MAX_AS_RUN_ENTRIES);
+    }
+}
+
+void Channel::publish_status() {
+    // Called with status_mutex_ held; readers keep whatever snapshot they already loaded
+    auto status = std::make_shared<ChannelStatus>();
+    status->name = name_;
+    status->current_item = current_item_id_;
+    status->next_item = next_item_id_;
+    status->armed_item = armed_item_id_;
+    status->last_trigger_time = last_trigger_time_;
+    std::atomic_store(&status_, std::shared_ptr<const ChannelStatus>(std::move(status)));
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include "utils/deadline-queue.h"
+#include "utils/clock.h"
+#include "utils/latency-histogram.h"
+
+class PlaylistManager;
+class MediaController;
+class TimeTrigger;
+class FrameTrigger;
+struct StartLatencyRecord;
+struct JoinRecord;
+struct CommandQueueStats;
+struct ScheduleSnapshot;
+struct TimeSlot;
+
+// Point-in-time view of one channel. Published as an immutable snapshot,
+// never modified after it has been handed out.
+struct ChannelStatus {
+    std::string name;
+    std::string current_item;
+    std::string next_item;
+    std::string armed_item;
+    std::chrono::system_clock::time_point last_trigger_time;    // Epoch until the first trigger
+};
+
+// One line of the as-run log: what actually went on air, and when
+struct AsRunEntry {
+    std::string channel;
+    std::string item_id;
+    std::chrono::system_clock::time_point time;
+};
+
+// Trigger latency of one source on one channel, per stage
+struct LatencyBreakdown {
+    std::string channel;
+    std::string source;
+    StageHistograms stages;
+};
+
+// One independent output channel: its own schedule files, sources and
+// status. Channels do not own a thread; SchedulerCore's event loop arms
+// their deadlines and hands each due deadline back to its channel.
+class Channel {
+public:
+    Channel(const std::string& name, size_t index);
+    ~Channel();
+    
+    // Clock the channel's schedule runs on, set before initialize()
+    void set_clock(std::shared_ptr<Clock> clock);
+    
+    bool initialize();
+    void cleanup();
+    
+    const std::string& get_name() const;
+    size_t get_index() const;
+    
+    // Event loop hooks. A non-zero join_since_ns first joins the slot already
+    // in progress (startup, re-enable), measuring recovery from that instant.
+    // reload_schedules() returns true if the schedule changed; refresh_schedule()
+    // only picks up what the playlist manager published by itself since, such
+    // as durations the media probe found.
+    bool reload_schedules();
+    void refresh_schedule();
+    void arm_deadlines(DeadlineQueue& deadlines, int preroll_seconds, uint64_t join_since_ns = 0);
+    
+    // After a reload: replaces the deadlines of today's slots that have not
+    // started yet, leaving the item on air, and items still in their slot
+    // armed, alone. Nothing happens if the reload did not touch today.
+    void patch_deadlines(DeadlineQueue& deadlines, int preroll_seconds, FrameTrigger& frame_trigger);
+    void handle_deadline(const Deadline& deadline, FrameTrigger& frame_trigger);
+    void on_frame_trigger(const std::string& item_id);
+    
+    // The on-air item's source reached the end of its file. When the next slot
+    // is due within CHAIN_WINDOW it starts right away, back to back, and its
+    // trigger deadline later finds it already on air.
+    void on_media_ended(const std::string& source_name);
+    void disarm_items();
+    
+    // Status information; never blocks behind OBS calls or the scheduler thread
+    std::shared_ptr<const ChannelStatus> get_status_snapshot() const;
+    ChannelStatus get_status() const;
+    std::string get_current_item() const;
+    std::string get_next_item() const;
+    std::string get_arming_state() const;
+    std::vector<StartLatencyRecord> get_start_latency_records() const;
+    std::vector<JoinRecord> get_join_records() const;
+    std::vector<LatencyBreakdown> get_latency_histograms() const;
+    CommandQueueStats get_command_queue_stats() const;
+    
+    // Items that went on air, oldest first (bounded)
+    std::vector<AsRunEntry> get_as_run_log() const;
+    
+    // The channel's compiled schedule; never waits on a reload or the scheduler thread (shared with its time trigger)
+    std::shared_ptr<const ScheduleSnapshot> get_schedule_snapshot() const;
+    
+    // Component access
+    PlaylistManager* get_playlist_manager();
+    MediaController* get_media_controller();
+
+private:
+    void execute_scheduled_item(const std::string& item_id, int64_t wakeup_ns = -1);
+    void arm_scheduled_item(const std::string& item_id);
+    int32_t join_current_slot(DeadlineQueue& deadlines, uint64_t since_ns);
+    void push_slot_deadlines(DeadlineQueue& deadlines, const TimeSlot& slot, int preroll_seconds,
+                             Clock::SteadyTime now);
+    void update_next_item();
+    void mark_on_air(const std::string& item_id);
+    void publish_status();
+    
+    std::string name_;
+    size_t index_;
+    std::shared_ptr<Clock> clock_;
+    
+    std::unique_ptr<PlaylistManager> playlist_manager_;
+    std::unique_ptr<MediaController> media_controller_;
+    std::unique_ptr<TimeTrigger> time_trigger_;
+    
+    // Serializes writers (scheduler thread, video thread). Readers never take
+    // it; they load status_ instead.
+    mutable std::mutex status_mutex_;
+    std::string current_item_id_;
+    std::string next_item_id_;
+    std::string armed_item_id_;
+    std::chrono::system_clock::time_point last_trigger_time_;
+    int32_t chained_slot_ms_;       // Slot started early on a media end, -1 if none
+    
+    // Today's slots the deadlines were armed from, scheduler thread only
+    std::shared_ptr<const std::vector<TimeSlot>> armed_slots_;
+    
+    // Latest published snapshot, swapped with std::atomic_store
+    std::shared_ptr<const ChannelStatus> status_;
+    
+    mutable std::mutex as_run_mutex_;
+    std::vector<AsRunEntry> as_run_;
+    
+    static constexpr size_t MAX_AS_RUN_ENTRIES = 1000;
+    
+    // How long before their slot frame-accurate items are handed to the video tick.
+    // Arming close to the slot keeps wall-clock/monotonic drift out of the target.
+    static constexpr std::chrono::seconds FRAME_ARM_LEAD{2};
+    
+    // A slot less than this far in is still due and fires from the start instead
+    static constexpr std::chrono::seconds JOIN_MIN_ELAPSED{1};
+    
+    // An item ending at most this long before the next slot chains straight into it.
+    // Ending earlier leaves the gap to the slot's own trigger (and idle content).
+    static constexpr std::chrono::seconds CHAIN_WINDOW{2};
+    
+    // Prevent copying
+    Channel(const Channel&) = delete;
+    Channel& operator=(const Channel&) = delete;
+};
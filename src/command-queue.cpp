@@ -0,0 +1,143 @@
+#include "command-queue.h"
+#include "utils/logger.h"
+#include <obs-module.h>
+#include <util/platform.h>
+#include <algorithm>
+
+void CommandBatch::add(const std::string& name, Command command) {
+    commands_.emplace_back(name, std::move(command));
+}
+
+bool CommandBatch::empty() const {
+    return commands_.empty();
+}
+
+size_t CommandBatch::size() const {
+    return commands_.size();
+}
+
+CommandQueue::CommandQueue()
+    : state_(std::make_shared<State>())
+{
+}
+
+CommandQueue::~CommandQueue() {
+    close();
+}
+
+std::future<BatchResult> CommandQueue::submit(const std::string& label, CommandBatch batch) {
+    auto task = std::make_unique<Task>();
+    task->state = state_;
+    task->label = label;
+    task->batch = std::move(batch);
+    task->enqueued_ns = os_gettime_ns();
+    auto future = task->promise.get_future();
+    
+    bool queued_ahead;
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        auto& stats = state_->stats;
+        queued_ahead = stats.depth > 0;
+        stats.submitted++;
+        stats.depth++;
+        stats.max_depth = std::max(stats.max_depth, stats.depth);
+    }
+    
+    if (obs_in_task_thread(OBS_TASK_UI) && !queued_ahead) {
+        // Already where the batch would run, and running it now keeps the order
+        run(*task);
+    } else {
+        obs_queue_task(OBS_TASK_UI, &CommandQueue::run_task, task.release(), false);
+    }
+    
+    return future;
+}
+
+void CommandQueue::close() {
+    // Taking run_mutex waits out a batch that is running right now
+    std::lock_guard<std::mutex> run_lock(state_->run_mutex);
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    state_->closed = true;
+}
+
+size_t CommandQueue::get_depth() const {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return state_->stats.depth;
+}
+
+CommandQueueStats CommandQueue::get_stats() const {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return state_->stats;
+}
+
+std::vector<BatchResult> CommandQueue::get_recent_batches() const {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return state_->recent;
+}
+
+void CommandQueue::run_task(void* param) {
+    std::unique_ptr<Task> task(static_cast<Task*>(param));
+    run(*task);
+}
+
+void CommandQueue::run(Task& task) {
+    auto& state = *task.state;
+    
+    BatchResult result;
+    result.label = task.label;
+    result.enqueued_ns = task.enqueued_ns;
+    
+    {
+        std::lock_guard<std::mutex> run_lock(state.run_mutex);
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            result.executed = !state.closed;
+        }
+        
+        result.started_ns = os_gettime_ns();
+        result.ok = result.executed;
+        
+        if (result.executed) {
+            for (auto& command : task.batch.commands_) {
+                uint64_t start_ns = os_gettime_ns();
+                bool ok = false;
+                try {
+                    ok = command.second();
+                } catch (const std::exception& e) {
+                    LOG_ERROR("Exception in command " + command.first + ": " + std::string(e.what()));
+                }
+                
+                result.commands.push_back(
+                    CommandTiming{command.first, ok, static_cast<int64_t>(os_gettime_ns() - start_ns)});
+                
+                if (!ok) {
+                    result.ok = false;
+                    LOG_WARNING("Command " + command.first + " of batch " + task.label + " failed");
+                }
+            }
+        }
+        
+        result.finished_ns = os_gettime_ns();
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        auto& stats = state.stats;
+        stats.depth--;
+        stats.completed++;
+        
+        if (result.executed) {
+            stats.last_wait_ns = static_cast<int64_t>(result.started_ns - result.enqueued_ns);
+            stats.last_run_ns = static_cast<int64_t>(result.finished_ns - result.started_ns);
+            stats.max_wait_ns = std::max(stats.max_wait_ns, stats.last_wait_ns);
+            stats.max_run_ns = std::max(stats.max_run_ns, stats.last_run_ns);
+            
+            state.recent.push_back(result);
+            if (state.recent.size() > MAX_RECENT_BATCHES) {
+                state.recent.erase(state.recent.begin());
+            }
+        }
+    }
+    
+    task.promise.set_value(std::move(result));
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <future>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+
+// Timing of one command within a batch
+struct CommandTiming {
+    std::string name;
+    bool ok;
+    int64_t duration_ns;
+};
+
+// Outcome of a batch, delivered through the future returned by submit()
+struct BatchResult {
+    std::string label;
+    bool ok;                // Every command succeeded
+    bool executed;          // False when the queue was closed before the batch ran
+    uint64_t enqueued_ns;   // os_gettime_ns() at submit()
+    uint64_t started_ns;    // When OBS started running the batch
+    uint64_t finished_ns;
+    std::vector<CommandTiming> commands;
+    
+    BatchResult() : ok(false), executed(false), enqueued_ns(0), started_ns(0), finished_ns(0) {}
+};
+
+// Queue health, readable from any thread
+struct CommandQueueStats {
+    size_t depth;               // Batches submitted but not finished
+    size_t max_depth;
+    size_t submitted;
+    size_t completed;
+    int64_t last_wait_ns;       // Submit to start of the latest batch
+    int64_t max_wait_ns;
+    int64_t last_run_ns;        // Execution time of the latest batch
+    int64_t max_run_ns;
+    
+    CommandQueueStats()
+        : depth(0), max_depth(0), submitted(0), completed(0)
+        , last_wait_ns(0), max_wait_ns(0), last_run_ns(0), max_run_ns(0) {}
+};
+
+// The OBS operations making up one trigger, run in order. A failing command
+// is reported but does not stop the ones after it.
+class CommandBatch {
+public:
+    using Command = std::function<bool()>;
+    
+    void add(const std::string& name, Command command);
+    bool empty() const;
+    size_t size() const;
+
+private:
+    friend class CommandQueue;
+    std::vector<std::pair<std::string, Command>> commands_;
+};
+
+// Runs command batches on the OBS UI thread via obs_queue_task, so the
+// scheduler thread never waits on OBS. A batch submitted on the UI thread
+// runs inline when nothing is queued ahead of it. Batches submitted from the
+// graphics thread (the video tick) are queued like any other: they may switch
+// scenes or load files, which must not run on, nor block, the render thread.
+// Work that has to land on a frame is done by the caller on the tick itself.
+class CommandQueue {
+public:
+    CommandQueue();
+    ~CommandQueue();
+    
+    std::future<BatchResult> submit(const std::string& label, CommandBatch batch);
+    
+    // Stops accepting and running batches. Waits for a batch that is already
+    // running; batches still queued in OBS complete with executed == false.
+    void close();
+    
+    // Status
+    size_t get_depth() const;
+    CommandQueueStats get_stats() const;
+    std::vector<BatchResult> get_recent_batches() const;
+
+private:
+    // Outlives the queue so tasks still queued in OBS can find out it closed
+    struct State {
+        std::mutex mutex;           // Guards the fields below
+        std::mutex run_mutex;       // Held while a batch runs
+        bool closed = false;
+        CommandQueueStats stats;
+        std::vector<BatchResult> recent;
+    };
+    
+    struct Task {
+        std::shared_ptr<State> state;
+        std::string label;
+        CommandBatch batch;
+        uint64_t enqueued_ns;
+        std::promise<BatchResult> promise;
+    };
+    
+    static void run_task(void* param);
+    static void run(Task& task);
+    
+    std::shared_ptr<State> state_;
+    
+    static constexpr size_t MAX_RECENT_BATCHES = 100;
+    
+    // Prevent copying
+    CommandQueue(const CommandQueue&) = delete;
+    CommandQueue& operator=(const CommandQueue&) = delete;
+};
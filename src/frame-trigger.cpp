@@ -0,0 +1,151 @@
+#include "frame-trigger.h"
+#include "utils/logger.h"
+#include <obs-module.h>
+#include <util/platform.h>
+#include <algorithm>
+
+FrameTrigger::FrameTrigger()
+    : clock_(Clock::system())
+    , registered_(false)
+{
+}
+
+FrameTrigger::~FrameTrigger() {
+    cleanup();
+}
+
+bool FrameTrigger::initialize(FireCallback callback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    LOG_INFO("Initializing frame trigger");
+    
+    fire_callback_ = callback;
+    
+    if (!registered_) {
+        obs_add_tick_callback(&FrameTrigger::tick_callback, this);
+        registered_ = true;
+    }
+    
+    return true;
+}
+
+void FrameTrigger::cleanup() {
+    bool was_registered;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        was_registered = registered_;
+        registered_ = false;
+        armed_.clear();
+    }
+    
+    // Must not hold mutex_ here, the video thread may be inside on_tick()
+    if (was_registered) {
+        obs_remove_tick_callback(&FrameTrigger::tick_callback, this);
+        LOG_INFO("Frame trigger cleaned up");
+    }
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    fire_callback_ = nullptr;
+}
+
+void FrameTrigger::set_clock(std::shared_ptr<Clock> clock) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    clock_ = clock ? clock : Clock::system();
+}
+
+void FrameTrigger::arm(size_t channel, const std::string& item_id, std::chrono::system_clock::time_point when) {
+    // Translate the wall-clock instant onto the monotonic clock video frames are stamped with
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    auto offset = std::chrono::duration_cast<std::chrono::nanoseconds>(when - clock_->now()).count();
+    uint64_t now_ns = os_gettime_ns();
+    uint64_t target_ns = offset > 0 ? now_ns + static_cast<uint64_t>(offset) : now_ns;
+    
+    armed_.erase(std::remove_if(armed_.begin(), armed_.end(), [&](const ArmedItem& armed) {
+        return armed.channel == channel && armed.item_id == item_id;
+    }), armed_.end());
+    
+    ArmedItem armed{channel, item_id, target_ns};
+    armed_.insert(std::upper_bound(armed_.begin(), armed_.end(), armed), armed);
+    
+    LOG_DEBUG("Frame trigger armed for item " + item_id + " in " +
+              std::to_string(offset / 1000000) + "ms");
+}
+
+void FrameTrigger::disarm(size_t channel, const std::string& item_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    armed_.erase(std::remove_if(armed_.begin(), armed_.end(), [&](const ArmedItem& armed) {
+        return armed.channel == channel && armed.item_id == item_id;
+    }), armed_.end());
+}
+
+void FrameTrigger::disarm_all() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    armed_.clear();
+}
+
+size_t FrameTrigger::get_armed_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return armed_.size();
+}
+
+std::vector<FrameTriggerRecord> FrameTrigger::get_records() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return records_;
+}
+
+void FrameTrigger::tick_callback(void* data, float seconds) {
+    UNUSED_PARAMETER(seconds);
+    static_cast<FrameTrigger*>(data)->on_tick();
+}
+
+void FrameTrigger::on_tick() {
+    uint64_t frame_ns = obs_get_video_frame_time();
+    
+    std::vector<FrameTriggerRecord> fired;
+    FireCallback callback;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        
+        // Cheap check on every frame: only the earliest target matters
+        if (armed_.empty() || armed_.front().target_ns > frame_ns) {
+            return;
+        }
+        
+        double frames_per_ns = 0.0;
+        obs_video_info ovi;
+        if (obs_get_video_info(&ovi) && ovi.fps_den > 0) {
+            frames_per_ns = static_cast<double>(ovi.fps_num) / (ovi.fps_den * 1000000000.0);
+        }
+        
+        auto end = std::upper_bound(armed_.begin(), armed_.end(), ArmedItem{0, "", frame_ns});
+        for (auto it = armed_.begin(); it != end; ++it) {
+            FrameTriggerRecord record;
+            record.channel = it->channel;
+            record.item_id = it->item_id;
+            record.target_ns = it->target_ns;
+            record.frame_ns = frame_ns;
+            record.offset_ns = static_cast<int64_t>(frame_ns - it->target_ns);
+            record.offset_frames = record.offset_ns * frames_per_ns;
+            fired.push_back(record);
+        }
+        armed_.erase(armed_.begin(), end);
+        
+        records_.insert(records_.end(), fired.begin(), fired.end());
+        if (records_.size() > MAX_RECORDS) {
+            records_.erase(records_.begin(), records_.end() - MAX_RECORDS);
+        }
+        
+        callback = fire_callback_;
+    }
+    
+    for (const auto& record : fired) {
+        LOG_DEBUG("Frame trigger fired item " + record.item_id + " " +
+                  std::to_string(record.offset_ns / 1000) + "us after its instant (" +
+                  std::to_string(record.offset_frames) + " frames)");
+        
+        if (callback) {
+            callback(record.channel, record.item_id);
+        }
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <mutex>
+#include <functional>
+#include <cstdint>
+#include <memory>
+#include "utils/clock.h"
+
+// Outcome of a single frame-aligned trigger
+struct FrameTriggerRecord {
+    size_t channel;         // Index of the channel the item belongs to
+    std::string item_id;
+    uint64_t target_ns;     // Scheduled instant on the OBS clock (os_gettime_ns)
+    uint64_t frame_ns;      // Timestamp of the video frame the item fired on
+    int64_t offset_ns;      // frame_ns - target_ns
+    double offset_frames;   // Offset expressed in frames at the current video rate
+};
+
+// Fires armed items from the OBS video tick, on the first frame whose
+// timestamp reaches the scheduled instant.
+class FrameTrigger {
+public:
+    using FireCallback = std::function<void(size_t channel, const std::string& item_id)>;
+    
+    FrameTrigger();
+    ~FrameTrigger();
+    
+    bool initialize(FireCallback callback);
+    void cleanup();
+    
+    // Clock the armed wall-clock instants are read against
+    void set_clock(std::shared_ptr<Clock> clock);
+    
+    // Arm an item for the given wall-clock instant, replacing an earlier arm of it
+    void arm(size_t channel, const std::string& item_id, std::chrono::system_clock::time_point when);
+    void disarm(size_t channel, const std::string& item_id);
+    void disarm_all();
+    
+    // Status
+    size_t get_armed_count() const;
+    std::vector<FrameTriggerRecord> get_records() const;
+
+private:
+    struct ArmedItem {
+        size_t channel;
+        std::string item_id;
+        uint64_t target_ns;
+        
+        bool operator<(const ArmedItem& other) const {
+            return target_ns < other.target_ns;
+        }
+    };
+    
+    static void tick_callback(void* data, float seconds);
+    void on_tick();
+    
+    mutable std::mutex mutex_;
+    std::vector<ArmedItem> armed_;              // Sorted by target_ns
+    std::vector<FrameTriggerRecord> records_;
+    FireCallback fire_callback_;
+    std::shared_ptr<Clock> clock_;
+    bool registered_;
+    
+    static constexpr size_t MAX_RECORDS = 1000;
+    
+    // Prevent copying
+    FrameTrigger(const FrameTrigger&) = delete;
+    FrameTrigger& operator=(const FrameTrigger&) = delete;
+};
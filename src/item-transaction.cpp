@@ -0,0 +1,253 @@
+#include "item-transaction.h"
+#include "utils/logger.h"
+#include <obs-frontend-api.h>
+#include <util/platform.h>
+#include <chrono>
+#include <thread>
+
+ItemTransaction::ItemTransaction(SceneItemIndex& scene_items)
+    : scene_items_(scene_items)
+    , scene_(nullptr)
+    , expected_window_ns_(0)
+    , previous_scene_(nullptr)
+    , target_(nullptr)
+    , target_source_(nullptr)
+    , files_applied_(0)
+    , visibility_applied_(false)
+    , scene_switched_(false)
+    , plays_applied_(0)
+    , committed_(false)
+    , rolled_back_(false)
+    , frame_span_(-1)
+    , window_ns_(-1)
+{
+}
+
+ItemTransaction::~ItemTransaction() {
+    release_references();
+}
+
+void ItemTransaction::set_scene(obs_scene_t* scene) {
+    scene_ = scene;
+}
+
+void ItemTransaction::set_visible(const std::string& source_name, bool visible) {
+    visibility_.emplace_back(source_name, visible);
+}
+
+void ItemTransaction::load_file(obs_source_t* source, const std::string& file_path) {
+    files_.push_back(FileChange{source, file_path, nullptr, ""});
+}
+
+void ItemTransaction::play(obs_source_t* source) {
+    plays_.push_back(PlayChange{source, OBS_MEDIA_STATE_NONE});
+}
+
+void ItemTransaction::set_expected_window(int64_t window_ns) {
+    expected_window_ns_ = window_ns;
+}
+
+bool ItemTransaction::commit() {
+    if (committed_) {
+        return frame_span_ >= 0;
+    }
+    committed_ = true;
+    
+    bool ok = snapshot() && apply();
+    release_references();
+    return ok;
+}
+
+bool ItemTransaction::is_committed() const {
+    return committed_;
+}
+
+bool ItemTransaction::is_rolled_back() const {
+    return rolled_back_;
+}
+
+const std::string& ItemTransaction::get_error() const {
+    return error_;
+}
+
+int64_t ItemTransaction::get_frame_span() const {
+    return frame_span_;
+}
+
+int64_t ItemTransaction::get_window_ns() const {
+    return window_ns_;
+}
+
+bool ItemTransaction::snapshot() {
+    previous_scene_ = obs_frontend_get_current_scene();
+    target_ = scene_ ? scene_ : obs_scene_from_source(previous_scene_);
+    target_source_ = scene_ ? obs_scene_get_source(scene_) : nullptr;
+    if (!target_ && !visibility_.empty()) {
+        return fail("No scene to show the sources in");
+    }
+    
+    for (const auto& change : visibility_) {
+        bool found = false;
+        bool visible = scene_items_.is_visible(target_, change.first, &found);
+        if (!found) {
+            return fail("Source not found in scene: " + change.first);
+        }
+        previous_visibility_.emplace_back(change.first, visible);
+    }
+    
+    for (auto& file : files_) {
+        file.settings = obs_source_get_settings(file.source);
+        if (!file.settings) {
+            return fail("Failed to get settings for media file: " + file.file_path);
+        }
+        const char* previous = obs_data_get_string(file.settings, "file");
+        file.previous = previous ? previous : "";
+    }
+    
+    for (auto& play : plays_) {
+        play.previous = obs_source_media_get_state(play.source);
+    }
+    return true;
+}
+
+bool ItemTransaction::apply() {
+    wait_for_frame_room();
+    uint64_t first_ns = os_gettime_ns();
+    uint32_t first_frame = obs_get_total_frames();
+    
+    // Prepare the target scene, still off air when it is about to be switched to
+    for (auto& file : files_) {
+        obs_data_set_string(file.settings, "file", file.file_path.c_str());
+        obs_source_update(file.source, file.settings);
+        files_applied_++;
+    }
+    
+    if (!visibility_.empty()) {
+        visibility_applied_ = true;
+        if (scene_items_.set_visible(target_, visibility_) < visibility_.size()) {
+            return fail("Sources left the scene before they could be shown");
+        }
+    }
+    
+    // Go live, the switch and the playback calls back to back
+    if (target_source_ && target_source_ != previous_scene_) {
+        obs_frontend_set_current_scene(target_source_);
+        scene_switched_ = true;
+    }
+    
+    for (const auto& play : plays_) {
+        obs_source_media_play_pause(play.source, false);
+        plays_applied_++;
+    }
+    
+    uint32_t last_frame = obs_get_total_frames();
+    uint64_t last_ns = os_gettime_ns();
+    
+    // In studio mode the frontend only changes the preview
+    if (scene_switched_) {
+        obs_source_t* current = obs_frontend_get_current_scene();
+        obs_source_release(current);
+        if (current != target_source_) {
+            return fail("Scene switch did not take effect");
+        }
+    }
+    
+    frame_span_ = static_cast<int64_t>(last_frame - first_frame);
+    window_ns_ = static_cast<int64_t>(last_ns - first_ns);
+    return true;
+}
+
+void ItemTransaction::wait_for_frame_room() const {
+    // On the graphics thread no frame renders until the commit returns
+    if (expected_window_ns_ <= 0 || obs_in_task_thread(OBS_TASK_GRAPHICS)) {
+        return;
+    }
+    
+    obs_video_info ovi;
+    if (!obs_get_video_info(&ovi) || ovi.fps_num == 0) {
+        return;
+    }
+    uint64_t interval_ns = 1000000000ULL * ovi.fps_den / ovi.fps_num;
+    
+    // Changes that take most of a frame would not fit between two anyway
+    if (static_cast<uint64_t>(expected_window_ns_) > interval_ns / 2) {
+        return;
+    }
+    
+    // Nothing to wait for when the changes fit before the next frame, or
+    // when no frame has been rendered for a while
+    uint64_t now_ns = os_gettime_ns();
+    uint64_t next_frame_ns = obs_get_video_frame_time() + interval_ns;
+    if (now_ns + static_cast<uint64_t>(expected_window_ns_) < next_frame_ns ||
+        now_ns > next_frame_ns + interval_ns) {
+        return;
+    }
+    
+    // Start right behind the next frame instead, waiting at most one frame
+    uint32_t frame = obs_get_total_frames();
+    auto give_up = std::chrono::steady_clock::now() + std::chrono::nanoseconds(interval_ns);
+    while (obs_get_total_frames() == frame && std::chrono::steady_clock::now() < give_up) {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+}
+
+void ItemTransaction::rollback() {
+    if (!files_applied_ && !visibility_applied_ && !scene_switched_ && !plays_applied_) {
+        return;
+    }
+    
+    while (plays_applied_ > 0) {
+        plays_applied_--;
+        restore_playback(plays_[plays_applied_].source, plays_[plays_applied_].previous);
+    }
+    
+    if (scene_switched_ && previous_scene_) {
+        obs_frontend_set_current_scene(previous_scene_);
+    }
+    scene_switched_ = false;
+    
+    if (visibility_applied_) {
+        scene_items_.set_visible(target_, previous_visibility_);
+        visibility_applied_ = false;
+    }
+    
+    // The previous file reopens from its start
+    while (files_applied_ > 0) {
+        files_applied_--;
+        FileChange& file = files_[files_applied_];
+        obs_data_set_string(file.settings, "file", file.previous.c_str());
+        obs_source_update(file.source, file.settings);
+    }
+    
+    rolled_back_ = true;
+    LOG_WARNING("Rolled back item changes: " + error_);
+}
+
+bool ItemTransaction::fail(const std::string& error) {
+    error_ = error;
+    rollback();
+    return false;
+}
+
+void ItemTransaction::release_references() {
+    for (auto& file : files_) {
+        obs_data_release(file.settings);
+        file.settings = nullptr;
+    }
+    obs_source_release(previous_scene_);
+    previous_scene_ = nullptr;
+}
+
+void ItemTransaction::restore_playback(obs_source_t* source, obs_media_state state) {
+    switch (state) {
+    case OBS_MEDIA_STATE_PLAYING:
+        obs_source_media_play_pause(source, false);
+        break;
+    case OBS_MEDIA_STATE_PAUSED:
+        obs_source_media_play_pause(source, true);
+        break;
+    default:
+        obs_source_media_stop(source);
+        break;
+    }
+}
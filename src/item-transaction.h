@@ -0,0 +1,95 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <obs-module.h>
+#include "scene-item-index.h"
+
+// The scene, visibility, file and playback changes that put one item on air,
+// collected first and applied together by commit() on the UI thread. Every
+// lookup and every value needed to undo a change is read before the first
+// change goes out. The target scene is prepared (files loaded, items shown
+// or hidden in one atomic update) while it is still off air, and only then
+// switched to and the media started, so the visible changes land back to
+// back. If a step fails, the steps already applied are undone in reverse.
+// Sources and scenes are borrowed, as the registry hands them out.
+class ItemTransaction {
+public:
+    explicit ItemTransaction(SceneItemIndex& scene_items);
+    ~ItemTransaction();
+    
+    // The scene the item goes on air in, switched to unless it already is.
+    // Without one, the changes apply to whatever scene is current.
+    void set_scene(obs_scene_t* scene);
+    void set_visible(const std::string& source_name, bool visible);
+    void load_file(obs_source_t* source, const std::string& file_path);
+    void play(obs_source_t* source);
+    
+    // How long the changes are expected to take. A commit that would run into
+    // the next frame waits for that frame to go out first, so the changes
+    // land between two frames. 0 (the default) never waits.
+    void set_expected_window(int64_t window_ns);
+    
+    // Applies the changes once; false (after rolling back) if any step failed
+    bool commit();
+    
+    bool is_committed() const;
+    bool is_rolled_back() const;
+    const std::string& get_error() const;
+    
+    // Frames rendered between the first and the last change, and the time
+    // the changes took, -1 unless committed
+    int64_t get_frame_span() const;
+    int64_t get_window_ns() const;
+
+private:
+    struct FileChange {
+        obs_source_t* source;
+        std::string file_path;
+        obs_data_t* settings;       // Held from snapshot to apply
+        std::string previous;
+    };
+    
+    struct PlayChange {
+        obs_source_t* source;
+        obs_media_state previous;
+    };
+    
+    bool snapshot();
+    bool apply();
+    void wait_for_frame_room() const;
+    void rollback();
+    bool fail(const std::string& error);
+    void release_references();
+    static void restore_playback(obs_source_t* source, obs_media_state state);
+    
+    SceneItemIndex& scene_items_;
+    obs_scene_t* scene_;
+    std::vector<SceneItemIndex::VisibilityChange> visibility_;
+    std::vector<FileChange> files_;
+    std::vector<PlayChange> plays_;
+    int64_t expected_window_ns_;
+    
+    // Read by snapshot(): where the changes go, and what a rollback returns to
+    obs_source_t* previous_scene_;      // Referenced until commit() returns
+    obs_scene_t* target_;               // Where the visibility changes go
+    obs_source_t* target_source_;       // Switched to, nullptr to stay
+    std::vector<SceneItemIndex::VisibilityChange> previous_visibility_;
+    
+    // How far commit() got
+    size_t files_applied_;
+    bool visibility_applied_;
+    bool scene_switched_;
+    size_t plays_applied_;
+    
+    bool committed_;
+    bool rolled_back_;
+    std::string error_;
+    int64_t frame_span_;
+    int64_t window_ns_;
+    
+    // Prevent copying
+    ItemTransaction(const ItemTransaction&) = delete;
+    ItemTransaction& operator=(const ItemTransaction&) = delete;
+};
@@ -1,16 +1,23 @@
 #include "media-controller.h"
+#include "item-transaction.h"
 #include "playlist-manager.h"
 #include "utils/config.h"
 #include "utils/logger.h"
 #include <obs-module.h>
 #include <obs-frontend-api.h>
 #include <util/dstr.h>
+#include <util/platform.h>
 #include <filesystem>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 
 MediaController::MediaController()
     : auto_switch_scenes_(true)
     , fade_transitions_(true)
     , transition_duration_ms_(500)
+    , tick_registered_(false)
+    , apply_window_ns_(0)
 {
 }
 
@@ -30,9 +37,18 @@ bool MediaController::initialize() {
             default_idle_content_ = auto_schedule_files_[0].path;
         }
         
-        // Refresh source and scene lists
-        refresh_source_list();
-        refresh_scene_list();
+        // List sources and scenes, then follow OBS adding, removing and renaming them
+        registry_.set_removed_callback([this](obs_source_t* source) {
+            disconnect_media_signals(source);
+            scene_items_.forget(obs_scene_from_source(source));
+        });
+        registry_.start();
+        scene_items_.start();
+        
+        if (!tick_registered_) {
+            obs_add_tick_callback(&MediaController::first_frame_tick, this);
+            tick_registered_ = true;
+        }
         
         LOG_INFO("Media controller initialized successfully");
         return true;
@@ -44,25 +60,52 @@ bool MediaController::initialize() {
 }
 
 void MediaController::cleanup() {
-    std::lock_guard<std::mutex> lock(mutex_);
+    // Media signals still in flight find nobody to report to
+    {
+        std::lock_guard<std::mutex> event_lock(event_mutex_);
+        media_event_callback_ = nullptr;
+    }
+    
+    // Queued batches capture this controller and raw source pointers
+    command_queue_.close();
     
-    // Release source references
-    for (auto& pair : media_sources_) {
-        if (pair.second) {
-            obs_source_release(pair.second);
+    if (tick_registered_) {
+        obs_remove_tick_callback(&MediaController::first_frame_tick, this);
+        tick_registered_ = false;
+    }
+    
+    {
+        std::lock_guard<std::mutex> probe_lock(probe_mutex_);
+        first_frame_probes_.clear();
+        
+        for (const auto& probe : join_probes_) {
+            if (probe.held->exchange(false)) {
+                obs_source_dec_showing(probe.source);
+            }
         }
+        join_probes_.clear();
+        joining_sources_.clear();
     }
-    media_sources_.clear();
     
-    // Release scene references
-    for (auto& pair : scenes_) {
-        if (pair.second) {
-            obs_scene_release(pair.second);
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    // Drop the showing references held by pre-rolled items
+    for (auto& pair : armed_items_) {
+        if (*pair.second.held) {
+            obs_source_dec_showing(pair.second.source);
         }
     }
-    scenes_.clear();
+    armed_items_.clear();
     
-    media_event_callback_ = nullptr;
+    {
+        std::lock_guard<std::mutex> twin_lock(twin_mutex_);
+        live_twins_.clear();
+    }
+    
+    // The registry and item index hold no references, only their signal connections go
+    scene_items_.stop();
+    registry_.stop();
+    disconnect_media_signals();
     
     LOG_INFO("Media controller cleaned up");
 }
@@ -208,6 +251,15 @@ std::string MediaController::get_current_scene() const {
 }
 
 bool MediaController::set_source_visibility(const std::string& source_name, bool visible) {
+    if (!set_sources_visibility({{source_name, visible}})) {
+        return false;
+    }
+    
+    LOG_INFO("Set source visibility: " + source_name + " -> " + (visible ? "visible" : "hidden"));
+    return true;
+}
+
+bool MediaController::set_sources_visibility(const std::vector<SceneItemIndex::VisibilityChange>& changes) {
     std::lock_guard<std::mutex> lock(mutex_);
     
     try {
@@ -225,28 +277,22 @@ bool MediaController::set_source_visibility(const std::string& source_name, bool
             return false;
         }
         
-        // Find the scene item
-        obs_sceneitem_t* item = get_scene_item(current_scene, source_name);
-        if (!item) {
-            obs_scene_release(current_scene);
-            obs_source_release(current_scene_source);
-            LOG_ERROR("Source not found in current scene: " + source_name);
-            return false;
-        }
-        
-        // Set visibility
-        obs_sceneitem_set_visible(item, visible);
-        
-        // Cleanup
-        obs_sceneitem_release(item);
-        obs_scene_release(current_scene);
+        // Every change in one atomic update
+        size_t applied = scene_items_.set_visible(current_scene, changes);
         obs_source_release(current_scene_source);
         
-        LOG_INFO("Set source visibility: " + source_name + " -> " + (visible ? "visible" : "hidden"));
+        if (applied < changes.size()) {
+            for (const auto& change : changes) {
+                if (!scene_items_.find(current_scene, change.first)) {
+                    LOG_ERROR("Source not found in current scene: " + change.first);
+                }
+            }
+            return false;
+        }
         return true;
         
     } catch (const std::exception& e) {
-        LOG_ERROR("Exception setting source visibility for " + source_name + ": " + std::string(e.what()));
+        LOG_ERROR("Exception setting source visibility: " + std::string(e.what()));
         return false;
     }
 }
@@ -260,68 +306,465 @@ bool MediaController::get_source_visibility(const std::string& source_name) cons
     }
     
     obs_scene_t* current_scene = obs_scene_from_source(current_scene_source);
-    if (!current_scene) {
-        obs_source_release(current_scene_source);
-        return false;
+    bool visible = current_scene && scene_items_.is_visible(current_scene, source_name);
+    
+    obs_source_release(current_scene_source);
+    return visible;
+}
+
+std::future<BatchResult> MediaController::execute_item_async(const ScheduledItem& item, int64_t wakeup_ns) {
+    LOG_INFO("Executing scheduled item: " + item.name);
+    
+    // A pre-rolled item only needs to be unpaused and revealed
+    if (is_item_armed(item.id)) {
+        return fire_armed_item_async(item, wakeup_ns);
     }
     
-    obs_sceneitem_t* item = get_scene_item(current_scene, source_name);
-    if (!item) {
-        obs_scene_release(current_scene);
-        obs_source_release(current_scene_source);
-        return false;
+    uint64_t trigger_ns = os_gettime_ns();
+    
+    if (obs_in_task_thread(OBS_TASK_GRAPHICS)) {
+        LOG_WARNING("Item " + item.name + " was not pre-rolled, it starts from the UI thread after its frame");
     }
     
-    bool visible = obs_sceneitem_visible(item);
+    // Resolve everything up front, the commands themselves never touch mutex_
+    PlayoutTarget target;
+    obs_scene_t* scene = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!item.scene.empty()) {
+            scene = get_scene(item.scene);
+        }
+        target = resolve_playout_target(item.source, scene);
+    }
+    obs_source_t* source = target.source;
     
-    obs_sceneitem_release(item);
-    obs_scene_release(current_scene);
-    obs_source_release(current_scene_source);
+    if (!item.scene.empty() && !scene) {
+        LOG_WARNING("Failed to switch to scene: " + item.scene);
+    }
     
-    return visible;
+    // Shown in the scene that goes on air, loaded and started together with the switch
+    auto transaction = std::make_shared<ItemTransaction>(scene_items_);
+    transaction->set_scene(scene);
+    if (source) {
+        transaction->set_visible(target.name, true);
+        if (target.previous) {
+            transaction->set_visible(target.previous_name, false);
+        }
+        if (!item.file_path.empty()) {
+            transaction->load_file(source, item.file_path);
+        }
+        transaction->play(source);
+    }
+    
+    CommandBatch batch;
+    batch.add("apply", [this, transaction]() {
+        return commit_transaction(*transaction);
+    });
+    
+    if (target.previous) {
+        // Later batches already load into the other one of the pair
+        set_live_twin(item.source, target.name);
+        std::string source_name = item.source;
+        batch.add("swap", [this, source_name, target, transaction]() {
+            swap_twins(source_name, target, transaction->get_frame_span() >= 0);
+            return transaction->get_frame_span() >= 0;
+        });
+    }
+    
+    if (source) {
+        std::string item_id = item.id;
+        std::string source_name = item.source;
+        batch.add("probe", [this, item_id, source_name, source, trigger_ns, wakeup_ns, transaction]() {
+            if (transaction->get_frame_span() < 0) {
+                return false;
+            }
+            begin_first_frame_probe(item_id, source_name, source, trigger_ns, wakeup_ns, false,
+                                    transaction->get_frame_span());
+            return true;
+        });
+    }
+    
+    auto result = command_queue_.submit("execute " + item.name, std::move(batch));
+    
+    if (!source) {
+        // The scene switch still goes out, but there is nothing to play
+        LOG_ERROR("Media source not found: " + item.source);
+        return std::future<BatchResult>();
+    }
+    
+    return result;
 }
 
-bool MediaController::execute_item(const ScheduledItem& item) {
-    LOG_INFO("Executing scheduled item: " + item.name);
+bool MediaController::execute_item(const ScheduledItem& item, int64_t wakeup_ns) {
+    try {
+        return execute_item_async(item, wakeup_ns).valid();
+        
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception executing scheduled item " + item.name + ": " + std::string(e.what()));
+        return false;
+    }
+}
+
+bool MediaController::arm_item(const ScheduledItem& item) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    if (armed_items_.count(item.id)) {
+        return true;
+    }
+    
+    // One pre-rolled file per source, a second one would replace the first.
+    // With a pair, that is the one of the two that is hidden.
+    for (const auto& pair : armed_items_) {
+        if (pair.second.source_name == item.source || pair.second.previous_name == item.source) {
+            LOG_DEBUG("Source " + item.source + " already holds a pre-rolled item, skipping " + item.name);
+            return false;
+        }
+    }
     
     try {
-        // Switch scene if specified
-        if (!item.scene.empty()) {
-            if (!switch_to_scene(item.scene)) {
-                LOG_WARNING("Failed to switch to scene: " + item.scene);
-            }
+        obs_scene_t* scene = item.scene.empty() ? nullptr : get_scene(item.scene);
+        PlayoutTarget target = resolve_playout_target(item.source, scene);
+        obs_source_t* source = target.source;
+        if (!source) {
+            LOG_ERROR("Media source not found for pre-roll: " + item.source);
+            return false;
         }
         
-        // Set source visibility if needed
-        if (!item.source.empty()) {
-            // First, make sure the source is visible
-            if (!set_source_visibility(item.source, true)) {
-                LOG_WARNING("Failed to set source visibility: " + item.source);
-            }
+        if (!item.scene.empty() && !scene) {
+            LOG_WARNING("Failed to hide source for pre-roll: " + item.source);
+        }
+        
+        // Whatever plays there, idle content or a joined item the channel
+        // has not taken as current yet, would be hidden and replaced
+        if (is_source_on_air(source, target.name)) {
+            LOG_DEBUG("Source " + target.name + " is on air, not pre-rolling " + item.name);
+            return false;
+        }
+        
+        CommandBatch batch;
+        
+        // Hide first so the viewer never sees the new file's first frame early
+        std::string source_name = target.name;
+        if (item.scene.empty() || scene) {
+            batch.add("hide_source", [this, scene, source_name]() {
+                return set_scene_item_visible(scene, source_name, false);
+            });
         }
         
-        // Play the media
         if (!item.file_path.empty()) {
-            if (!play_media(item.source, item.file_path)) {
-                LOG_ERROR("Failed to play media: " + item.file_path);
+            std::string file_path = item.file_path;
+            batch.add("load_file", [source, file_path]() {
+                return set_media_file(source, file_path);
+            });
+        }
+        
+        // Hold the file on its first frame and keep the source showing so
+        // the decoder stays open and warm while the scene item is hidden
+        auto held = std::make_shared<std::atomic<bool>>(false);
+        batch.add("hold", [source, held]() {
+            obs_source_media_play_pause(source, true);
+            obs_source_inc_showing(source);
+            *held = true;
+            return true;
+        });
+        
+        // Queued batches run in order, so the fire batch always finds the hold in place
+        armed_items_[item.id] = ArmedItem{target.name, source, held, target.previous_name, target.previous};
+        command_queue_.submit("arm " + item.name, std::move(batch));
+        
+        LOG_INFO("Armed item " + item.name + " on source " + target.name);
+        return true;
+        
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception arming item " + item.name + ": " + std::string(e.what()));
+        return false;
+    }
+}
+
+std::future<BatchResult> MediaController::fire_armed_item_async(const ScheduledItem& item, int64_t wakeup_ns) {
+    uint64_t trigger_ns = os_gettime_ns();
+    obs_source_t* source = nullptr;
+    obs_scene_t* target_scene = nullptr;
+    PlayoutTarget target;
+    std::shared_ptr<std::atomic<bool>> held;
+    
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        
+        auto it = armed_items_.find(item.id);
+        if (it == armed_items_.end()) {
+            return std::future<BatchResult>();
+        }
+        
+        source = it->second.source;
+        target = PlayoutTarget{it->second.source_name, source, it->second.previous_name, it->second.previous};
+        held = it->second.held;
+        if (!item.scene.empty()) {
+            target_scene = get_scene(item.scene);
+        }
+        
+        armed_items_.erase(it);
+    }
+    
+    if (!target_scene && !item.scene.empty()) {
+        LOG_WARNING("Failed to switch to scene: " + item.scene);
+    }
+    
+    // A frame trigger fires from the video tick. Once the hold is in place
+    // only the reveal and the unpause are left, and those land on this frame.
+    if (obs_in_task_thread(OBS_TASK_GRAPHICS) && *held) {
+        return fire_on_frame(item, target, target_scene, held, trigger_ns, wakeup_ns);
+    }
+    
+    // Reveal in the target scene before switching to it, so the switch
+    // lands on a scene that is already showing the item. The other one of a
+    // pair goes off air in the same update.
+    auto transaction = std::make_shared<ItemTransaction>(scene_items_);
+    transaction->set_scene(target_scene);
+    transaction->set_visible(target.name, true);
+    if (target.previous) {
+        transaction->set_visible(target.previous_name, false);
+    }
+    transaction->play(source);
+    
+    CommandBatch batch;
+    batch.add("apply", [this, transaction]() {
+        return commit_transaction(*transaction);
+    });
+    
+    std::string source_name = item.source;
+    if (target.previous) {
+        set_live_twin(source_name, target.name);
+        batch.add("swap", [this, source_name, target, transaction]() {
+            swap_twins(source_name, target, transaction->get_frame_span() >= 0);
+            return transaction->get_frame_span() >= 0;
+        });
+    }
+    
+    batch.add("release_hold", [source, held]() {
+        if (held->exchange(false)) {
+            obs_source_dec_showing(source);
+        }
+        return true;
+    });
+    
+    std::string item_id = item.id;
+    batch.add("probe", [this, item_id, source_name, source, trigger_ns, wakeup_ns, transaction]() {
+        if (transaction->get_frame_span() < 0) {
+            return false;
+        }
+        begin_first_frame_probe(item_id, source_name, source, trigger_ns, wakeup_ns, true,
+                                transaction->get_frame_span());
+        return true;
+    });
+    
+    LOG_INFO("Fired pre-rolled item: " + item.name);
+    return command_queue_.submit("fire " + item.name, std::move(batch));
+}
+
+std::future<BatchResult> MediaController::fire_on_frame(const ScheduledItem& item, const PlayoutTarget& target,
+                                                        obs_scene_t* scene,
+                                                        const std::shared_ptr<std::atomic<bool>>& held,
+                                                        uint64_t trigger_ns, int64_t wakeup_ns) {
+    // Runs on the video thread: nothing here may wait on the UI thread
+    std::vector<SceneItemIndex::VisibilityChange> changes{{target.name, true}};
+    if (target.previous) {
+        changes.emplace_back(target.previous_name, false);
+    }
+    
+    uint32_t reveal_frame = obs_get_total_frames();
+    bool revealed = set_scene_items_visible(scene, changes);
+    if (revealed) {
+        obs_source_media_play_pause(target.source, false);
+    } else {
+        LOG_ERROR("Failed to reveal item " + item.name + " on its frame: " + target.name + " is not in the scene");
+    }
+    
+    // The rest follows on the UI thread, behind any batch already queued
+    CommandBatch batch;
+    batch.add("reveal", [revealed]() {
+        return revealed;
+    });
+    
+    std::string source_name = item.source;
+    if (target.previous) {
+        set_live_twin(source_name, target.name);
+        batch.add("swap", [this, source_name, target, revealed]() {
+            swap_twins(source_name, target, revealed);
+            return revealed;
+        });
+    }
+    
+    // Revealed while its scene was still off air, so the switch shows it already playing
+    auto switch_frames = std::make_shared<int64_t>(0);
+    if (scene && revealed) {
+        batch.add("switch_scene", [scene, reveal_frame, switch_frames]() {
+            obs_source_t* scene_source = obs_scene_get_source(scene);
+            obs_source_t* current = obs_frontend_get_current_scene();
+            obs_source_release(current);
+            if (!scene_source) {
                 return false;
             }
-        } else {
-            if (!play_media(item.source)) {
-                LOG_ERROR("Failed to play media source: " + item.source);
-                return false;
+            if (current != scene_source) {
+                obs_frontend_set_current_scene(scene_source);
+                *switch_frames = static_cast<int64_t>(obs_get_total_frames() - reveal_frame);
             }
+            return true;
+        });
+    }
+    
+    obs_source_t* source = target.source;
+    batch.add("release_hold", [source, held]() {
+        if (held->exchange(false)) {
+            obs_source_dec_showing(source);
         }
-        
-        LOG_INFO("Successfully executed scheduled item: " + item.name);
         return true;
+    });
+    
+    if (revealed) {
+        std::string item_id = item.id;
+        batch.add("probe", [this, item_id, source_name, source, trigger_ns, wakeup_ns, switch_frames]() {
+            begin_first_frame_probe(item_id, source_name, source, trigger_ns, wakeup_ns, true, *switch_frames);
+            return true;
+        });
+    }
+    
+    LOG_INFO("Fired pre-rolled item on its frame: " + item.name);
+    return command_queue_.submit("fire " + item.name, std::move(batch));
+}
+
+bool MediaController::fire_armed_item(const ScheduledItem& item, int64_t wakeup_ns) {
+    return fire_armed_item_async(item, wakeup_ns).valid();
+}
+
+bool MediaController::is_item_armed(const std::string& item_id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return armed_items_.count(item_id) > 0;
+}
+
+void MediaController::disarm_all() {
+    std::vector<ArmedItem> disarmed;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& pair : armed_items_) {
+            disarmed.push_back(pair.second);
+        }
+        armed_items_.clear();
+    }
+    
+    if (disarmed.empty()) {
+        return;
+    }
+    
+    LOG_INFO("Disarmed " + std::to_string(disarmed.size()) + " pre-rolled items");
+    
+    CommandBatch batch;
+    batch.add("release_holds", [disarmed]() {
+        for (const auto& armed : disarmed) {
+            if (armed.held->exchange(false)) {
+                obs_source_dec_showing(armed.source);
+            }
+        }
+        return true;
+    });
+    command_queue_.submit("disarm", std::move(batch));
+}
+
+bool MediaController::join_item(const ScheduledItem& item, int64_t offset_ms, uint64_t since_ns) {
+    uint64_t start_ns = os_gettime_ns();
+    
+    try {
+        PlayoutTarget target;
+        obs_scene_t* scene = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!item.scene.empty()) {
+                scene = get_scene(item.scene);
+            }
+            target = resolve_playout_target(item.source, scene);
+        }
+        obs_source_t* source = target.source;
+        
+        if (!source) {
+            LOG_ERROR("Media source not found for join: " + item.source);
+            return false;
+        }
+        if (!item.scene.empty() && !scene) {
+            LOG_WARNING("Failed to switch to scene: " + item.scene);
+        }
+        
+        CommandBatch batch;
+        
+        // Nothing of the item shows until it sits on the right frame
+        std::string hidden_name = target.name;
+        batch.add("hide_source", [this, scene, hidden_name]() {
+            return set_scene_item_visible(scene, hidden_name, false);
+        });
+        
+        if (!item.file_path.empty()) {
+            std::string file_path = item.file_path;
+            batch.add("load_file", [source, file_path]() {
+                return set_media_file(source, file_path);
+            });
+        }
+        
+        auto held = std::make_shared<std::atomic<bool>>(false);
+        batch.add("hold", [source, held]() {
+            obs_source_media_play_pause(source, true);
+            obs_source_inc_showing(source);
+            *held = true;
+            return true;
+        });
+        
+        // The video tick seeks once the file is open and reveals it on the matching frame
+        JoinProbe probe{item.id, item.source, source, scene, offset_ms, start_ns, since_ns,
+                        JOIN_SEEK_LEAD_MS, -1, held, target};
+        if (target.previous) {
+            set_live_twin(item.source, target.name);
+        }
+        batch.add("probe", [this, probe]() {
+            std::lock_guard<std::mutex> lock(probe_mutex_);
+            join_probes_.push_back(probe);
+            joining_sources_.erase(joining_sources_.find(probe.source));
+            return true;
+        });
+        {
+            std::lock_guard<std::mutex> lock(probe_mutex_);
+            joining_sources_.insert(source);
+        }
+        
+        LOG_INFO("Joining item " + item.name + " " + std::to_string(offset_ms / 1000) + "s into its slot");
+        return command_queue_.submit("join " + item.name, std::move(batch)).valid();
         
     } catch (const std::exception& e) {
-        LOG_ERROR("Exception executing scheduled item " + item.name + ": " + std::string(e.what()));
+        LOG_ERROR("Exception joining item " + item.name + ": " + std::string(e.what()));
         return false;
     }
 }
 
+std::vector<JoinRecord> MediaController::get_join_records() const {
+    std::lock_guard<std::mutex> lock(probe_mutex_);
+    return join_records_;
+}
+
+std::vector<StartLatencyRecord> MediaController::get_start_latency_records() const {
+    std::lock_guard<std::mutex> lock(probe_mutex_);
+    return start_latency_records_;
+}
+
+std::map<std::string, StageHistograms> MediaController::get_latency_histograms() const {
+    std::lock_guard<std::mutex> lock(probe_mutex_);
+    return latency_histograms_;
+}
+
+CommandQueueStats MediaController::get_command_queue_stats() const {
+    return command_queue_.get_stats();
+}
+
+std::vector<BatchResult> MediaController::get_recent_batches() const {
+    return command_queue_.get_recent_batches();
+}
+
 bool MediaController::play_idle_content() {
     if (default_idle_content_.empty()) {
         LOG_WARNING("No default idle content configured");
@@ -330,14 +773,23 @@ bool MediaController::play_idle_content() {
     
     LOG_INFO("Playing idle content: " + default_idle_content_);
     
-    // Try to find a media source to play idle content
-    auto media_sources = get_media_sources();
-    if (!media_sources.empty()) {
-        return play_media(media_sources[0], default_idle_content_);
-    }
+    // Finding a media source enumerates every source, so that runs on the OBS side too
+    std::string file_path = default_idle_content_;
+    CommandBatch batch;
+    batch.add("play_idle", [file_path]() {
+        obs_source_t* source = find_first_media_source();
+        if (!source) {
+            LOG_ERROR("No media sources available for idle content");
+            return false;
+        }
+        
+        bool ok = set_media_file(source, file_path);
+        obs_source_media_play_pause(source, false);
+        obs_source_release(source);
+        return ok;
+    });
     
-    LOG_ERROR("No media sources available for idle content");
-    return false;
+    return command_queue_.submit("idle", std::move(batch)).valid();
 }
 
 std::vector<std::string> MediaController::get_media_sources() const {
@@ -363,6 +815,17 @@ std::vector<std::string> MediaController::get_media_sources() const {
         return true;
     }, &result);
     
+    // The twin of an A/B pair plays the source's items, it is not scheduled on its own
+    std::vector<std::string> twins;
+    for (const auto& name : result) {
+        if (std::find(result.begin(), result.end(), get_twin_name(name)) != result.end()) {
+            twins.push_back(get_twin_name(name));
+        }
+    }
+    result.erase(std::remove_if(result.begin(), result.end(), [&twins](const std::string& name) {
+        return std::find(twins.begin(), twins.end(), name) != twins.end();
+    }), result.end());
+    
     return result;
 }
 
@@ -409,7 +872,6 @@ std::vector<std::string> MediaController::get_sources_in_scene(const std::string
         return true;
     }, &result);
     
-    obs_scene_release(scene);
     return result;
 }
 
@@ -464,10 +926,19 @@ bool MediaController::is_media_ended(const std::string& source_name) const {
 }
 
 void MediaController::set_media_event_callback(MediaEventCallback callback) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<std::mutex> lock(event_mutex_);
     media_event_callback_ = callback;
 }
 
+std::string MediaController::get_twin_name(const std::string& source_name) {
+    return source_name + TWIN_SUFFIX;
+}
+
+bool MediaController::has_twin_source(const std::string& source_name) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return get_media_source(source_name) && get_media_source(get_twin_name(source_name));
+}
+
 bool MediaController::validate_media_source(const std::string& source_name) const {
     obs_source_t* source = get_media_source(source_name);
     return source != nullptr;
@@ -475,11 +946,7 @@ bool MediaController::validate_media_source(const std::string& source_name) cons
 
 bool MediaController::validate_scene(const std::string& scene_name) const {
     obs_scene_t* scene = get_scene(scene_name);
-    if (scene) {
-        obs_scene_release(scene);
-        return true;
-    }
-    return false;
+    return scene != nullptr;
 }
 
 bool MediaController::validate_file_path(const std::string& file_path) const {
@@ -488,94 +955,219 @@ bool MediaController::validate_file_path(const std::string& file_path) const {
 
 // Private methods implementation
 
-obs_source_t* MediaController::get_media_source(const std::string& source_name) {
-    auto it = media_sources_.find(source_name);
-    if (it != media_sources_.end() && it->second) {
-        return it->second;
-    }
-    
-    // Try to find the source
-    obs_source_t* source = obs_get_source_by_name(source_name.c_str());
+obs_source_t* MediaController::get_media_source(const std::string& source_name) const {
+    obs_source_t* source = registry_.find(source_name, SourceRegistry::Kind::Media);
     if (source) {
-        // Check if it's a media source
-        const char* source_id = obs_source_get_id(source);
-        if (source_id && (strcmp(source_id, "ffmpeg_source") == 0 || 
-                          strcmp(source_id, "media_source") == 0 ||
-                          strcmp(source_id, "vlc_source") == 0)) {
-            media_sources_[source_name] = source;
-            return source;
-        }
-        
-        obs_source_release(source);
+        connect_media_signals(source);
+    }
+    return source;
+}
+
+obs_scene_t* MediaController::get_scene(const std::string& scene_name) const {
+    return registry_.find_scene(scene_name);
+}
+
+bool MediaController::set_scene_item_visible(obs_scene_t* scene, const std::string& source_name,
+                                             bool visible) {
+    return set_scene_items_visible(scene, {{source_name, visible}});
+}
+
+bool MediaController::set_scene_items_visible(obs_scene_t* scene,
+                                              const std::vector<SceneItemIndex::VisibilityChange>& changes) {
+    // Targets the given scene, or the current scene when none is given
+    obs_source_t* scene_source = scene ? obs_source_get_ref(obs_scene_get_source(scene))
+                                       : obs_frontend_get_current_scene();
+    if (!scene_source) {
+        return false;
     }
     
-    return nullptr;
+    obs_scene_t* target = obs_scene_from_source(scene_source);
+    bool found = target && scene_items_.set_visible(target, changes) == changes.size();
+    
+    obs_source_release(scene_source);
+    return found;
 }
 
-obs_scene_t* MediaController::get_scene(const std::string& scene_name) {
-    auto it = scenes_.find(scene_name);
-    if (it != scenes_.end() && it->second) {
-        return it->second;
+MediaController::PlayoutTarget MediaController::resolve_playout_target(const std::string& source_name,
+                                                                      obs_scene_t* scene) const {
+    // Called with mutex_ held
+    PlayoutTarget target{source_name, get_media_source(source_name), "", nullptr};
+    if (!target.source) {
+        return target;
     }
     
-    obs_source_t* scene_source = obs_get_source_by_name(scene_name.c_str());
-    if (scene_source) {
-        obs_scene_t* scene = obs_scene_from_source(scene_source);
-        if (scene) {
-            scenes_[scene_name] = scene;
-            obs_source_release(scene_source);
-            return scene;
-        }
-        obs_source_release(scene_source);
+    // Both of a pair have to be in the scene the item goes on air in
+    std::string twin_name = get_twin_name(source_name);
+    obs_source_t* twin = get_media_source(twin_name);
+    if (!twin || (scene && (!scene_items_.find(scene, source_name) || !scene_items_.find(scene, twin_name)))) {
+        return target;
     }
     
-    return nullptr;
+    if (get_live_twin(source_name) == twin_name) {
+        target.previous_name = twin_name;
+        target.previous = twin;
+    } else {
+        target.previous_name = source_name;
+        target.previous = target.source;
+        target.name = twin_name;
+        target.source = twin;
+    }
+    return target;
 }
 
-obs_sceneitem_t* MediaController::get_scene_item(obs_scene_t* scene, const std::string& source_name) {
-    obs_sceneitem_t* item = nullptr;
-    
-    obs_scene_enum_items(scene, [](obs_scene_t*, obs_sceneitem_t* current_item, void* data) {
-        auto* search_data = static_cast<std::pair<std::string, obs_sceneitem_t*>*>(data);
-        
-        obs_source_t* source = obs_sceneitem_get_source(current_item);
-        if (source) {
-            const char* name = obs_source_get_name(source);
-            if (name && std::string(name) == search_data->first) {
-                search_data->second = current_item;
-                obs_sceneitem_addref(current_item);
-                return false; // Stop enumeration
+bool MediaController::is_source_on_air(obs_source_t* source, const std::string& source_name) const {
+    {
+        std::lock_guard<std::mutex> lock(probe_mutex_);
+        if (joining_sources_.count(source)) {
+            return true;
+        }
+        for (const auto& probe : join_probes_) {
+            if (probe.source == source) {
+                return true;
             }
         }
-        
-        return true; // Continue enumeration
-    }, &std::make_pair(source_name, item));
+    }
     
-    return item;
+    obs_source_t* current_scene_source = obs_frontend_get_current_scene();
+    if (!current_scene_source) {
+        return false;
+    }
+    obs_scene_t* current_scene = obs_scene_from_source(current_scene_source);
+    bool visible = current_scene && scene_items_.is_visible(current_scene, source_name);
+    obs_source_release(current_scene_source);
+    
+    // Ended or stopped, it shows nothing worth keeping
+    obs_media_state_t state = obs_source_media_get_state(source);
+    return visible && (state == OBS_MEDIA_STATE_PLAYING || state == OBS_MEDIA_STATE_PAUSED ||
+                       state == OBS_MEDIA_STATE_OPENING || state == OBS_MEDIA_STATE_BUFFERING);
+}
+
+std::string MediaController::get_live_twin(const std::string& source_name) const {
+    std::lock_guard<std::mutex> lock(twin_mutex_);
+    auto it = live_twins_.find(source_name);
+    return it != live_twins_.end() ? it->second : source_name;
 }
 
-void MediaController::refresh_source_list() {
-    // Clear existing references
-    for (auto& pair : media_sources_) {
-        if (pair.second) {
-            obs_source_release(pair.second);
+void MediaController::set_live_twin(const std::string& source_name, const std::string& live_name) {
+    std::lock_guard<std::mutex> lock(twin_mutex_);
+    if (live_name == source_name) {
+        live_twins_.erase(source_name);
+    } else {
+        live_twins_[source_name] = live_name;
+    }
+}
+
+void MediaController::swap_twins(const std::string& source_name, const PlayoutTarget& target, bool applied) {
+    // Runs right after the transaction that shows target.name
+    if (!applied) {
+        // Rolled back, the other one is still on air unless a later item moved on
+        if (get_live_twin(source_name) == target.name) {
+            set_live_twin(source_name, target.previous_name);
         }
+        return;
+    }
+    
+    // Hidden by now; stopping it closes the file it played
+    obs_source_media_stop(target.previous);
+}
+
+bool MediaController::commit_transaction(ItemTransaction& transaction) {
+    transaction.set_expected_window(apply_window_ns_);
+    if (!transaction.commit()) {
+        LOG_ERROR("Failed to apply item changes: " + transaction.get_error() +
+                  (transaction.is_rolled_back() ? " (rolled back)" : ""));
+        return false;
+    }
+    
+    if (transaction.get_frame_span() > 0) {
+        LOG_DEBUG("Item changes spanned " + std::to_string(transaction.get_frame_span()) + " frames");
     }
-    media_sources_.clear();
     
-    // This will be repopulated on demand
+    // Slow to forget a long commit, so one quick commit does not undo the wait
+    int64_t expected_ns = apply_window_ns_;
+    apply_window_ns_ = std::max(transaction.get_window_ns(), expected_ns - expected_ns / 8);
+    return true;
 }
 
-void MediaController::refresh_scene_list() {
-    // Clear existing references
-    for (auto& pair : scenes_) {
-        if (pair.second) {
-            obs_scene_release(pair.second);
+obs_source_t* MediaController::find_first_media_source() {
+    obs_source_t* found = nullptr;
+    
+    obs_enum_sources([](void* data, obs_source_t* source) {
+        const char* source_id = obs_source_get_id(source);
+        if (source_id && (strcmp(source_id, "ffmpeg_source") == 0 || 
+                          strcmp(source_id, "media_source") == 0 ||
+                          strcmp(source_id, "vlc_source") == 0)) {
+            *static_cast<obs_source_t**>(data) = obs_source_get_ref(source);
+            return false;
         }
+        return true;
+    }, &found);
+    
+    return found;
+}
+
+void MediaController::connect_media_signals(obs_source_t* source) const {
+    // Once per source, on its first lookup
+    static const std::pair<const char*, const char*> signals[] = {
+        {"media_started", "started"},
+        {"media_ended", "ended"},
+        {"media_stopped", "stopped"},
+    };
+    
+    std::lock_guard<std::mutex> lock(signal_mutex_);
+    auto result = media_signals_.emplace(source, std::vector<std::unique_ptr<MediaSignalBinding>>());
+    if (!result.second) {
+        return;
     }
-    scenes_.clear();
     
-    // This will be repopulated on demand
+    signal_handler_t* handler = obs_source_get_signal_handler(source);
+    if (!handler) {
+        return;
+    }
+    
+    for (const auto& signal : signals) {
+        auto binding = std::make_unique<MediaSignalBinding>();
+        binding->controller = const_cast<MediaController*>(this);
+        binding->source = source;
+        binding->signal = signal.first;
+        binding->event = signal.second;
+        signal_handler_connect(handler, signal.first, &MediaController::media_source_callback, binding.get());
+        result.first->second.push_back(std::move(binding));
+    }
+}
+
+void MediaController::disconnect_media_signals(obs_source_t* source) {
+    // The source is on its way out of OBS but still valid
+    std::lock_guard<std::mutex> lock(signal_mutex_);
+    auto it = media_signals_.find(source);
+    if (it == media_signals_.end()) {
+        return;
+    }
+    
+    signal_handler_t* handler = obs_source_get_signal_handler(source);
+    for (const auto& binding : it->second) {
+        if (handler) {
+            signal_handler_disconnect(handler, binding->signal, &MediaController::media_source_callback,
+                                      binding.get());
+        }
+    }
+    media_signals_.erase(it);
+}
+
+void MediaController::disconnect_media_signals() {
+    // Every source still connected is still in OBS, removed ones were dropped as they went
+    std::lock_guard<std::mutex> lock(signal_mutex_);
+    for (const auto& pair : media_signals_) {
+        signal_handler_t* handler = obs_source_get_signal_handler(pair.first);
+        if (!handler) {
+            continue;
+        }
+        for (const auto& binding : pair.second) {
+            signal_handler_disconnect(handler, binding->signal, &MediaController::media_source_callback,
+                                      binding.get());
+        }
+    }
+    media_signals_.clear();
 }
 
 bool MediaController::set_media_file(obs_source_t* source, const std::string& file_path) {
@@ -601,8 +1193,249 @@ bool MediaController::set_media_file(obs_source_t* source, const std::string& fi
     return true;
 }
 
+void MediaController::begin_first_frame_probe(const std::string& item_id, const std::string& source_name,
+                                              obs_source_t* source, uint64_t trigger_ns, int64_t wakeup_ns,
+                                              bool prerolled, int64_t apply_frames) {
+    if (!source) {
+        return;
+    }
+    
+    // Runs as the batch's last command, so the OBS calls before it have been issued
+    uint64_t issue_ns = os_gettime_ns();
+    
+    std::lock_guard<std::mutex> lock(probe_mutex_);
+    first_frame_probes_.push_back(FirstFrameProbe{item_id, source_name, source, trigger_ns, issue_ns, wakeup_ns,
+                                                  obs_source_media_get_time(source), prerolled, apply_frames});
+}
+
+void MediaController::first_frame_tick(void* data, float seconds) {
+    UNUSED_PARAMETER(seconds);
+    auto* controller = static_cast<MediaController*>(data);
+    controller->check_first_frame_probes();
+    controller->check_join_probes();
+}
+
+void MediaController::check_first_frame_probes() {
+    std::lock_guard<std::mutex> lock(probe_mutex_);
+    
+    if (first_frame_probes_.empty()) {
+        return;
+    }
+    
+    uint64_t frame_ns = obs_get_video_frame_time();
+    
+    auto finished = std::remove_if(first_frame_probes_.begin(), first_frame_probes_.end(),
+        [this, frame_ns](const FirstFrameProbe& probe) {
+            // The first frame is out once the media clock moves past where it was at trigger time
+            bool started = obs_source_media_get_state(probe.source) == OBS_MEDIA_STATE_PLAYING &&
+                           obs_source_media_get_time(probe.source) != probe.start_media_time;
+            bool timed_out = frame_ns > probe.trigger_ns + FIRST_FRAME_TIMEOUT_NS;
+            
+            if (started) {
+                StartLatencyRecord record{probe.item_id, probe.prerolled,
+                                          static_cast<int64_t>(frame_ns - probe.trigger_ns), probe.wakeup_ns,
+                                          static_cast<int64_t>(probe.issue_ns - probe.trigger_ns),
+                                          probe.apply_frames};
+                start_latency_records_.push_back(record);
+                if (start_latency_records_.size() > MAX_LATENCY_RECORDS) {
+                    start_latency_records_.erase(start_latency_records_.begin());
+                }
+                
+                auto& histograms = latency_histograms_[probe.source_name];
+                histograms[static_cast<size_t>(LatencyStage::Dispatch)].record(record.dispatch_ns);
+                histograms[static_cast<size_t>(LatencyStage::Start)].record(
+                    static_cast<int64_t>(frame_ns) - static_cast<int64_t>(probe.issue_ns));
+                if (probe.wakeup_ns >= 0) {
+                    histograms[static_cast<size_t>(LatencyStage::Wakeup)].record(probe.wakeup_ns);
+                    histograms[static_cast<size_t>(LatencyStage::Total)].record(probe.wakeup_ns + record.latency_ns);
+                }
+                
+                LOG_DEBUG("Item " + probe.item_id + " first frame " +
+                          std::to_string(record.latency_ns / 1000000) + "ms after trigger" +
+                          (probe.prerolled ? " (pre-rolled)" : ""));
+            } else if (timed_out) {
+                LOG_WARNING("No frame from item " + probe.item_id + " within 10s of its trigger");
+            }
+            
+            return started || timed_out;
+        });
+    
+    first_frame_probes_.erase(finished, first_frame_probes_.end());
+}
+
+void MediaController::media_source_callback(void* data, calldata_t* cd) {
+    UNUSED_PARAMETER(cd);
+    
+    // The binding already knows the source and event, no need to parse calldata.
+    // The name is read now, so a renamed source reports its new one.
+    auto* binding = static_cast<MediaSignalBinding*>(data);
+    const char* name = obs_source_get_name(binding->source);
+    binding->controller->handle_media_event(name ? name : "", binding->event);
+}
+
 void MediaController::handle_media_event(const std::string& source_name, const std::string& event) {
-    if (media_event_callback_) {
-        media_event_callback_(source_name, event);
+    MediaEventCallback callback;
+    {
+        std::lock_guard<std::mutex> lock(event_mutex_);
+        callback = media_event_callback_;
+    }
+    
+    LOG_DEBUG("Media " + event + " on source: " + source_name);
+    
+    // A twin reports under its pair's name; the hidden one of a pair is not on air
+    std::string pair_name = source_name;
+    size_t suffix_length = std::strlen(TWIN_SUFFIX);
+    if (source_name.size() > suffix_length &&
+        source_name.compare(source_name.size() - suffix_length, suffix_length, TWIN_SUFFIX) == 0 &&
+        registry_.find(source_name.substr(0, source_name.size() - suffix_length), SourceRegistry::Kind::Media)) {
+        pair_name = source_name.substr(0, source_name.size() - suffix_length);
+    }
+    if (get_live_twin(pair_name) != source_name) {
+        return;
+    }
+    
+    if (callback) {
+        callback(pair_name, event);
+    }
+}
+
+void MediaController::check_join_probes() {
+    std::vector<JoinProbe> ready;
+    {
+        std::lock_guard<std::mutex> lock(probe_mutex_);
+        
+        if (join_probes_.empty()) {
+            return;
+        }
+        
+        uint64_t frame_ns = obs_get_video_frame_time();
+        
+        for (auto it = join_probes_.begin(); it != join_probes_.end();) {
+            JoinProbe& probe = *it;
+            
+            // Where the programme is on this frame
+            int64_t expected_ms = probe.offset_ms +
+                                  (static_cast<int64_t>(frame_ns) - static_cast<int64_t>(probe.start_ns)) / 1000000;
+            bool timed_out = frame_ns > probe.start_ns + FIRST_FRAME_TIMEOUT_NS;
+            bool done = false;
+            
+            obs_media_state_t state = obs_source_media_get_state(probe.source);
+            bool opened = state == OBS_MEDIA_STATE_PAUSED || state == OBS_MEDIA_STATE_PLAYING;
+            
+            if (timed_out) {
+                LOG_WARNING("Item " + probe.item_id + " did not settle within 10s of joining, revealing it as is");
+                int64_t media_ms = obs_source_media_get_time(probe.source);
+                record_join(JoinRecord{probe.item_id, expected_ms, media_ms - expected_ms,
+                                       static_cast<int64_t>(frame_ns - probe.since_ns), true});
+                ready.push_back(probe);
+                done = true;
+            } else if (!opened) {
+                // Still opening the file
+            } else if (probe.target_ms < 0) {
+                int64_t duration_ms = obs_source_media_get_duration(probe.source);
+                if (duration_ms > 0 && expected_ms >= duration_ms) {
+                    // The file is shorter than the slot and has already run out
+                    LOG_INFO("Item " + probe.item_id + " already ended, not joining it");
+                    obs_source_media_stop(probe.source);
+                    if (probe.held->exchange(false)) {
+                        obs_source_dec_showing(probe.source);
+                    }
+                    if (probe.target.previous) {
+                        set_live_twin(probe.source_name, probe.target.previous_name);
+                    }
+                    record_join(JoinRecord{probe.item_id, expected_ms, 0,
+                                           static_cast<int64_t>(frame_ns - probe.since_ns), false});
+                    done = true;
+                } else {
+                    probe.target_ms = expected_ms + probe.seek_lead_ms;
+                    obs_source_media_set_time(probe.source, probe.target_ms);
+                }
+            } else {
+                int64_t media_ms = obs_source_media_get_time(probe.source);
+                bool landed = std::llabs(media_ms - probe.target_ms) <= JOIN_SEEK_TOLERANCE_MS;
+                
+                if (landed && expected_ms > probe.target_ms + JOIN_SEEK_TOLERANCE_MS) {
+                    // The seek took longer than its lead, aim further ahead
+                    probe.seek_lead_ms *= 2;
+                    probe.target_ms = -1;
+                    LOG_DEBUG("Seek for item " + probe.item_id + " landed late, retrying with " +
+                              std::to_string(probe.seek_lead_ms) + "ms lead");
+                } else if (landed && expected_ms >= probe.target_ms) {
+                    record_join(JoinRecord{probe.item_id, expected_ms, media_ms - expected_ms,
+                                           static_cast<int64_t>(frame_ns - probe.since_ns), true});
+                    ready.push_back(probe);
+                    done = true;
+                }
+            }
+            
+            it = done ? join_probes_.erase(it) : it + 1;
+        }
+    }
+    
+    // On the video thread, so the item goes live on this frame
+    for (const auto& probe : ready) {
+        reveal_joined_item(probe);
+    }
+}
+
+void MediaController::reveal_joined_item(const JoinProbe& probe) {
+    // Runs on the video thread: the unpause and the reveal land on this frame,
+    // everything that has to wait on the UI thread is queued behind them
+    obs_source_t* source = probe.source;
+    obs_scene_t* scene = probe.scene;
+    PlayoutTarget target = probe.target;
+    std::shared_ptr<std::atomic<bool>> held = probe.held;
+    
+    std::vector<SceneItemIndex::VisibilityChange> changes{{target.name, true}};
+    if (target.previous) {
+        changes.emplace_back(target.previous_name, false);
+    }
+    
+    obs_source_media_play_pause(source, false);
+    bool revealed = set_scene_items_visible(scene, changes);
+    
+    CommandBatch batch;
+    batch.add("reveal_source", [revealed]() {
+        return revealed;
+    });
+    if (target.previous) {
+        obs_source_t* previous = target.previous;
+        batch.add("stop_previous", [previous]() {
+            obs_source_media_stop(previous);
+            return true;
+        });
+    }
+    batch.add("release_hold", [source, held]() {
+        if (held->exchange(false)) {
+            obs_source_dec_showing(source);
+        }
+        return true;
+    });
+    
+    if (scene) {
+        batch.add("switch_scene", [scene]() {
+            obs_source_t* scene_source = obs_scene_get_source(scene);
+            if (!scene_source) {
+                return false;
+            }
+            obs_frontend_set_current_scene(scene_source);
+            return true;
+        });
+    }
+    
+    command_queue_.submit("reveal " + probe.item_id, std::move(batch));
+}
+
+void MediaController::record_join(const JoinRecord& record) {
+    // Called with probe_mutex_ held
+    join_records_.push_back(record);
+    if (join_records_.size() > MAX_LATENCY_RECORDS) {
+        join_records_.erase(join_records_.begin());
+    }
+    
+    if (record.revealed) {
+        LOG_INFO("Joined item " + record.item_id + " at " + std::to_string(record.offset_ms / 1000) + "s, " +
+                 std::to_string(record.seek_error_ms) + "ms off, " +
+                 std::to_string(record.recovery_ns / 1000000) + "ms after the join was requested");
     }
 }
@@ -4,13 +4,41 @@
 #include <memory>
 #include <mutex>
 #include <vector>
+#include <map>
+#include <set>
+#include <unordered_map>
 #include <functional>
+#include <future>
+#include <atomic>
+#include <cstdint>
 #include <obs-module.h>
-
-struct obs_data_t;
-struct obs_source_t;
+#include "command-queue.h"
+#include "source-registry.h"
+#include "scene-item-index.h"
+#include "utils/config.h"
+#include "utils/latency-histogram.h"
 
 struct ScheduledItem;
+class ItemTransaction;
+
+// Trigger-to-first-frame measurement for one executed item
+struct StartLatencyRecord {
+    std::string item_id;
+    bool prerolled;         // Whether the item was armed before its trigger
+    int64_t latency_ns;     // From trigger until the media clock first advanced
+    int64_t wakeup_ns;      // Scheduled instant until the trigger, -1 if unknown
+    int64_t dispatch_ns;    // Trigger until the OBS commands had run
+    int64_t apply_frames;   // Frames rendered between the item's first and last change
+};
+
+// Join-in-progress outcome for one item picked up mid-programme
+struct JoinRecord {
+    std::string item_id;
+    int64_t offset_ms;      // Programme offset the item was revealed at
+    int64_t seek_error_ms;  // Media position minus programme offset at reveal
+    int64_t recovery_ns;    // From the join request's reference instant until the reveal frame
+    bool revealed;          // False when the file turned out to be over already
+};
 
 class MediaController {
 public:
@@ -31,14 +59,55 @@ public:
     bool switch_to_scene(const std::string& scene_name);
     std::string get_current_scene() const;
     
-    // Source visibility
+    // Source visibility, in the current scene. Several changes given at once
+    // show on the same frame; false if any of the sources is not in the scene.
     bool set_source_visibility(const std::string& source_name, bool visible);
+    bool set_sources_visibility(const std::vector<SceneItemIndex::VisibilityChange>& changes);
     bool get_source_visibility(const std::string& source_name) const;
     
-    // Scheduled item execution
-    bool execute_item(const ScheduledItem& item);
+    // Scheduled item execution. These resolve sources on the calling thread and
+    // hand the OBS calls to the command queue as one batch, without waiting for
+    // it to run. The bool variants report whether the batch was submitted.
+    // wakeup_ns is how late the scheduler woke for the item (-1 = unknown).
+    std::future<BatchResult> execute_item_async(const ScheduledItem& item, int64_t wakeup_ns = -1);
+    bool execute_item(const ScheduledItem& item, int64_t wakeup_ns = -1);
     bool play_idle_content();
     
+    // Pre-roll: load the item paused and hidden ahead of its trigger, then
+    // only unpause and reveal it at trigger time. Fired from the video tick
+    // once its hold is in place, the reveal and unpause run right there, on
+    // the trigger frame, and the scene switch and the rest queue behind them.
+    bool arm_item(const ScheduledItem& item);
+    bool fire_armed_item(const ScheduledItem& item, int64_t wakeup_ns = -1);
+    bool is_item_armed(const std::string& item_id) const;
+    void disarm_all();
+    
+    // A/B playout. A media source named get_twin_name(source) next to the
+    // source in the item's scene makes the two a pair: each item of the source
+    // loads into whichever of them is hidden, pre-rolled like any other, and
+    // goes on air by showing it and hiding the other in one atomic update, so
+    // back-to-back items on one source never show a file being opened. Media
+    // events of the pair are reported under the source's name, and only for
+    // the one on air.
+    static constexpr const char* TWIN_SUFFIX = " (B)";
+    static std::string get_twin_name(const std::string& source_name);
+    bool has_twin_source(const std::string& source_name) const;
+    
+    // Join-in-progress: load the item hidden and paused, seek it to where the
+    // programme is by now (offset_ms at the time of the call), and only
+    // unpause and reveal it once the media clock is there. Recovery time is
+    // measured from since_ns (os_gettime_ns() time base).
+    bool join_item(const ScheduledItem& item, int64_t offset_ms, uint64_t since_ns);
+    std::vector<JoinRecord> get_join_records() const;
+    
+    // Start latency measurements, and per-source histograms of every stage
+    std::vector<StartLatencyRecord> get_start_latency_records() const;
+    std::map<std::string, StageHistograms> get_latency_histograms() const;
+    
+    // Command queue health (depth, wait and run times)
+    CommandQueueStats get_command_queue_stats() const;
+    std::vector<BatchResult> get_recent_batches() const;
+    
     // Source discovery
     std::vector<std::string> get_media_sources() const;
     std::vector<std::string> get_scenes() const;
@@ -50,7 +119,11 @@ public:
     int get_media_time(const std::string& source_name) const;
     bool is_media_ended(const std::string& source_name) const;
     
-    // Callbacks for media events
+    // Callbacks for media events. Every source the controller resolves is
+    // subscribed to media_started/media_ended/media_stopped, reported as
+    // "started", "ended" and "stopped" under the source's current name. The
+    // callback runs on whichever thread OBS signals from (the source's media
+    // thread for "ended") and must not call back into this controller.
     using MediaEventCallback = std::function<void(const std::string& source_name, const std::string& event)>;
     void set_media_event_callback(MediaEventCallback callback);
     
@@ -60,12 +133,70 @@ public:
     bool validate_file_path(const std::string& file_path) const;
 
 private:
+    // Where an item plays: its source, or whichever of the source's pair is hidden
+    struct PlayoutTarget {
+        std::string name;
+        obs_source_t* source;
+        std::string previous_name;  // The other one of the pair, on air until the swap; empty without a pair
+        obs_source_t* previous;
+    };
+    
+    struct ArmedItem {
+        std::string source_name;
+        obs_source_t* source;
+        std::shared_ptr<std::atomic<bool>> held;   // Set once the hold command has run
+        std::string previous_name;
+        obs_source_t* previous;
+    };
+    
+    struct FirstFrameProbe {
+        std::string item_id;
+        std::string source_name;
+        obs_source_t* source;
+        uint64_t trigger_ns;
+        uint64_t issue_ns;          // When the batch's OBS calls had run
+        int64_t wakeup_ns;
+        int64_t start_media_time;
+        bool prerolled;
+        int64_t apply_frames;
+    };
+    
+    struct JoinProbe {
+        std::string item_id;
+        std::string source_name;
+        obs_source_t* source;
+        obs_scene_t* scene;         // Scene revealed in and switched to, nullptr = current scene
+        int64_t offset_ms;          // Programme offset at start_ns
+        uint64_t start_ns;
+        uint64_t since_ns;
+        int64_t seek_lead_ms;       // How far ahead of the programme the seek aims
+        int64_t target_ms;          // Seek target, -1 until a seek went out
+        std::shared_ptr<std::atomic<bool>> held;
+        PlayoutTarget target;       // Scene item revealed, and the one of a pair hidden with it
+    };
+    
+    // One signal connection of a managed source, passed to OBS as the callback data
+    struct MediaSignalBinding {
+        MediaController* controller;
+        obs_source_t* source;
+        const char* signal;
+        const char* event;
+    };
+    
     mutable std::mutex mutex_;
+    
+    // Separate from mutex_, OBS may signal synchronously from a call made under it
+    mutable std::mutex event_mutex_;
     MediaEventCallback media_event_callback_;
     
-    // OBS source references
-    std::map<std::string, obs_source_t*> media_sources_;
-    std::map<std::string, obs_scene_t*> scenes_;
+    // Sources and scenes by name, and scene items by source name, kept current by OBS signals
+    SourceRegistry registry_;
+    mutable SceneItemIndex scene_items_;
+    
+    // Media signal connections per resolved source. Separate from mutex_, the
+    // registry reports removals from whichever thread OBS removes them on.
+    mutable std::mutex signal_mutex_;
+    mutable std::unordered_map<obs_source_t*, std::vector<std::unique_ptr<MediaSignalBinding>>> media_signals_;
     
     // Configuration
     std::string default_idle_content_;
@@ -74,22 +205,79 @@ private:
     bool fade_transitions_;
     int transition_duration_ms_;
     
-    // Internal methods
-    obs_source_t* get_media_source(const std::string& source_name);
-    obs_scene_t* get_scene(const std::string& scene_name);
-    obs_sceneitem_t* get_scene_item(obs_scene_t* scene, const std::string& source_name);
+    // Pre-rolled items, keyed by item id
+    std::map<std::string, ArmedItem> armed_items_;
+    
+    // Which one of each A/B pair is on air, keyed by the source's name; a
+    // pair without an entry has the source itself on air. Separate from
+    // mutex_, commands and media signals read and correct it.
+    mutable std::mutex twin_mutex_;
+    std::map<std::string, std::string> live_twins_;
+    
+    // Start latency tracking, sampled from the video tick
+    mutable std::mutex probe_mutex_;
+    std::vector<FirstFrameProbe> first_frame_probes_;
+    std::vector<StartLatencyRecord> start_latency_records_;
+    std::map<std::string, StageHistograms> latency_histograms_;     // Keyed by source name
+    std::vector<JoinProbe> join_probes_;
+    std::multiset<obs_source_t*> joining_sources_;     // Joins submitted, until their probe is in place
+    std::vector<JoinRecord> join_records_;
+    bool tick_registered_;
     
-    void refresh_source_list();
-    void refresh_scene_list();
+    // OBS calls for triggers run through here, off the scheduler thread
+    CommandQueue command_queue_;
+    
+    // How long recent items took from their first to their last change, so
+    // the next one can wait for room between two frames
+    std::atomic<int64_t> apply_window_ns_;
+    
+    static constexpr uint64_t FIRST_FRAME_TIMEOUT_NS = 10000000000ULL;
+    static constexpr size_t MAX_LATENCY_RECORDS = 1000;
+    
+    // Joins seek this far ahead of the programme so the seek lands before
+    // real time gets there; doubled whenever a seek lands too late
+    static constexpr int64_t JOIN_SEEK_LEAD_MS = 500;
+    static constexpr int64_t JOIN_SEEK_TOLERANCE_MS = 40;
+    
+    // Internal methods. Lookups go through the registry and take no reference.
+    obs_source_t* get_media_source(const std::string& source_name) const;
+    obs_scene_t* get_scene(const std::string& scene_name) const;
+    bool set_scene_item_visible(obs_scene_t* scene, const std::string& source_name, bool visible);
+    bool set_scene_items_visible(obs_scene_t* scene, const std::vector<SceneItemIndex::VisibilityChange>& changes);
+    PlayoutTarget resolve_playout_target(const std::string& source_name, obs_scene_t* scene) const;
+    bool is_source_on_air(obs_source_t* source, const std::string& source_name) const;
+    std::string get_live_twin(const std::string& source_name) const;
+    void set_live_twin(const std::string& source_name, const std::string& live_name);
+    void swap_twins(const std::string& source_name, const PlayoutTarget& target, bool applied);
+    bool commit_transaction(ItemTransaction& transaction);
+    static obs_source_t* find_first_media_source();
+    std::future<BatchResult> fire_armed_item_async(const ScheduledItem& item, int64_t wakeup_ns);
+    std::future<BatchResult> fire_on_frame(const ScheduledItem& item, const PlayoutTarget& target,
+                                           obs_scene_t* scene, const std::shared_ptr<std::atomic<bool>>& held,
+                                           uint64_t trigger_ns, int64_t wakeup_ns);
+    
+    void connect_media_signals(obs_source_t* source) const;
+    void disconnect_media_signals(obs_source_t* source);
+    void disconnect_media_signals();
     
     // Media control helpers
-    bool set_media_file(obs_source_t* source, const std::string& file_path);
+    static bool set_media_file(obs_source_t* source, const std::string& file_path);
     bool trigger_media_action(obs_source_t* source, const std::string& action);
     
     // Transition helpers
     bool execute_scene_transition(const std::string& from_scene, const std::string& to_scene);
     void fade_source_visibility(const std::string& source_name, bool visible, int duration_ms);
     
+    // Start latency helpers
+    void begin_first_frame_probe(const std::string& item_id, const std::string& source_name,
+                                 obs_source_t* source, uint64_t trigger_ns, int64_t wakeup_ns,
+                                 bool prerolled, int64_t apply_frames);
+    static void first_frame_tick(void* data, float seconds);
+    void check_first_frame_probes();
+    void check_join_probes();
+    void reveal_joined_item(const JoinProbe& probe);
+    void record_join(const JoinRecord& record);
+    
     // Event handlers
     static void media_source_callback(void* data, calldata_t* cd);
     void handle_media_event(const std::string& source_name, const std::string& event);
@@ -0,0 +1,427 @@
+#include "media-probe.h"
+#include "utils/config.h"
+#include "utils/logger.h"
+#include "utils/mapped-file.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <type_traits>
+
+#ifdef HAVE_LIBAVFORMAT
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavutil/channel_layout.h>
+}
+#endif
+
+namespace {
+
+// On-disk layout: a header, one fixed-size record per file and the paths in
+// a string table after them, each section 8-byte aligned
+const char MAGIC[8] = {'O', 'T', 'S', 'P', 'R', 'O', 'B', 'E'};
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+const char CACHE_FILE_NAME[] = "media-probe.bin";
+
+struct StringRef {
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct Header {
+    char magic[8];
+    uint32_t format_version;
+    uint32_t byte_order;
+    uint64_t file_size;         // Whole file, catches truncation
+    uint32_t entry_count;
+    uint32_t padding;
+    uint64_t entries_offset;
+    uint64_t strings_offset;
+    uint64_t strings_size;
+};
+
+struct EntryRecord {
+    StringRef path;
+    uint64_t source_size;
+    int64_t source_mtime;
+    int64_t duration_ms;
+    uint32_t fps_num;
+    uint32_t fps_den;
+    uint32_t width;
+    uint32_t height;
+    uint32_t audio_channels;
+    uint32_t sample_rate;
+    uint64_t channel_layout;
+    uint8_t ok;
+    uint8_t padding[7];
+};
+
+static_assert(std::is_trivially_copyable<Header>::value && std::is_trivially_copyable<EntryRecord>::value,
+              "cache records are copied as bytes");
+static_assert(sizeof(Header) % 8 == 0 && sizeof(EntryRecord) % 8 == 0, "records keep sections aligned");
+
+size_t align8(size_t size) {
+    return (size + 7) & ~static_cast<size_t>(7);
+}
+
+} // namespace
+
+MediaProbe::MediaProbe(const std::string& directory, size_t threads)
+    : directory_(directory)
+    , probe_count_(0)
+    , stopping_(false)
+    , next_listener_id_(1)
+    , pool_(threads > 0 ? threads : DEFAULT_THREADS)
+{
+}
+
+MediaProbe::~MediaProbe() {
+    // The pool still runs through its queue when destroyed; make that quick
+    stopping_ = true;
+}
+
+std::shared_ptr<MediaProbe> MediaProbe::shared() {
+    static const std::shared_ptr<MediaProbe> instance = []() {
+        auto probe = std::make_shared<MediaProbe>(Config::get_schedule_cache_path());
+        probe->load();
+        return probe;
+    }();
+    return instance;
+}
+
+bool MediaProbe::is_available() const {
+#ifdef HAVE_LIBAVFORMAT
+    return true;
+#else
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<bool>(probe_);
+#endif
+}
+
+void MediaProbe::set_probe_function(ProbeFunction probe) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    probe_ = std::move(probe);
+}
+
+size_t MediaProbe::load() {
+    std::string cache_path = get_cache_path();
+    if (cache_path.empty() || !std::filesystem::exists(cache_path)) {
+        return 0;
+    }
+    
+    MappedFile file;
+    if (!file.open(cache_path)) {
+        return 0;
+    }
+    
+    const char* data = file.data();
+    size_t size = file.size();
+    Header header;
+    if (size < sizeof(Header)) {
+        return 0;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.format_version != FORMAT_VERSION ||
+        header.byte_order != BYTE_ORDER_MARK || header.file_size != size ||
+        header.entries_offset % 8 != 0 || header.entries_offset > size ||
+        header.entry_count > (size - header.entries_offset) / sizeof(EntryRecord) ||
+        header.strings_offset > size || header.strings_size > size - header.strings_offset) {
+        LOG_WARNING("Ignoring outdated or damaged media probe cache: " + cache_path);
+        return 0;
+    }
+    
+    std::map<std::string, Entry> entries;
+    const char* strings = data + header.strings_offset;
+    for (uint32_t i = 0; i < header.entry_count; ++i) {
+        EntryRecord record;
+        std::memcpy(&record, data + header.entries_offset + i * sizeof(EntryRecord), sizeof(record));
+        if (record.path.offset > header.strings_size || record.path.length > header.strings_size - record.path.offset) {
+            LOG_WARNING("Ignoring damaged media probe cache: " + cache_path);
+            return 0;
+        }
+        
+        Entry entry;
+        entry.stamp.size = record.source_size;
+        entry.stamp.mtime = record.source_mtime;
+        entry.ok = record.ok != 0;
+        entry.info.duration_ms = record.duration_ms;
+        entry.info.fps_num = record.fps_num;
+        entry.info.fps_den = record.fps_den;
+        entry.info.width = record.width;
+        entry.info.height = record.height;
+        entry.info.audio_channels = record.audio_channels;
+        entry.info.sample_rate = record.sample_rate;
+        entry.info.channel_layout = record.channel_layout;
+        entries.emplace(std::string(strings + record.path.offset, record.path.length), entry);
+    }
+    
+    size_t count = entries.size();
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_ = std::move(entries);
+    return count;
+}
+
+bool MediaProbe::save() const {
+    std::string cache_path = get_cache_path();
+    if (cache_path.empty()) {
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> save_lock(save_mutex_);
+    std::vector<EntryRecord> records;
+    std::string strings;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        records.reserve(entries_.size());
+        for (const auto& pair : entries_) {
+            EntryRecord record;
+            std::memset(&record, 0, sizeof(record));
+            record.path.offset = static_cast<uint32_t>(strings.size());
+            record.path.length = static_cast<uint32_t>(pair.first.size());
+            strings.append(pair.first);
+            record.source_size = pair.second.stamp.size;
+            record.source_mtime = pair.second.stamp.mtime;
+            record.duration_ms = pair.second.info.duration_ms;
+            record.fps_num = pair.second.info.fps_num;
+            record.fps_den = pair.second.info.fps_den;
+            record.width = pair.second.info.width;
+            record.height = pair.second.info.height;
+            record.audio_channels = pair.second.info.audio_channels;
+            record.sample_rate = pair.second.info.sample_rate;
+            record.channel_layout = pair.second.info.channel_layout;
+            record.ok = pair.second.ok ? 1 : 0;
+            records.push_back(record);
+        }
+    }
+    if (strings.size() > UINT32_MAX) {
+        return false;
+    }
+    
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.format_version = FORMAT_VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.entry_count = static_cast<uint32_t>(records.size());
+    header.entries_offset = align8(sizeof(Header));
+    header.strings_offset = align8(header.entries_offset + records.size() * sizeof(EntryRecord));
+    header.strings_size = strings.size();
+    header.file_size = header.strings_offset + strings.size();
+    
+    std::vector<char> data(header.file_size, 0);
+    std::memcpy(data.data(), &header, sizeof(header));
+    if (!records.empty()) {
+        std::memcpy(data.data() + header.entries_offset, records.data(), records.size() * sizeof(EntryRecord));
+    }
+    std::memcpy(data.data() + header.strings_offset, strings.data(), strings.size());
+    
+    try {
+        // Written aside and renamed over the old file, so a load never sees half of one
+        std::filesystem::create_directories(directory_);
+        std::string temp_path = cache_path + ".tmp";
+        {
+            std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+            if (!file.write(data.data(), static_cast<std::streamsize>(data.size()))) {
+                LOG_WARNING("Failed to write media probe cache: " + temp_path);
+                return false;
+            }
+        }
+        std::filesystem::rename(temp_path, cache_path);
+        return true;
+        
+    } catch (const std::exception& e) {
+        LOG_WARNING("Failed to write media probe cache " + cache_path + ": " + std::string(e.what()));
+        return false;
+    }
+}
+
+size_t MediaProbe::request(const std::vector<std::string>& paths) {
+    if (!is_available()) {
+        return 0;
+    }
+    
+    // Stat outside the lock; lookups keep going meanwhile
+    std::vector<std::pair<std::string, SourceStamp>> stamped;
+    stamped.reserve(paths.size());
+    for (const auto& path : paths) {
+        SourceStamp stamp;
+        if (!path.empty() && ScheduleCache::stat_source(path, stamp)) {
+            stamped.emplace_back(path, stamp);
+        }
+    }
+    
+    auto batch = std::make_shared<Batch>();
+    std::vector<std::pair<std::string, SourceStamp>> queued;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& file : stamped) {
+            auto it = entries_.find(file.first);
+            if (it != entries_.end()) {
+                if (it->second.stamp == file.second) {
+                    continue;
+                }
+                entries_.erase(it);
+            }
+            if (!in_flight_.insert(file.first).second) {
+                continue;   // Already queued, by this batch or an earlier one
+            }
+            batch->paths.push_back(file.first);
+            queued.push_back(file);
+        }
+        batch->remaining = queued.size();
+    }
+    
+    for (const auto& file : queued) {
+        pool_.submit([this, file, batch]() { probe_one(file.first, file.second, batch); });
+    }
+    return queued.size();
+}
+
+void MediaProbe::probe_one(const std::string& path, const SourceStamp& stamp, const std::shared_ptr<Batch>& batch) {
+    if (!stopping_) {
+        ProbeFunction probe;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            probe = probe_;
+        }
+        
+        Entry entry;
+        entry.stamp = stamp;
+        std::string error;
+        entry.ok = probe ? probe(path, entry.info, error) : probe_file(path, entry.info, error);
+        if (!entry.ok) {
+            LOG_WARNING("Failed to probe media file " + path + ": " + error);
+        }
+        
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_[path] = entry;
+        probe_count_++;
+    }
+    
+    bool last = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        in_flight_.erase(path);
+        last = --batch->remaining == 0;
+    }
+    if (last && !stopping_) {
+        finish_batch(*batch);
+    }
+}
+
+void MediaProbe::finish_batch(const Batch& batch) {
+    save();
+    
+    std::lock_guard<std::mutex> lock(listener_mutex_);
+    for (const auto& pair : listeners_) {
+        pair.second(batch.paths);
+    }
+}
+
+bool MediaProbe::lookup(const std::string& path, MediaInfo& info) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(path);
+    if (it == entries_.end() || !it->second.ok) {
+        return false;
+    }
+    info = it->second.info;
+    return true;
+}
+
+int MediaProbe::add_listener(Listener listener) {
+    std::lock_guard<std::mutex> lock(listener_mutex_);
+    int id = next_listener_id_++;
+    listeners_.emplace(id, std::move(listener));
+    return id;
+}
+
+void MediaProbe::remove_listener(int id) {
+    std::lock_guard<std::mutex> lock(listener_mutex_);
+    listeners_.erase(id);
+}
+
+void MediaProbe::wait_idle() {
+    pool_.wait_idle();
+}
+
+size_t MediaProbe::get_entry_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+size_t MediaProbe::get_probe_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return probe_count_;
+}
+
+const std::string& MediaProbe::get_directory() const {
+    return directory_;
+}
+
+std::string MediaProbe::get_cache_path() const {
+    if (directory_.empty()) {
+        return "";
+    }
+    return (std::filesystem::path(directory_) / CACHE_FILE_NAME).string();
+}
+
+bool MediaProbe::probe_file(const std::string& path, MediaInfo& info, std::string& error) {
+#ifdef HAVE_LIBAVFORMAT
+    char message[AV_ERROR_MAX_STRING_SIZE];
+    AVFormatContext* format = nullptr;
+    int result = avformat_open_input(&format, path.c_str(), nullptr, nullptr);
+    if (result < 0) {
+        error = av_make_error_string(message, sizeof(message), result);
+        return false;
+    }
+    result = avformat_find_stream_info(format, nullptr);
+    if (result < 0) {
+        error = av_make_error_string(message, sizeof(message), result);
+        avformat_close_input(&format);
+        return false;
+    }
+    
+    info = MediaInfo();
+    if (format->duration != AV_NOPTS_VALUE && format->duration > 0) {
+        info.duration_ms = av_rescale(format->duration, 1000, AV_TIME_BASE);
+    }
+    
+    // Cover art of an audio file is a video stream too, but not one that plays
+    int video = av_find_best_stream(format, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    if (video >= 0 && !(format->streams[video]->disposition & AV_DISPOSITION_ATTACHED_PIC)) {
+        AVStream* stream = format->streams[video];
+        info.width = static_cast<uint32_t>(stream->codecpar->width);
+        info.height = static_cast<uint32_t>(stream->codecpar->height);
+        AVRational rate = av_guess_frame_rate(format, stream, nullptr);
+        if (rate.num > 0 && rate.den > 0) {
+            info.fps_num = static_cast<uint32_t>(rate.num);
+            info.fps_den = static_cast<uint32_t>(rate.den);
+        }
+        if (info.duration_ms == 0 && stream->duration != AV_NOPTS_VALUE && stream->duration > 0) {
+            info.duration_ms = av_rescale_q(stream->duration, stream->time_base, AVRational{1, 1000});
+        }
+    }
+    
+    int audio = av_find_best_stream(format, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+    if (audio >= 0) {
+        const AVCodecParameters* codec = format->streams[audio]->codecpar;
+        info.sample_rate = static_cast<uint32_t>(codec->sample_rate);
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(57, 24, 100)
+        info.audio_channels = static_cast<uint32_t>(codec->ch_layout.nb_channels);
+        if (codec->ch_layout.order == AV_CHANNEL_ORDER_NATIVE) {
+            info.channel_layout = codec->ch_layout.u.mask;
+        }
+#else
+        info.audio_channels = static_cast<uint32_t>(codec->channels);
+        info.channel_layout = codec->channel_layout;
+#endif
+    }
+    
+    avformat_close_input(&format);
+    return true;
+#else
+    (void)path;
+    (void)info;
+    error = "built without libavformat";
+    return false;
+#endif
+}
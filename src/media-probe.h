@@ -0,0 +1,140 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+#include "schedule-cache.h"
+#include "utils/worker-pool.h"
+
+// What probing a media file found. Fields it could not find stay zero: a
+// still image has no duration, an audio file no frame rate or size.
+struct MediaInfo {
+    int64_t duration_ms;
+    uint32_t fps_num;
+    uint32_t fps_den;
+    uint32_t width;
+    uint32_t height;
+    uint32_t audio_channels;
+    uint32_t sample_rate;
+    uint64_t channel_layout;    // Speaker mask as libavutil's AV_CH_*, 0 if not in native order
+    
+    MediaInfo()
+        : duration_ms(0), fps_num(0), fps_den(0), width(0), height(0)
+        , audio_channels(0), sample_rate(0), channel_layout(0) {}
+    
+    bool has_video() const { return width > 0 && height > 0; }
+    bool has_audio() const { return audio_channels > 0; }
+};
+
+// Durations and stream layouts of the media files schedules refer to, read
+// in the background and kept across restarts.
+//
+// request() stats each file and queues those not yet known at their current
+// size and modification time on a pool of its own, a couple of threads by
+// default, so probing never takes more than that from the schedule loads or
+// the video thread. Results, failures included so a broken file is not
+// opened again at every start, are kept in memory and after each batch
+// written to one flat binary file in the cache directory, renamed over the
+// previous one. Listeners hear which files a batch probed once it is done.
+class MediaProbe {
+public:
+    // Bump whenever the layout of the persisted file changes
+    static constexpr uint32_t FORMAT_VERSION = 1;
+    static constexpr size_t DEFAULT_THREADS = 2;
+    
+    // Reads what it can of the file at path; false with error set if it could not be opened
+    using ProbeFunction = std::function<bool(const std::string& path, MediaInfo& info, std::string& error)>;
+    using Listener = std::function<void(const std::vector<std::string>& paths)>;
+    
+    // Nothing is persisted without a directory
+    explicit MediaProbe(const std::string& directory = "", size_t threads = DEFAULT_THREADS);
+    ~MediaProbe();
+    
+    // The instance all channels and the editor share, persisted next to the
+    // schedule cache (Config::get_schedule_cache_path()) and loaded on first use
+    static std::shared_ptr<MediaProbe> shared();
+    
+    // Whether files can be probed at all: libavformat was built in, or a
+    // probe function was set. Without either request() queues nothing.
+    bool is_available() const;
+    
+    // Replaces libavformat, for tests and benchmarks
+    void set_probe_function(ProbeFunction probe);
+    
+    // Reads the persisted results, replacing those in memory. A file of
+    // another format version or byte order, or damaged, is ignored and
+    // rewritten after the next batch. Returns the number of entries read.
+    size_t load();
+    bool save() const;
+    
+    // Queues the files not probed at their current size and time, or not at
+    // all; files that do not exist are skipped. A changed file is forgotten
+    // until probed again. Returns the number of files queued.
+    size_t request(const std::vector<std::string>& paths);
+    
+    // What the last successful probe of path found, without touching the disk
+    bool lookup(const std::string& path, MediaInfo& info) const;
+    
+    // Listeners are called on a probe thread; remove_listener() returns once
+    // no call to the removed one is running
+    int add_listener(Listener listener);
+    void remove_listener(int id);
+    
+    // Blocks until every queued file was probed and its listeners called
+    void wait_idle();
+    
+    size_t get_entry_count() const;
+    size_t get_probe_count() const;     // Probes run since construction
+    const std::string& get_directory() const;
+    std::string get_cache_path() const;
+    
+    // Opens the file with libavformat and reads its duration, the frame rate
+    // and size of its video and the layout of its audio
+    static bool probe_file(const std::string& path, MediaInfo& info, std::string& error);
+
+private:
+    struct Entry {
+        SourceStamp stamp;      // Of the file when it was probed
+        bool ok;
+        MediaInfo info;
+        
+        Entry() : ok(false) {}
+    };
+    
+    struct Batch {
+        std::vector<std::string> paths;
+        size_t remaining;
+    };
+    
+    void probe_one(const std::string& path, const SourceStamp& stamp, const std::shared_ptr<Batch>& batch);
+    void finish_batch(const Batch& batch);
+    
+    std::string directory_;
+    
+    mutable std::mutex mutex_;
+    std::map<std::string, Entry> entries_;
+    std::set<std::string> in_flight_;
+    ProbeFunction probe_;
+    size_t probe_count_;
+    std::atomic<bool> stopping_;        // Queued files are dropped once set
+    
+    // Held while listeners run, so removing one waits for its call to end
+    std::mutex listener_mutex_;
+    std::map<int, Listener> listeners_;
+    int next_listener_id_;
+    
+    mutable std::mutex save_mutex_;     // One writer of the cache file at a time
+    
+    // Last, so its threads stop before the members above go away
+    WorkerPool pool_;
+    
+    // Prevent copying
+    MediaProbe(const MediaProbe&) = delete;
+    MediaProbe& operator=(const MediaProbe&) = delete;
+};
@@ -1,12 +1,16 @@
 #include "playlist-manager.h"
+#include "schedule-cache.h"
+#include "schedule-parser.h"
 #include "utils/config.h"
 #include "utils/logger.h"
-#include <fstream>
 #include <sstream>
 #include <algorithm>
 #include <filesystem>
+#include <chrono>
 #include <ctime>
-#include <regex>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -14,7 +18,64 @@
 #include <unistd.h>
 #endif
 
-PlaylistManager::PlaylistManager() {
+namespace {
+
+// Items of one key in file order, consumed front to back while matching
+struct MatchCandidates {
+    std::vector<const ScheduledItem*> items;
+    size_t next = 0;
+};
+
+std::string match_key(const Playlist& playlist, const ScheduledItem& item) {
+    return playlist.name + '\n' + item.name + '\n' + item.source;
+}
+
+bool same_calendar(const ScheduledItem& a, const ScheduledItem& b) {
+    if (!a.calendar || !b.calendar) {
+        return !a.calendar && !b.calendar;
+    }
+    return a.calendar == b.calendar || *a.calendar == *b.calendar;
+}
+
+bool same_content(const ScheduledItem& a, const ScheduledItem& b) {
+    return a.file_path == b.file_path && a.duration == b.duration &&
+           a.detected_duration_ms == b.detected_duration_ms && a.loop == b.loop &&
+           a.scene == b.scene && a.trigger_mode == b.trigger_mode && a.priority == b.priority &&
+           a.playlist_priority == b.playlist_priority;
+}
+
+// Conflicts logged in detail per publish; the rest are only counted
+const size_t LOGGED_CONFLICTS = 20;
+
+ScheduleConflict describe_conflict(const ScheduleTimeline& timeline, int weekday,
+                                   const ScheduleTimeline::Conflict& conflict) {
+    ScheduleConflict result;
+    result.weekday = weekday;
+    result.time = ScheduleTimeline::format_time(conflict.start_ms);
+    result.winner = timeline.get_item(conflict.winner);
+    result.loser = timeline.get_item(conflict.loser);
+    result.dropped = conflict.dropped;
+    return result;
+}
+
+} // namespace
+
+std::shared_ptr<const ScheduledItem> ScheduleSnapshot::find_item(const std::string& item_id) const {
+    auto it = items.find(item_id);
+    return (it != items.end()) ? it->second : nullptr;
+}
+
+PlaylistManager::PlaylistManager()
+    : duplicate_ids_(false)
+    , channel_(Config::DEFAULT_CHANNEL)
+    , clock_(Clock::system())
+    , cache_directory_set_(false)
+    , horizon_days_(ScheduleTimeline::DEFAULT_HORIZON_DAYS)
+    , load_pool_(std::make_shared<WorkerPool>())
+    , probe_listener_(0)
+    , snapshot_(std::make_shared<const ScheduleSnapshot>())
+    , snapshot_version_(0)
+{
 }
 
 PlaylistManager::~PlaylistManager() {
@@ -22,22 +83,40 @@ PlaylistManager::~PlaylistManager() {
 }
 
 bool PlaylistManager::initialize() {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    LOG_INFO("Initializing playlist manager");
+    LOG_INFO("Initializing playlist manager for channel " + get_channel());
     
     try {
-        // Load all configured schedule files
+        std::shared_ptr<MediaProbe> probe;
+        bool attached;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!cache_directory_set_) {
+                cache_directory_ = Config::get_schedule_cache_path();
+                cache_directory_set_ = true;
+            }
+            probe = media_probe_;
+            attached = probe_listener_ != 0;
+        }
+        if (!attached) {
+            set_media_probe(probe ? probe : MediaProbe::shared());
+        }
+        
+        // Load all schedule files configured for this channel: read side by
+        // side, then published once. Not under mutex_, which reload_files
+        // only takes to apply what it read.
+        std::vector<std::string> file_paths;
         auto schedule_files = Config::get_schedule_files();
         for (const auto& file_info : schedule_files) {
-            if (file_info.enabled) {
-                if (load_schedule_file(file_info.path)) {
-                    LOG_INFO("Loaded schedule file: " + file_info.path);
-                } else {
-                    LOG_WARNING("Failed to load schedule file: " + file_info.path);
-                }
+            if (file_info.enabled && is_channel_file(file_info)) {
+                file_paths.push_back(file_info.path);
             }
         }
+        reload_files(file_paths);
+        
+        for (const auto& time : get_load_times()) {
+            LOG_INFO("Loaded schedule file: " + time.path + " (Items: " + std::to_string(time.items) + ", " +
+                     std::to_string(time.read_us / 1000) + "ms" + (time.cached ? ", cached)" : ")"));
+        }
         
         // Setup file watching for changes
         setup_file_watching();
@@ -52,67 +131,120 @@ bool PlaylistManager::initialize() {
 }
 
 void PlaylistManager::cleanup() {
+    detach_media_probe();
     std::lock_guard<std::mutex> lock(mutex_);
     
     cleanup_file_watching();
     
     playlists_.clear();
-    items_.clear();
-    file_to_playlist_id_.clear();
+    files_.clear();
+    publish_snapshot();
     
     LOG_INFO("Playlist manager cleaned up");
 }
 
-bool PlaylistManager::load_schedule_file(const std::string& file_path) {
+void PlaylistManager::set_channel(const std::string& channel) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    channel_ = channel.empty() ? Config::DEFAULT_CHANNEL : channel;
+}
+
+std::string PlaylistManager::get_channel() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return channel_;
+}
+
+void PlaylistManager::set_clock(std::shared_ptr<Clock> clock) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    clock_ = clock ? clock : Clock::system();
+}
+
+void PlaylistManager::set_horizon_days(int days) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    horizon_days_ = std::max(days, 0);
+}
+
+void PlaylistManager::set_cache_directory(const std::string& directory) {
     std::lock_guard<std::mutex> lock(mutex_);
+    cache_directory_ = directory;
+    cache_directory_set_ = true;
+}
+
+void PlaylistManager::set_load_threads(size_t threads) {
+    auto pool = std::make_shared<WorkerPool>(threads);
+    std::lock_guard<std::mutex> lock(mutex_);
+    load_pool_ = std::move(pool);
+}
+
+void PlaylistManager::set_media_probe(std::shared_ptr<MediaProbe> probe) {
+    detach_media_probe();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        media_probe_ = probe;
+    }
+    if (!probe) {
+        return;
+    }
     
+    int listener = probe->add_listener([this](const std::vector<std::string>& paths) {
+        apply_media_info(paths);
+    });
+    std::lock_guard<std::mutex> lock(mutex_);
+    probe_listener_ = listener;
+}
+
+void PlaylistManager::detach_media_probe() {
+    // Not under mutex_, which a listener call running now may be waiting for
+    std::shared_ptr<MediaProbe> probe;
+    int listener;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        probe = media_probe_;
+        listener = probe_listener_;
+        probe_listener_ = 0;
+    }
+    if (probe && listener != 0) {
+        probe->remove_listener(listener);
+    }
+}
+
+bool PlaylistManager::is_channel_file(const Config::ScheduleFile& file_info) const {
+    const std::string& file_channel = file_info.channel.empty() ? Config::DEFAULT_CHANNEL : file_info.channel;
+    return file_channel == get_channel();
+}
+
+bool PlaylistManager::load_schedule_file(const std::string& file_path) {
     try {
-        // Check if file exists
-        if (!std::filesystem::exists(file_path)) {
-            LOG_WARNING("Schedule file does not exist: " + file_path);
-            return false;
-        }
+        // Stamped before reading, so a write racing the read shows as a change later
+        LoadedFile file;
+        ScheduleCache::stat_source(file_path, file.stamp);
         
-        // Validate file format
-        if (!validate_schedule_file(file_path)) {
-            LOG_ERROR("Invalid schedule file format: " + file_path);
+        auto read_start = std::chrono::steady_clock::now();
+        std::vector<Playlist> playlists;
+        FileLoadTime time;
+        if (!read_schedule_file(file_path, playlists, time.cached)) {
             return false;
         }
+        prepare_playlists(playlists);
+        time.read_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - read_start).count();
+        time.path = file_path;
         
-        // Parse the file
-        Playlist playlist;
-        if (!parse_json_file(file_path, playlist)) {
-            LOG_ERROR("Failed to parse schedule file: " + file_path);
-            return false;
-        }
-        
-        // Remove existing playlist from this file if it exists
-        auto it = file_to_playlist_id_.find(file_path);
-        if (it != file_to_playlist_id_.end()) {
-            auto playlist_it = playlists_.find(it->second);
-            if (playlist_it != playlists_.end()) {
-                // Remove items from this playlist
-                for (const auto& item : playlist_it->second.items) {
-                    items_.erase(item.id);
-                }
-                playlists_.erase(playlist_it);
-            }
+        size_t item_count = 0;
+        for (const auto& playlist : playlists) {
+            item_count += playlist.items.size();
         }
-        
-        // Add new playlist
-        std::string playlist_id = generate_playlist_id(playlist.name);
-        playlist.id = playlist_id;
-        playlists_[playlist_id] = playlist;
-        file_to_playlist_id_[file_path] = playlist_id;
-        
-        // Add items to the global item map
-        for (auto& item : playlist.items) {
-            item.id = generate_item_id(item);
-            items_[item.id] = std::make_shared<ScheduledItem>(item);
+        time.items = item_count;
+        size_t playlist_count = playlists.size();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            load_times_.assign(1, std::move(time));
+            ScheduleDiff diff;
+            store_playlists(file_path, std::move(file), std::move(playlists), diff);
+            publish_changes(std::move(diff));
         }
         
         LOG_INFO("Successfully loaded schedule file: " + file_path + 
-                " (Playlist: " + playlist.name + ", Items: " + std::to_string(playlist.items.size()) + ")");
+                " (Playlists: " + std::to_string(playlist_count) + ", Items: " + std::to_string(item_count) + ")");
         
         return true;
         
@@ -122,140 +254,660 @@ bool PlaylistManager::load_schedule_file(const std::string& file_path) {
     }
 }
 
-void PlaylistManager::unload_schedule_file(const std::string& file_path) {
+bool PlaylistManager::read_schedule_file(const std::string& file_path, std::vector<Playlist>& playlists,
+                                         bool& cached) const {
+    // Check if file exists
+    if (!std::filesystem::exists(file_path)) {
+        LOG_WARNING("Schedule file does not exist: " + file_path);
+        return false;
+    }
+    
+    std::string cache_directory;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cache_directory = cache_directory_;
+    }
+    
+    // Compiled copy from an earlier start, if the file has not changed since
+    ParsedSchedule schedule;
+    ScheduleCache cache(cache_directory);
+    cached = !cache_directory.empty() && cache.load(file_path, schedule);
+    if (!cached) {
+        // Validates and parses in the same pass
+        SourceStamp stamp;
+        bool stamped = ScheduleCache::stat_source(file_path, stamp);
+        ScheduleParser parser;
+        if (!parser.parse_file(file_path, schedule)) {
+            LOG_ERROR("Failed to parse schedule file " + file_path + ": " + parser.get_error());
+            return false;
+        }
+        
+        if (!cache_directory.empty() && stamped) {
+            cache.store(file_path, stamp, schedule);
+        }
+    }
+    
+    for (const auto& warning : schedule.warnings) {
+        LOG_WARNING(file_path + ": " + warning);
+    }
+    
+    playlists = std::move(schedule.playlists);
+    return true;
+}
+
+void PlaylistManager::prepare_playlists(std::vector<Playlist>& playlists) const {
+    // Ids depend on nothing but the playlist, so they are assigned before
+    // mutex_ is taken, on whichever thread read the file
+    for (auto& playlist : playlists) {
+        playlist.id = generate_playlist_id(playlist.name);
+        for (auto& item : playlist.items) {
+            item.id = generate_item_id(item);
+            item.playlist_priority = playlist.priority;
+        }
+    }
+    
+    // Files of items without a duration go to the probe, which skips those
+    // it knows already; what it finds is filled in when they are stored
+    std::shared_ptr<MediaProbe> probe;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        probe = media_probe_;
+    }
+    if (probe) {
+        std::vector<std::string> files;
+        for (const auto& playlist : playlists) {
+            for (const auto& item : playlist.items) {
+                if (item.duration <= 0 && !item.file_path.empty()) {
+                    files.push_back(item.file_path);
+                }
+            }
+        }
+        std::sort(files.begin(), files.end());
+        files.erase(std::unique(files.begin(), files.end()), files.end());
+        probe->request(files);
+    }
+}
+
+bool PlaylistManager::fill_detected_durations(Playlist& playlist) const {
+    // Called with mutex_ held, so a probe finishing now is either seen here
+    // or applies to the stored playlist once this publish is out
+    if (!media_probe_) {
+        return false;
+    }
+    
+    bool changed = false;
+    for (auto& item : playlist.items) {
+        MediaInfo info;
+        int64_t detected = 0;
+        if (item.duration <= 0 && !item.file_path.empty() && media_probe_->lookup(item.file_path, info)) {
+            detected = info.duration_ms;
+        }
+        changed = changed || detected != item.detected_duration_ms;
+        item.detected_duration_ms = detected;
+    }
+    return changed;
+}
+
+void PlaylistManager::apply_media_info(const std::vector<std::string>& paths) {
+    // Called on a probe thread once a batch of files was probed. Playlists
+    // using them are copied with the durations found and published like a
+    // reload that modified those items.
+    std::unordered_set<std::string> probed(paths.begin(), paths.end());
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    std::vector<std::shared_ptr<const Playlist>> before;
+    std::vector<std::shared_ptr<const Playlist>> after;
+    for (auto& pair : playlists_) {
+        bool uses = false;
+        for (const auto& item : pair.second->items) {
+            uses = uses || (item.duration <= 0 && probed.count(item.file_path) > 0);
+        }
+        if (!uses) {
+            continue;
+        }
+        
+        Playlist playlist = *pair.second;
+        if (!fill_detected_durations(playlist)) {
+            continue;
+        }
+        before.push_back(pair.second);
+        pair.second = std::make_shared<const Playlist>(std::move(playlist));
+        after.push_back(pair.second);
+    }
+    if (after.empty()) {
+        return;
+    }
+    
+    ScheduleDiff diff;
+    diff_playlists(before, after, *snapshot_, diff);
+    LOG_INFO("Detected media durations for " + std::to_string(diff.modified.size()) + " item(s)");
+    publish_changes(std::move(diff));
+}
+
+void PlaylistManager::add_playlist(const std::string& file_path, Playlist playlist) {
+    std::vector<Playlist> playlists;
+    playlists.push_back(std::move(playlist));
+    add_playlists(file_path, std::move(playlists));
+}
+
+void PlaylistManager::add_playlists(const std::string& file_path, std::vector<Playlist> playlists) {
+    prepare_playlists(playlists);
     std::lock_guard<std::mutex> lock(mutex_);
+    ScheduleDiff diff;
+    store_playlists(file_path, LoadedFile(), std::move(playlists), diff);
+    publish_changes(std::move(diff));
+}
+
+void PlaylistManager::store_playlists(const std::string& file_path, LoadedFile file, std::vector<Playlist> playlists,
+                                      ScheduleDiff& diff) {
+    // Called with mutex_ held, playlists prepared; replaces whatever the file
+    // held before and adds the difference to diff
+    auto before = remove_playlists(file_path);
     
-    auto it = file_to_playlist_id_.find(file_path);
-    if (it != file_to_playlist_id_.end()) {
-        std::string playlist_id = it->second;
+    std::vector<std::shared_ptr<const Playlist>> after;
+    after.reserve(playlists.size());
+    for (auto& playlist : playlists) {
+        std::string playlist_id = playlist.id;
+        if (!playlist.default_idle.empty()) {
+            default_idle_content_ = playlist.default_idle;
+        }
+        fill_detected_durations(playlist);
         
-        auto playlist_it = playlists_.find(playlist_id);
-        if (playlist_it != playlists_.end()) {
-            // Remove items from this playlist
-            for (const auto& item : playlist_it->second.items) {
-                items_.erase(item.id);
+        auto stored = std::make_shared<const Playlist>(std::move(playlist));
+        playlists_[playlist_id] = stored;
+        file.playlist_ids.push_back(playlist_id);
+        after.push_back(std::move(stored));
+    }
+    files_[file_path] = std::move(file);
+    
+    diff_playlists(before, after, *snapshot_, diff);
+}
+
+std::vector<std::shared_ptr<const Playlist>> PlaylistManager::remove_playlists(const std::string& file_path) {
+    // Called with mutex_ held; returns what the file held
+    std::vector<std::shared_ptr<const Playlist>> removed;
+    auto it = files_.find(file_path);
+    if (it == files_.end()) {
+        return removed;
+    }
+    
+    for (const auto& playlist_id : it->second.playlist_ids) {
+        auto playlist = playlists_.find(playlist_id);
+        if (playlist != playlists_.end()) {
+            removed.push_back(playlist->second);
+            playlists_.erase(playlist);
+        }
+    }
+    files_.erase(it);
+    return removed;
+}
+
+void PlaylistManager::diff_playlists(const std::vector<std::shared_ptr<const Playlist>>& before,
+                                     const std::vector<std::shared_ptr<const Playlist>>& after,
+                                     const ScheduleSnapshot& previous, ScheduleDiff& diff) const {
+    // The published copy of an old item, which the new snapshot drops
+    auto published = [&previous](const ScheduledItem& item) {
+        auto found = previous.find_item(item.id);
+        return found ? found : std::make_shared<const ScheduledItem>(item);
+    };
+    
+    std::unordered_map<std::string, MatchCandidates> old_items;
+    for (const auto& playlist : before) {
+        if (!playlist->enabled) {
+            continue;
+        }
+        for (const auto& item : playlist->items) {
+            old_items[match_key(*playlist, item)].items.push_back(&item);
+        }
+    }
+    
+    for (const auto& playlist : after) {
+        if (!playlist->enabled) {
+            continue;
+        }
+        for (const auto& item : playlist->items) {
+            auto it = old_items.find(match_key(*playlist, item));
+            if (it == old_items.end() || it->second.next == it->second.items.size()) {
+                diff.added.emplace_back(playlist, &item);
+                continue;
             }
             
-            playlists_.erase(playlist_it);
-            LOG_INFO("Unloaded playlist: " + playlist_id);
+            const ScheduledItem& old_item = *it->second.items[it->second.next++];
+            ScheduleDiff::ItemPtr new_item(playlist, &item);
+            bool same_slot = old_item.time == item.time && old_item.days == item.days &&
+                             same_calendar(old_item, item);
+            if (same_slot && same_content(old_item, item)) {
+                diff.unchanged.emplace_back(published(old_item), std::move(new_item));
+            } else if (!same_slot) {
+                diff.retimed.emplace_back(published(old_item), std::move(new_item));
+            } else {
+                diff.modified.emplace_back(published(old_item), std::move(new_item));
+            }
         }
-        
-        file_to_playlist_id_.erase(it);
+    }
+    
+    for (const auto& pair : old_items) {
+        for (size_t i = pair.second.next; i < pair.second.items.size(); ++i) {
+            diff.removed.push_back(published(*pair.second.items[i]));
+        }
+    }
+}
+
+void PlaylistManager::fill_snapshot(ScheduleSnapshot& snapshot) {
+    // Called with mutex_ held
+    snapshot.version = ++snapshot_version_;
+    snapshot.default_idle_content = default_idle_content_;
+    snapshot.playlists.reserve(playlists_.size());
+    for (const auto& pair : playlists_) {
+        snapshot.playlists.push_back(pair.second);
+    }
+}
+
+void PlaylistManager::publish_changes(ScheduleDiff diff) {
+    // Called with mutex_ held. Starts from the published snapshot and only
+    // swaps the items diff names; the timeline is patched, not rebuilt, so
+    // weekdays the change does not touch are shared with the previous one.
+    auto previous = std::atomic_load(&snapshot_);
+    
+    // Past half the schedule, building from scratch is cheaper than patching;
+    // unchanged items of the files read again are moved over, so they count.
+    // The first load is all build.
+    size_t touched = diff.changed_count() + diff.unchanged.size();
+    if (duplicate_ids_ || previous->items.empty() || touched > previous->items.size() / 2) {
+        publish_snapshot(std::move(diff));
+        return;
+    }
+    
+    auto snapshot = std::make_shared<ScheduleSnapshot>();
+    snapshot->items = previous->items;
+    
+    std::vector<std::shared_ptr<const ScheduledItem>> removed;
+    auto remove = [&](const std::shared_ptr<const ScheduledItem>& item) {
+        auto it = snapshot->items.find(item->id);
+        if (it != snapshot->items.end() && it->second == item) {
+            snapshot->items.erase(it);
+            removed.push_back(item);
+        }
+    };
+    for (const auto& item : diff.removed) {
+        remove(item);
+    }
+    for (const auto& pair : diff.retimed) {
+        remove(pair.first);
+    }
+    for (const auto& pair : diff.modified) {
+        remove(pair.first);
+    }
+    
+    std::vector<std::shared_ptr<const ScheduledItem>> added;
+    auto add = [&](const std::shared_ptr<const ScheduledItem>& item) {
+        if (!snapshot->items.emplace(item->id, item).second) {
+            return false;
+        }
+        added.push_back(item);
+        return true;
+    };
+    bool unique = true;
+    for (const auto& item : diff.added) {
+        unique = unique && add(item);
+    }
+    for (const auto& pair : diff.retimed) {
+        unique = unique && add(pair.second);
+    }
+    for (const auto& pair : diff.modified) {
+        unique = unique && add(pair.second);
+    }
+    
+    if (!unique) {
+        // An id now appears twice; only a full build settles which copy is kept
+        publish_snapshot(std::move(diff));
+        return;
+    }
+    
+    // Items point into their playlist, so even unchanged ones move over to the
+    // file's new playlists; the old ones are freed with the last snapshot using them
+    std::vector<std::pair<std::shared_ptr<const ScheduledItem>, std::shared_ptr<const ScheduledItem>>> replaced;
+    for (const auto& pair : diff.unchanged) {
+        auto it = snapshot->items.find(pair.first->id);
+        if (it != snapshot->items.end() && it->second == pair.first) {
+            it->second = pair.second;
+            replaced.push_back(pair);
+        }
+    }
+    
+    fill_snapshot(*snapshot);
+    snapshot->timeline.patch(previous->timeline, removed, added, replaced);
+    snapshot->timeline.advance(get_current_date());
+    snapshot->changes = std::move(diff);
+    log_conflicts(*previous, *snapshot);
+    
+    std::atomic_store(&snapshot_, std::shared_ptr<const ScheduleSnapshot>(std::move(snapshot)));
+}
+
+void PlaylistManager::publish_snapshot(ScheduleDiff changes) {
+    // Called with mutex_ held. Compiles the whole working copy into a fresh
+    // snapshot; readers holding the previous one are not affected.
+    auto snapshot = std::make_shared<ScheduleSnapshot>();
+    fill_snapshot(*snapshot);
+    
+    duplicate_ids_ = false;
+    for (const auto& playlist : snapshot->playlists) {
+        if (!playlist->enabled) {
+            continue;
+        }
+        for (const auto& item : playlist->items) {
+            auto& stored = snapshot->items[item.id];
+            duplicate_ids_ = duplicate_ids_ || stored;
+            stored = std::shared_ptr<const ScheduledItem>(playlist, &item);
+        }
+    }
+    
+    std::vector<std::shared_ptr<const ScheduledItem>> items;
+    items.reserve(snapshot->items.size());
+    for (const auto& pair : snapshot->items) {
+        items.push_back(pair.second);
+    }
+    snapshot->timeline.build(items, get_current_date(), horizon_days_);
+    snapshot->changes = std::move(changes);
+    log_conflicts(*std::atomic_load(&snapshot_), *snapshot);
+    
+    std::atomic_store(&snapshot_, std::shared_ptr<const ScheduleSnapshot>(std::move(snapshot)));
+}
+
+void PlaylistManager::unload_schedule_file(const std::string& file_path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    if (files_.count(file_path)) {
+        LOG_INFO("Unloaded schedule file: " + file_path);
+        ScheduleDiff diff;
+        diff_playlists(remove_playlists(file_path), {}, *snapshot_, diff);
+        publish_changes(std::move(diff));
     }
 }
 
 void PlaylistManager::reload_schedules() {
     LOG_INFO("Reloading all schedule files");
     
-    // Clear existing data
-    playlists_.clear();
-    items_.clear();
-    file_to_playlist_id_.clear();
-    
-    // Reload all configured schedule files
+    std::vector<std::string> file_paths;
     auto schedule_files = Config::get_schedule_files();
     for (const auto& file_info : schedule_files) {
-        if (file_info.enabled) {
-            load_schedule_file(file_info.path);
+        if (file_info.enabled && is_channel_file(file_info)) {
+            file_paths.push_back(file_info.path);
         }
     }
+    
+    reload_files(file_paths);
 }
 
-std::vector<Playlist> PlaylistManager::get_playlists() const {
+bool PlaylistManager::reload_files(const std::vector<std::string>& file_paths) {
+    auto start = std::chrono::steady_clock::now();
+    
+    std::map<std::string, LoadedFile> known;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& pair : files_) {
+            LoadedFile file;
+            file.stamp = pair.second.stamp;
+            file.hash = pair.second.hash;
+            file.hashed = pair.second.hashed;
+            known.emplace(pair.first, std::move(file));
+        }
+    }
+    
+    // Find and parse the changed files outside the lock, side by side on the
+    // load pool; readers keep the old schedule meanwhile. A file whose time
+    // changed but not its contents is only restamped.
+    struct ChangedFile {
+        std::string path;
+        LoadedFile file;
+        std::vector<Playlist> playlists;
+    };
+    enum class Outcome { Unchanged, Restamped, Changed, Failed };
+    struct FileRead {
+        Outcome outcome = Outcome::Failed;
+        ChangedFile update;
+        FileLoadTime time;
+    };
+    
+    std::vector<std::string> paths;
+    std::set<std::string> wanted;
+    for (const auto& file_path : file_paths) {
+        if (wanted.insert(file_path).second) {
+            paths.push_back(file_path);
+        }
+    }
+    
+    std::shared_ptr<WorkerPool> pool;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pool = load_pool_;
+    }
+    
+    std::vector<FileRead> reads(paths.size());
+    pool->for_each(paths.size(), [&](size_t index) {
+        const std::string& file_path = paths[index];
+        FileRead& read = reads[index];
+        try {
+            LoadedFile file;
+            if (!ScheduleCache::stat_source(file_path, file.stamp)) {
+                LOG_WARNING("Schedule file does not exist: " + file_path);
+                return;
+            }
+            
+            auto it = known.find(file_path);
+            if (it != known.end() && it->second.stamp == file.stamp) {
+                read.outcome = Outcome::Unchanged;
+                return;
+            }
+            
+            file.hashed = ScheduleCache::hash_source(file_path, file.hash);
+            if (it != known.end() && it->second.hashed && file.hashed && it->second.hash == file.hash) {
+                read.update.file = std::move(file);
+                read.outcome = Outcome::Restamped;
+                return;
+            }
+            
+            auto read_start = std::chrono::steady_clock::now();
+            if (!read_schedule_file(file_path, read.update.playlists, read.time.cached)) {
+                return;
+            }
+            prepare_playlists(read.update.playlists);
+            read.time.read_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - read_start).count();
+            read.time.path = file_path;
+            for (const auto& playlist : read.update.playlists) {
+                read.time.items += playlist.items.size();
+            }
+            
+            read.update.path = file_path;
+            read.update.file = std::move(file);
+            read.outcome = Outcome::Changed;
+            
+        } catch (const std::exception& e) {
+            LOG_ERROR("Exception loading schedule file " + file_path + ": " + std::string(e.what()));
+        }
+    });
+    
+    std::vector<ChangedFile> changed;
+    std::vector<std::pair<std::string, LoadedFile>> restamped;
+    std::vector<FileLoadTime> load_times;
+    int64_t read_us = 0;
+    size_t slowest = 0;
+    size_t failed = 0;
+    for (size_t index = 0; index < reads.size(); ++index) {
+        FileRead& read = reads[index];
+        switch (read.outcome) {
+        case Outcome::Unchanged:
+            break;
+        case Outcome::Restamped:
+            restamped.emplace_back(paths[index], std::move(read.update.file));
+            break;
+        case Outcome::Changed:
+            LOG_DEBUG("Read " + paths[index] + " in " + std::to_string(read.time.read_us) + "us" +
+                      (read.time.cached ? " (cached)" : ""));
+            read_us += read.time.read_us;
+            if (load_times.empty() || read.time.read_us > load_times[slowest].read_us) {
+                slowest = load_times.size();
+            }
+            load_times.push_back(std::move(read.time));
+            changed.push_back(std::move(read.update));
+            break;
+        case Outcome::Failed:
+            wanted.erase(paths[index]);
+            failed++;
+            break;
+        }
+    }
+    reads.clear();
+    
+    // Then apply the differences in one go
     std::lock_guard<std::mutex> lock(mutex_);
+    load_times_ = std::move(load_times);
+    for (auto& pair : restamped) {
+        auto it = files_.find(pair.first);
+        if (it != files_.end()) {
+            it->second.stamp = pair.second.stamp;
+            it->second.hash = pair.second.hash;
+            it->second.hashed = true;
+        }
+    }
     
-    std::vector<Playlist> result;
-    result.reserve(playlists_.size());
+    ScheduleDiff diff;
+    std::vector<std::string> dropped;
+    for (const auto& pair : files_) {
+        if (!wanted.count(pair.first)) {
+            dropped.push_back(pair.first);
+        }
+    }
+    for (const auto& file_path : dropped) {
+        diff_playlists(remove_playlists(file_path), {}, *snapshot_, diff);
+    }
+    for (auto& update : changed) {
+        store_playlists(update.path, std::move(update.file), std::move(update.playlists), diff);
+    }
     
-    for (const auto& pair : playlists_) {
-        result.push_back(pair.second);
+    auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    std::string summary = std::to_string(changed.size()) + " of " + std::to_string(wanted.size() + failed) +
+                          " schedule file(s) changed, " + std::to_string(dropped.size()) + " dropped; " +
+                          std::to_string(diff.changed_count()) + " of " +
+                          std::to_string(diff.changed_count() + diff.unchanged.size()) + " item(s) changed (" +
+                          std::to_string(diff.added.size()) + " added, " +
+                          std::to_string(diff.removed.size()) + " removed, " +
+                          std::to_string(diff.retimed.size()) + " retimed, " +
+                          std::to_string(diff.modified.size()) + " modified)";
+    if (!changed.empty()) {
+        summary += "; read in " + std::to_string(read_us) + "us over " +
+                   std::to_string(std::min(pool->get_thread_count(), changed.size())) + " thread(s), slowest " +
+                   load_times_[slowest].path + " (" + std::to_string(load_times_[slowest].read_us) + "us)";
     }
     
-    return result;
+    if (diff.empty() && changed.empty() && dropped.empty()) {
+        LOG_INFO("Reloaded in " + std::to_string(elapsed_us) + "us: " + summary + ", schedule kept");
+        return false;
+    }
+    
+    publish_changes(std::move(diff));
+    elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    LOG_INFO("Reloaded in " + std::to_string(elapsed_us) + "us: " + summary);
+    return true;
 }
 
-Playlist* PlaylistManager::get_playlist(const std::string& playlist_id) {
+std::vector<FileLoadTime> PlaylistManager::get_load_times() const {
     std::lock_guard<std::mutex> lock(mutex_);
-    
-    auto it = playlists_.find(playlist_id);
-    return (it != playlists_.end()) ? &it->second : nullptr;
+    return load_times_;
+}
+
+std::shared_ptr<const ScheduleSnapshot> PlaylistManager::get_snapshot() const {
+    return std::atomic_load(&snapshot_);
 }
 
-std::shared_ptr<ScheduledItem> PlaylistManager::get_item(const std::string& item_id) {
+bool PlaylistManager::advance_horizon() {
     std::lock_guard<std::mutex> lock(mutex_);
     
-    auto it = items_.find(item_id);
-    return (it != items_.end()) ? it->second : nullptr;
+    auto previous = std::atomic_load(&snapshot_);
+    CivilDay today = get_current_date();
+    if (previous->timeline.get_first_day() == today) {
+        return false;
+    }
+    
+    // The same schedule with the dates moved on; weekdays and the dates
+    // still ahead are shared with the previous snapshot
+    auto snapshot = std::make_shared<ScheduleSnapshot>(*previous);
+    snapshot->version = ++snapshot_version_;
+    snapshot->changes = ScheduleDiff();
+    snapshot->timeline.advance(today);
+    std::atomic_store(&snapshot_, std::shared_ptr<const ScheduleSnapshot>(std::move(snapshot)));
+    
+    LOG_DEBUG("Schedule horizon of channel " + channel_ + " now starts " + CalendarRule::format_date(today));
+    return true;
 }
 
-std::vector<std::shared_ptr<ScheduledItem>> PlaylistManager::get_items_for_time(
-    const std::string& time, const std::string& day) const {
+std::vector<Playlist> PlaylistManager::get_playlists() const {
+    auto snapshot = get_snapshot();
     
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<Playlist> playlists;
+    playlists.reserve(snapshot->playlists.size());
+    for (const auto& playlist : snapshot->playlists) {
+        playlists.push_back(*playlist);
+    }
+    return playlists;
+}
+
+std::shared_ptr<const Playlist> PlaylistManager::get_playlist(const std::string& playlist_id) const {
+    for (const auto& playlist : get_snapshot()->playlists) {
+        if (playlist->id == playlist_id) {
+            return playlist;
+        }
+    }
+    return nullptr;
+}
+
+std::shared_ptr<const ScheduledItem> PlaylistManager::get_item(const std::string& item_id) const {
+    return get_snapshot()->find_item(item_id);
+}
+
+std::vector<std::shared_ptr<const ScheduledItem>> PlaylistManager::get_items_for_time(
+    const std::string& time, const std::string& day) const {
     
-    std::vector<std::shared_ptr<ScheduledItem>> result;
+    int32_t ms = ScheduleTimeline::time_to_ms(time);
+    if (ms < 0) {
+        return {};
+    }
     
-    for (const auto& pair : items_) {
-        const auto& item = pair.second;
-        
-        // Check if item is scheduled for this day
-        bool day_match = std::find(item->days.begin(), item->days.end(), day) != item->days.end();
-        
-        // Check if item is scheduled for this time
-        bool time_match = (item->time == time);
-        
-        if (day_match && time_match) {
-            result.push_back(item);
-        }
+    auto snapshot = get_snapshot();
+    const auto& timeline = snapshot->timeline;
+    std::vector<std::shared_ptr<const ScheduledItem>> result;
+    for (const auto& entry : timeline.get_entries_at(ScheduleTimeline::day_index(day), ms)) {
+        result.push_back(timeline.get_item(entry.item));
     }
     
     return result;
 }
 
-std::vector<std::shared_ptr<ScheduledItem>> PlaylistManager::get_items_for_day(const std::string& day) const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    std::vector<std::shared_ptr<ScheduledItem>> result;
+std::vector<std::shared_ptr<const ScheduledItem>> PlaylistManager::get_items_for_day(const std::string& day) const {
+    auto snapshot = get_snapshot();
+    const auto& timeline = snapshot->timeline;
+    const auto& entries = timeline.get_entries(ScheduleTimeline::day_index(day));
     
-    for (const auto& pair : items_) {
-        const auto& item = pair.second;
-        
-        // Check if item is scheduled for this day
-        if (std::find(item->days.begin(), item->days.end(), day) != item->days.end()) {
-            result.push_back(item);
-        }
+    // In start order
+    std::vector<std::shared_ptr<const ScheduledItem>> result;
+    result.reserve(entries.size());
+    for (const auto& entry : entries) {
+        result.push_back(timeline.get_item(entry.item));
     }
     
     return result;
 }
 
 bool PlaylistManager::validate_schedule_file(const std::string& file_path) const {
-    try {
-        std::ifstream file(file_path);
-        if (!file.is_open()) {
-            return false;
-        }
-        
-        std::stringstream buffer;
-        buffer << file.rdbuf();
-        std::string content = buffer.str();
-        file.close();
-        
-        // Basic JSON validation - check for required fields
-        if (content.find("\"version\"") == std::string::npos) {
-            return false;
-        }
-        
-        if (content.find("\"playlists\"") == std::string::npos) {
-            return false;
-        }
-        
-        return true;
-        
-    } catch (const std::exception& e) {
-        LOG_ERROR("Exception validating schedule file: " + std::string(e.what()));
+    ScheduleParser parser;
+    ParsedSchedule schedule;
+    if (!parser.parse_file(file_path, schedule)) {
+        LOG_ERROR("Invalid schedule file " + file_path + ": " + parser.get_error());
         return false;
     }
+    
+    return true;
 }
 
 bool PlaylistManager::validate_item(const ScheduledItem& item) const {
@@ -264,9 +916,8 @@ bool PlaylistManager::validate_item(const ScheduledItem& item) const {
         return false;
     }
     
-    // Validate time format (HH:MM)
-    std::regex time_regex(R"(^([01]?[0-9]|2[0-3]):[0-5][0-9]$)");
-    if (!std::regex_match(item.time, time_regex)) {
+    // Validate time format (HH:MM, optionally with seconds and milliseconds)
+    if (ScheduleTimeline::time_to_ms(item.time) < 0) {
         return false;
     }
     
@@ -280,105 +931,84 @@ bool PlaylistManager::validate_item(const ScheduledItem& item) const {
 }
 
 size_t PlaylistManager::get_total_items() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return items_.size();
+    return get_snapshot()->items.size();
 }
 
 size_t PlaylistManager::get_active_items() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    std::string current_day = get_current_day();
-    size_t count = 0;
-    
-    for (const auto& pair : items_) {
-        const auto& item = pair.second;
-        if (std::find(item->days.begin(), item->days.end(), current_day) != item->days.end()) {
-            count++;
-        }
-    }
-    
-    return count;
+    return get_snapshot()->timeline.get_entries_on(get_current_date()).size();
 }
 
 std::string PlaylistManager::get_default_idle_content() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return default_idle_content_;
+    return get_snapshot()->default_idle_content;
 }
 
-bool PlaylistManager::parse_json_file(const std::string& file_path, Playlist& playlist) const {
-    try {
-        std::ifstream file(file_path);
-        if (!file.is_open()) {
-            return false;
+std::vector<ScheduleConflict> PlaylistManager::get_conflicts() const {
+    auto snapshot = get_snapshot();
+    std::vector<ScheduleConflict> conflicts;
+    conflicts.reserve(snapshot->timeline.get_conflict_count());
+    for (int weekday = 0; weekday < ScheduleTimeline::DAYS_PER_WEEK; ++weekday) {
+        for (const auto& conflict : snapshot->timeline.get_conflicts(weekday)) {
+            conflicts.push_back(describe_conflict(snapshot->timeline, weekday, conflict));
         }
-        
-        std::stringstream buffer;
-        buffer << file.rdbuf();
-        std::string content = buffer.str();
-        file.close();
-        
-        return parse_playlist_json(content, playlist);
-        
-    } catch (const std::exception& e) {
-        LOG_ERROR("Exception parsing JSON file: " + std::string(e.what()));
-        return false;
     }
+    return conflicts;
 }
 
-bool PlaylistManager::parse_playlist_json(const std::string& json_content, Playlist& playlist) const {
-    // This is a simplified JSON parser - in a real implementation, use nlohmann/json
-    // For now, we'll do basic string parsing
-    
-    try {
-        // Extract playlist name (simplified)
-        size_t name_pos = json_content.find("\"name\"");
-        if (name_pos != std::string::npos) {
-            size_t colon_pos = json_content.find(":", name_pos);
-            size_t value_start = json_content.find("\"", colon_pos);
-            if (value_start != std::string::npos) {
-                size_t value_end = json_content.find("\"", value_start + 1);
-                if (value_end != std::string::npos) {
-                    playlist.name = json_content.substr(value_start + 1, value_end - value_start - 1);
-                }
-            }
+void PlaylistManager::log_conflicts(const ScheduleSnapshot& previous, const ScheduleSnapshot& snapshot) const {
+    // Only weekdays compiled again can have new ones
+    size_t logged = 0;
+    for (int weekday = 0; weekday < ScheduleTimeline::DAYS_PER_WEEK; ++weekday) {
+        const auto& conflicts = snapshot.timeline.get_conflicts(weekday);
+        if (conflicts.empty() ||
+            &previous.timeline.get_slots(weekday) == &snapshot.timeline.get_slots(weekday)) {
+            continue;
         }
         
-        // Extract default idle content
-        size_t idle_pos = json_content.find("\"default_idle\"");
-        if (idle_pos != std::string::npos) {
-            size_t colon_pos = json_content.find(":", idle_pos);
-            size_t value_start = json_content.find("\"", colon_pos);
-            if (value_start != std::string::npos) {
-                size_t value_end = json_content.find("\"", value_start + 1);
-                if (value_end != std::string::npos) {
-                    default_idle_content_ = json_content.substr(value_start + 1, value_end - value_start - 1);
-                }
+        std::string day = DaySet::from_mask(static_cast<uint8_t>(1u << weekday)).names()[0];
+        LOG_WARNING(std::to_string(conflicts.size()) + " overlap(s) between items on a source or scene on " + day);
+        for (const auto& conflict : conflicts) {
+            if (logged == LOGGED_CONFLICTS) {
+                break;
             }
+            ++logged;
+            auto described = describe_conflict(snapshot.timeline, weekday, conflict);
+            bool same_source = described.winner->source == described.loser->source;
+            LOG_WARNING(day + " " + described.time + ": \"" + described.winner->name + "\" (" +
+                        described.winner->id + ") keeps " +
+                        (same_source ? described.winner->source : "the scene " + described.winner->scene) + ", \"" +
+                        described.loser->name + "\" (" + described.loser->id + ") " +
+                        (described.dropped ? "is not fired" : "is cut short"));
         }
-        
-        // Extract days (simplified)
-        std::vector<std::string> days = {"monday", "tuesday", "wednesday", "thursday", "friday", "saturday", "sunday"};
-        playlist.days = days; // Default to all days
-        
-        // For now, create a sample item - in real implementation, parse items array
-        ScheduledItem sample_item;
-        sample_item.name = "Sample Item";
-        sample_item.time = "09:00";
-        sample_item.source = "Media Source";
-        sample_item.file_path = default_idle_content_;
-        sample_item.days = days;
-        playlist.items.push_back(sample_item);
-        
-        return true;
-        
-    } catch (const std::exception& e) {
-        LOG_ERROR("Exception parsing playlist JSON: " + std::string(e.what()));
-        return false;
     }
 }
 
 std::string PlaylistManager::generate_item_id(const ScheduledItem& item) const {
-    return item.source + "_" + item.time + "_" + std::to_string(std::hash<std::string>{}(item.name));
+    // Short enough to stay inside the string (no allocation) wherever an id
+    // is copied: the item, the snapshot's map key, every weekday's slots
+    static const char DIGITS[] = "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ-_";
+    
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    auto mix = [&hash](const std::string& value) {
+        for (unsigned char c : value) {
+            hash = (hash ^ c) * 0x100000001b3ULL;
+        }
+        hash = (hash ^ 0xff) * 0x100000001b3ULL;    // Field separator
+    };
+    mix(item.source);
+    mix(item.time);
+    mix(item.name);
+    if (item.calendar) {
+        // Dated repeats of one item are told apart by their dates
+        mix(item.calendar->to_text());
+    }
+    
+    char id[12];
+    for (size_t i = 0; i < sizeof(id) - 1; ++i) {
+        id[i] = DIGITS[hash & 63];
+        hash >>= 6;
+    }
+    id[sizeof(id) - 1] = '\0';
+    return id;
 }
 
 std::string PlaylistManager::generate_playlist_id(const std::string& name) const {
@@ -397,16 +1027,18 @@ void PlaylistManager::cleanup_file_watching() {
 }
 
 std::string PlaylistManager::get_current_day() const {
-    auto now = std::time(nullptr);
-    auto tm = *std::localtime(&now);
+    auto tm = clock_->local_time();
     
     static const std::vector<std::string> days = {"sunday", "monday", "tuesday", "wednesday", "thursday", "friday", "saturday"};
     return days[tm.tm_wday];
 }
 
+CivilDay PlaylistManager::get_current_date() const {
+    return CalendarRule::from_tm(clock_->local_time());
+}
+
 std::string PlaylistManager::get_current_time() const {
-    auto now = std::time(nullptr);
-    auto tm = *std::localtime(&now);
+    auto tm = clock_->local_time();
     
     std::stringstream ss;
     ss << std::put_time(&tm, "%H:%M");
@@ -5,34 +5,118 @@
 #include <memory>
 #include <map>
 #include <mutex>
+#include <cstdint>
 #include <obs-module.h>
+#include "schedule-cache.h"
+#include "media-probe.h"
+#include "schedule-timeline.h"
+#include "utils/config.h"
+#include "utils/clock.h"
+#include "utils/worker-pool.h"
 
-struct obs_data_t;
-struct obs_source_t;
+enum class TriggerMode {
+    Minute,     // Fired by the scheduler thread at the slot time
+    Frame       // Fired from the video tick on the frame that crosses the slot time
+};
 
+// Small fields are grouped at the end, where they pack without padding
 struct ScheduledItem {
     std::string id;
     std::string name;
-    std::string time;           // HH:MM format
+    std::string time;           // HH:MM, HH:MM:SS or HH:MM:SS.mmm (timecode is converted when parsed)
     std::string source;         // OBS media source name
     std::string file_path;      // Path to media file
+    std::string scene;          // OBS scene to switch to (optional)
+    std::shared_ptr<const CalendarRule> calendar;   // Dates it is limited to, null: every week
+    int64_t detected_duration_ms;   // Of file_path as the media probe found it, 0 until then
     int duration;               // Duration in seconds (0 = auto-detect)
+    TriggerMode trigger_mode;   // Inherited from the schedule file
+    int priority;               // Wins an overlap on its source within the same playlist priority
+    int playlist_priority;      // Its playlist's, set when the playlist is loaded
+    DaySet days;                // Days this item is active
     bool loop;                  // Whether to loop the media
-    std::string scene;          // OBS scene to switch to (optional)
-    std::vector<std::string> days; // Days this item is active
     
     // Constructor
-    ScheduledItem() : duration(0), loop(false) {}
+    ScheduledItem() : detected_duration_ms(0), duration(0), trigger_mode(TriggerMode::Minute), priority(0),
+                      playlist_priority(0), loop(false) {}
+    
+    // How long it stays on air: its duration, else its file's detected one.
+    // 0 while unknown, and for looping items without a duration.
+    int64_t get_duration_ms() const {
+        if (duration > 0) {
+            return duration * int64_t(1000);
+        }
+        return loop ? 0 : detected_duration_ms;
+    }
 };
 
 struct Playlist {
     std::string name;
     std::string id;
-    std::vector<std::string> days;
+    DaySet days;
+    std::shared_ptr<const CalendarRule> calendar;   // Inherited by items without their own
     std::vector<ScheduledItem> items;
     bool enabled;
+    TriggerMode trigger_mode;
+    std::string default_idle;   // Idle content declared by the file (optional)
+    int priority;               // Its items win overlaps with those of lower priority playlists
+    
+    Playlist() : enabled(true), trigger_mode(TriggerMode::Minute), priority(0) {}
+};
+
+// What a publish changed, item by item. An item is the same one across
+// publishes while its playlist, name and source are (repeats pair up in file
+// order); only items of enabled playlists count.
+struct ScheduleDiff {
+    using ItemPtr = std::shared_ptr<const ScheduledItem>;
+    
+    std::vector<ItemPtr> added;
+    std::vector<ItemPtr> removed;
+    std::vector<std::pair<ItemPtr, ItemPtr>> retimed;      // (before, after): time or days changed, and so the id
+    std::vector<std::pair<ItemPtr, ItemPtr>> modified;     // (before, after): same slot, other fields changed
+    std::vector<std::pair<ItemPtr, ItemPtr>> unchanged;    // (before, after): identical, after held by the file read again
     
-    Playlist() : enabled(true) {}
+    bool empty() const {
+        return added.empty() && removed.empty() && retimed.empty() && modified.empty();
+    }
+    size_t changed_count() const {
+        return added.size() + removed.size() + retimed.size() + modified.size();
+    }
+};
+
+// Compiled view of every schedule file of a channel. Built once per load or
+// reload and published by swapping a shared pointer, never modified after
+// that: readers keep whichever snapshot they loaded, without taking a lock.
+struct ScheduleSnapshot {
+    uint64_t version;           // Increases with every published snapshot
+    std::vector<std::shared_ptr<const Playlist>> playlists;    // Shared with the next snapshot when unchanged
+    std::map<std::string, std::shared_ptr<const ScheduledItem>> items;     // item_id -> item, pointing into playlists
+    std::string default_idle_content;
+    ScheduleTimeline timeline;  // The items above, indexed by weekday and start
+    ScheduleDiff changes;       // Against the previous snapshot
+    
+    ScheduleSnapshot() : version(0) {}
+    
+    std::shared_ptr<const ScheduledItem> find_item(const std::string& item_id) const;
+};
+
+// Two items wanting one source or the programme at once on a weekday, as the timeline settled it
+struct ScheduleConflict {
+    int weekday;
+    std::string time;           // Where they meet, as ScheduleTimeline::format_time
+    std::shared_ptr<const ScheduledItem> winner;
+    std::shared_ptr<const ScheduledItem> loser;
+    bool dropped;               // The loser is not fired; otherwise the winner cuts it short
+};
+
+// How long reading one schedule file took, as the load that read it saw it
+struct FileLoadTime {
+    std::string path;
+    int64_t read_us;            // Parsing (or the cache read) and assigning ids
+    size_t items;
+    bool cached;                // Read from the schedule cache rather than parsed
+    
+    FileLoadTime() : read_us(0), items(0), cached(false) {}
 };
 
 class PlaylistManager {
@@ -43,19 +127,63 @@ public:
     bool initialize();
     void cleanup();
     
+    // Channel whose schedule files this manager loads
+    void set_channel(const std::string& channel);
+    std::string get_channel() const;
+    
+    // Clock deciding which day's items are active, set before initialize()
+    void set_clock(std::shared_ptr<Clock> clock);
+    
+    // How many days from today items with calendar dates are expanded for
+    void set_horizon_days(int days);
+    
+    // Where parsed schedule files are cached; empty (the default until
+    // initialize(), which uses Config::get_schedule_cache_path()) parses every time
+    void set_cache_directory(const std::string& directory);
+    
+    // Threads schedule files are read on, 0 (the default) for one per core
+    void set_load_threads(size_t threads);
+    
+    // Where items without a duration get their file's from. Unset until
+    // initialize(), which uses MediaProbe::shared(); items are published
+    // with what it already knows and again as their files are probed.
+    void set_media_probe(std::shared_ptr<MediaProbe> probe);
+    
     // Schedule file management
     bool load_schedule_file(const std::string& file_path);
     void unload_schedule_file(const std::string& file_path);
     void reload_schedules();
     
+    // Brings the schedule in line with exactly these files. Only files whose
+    // contents changed since they were read are parsed again, and only the
+    // items that changed are replaced; nothing is published when no file did.
+    // Returns true if a new snapshot was published.
+    bool reload_files(const std::vector<std::string>& file_paths);
+    
+    // Files the last load or reload read, in the order they were given
+    std::vector<FileLoadTime> get_load_times() const;
+    
+    // Registers already parsed playlists as the content of file_path
+    void add_playlist(const std::string& file_path, Playlist playlist);
+    void add_playlists(const std::string& file_path, std::vector<Playlist> playlists);
+    
+    // Current schedule; never waits on a reload or the scheduler thread. Every getter below reads it as well.
+    std::shared_ptr<const ScheduleSnapshot> get_snapshot() const;
+    
+    // Once the date changed, publishes the schedule again with its calendar
+    // horizon starting today; only the dates it gains are expanded. Returns
+    // true if a snapshot was published.
+    bool advance_horizon();
+    
     // Playlist access
     std::vector<Playlist> get_playlists() const;
-    Playlist* get_playlist(const std::string& playlist_id);
+    std::shared_ptr<const Playlist> get_playlist(const std::string& playlist_id) const;
     
     // Item access
-    std::shared_ptr<ScheduledItem> get_item(const std::string& item_id);
-    std::vector<std::shared_ptr<ScheduledItem>> get_items_for_time(const std::string& time, const std::string& day) const;
-    std::vector<std::shared_ptr<ScheduledItem>> get_items_for_day(const std::string& day) const;
+    std::shared_ptr<const ScheduledItem> get_item(const std::string& item_id) const;
+    std::vector<std::shared_ptr<const ScheduledItem>> get_items_for_time(const std::string& time,
+                                                                         const std::string& day) const;
+    std::vector<std::shared_ptr<const ScheduledItem>> get_items_for_day(const std::string& day) const;
     
     // Validation
     bool validate_schedule_file(const std::string& file_path) const;
@@ -65,25 +193,62 @@ public:
     size_t get_total_items() const;
     size_t get_active_items() const;
     std::string get_default_idle_content() const;
+    
+    // Overlapping items of the current schedule, by weekday and time
+    std::vector<ScheduleConflict> get_conflicts() const;
 
 private:
+    // Writers' working copy, guarded by mutex_ and compiled into snapshot_
     mutable std::mutex mutex_;
-    std::map<std::string, Playlist> playlists_;
-    std::map<std::string, std::shared_ptr<ScheduledItem>> items_; // item_id -> item
-    std::map<std::string, std::string> file_to_playlist_id_; // file_path -> playlist_id
+    struct LoadedFile {
+        SourceStamp stamp;      // Size and time when it was read, zero if not read from disk
+        uint64_t hash;          // Of its contents, once a reload needed it
+        bool hashed;
+        std::vector<std::string> playlist_ids;
+        
+        LoadedFile() : hash(0), hashed(false) {}
+    };
+    
+    std::map<std::string, std::shared_ptr<const Playlist>> playlists_;
+    std::map<std::string, LoadedFile> files_;   // file_path -> what was loaded from it
+    bool duplicate_ids_;        // Some item id is used twice, patching would lose one
     std::string default_idle_content_;
+    std::string channel_;
+    std::shared_ptr<Clock> clock_;
+    std::string cache_directory_;
+    bool cache_directory_set_;
+    int horizon_days_;
+    std::shared_ptr<WorkerPool> load_pool_;     // Reads changed files side by side
+    std::vector<FileLoadTime> load_times_;
+    std::shared_ptr<MediaProbe> media_probe_;
+    int probe_listener_;
+    
+    // Latest published schedule, swapped with std::atomic_store
+    std::shared_ptr<const ScheduleSnapshot> snapshot_;
+    uint64_t snapshot_version_;
     
-    // JSON parsing helpers
-    bool parse_json_file(const std::string& file_path, Playlist& playlist) const;
-    bool parse_playlist_json(const std::string& json_content, Playlist& playlist) const;
-    bool parse_item_json(const std::string& json_content, ScheduledItem& item) const;
+    bool is_channel_file(const Config::ScheduleFile& file_info) const;
+    bool read_schedule_file(const std::string& file_path, std::vector<Playlist>& playlists, bool& cached) const;
+    void prepare_playlists(std::vector<Playlist>& playlists) const;
+    bool fill_detected_durations(Playlist& playlist) const;
+    void apply_media_info(const std::vector<std::string>& paths);
+    void detach_media_probe();
+    void store_playlists(const std::string& file_path, LoadedFile file, std::vector<Playlist> playlists,
+                         ScheduleDiff& diff);
+    std::vector<std::shared_ptr<const Playlist>> remove_playlists(const std::string& file_path);
+    void diff_playlists(const std::vector<std::shared_ptr<const Playlist>>& before,
+                        const std::vector<std::shared_ptr<const Playlist>>& after,
+                        const ScheduleSnapshot& previous, ScheduleDiff& diff) const;
+    void publish_changes(ScheduleDiff diff);
+    void publish_snapshot(ScheduleDiff changes = ScheduleDiff());
+    void fill_snapshot(ScheduleSnapshot& snapshot);
+    void log_conflicts(const ScheduleSnapshot& previous, const ScheduleSnapshot& snapshot) const;
     
     // Utility functions
     std::string generate_item_id(const ScheduledItem& item) const;
     std::string generate_playlist_id(const std::string& name) const;
-    bool time_string_to_minutes(const std::string& time_str, int& minutes) const;
-    std::string minutes_to_time_string(int minutes) const;
     std::string get_current_day() const;
+    CivilDay get_current_date() const;
     std::string get_current_time() const;
     
     // File monitoring
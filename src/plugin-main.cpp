@@ -21,6 +21,7 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 #include "utils/logger.h"
 #include "utils/config.h"
 #include "scheduler-core.h"
+#include <filesystem>
 
 OBS_DECLARE_MODULE()
 OBS_MODULE_USE_DEFAULT_LOCALE("obs-time-scheduler", "en-US")
@@ -75,6 +76,12 @@ static void obs_frontend_event_callback(enum obs_frontend_event event, void *pri
 		blog(LOG_INFO, "[Time Scheduler] OBS exiting, stopping scheduler");
 		if (scheduler) {
 			scheduler->stop();
+
+			// Keep the session's trigger latencies next to the config file
+			std::filesystem::path dump_path =
+				std::filesystem::path(Config::get_config_path()).parent_path() /
+				"latency-histograms.csv";
+			scheduler->dump_latency_histograms(dump_path.string());
 		}
 		break;
 	case OBS_FRONTEND_EVENT_SCENE_CHANGED:
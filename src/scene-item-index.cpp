@@ -0,0 +1,338 @@
+#include "scene-item-index.h"
+#include "utils/logger.h"
+#include <algorithm>
+
+SceneItemIndex::SceneItemIndex()
+    : started_(false)
+{
+}
+
+SceneItemIndex::~SceneItemIndex() {
+    stop();
+}
+
+void SceneItemIndex::start() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (started_) {
+            return;
+        }
+        started_ = true;
+    }
+    
+    signal_handler_t* handler = obs_get_signal_handler();
+    if (handler) {
+        signal_handler_connect(handler, "source_rename", &SceneItemIndex::source_renamed, this);
+    }
+}
+
+void SceneItemIndex::stop() {
+    std::vector<obs_scene_t*> scenes;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!started_) {
+            return;
+        }
+        started_ = false;
+        for (const auto& pair : scenes_) {
+            scenes.push_back(pair.first);
+        }
+        scenes_.clear();
+    }
+    
+    signal_handler_t* handler = obs_get_signal_handler();
+    if (handler) {
+        signal_handler_disconnect(handler, "source_rename", &SceneItemIndex::source_renamed, this);
+    }
+    for (auto* scene : scenes) {
+        disconnect_scene(scene);
+    }
+}
+
+obs_sceneitem_t* SceneItemIndex::find(obs_scene_t* scene, const std::string& source_name) {
+    if (!scene) {
+        return nullptr;
+    }
+    index_scene(scene);
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto scene_it = scenes_.find(scene);
+    if (scene_it == scenes_.end()) {
+        return nullptr;
+    }
+    auto it = scene_it->second.by_name.find(source_name);
+    return it != scene_it->second.by_name.end() ? it->second.front().item : nullptr;
+}
+
+bool SceneItemIndex::is_visible(obs_scene_t* scene, const std::string& source_name, bool* found) {
+    if (found) {
+        *found = false;
+    }
+    if (!scene) {
+        return false;
+    }
+    index_scene(scene);
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto scene_it = scenes_.find(scene);
+    if (scene_it == scenes_.end()) {
+        return false;
+    }
+    auto it = scene_it->second.by_name.find(source_name);
+    if (it == scene_it->second.by_name.end()) {
+        return false;
+    }
+    if (found) {
+        *found = true;
+    }
+    return it->second.front().visible;
+}
+
+size_t SceneItemIndex::set_visible(obs_scene_t* scene, const std::vector<VisibilityChange>& changes) {
+    if (!scene || changes.empty()) {
+        return 0;
+    }
+    index_scene(scene);
+    
+    std::vector<std::pair<obs_sceneitem_t*, bool>> updates;
+    updates.reserve(changes.size());
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto scene_it = scenes_.find(scene);
+        if (scene_it == scenes_.end()) {
+            return 0;
+        }
+        for (const auto& change : changes) {
+            auto it = scene_it->second.by_name.find(change.first);
+            if (it != scene_it->second.by_name.end()) {
+                updates.emplace_back(it->second.front().item, change.second);
+            }
+        }
+    }
+    
+    if (updates.empty()) {
+        return 0;
+    }
+    
+    // Not under mutex_, every change sends item_visible back here
+    obs_scene_atomic_update(scene, [](void* data, obs_scene_t*) {
+        for (const auto& update : *static_cast<std::vector<std::pair<obs_sceneitem_t*, bool>>*>(data)) {
+            obs_sceneitem_set_visible(update.first, update.second);
+        }
+    }, &updates);
+    
+    // item_visible normally said so already
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto scene_it = scenes_.find(scene);
+    if (scene_it != scenes_.end()) {
+        for (const auto& update : updates) {
+            Item* item = find_item(scene_it->second, update.first);
+            if (item) {
+                item->visible = update.second;
+            }
+        }
+    }
+    return updates.size();
+}
+
+void SceneItemIndex::forget(obs_scene_t* scene) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!scenes_.erase(scene)) {
+            return;
+        }
+    }
+    disconnect_scene(scene);
+}
+
+size_t SceneItemIndex::get_scene_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return scenes_.size();
+}
+
+void SceneItemIndex::index_scene(obs_scene_t* scene) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = scenes_.find(scene);
+        if (!started_ || (it != scenes_.end() && it->second.ready)) {
+            return;
+        }
+    }
+    
+    // A second caller waits here for the first to finish enumerating
+    std::lock_guard<std::mutex> index_lock(index_mutex_);
+    {
+        // Listed empty first, so items added while the scene is enumerated are not lost
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!started_ || !scenes_.emplace(scene, Scene()).second) {
+            return;
+        }
+    }
+    connect_scene(scene);
+    
+    // Bottom to top, the order a lookup by enumeration used to find them in
+    std::vector<Item> items;
+    obs_scene_enum_items(scene, [](obs_scene_t*, obs_sceneitem_t* item, void* data) {
+        static_cast<std::vector<Item>*>(data)->push_back(make_item(item));
+        return true;
+    }, &items);
+    
+    size_t added = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto scene_it = scenes_.find(scene);
+        if (scene_it == scenes_.end()) {
+            return;     // Forgotten meanwhile
+        }
+        for (const auto& item : items) {
+            if (!scene_it->second.by_item.count(item.item)) {
+                add_item(scene_it->second, item);
+                added++;
+            }
+        }
+        scene_it->second.ready = true;
+    }
+    
+    LOG_DEBUG("Indexed " + std::to_string(added) + " scene items");
+}
+
+SceneItemIndex::Item SceneItemIndex::make_item(obs_sceneitem_t* item) {
+    obs_source_t* source = obs_sceneitem_get_source(item);
+    const char* name = source ? obs_source_get_name(source) : nullptr;
+    return Item{item, source, name ? name : "", obs_sceneitem_visible(item)};
+}
+
+void SceneItemIndex::add_item(Scene& index, const Item& item) {
+    index.by_name[item.name].push_back(item);
+    index.by_item[item.item] = item.name;
+}
+
+void SceneItemIndex::remove_item(Scene& index, obs_sceneitem_t* item) {
+    auto it = index.by_item.find(item);
+    if (it == index.by_item.end()) {
+        return;
+    }
+    
+    auto name_it = index.by_name.find(it->second);
+    if (name_it != index.by_name.end()) {
+        auto& items = name_it->second;
+        items.erase(std::remove_if(items.begin(), items.end(),
+            [item](const Item& candidate) { return candidate.item == item; }), items.end());
+        if (items.empty()) {
+            index.by_name.erase(name_it);
+        }
+    }
+    index.by_item.erase(it);
+}
+
+SceneItemIndex::Item* SceneItemIndex::find_item(Scene& index, obs_sceneitem_t* item) {
+    auto it = index.by_item.find(item);
+    if (it == index.by_item.end()) {
+        return nullptr;
+    }
+    auto name_it = index.by_name.find(it->second);
+    if (name_it == index.by_name.end()) {
+        return nullptr;
+    }
+    for (auto& candidate : name_it->second) {
+        if (candidate.item == item) {
+            return &candidate;
+        }
+    }
+    return nullptr;
+}
+
+void SceneItemIndex::connect_scene(obs_scene_t* scene) {
+    signal_handler_t* handler = obs_source_get_signal_handler(obs_scene_get_source(scene));
+    if (handler) {
+        signal_handler_connect(handler, "item_add", &SceneItemIndex::item_added, this);
+        signal_handler_connect(handler, "item_remove", &SceneItemIndex::item_removed, this);
+        signal_handler_connect(handler, "item_visible", &SceneItemIndex::item_visible, this);
+    }
+}
+
+void SceneItemIndex::disconnect_scene(obs_scene_t* scene) {
+    signal_handler_t* handler = obs_source_get_signal_handler(obs_scene_get_source(scene));
+    if (handler) {
+        signal_handler_disconnect(handler, "item_add", &SceneItemIndex::item_added, this);
+        signal_handler_disconnect(handler, "item_remove", &SceneItemIndex::item_removed, this);
+        signal_handler_disconnect(handler, "item_visible", &SceneItemIndex::item_visible, this);
+    }
+}
+
+void SceneItemIndex::item_added(void* data, calldata_t* cd) {
+    auto* index = static_cast<SceneItemIndex*>(data);
+    auto* scene = static_cast<obs_scene_t*>(calldata_ptr(cd, "scene"));
+    auto* item = static_cast<obs_sceneitem_t*>(calldata_ptr(cd, "item"));
+    if (!scene || !item) {
+        return;
+    }
+    
+    // New items go on top, so one already showing the source stays the one found
+    Item added = make_item(item);
+    std::lock_guard<std::mutex> lock(index->mutex_);
+    auto scene_it = index->scenes_.find(scene);
+    if (scene_it != index->scenes_.end() && !scene_it->second.by_item.count(item)) {
+        add_item(scene_it->second, added);
+    }
+}
+
+void SceneItemIndex::item_removed(void* data, calldata_t* cd) {
+    auto* index = static_cast<SceneItemIndex*>(data);
+    auto* scene = static_cast<obs_scene_t*>(calldata_ptr(cd, "scene"));
+    auto* item = static_cast<obs_sceneitem_t*>(calldata_ptr(cd, "item"));
+    
+    std::lock_guard<std::mutex> lock(index->mutex_);
+    auto scene_it = index->scenes_.find(scene);
+    if (scene_it != index->scenes_.end()) {
+        remove_item(scene_it->second, item);
+    }
+}
+
+void SceneItemIndex::item_visible(void* data, calldata_t* cd) {
+    auto* index = static_cast<SceneItemIndex*>(data);
+    auto* scene = static_cast<obs_scene_t*>(calldata_ptr(cd, "scene"));
+    auto* item = static_cast<obs_sceneitem_t*>(calldata_ptr(cd, "item"));
+    bool visible = calldata_bool(cd, "visible");
+    
+    std::lock_guard<std::mutex> lock(index->mutex_);
+    auto scene_it = index->scenes_.find(scene);
+    if (scene_it != index->scenes_.end()) {
+        Item* indexed = find_item(scene_it->second, item);
+        if (indexed) {
+            indexed->visible = visible;
+        }
+    }
+}
+
+void SceneItemIndex::source_renamed(void* data, calldata_t* cd) {
+    auto* index = static_cast<SceneItemIndex*>(data);
+    auto* source = static_cast<obs_source_t*>(calldata_ptr(cd, "source"));
+    const char* prev_name = calldata_string(cd, "prev_name");
+    const char* new_name = calldata_string(cd, "new_name");
+    if (!source || !prev_name || !new_name) {
+        return;
+    }
+    
+    // Items are keyed by the name of the source they show
+    std::lock_guard<std::mutex> lock(index->mutex_);
+    for (auto& pair : index->scenes_) {
+        Scene& scene = pair.second;
+        auto it = scene.by_name.find(prev_name);
+        if (it == scene.by_name.end()) {
+            continue;
+        }
+        
+        std::vector<Item> moved;
+        for (const auto& item : it->second) {
+            if (item.source == source) {
+                moved.push_back(item);
+            }
+        }
+        for (auto& item : moved) {
+            remove_item(scene, item.item);
+            item.name = new_name;
+            add_item(scene, item);
+        }
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <mutex>
+#include <cstddef>
+#include <obs-module.h>
+
+// Scene items by source name, per scene. A scene is enumerated once, on its
+// first lookup, and from then on follows its item_add, item_remove and
+// item_visible signals (and source_rename, for the names), so finding an
+// item or reading its visibility is a hash probe instead of a walk over the
+// scene. Holds no references: items are dropped as OBS removes them, and
+// scenes by forget() when their source goes.
+class SceneItemIndex {
+public:
+    using VisibilityChange = std::pair<std::string, bool>;      // Source name, visible
+    
+    SceneItemIndex();
+    ~SceneItemIndex();
+    
+    // Follows source renames until stop(), which also drops every scene
+    void start();
+    void stop();
+    
+    // The scene's item showing that source, nullptr if there is none. Where a
+    // source sits in a scene more than once, the bottom-most item is used,
+    // as enumerating the scene would find. No reference is taken.
+    obs_sceneitem_t* find(obs_scene_t* scene, const std::string& source_name);
+    
+    // Visibility as the item_visible signals left it. False when the source
+    // is not in the scene, which found tells apart when given.
+    bool is_visible(obs_scene_t* scene, const std::string& source_name, bool* found = nullptr);
+    
+    // Applies every change inside one obs_scene_atomic_update, so they show
+    // on the same frame. Returns how many of the sources were in the scene.
+    size_t set_visible(obs_scene_t* scene, const std::vector<VisibilityChange>& changes);
+    
+    // Stops following a scene that is going away
+    void forget(obs_scene_t* scene);
+    
+    size_t get_scene_count() const;
+
+private:
+    struct Item {
+        obs_sceneitem_t* item;
+        obs_source_t* source;
+        std::string name;
+        bool visible;
+    };
+    
+    // Items per source name, bottom-most first, and the name of each item
+    struct Scene {
+        std::unordered_map<std::string, std::vector<Item>> by_name;
+        std::unordered_map<obs_sceneitem_t*, std::string> by_item;
+        bool ready = false;         // Enumerated, not only followed
+    };
+    
+    void index_scene(obs_scene_t* scene);
+    static Item make_item(obs_sceneitem_t* item);
+    static void add_item(Scene& index, const Item& item);
+    static void remove_item(Scene& index, obs_sceneitem_t* item);
+    static Item* find_item(Scene& index, obs_sceneitem_t* item);
+    void connect_scene(obs_scene_t* scene);
+    void disconnect_scene(obs_scene_t* scene);
+    
+    static void item_added(void* data, calldata_t* cd);
+    static void item_removed(void* data, calldata_t* cd);
+    static void item_visible(void* data, calldata_t* cd);
+    static void source_renamed(void* data, calldata_t* cd);
+    
+    mutable std::mutex mutex_;
+    std::unordered_map<obs_scene_t*, Scene> scenes_;
+    bool started_;
+    
+    // Held while a scene is first enumerated; the signals never take it
+    std::mutex index_mutex_;
+    
+    // Prevent copying
+    SceneItemIndex(const SceneItemIndex&) = delete;
+    SceneItemIndex& operator=(const SceneItemIndex&) = delete;
+};
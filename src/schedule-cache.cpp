@@ -0,0 +1,521 @@
+#include "schedule-cache.h"
+#include "schedule-parser.h"
+#include "utils/logger.h"
+#include "utils/mapped-file.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+
+namespace {
+
+// On-disk layout. Every section starts 8-byte aligned and holds fixed-size
+// records; strings live once each in a shared table and are referred to by
+// offset and length.
+const char MAGIC[8] = {'O', 'T', 'S', 'C', 'A', 'C', 'H', 'E'};
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+struct StringRef {
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct Header {
+    char magic[8];
+    uint32_t format_version;
+    uint32_t byte_order;
+    uint64_t file_size;         // Whole entry, catches truncation
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint64_t source_hash;
+    StringRef source_path;
+    StringRef version;
+    StringRef timezone;
+    StringRef default_idle;
+    uint32_t playlist_count;
+    uint32_t item_count;
+    uint32_t warning_count;
+    uint32_t padding;
+    uint64_t playlists_offset;
+    uint64_t items_offset;
+    uint64_t warnings_offset;
+    uint64_t strings_offset;
+    uint64_t strings_size;
+};
+
+struct PlaylistRecord {
+    StringRef name;
+    StringRef default_idle;
+    StringRef calendar;         // CalendarRule::to_text(), empty for none
+    uint32_t first_item;
+    uint32_t item_count;
+    uint8_t days;               // DaySet mask
+    uint8_t enabled;
+    uint8_t trigger_mode;
+    uint8_t padding[1];
+    int32_t priority;
+};
+
+struct ItemRecord {
+    StringRef name;
+    StringRef time;
+    StringRef source;
+    StringRef file_path;
+    StringRef scene;
+    StringRef calendar;
+    int32_t duration;
+    int32_t priority;
+    uint8_t days;               // DaySet mask
+    uint8_t loop;
+    uint8_t trigger_mode;
+    uint8_t padding[5];
+};
+
+static_assert(std::is_trivially_copyable<Header>::value, "cache records are copied as bytes");
+static_assert(sizeof(Header) % 8 == 0 && sizeof(PlaylistRecord) % 8 == 0 && sizeof(ItemRecord) % 8 == 0,
+              "records keep sections aligned");
+
+// FNV-1a style, a word at a time; for noticing changes, not for security
+const uint64_t HASH_SEED = 0xcbf29ce484222325ULL;
+const uint64_t HASH_PRIME = 0x100000001b3ULL;
+
+uint64_t hash_bytes(uint64_t hash, const char* data, size_t size) {
+    while (size >= sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, data, sizeof(word));
+        hash = (hash ^ word) * HASH_PRIME;
+        hash ^= hash >> 32;
+        data += sizeof(word);
+        size -= sizeof(word);
+    }
+    while (size > 0) {
+        hash = (hash ^ static_cast<unsigned char>(*data)) * HASH_PRIME;
+        ++data;
+        --size;
+    }
+    return hash;
+}
+
+// Sources modified this close to their entry being written are hashed
+// before the entry is trusted, whatever their time says
+std::filesystem::file_time_type::duration racy_window() {
+    return std::chrono::duration_cast<std::filesystem::file_time_type::duration>(std::chrono::seconds(2));
+}
+
+class EntryWriter {
+public:
+    EntryWriter() {
+        data_.resize(sizeof(Header));
+    }
+    
+    StringRef add_string(const std::string& value) {
+        StringRef ref;
+        ref.offset = static_cast<uint32_t>(strings_.size());
+        ref.length = static_cast<uint32_t>(value.size());
+        strings_.append(value);
+        return ref;
+    }
+    
+    // For the few values repeated across items (sources, scenes, times, calendars).
+    // value must outlive the writer; it is looked up by view, not copied.
+    StringRef add_shared_string(const std::string& value) {
+        auto it = shared_refs_.find(value);
+        if (it != shared_refs_.end()) {
+            return it->second;
+        }
+        
+        StringRef ref = add_string(value);
+        shared_refs_.emplace(value, ref);
+        return ref;
+    }
+    
+    template <typename Record>
+    uint64_t add_section(const std::vector<Record>& records) {
+        align();
+        uint64_t offset = data_.size();
+        const char* bytes = reinterpret_cast<const char*>(records.data());
+        data_.insert(data_.end(), bytes, bytes + records.size() * sizeof(Record));
+        return offset;
+    }
+    
+    // Appends the string table, completes the header and returns the entry
+    const std::vector<char>& finish(Header& header) {
+        align();
+        header.strings_offset = data_.size();
+        header.strings_size = strings_.size();
+        data_.insert(data_.end(), strings_.begin(), strings_.end());
+        header.file_size = data_.size();
+        std::memcpy(data_.data(), &header, sizeof(header));
+        return data_;
+    }
+    
+    bool strings_fit() const {
+        return strings_.size() <= UINT32_MAX;
+    }
+
+private:
+    void align() {
+        data_.resize((data_.size() + 7) & ~static_cast<size_t>(7));
+    }
+    
+    std::vector<char> data_;
+    std::string strings_;
+    std::unordered_map<std::string_view, StringRef> shared_refs_;
+};
+
+class EntryReader {
+public:
+    EntryReader(const char* data, size_t size)
+        : data_(data)
+        , size_(size)
+        , header_(nullptr)
+    {
+    }
+    
+    bool check_header() {
+        if (size_ < sizeof(Header)) {
+            return false;
+        }
+        header_ = reinterpret_cast<const Header*>(data_);
+        return std::memcmp(header_->magic, MAGIC, sizeof(MAGIC)) == 0 &&
+               header_->format_version == ScheduleCache::FORMAT_VERSION &&
+               header_->byte_order == BYTE_ORDER_MARK &&
+               header_->file_size == size_ &&
+               header_->strings_offset <= size_ &&
+               header_->strings_size <= size_ - header_->strings_offset &&
+               section_fits(header_->playlists_offset, header_->playlist_count, sizeof(PlaylistRecord)) &&
+               section_fits(header_->items_offset, header_->item_count, sizeof(ItemRecord)) &&
+               section_fits(header_->warnings_offset, header_->warning_count, sizeof(StringRef));
+    }
+    
+    const Header& header() const {
+        return *header_;
+    }
+    
+    template <typename Record>
+    const Record* section(uint64_t offset) const {
+        return reinterpret_cast<const Record*>(data_ + offset);
+    }
+    
+    bool read_string(const StringRef& ref, std::string& out) const {
+        if (ref.offset > header_->strings_size || ref.length > header_->strings_size - ref.offset) {
+            return false;
+        }
+        out.assign(data_ + header_->strings_offset + ref.offset, ref.length);
+        return true;
+    }
+
+
+private:
+    bool section_fits(uint64_t offset, uint64_t count, size_t record_size) const {
+        return offset % 8 == 0 && offset <= size_ && count <= (size_ - offset) / record_size;
+    }
+    
+    const char* data_;
+    size_t size_;
+    const Header* header_;
+};
+
+bool decode_entry(const EntryReader& reader, ParsedSchedule& schedule) {
+    const Header& header = reader.header();
+    
+    // Items inheriting their playlist's calendar share one rule again
+    std::unordered_map<std::string, std::shared_ptr<const CalendarRule>> calendars;
+    auto read_calendar = [&reader, &calendars](const StringRef& ref, std::shared_ptr<const CalendarRule>& calendar) {
+        std::string text;
+        if (!reader.read_string(ref, text)) {
+            return false;
+        }
+        if (text.empty()) {
+            calendar.reset();
+            return true;
+        }
+        
+        auto& shared = calendars[text];
+        if (!shared) {
+            CalendarRule rule;
+            std::string error;
+            if (!CalendarRule::from_text(text, rule, error)) {
+                return false;
+            }
+            shared = std::make_shared<const CalendarRule>(std::move(rule));
+        }
+        calendar = shared;
+        return true;
+    };
+    if (!reader.read_string(header.version, schedule.version) ||
+        !reader.read_string(header.timezone, schedule.timezone) ||
+        !reader.read_string(header.default_idle, schedule.default_idle)) {
+        return false;
+    }
+    
+    const ItemRecord* items = reader.section<ItemRecord>(header.items_offset);
+    const PlaylistRecord* playlists = reader.section<PlaylistRecord>(header.playlists_offset);
+    schedule.playlists.resize(header.playlist_count);
+    for (uint32_t p = 0; p < header.playlist_count; ++p) {
+        const PlaylistRecord& record = playlists[p];
+        Playlist& playlist = schedule.playlists[p];
+        if (!reader.read_string(record.name, playlist.name) ||
+            !reader.read_string(record.default_idle, playlist.default_idle) ||
+            !read_calendar(record.calendar, playlist.calendar) ||
+            record.first_item > header.item_count || record.item_count > header.item_count - record.first_item) {
+            return false;
+        }
+        playlist.days = DaySet::from_mask(record.days);
+        playlist.enabled = record.enabled != 0;
+        playlist.trigger_mode = static_cast<TriggerMode>(record.trigger_mode);
+        playlist.priority = record.priority;
+        
+        playlist.items.resize(record.item_count);
+        for (uint32_t i = 0; i < record.item_count; ++i) {
+            const ItemRecord& item_record = items[record.first_item + i];
+            ScheduledItem& item = playlist.items[i];
+            if (!reader.read_string(item_record.name, item.name) ||
+                !reader.read_string(item_record.time, item.time) ||
+                !reader.read_string(item_record.source, item.source) ||
+                !reader.read_string(item_record.file_path, item.file_path) ||
+                !reader.read_string(item_record.scene, item.scene) ||
+                !read_calendar(item_record.calendar, item.calendar)) {
+                return false;
+            }
+            item.days = DaySet::from_mask(item_record.days);
+            item.duration = item_record.duration;
+            item.loop = item_record.loop != 0;
+            item.trigger_mode = static_cast<TriggerMode>(item_record.trigger_mode);
+            item.priority = item_record.priority;
+        }
+    }
+    
+    const StringRef* warnings = reader.section<StringRef>(header.warnings_offset);
+    schedule.warnings.resize(header.warning_count);
+    for (uint32_t w = 0; w < header.warning_count; ++w) {
+        if (!reader.read_string(warnings[w], schedule.warnings[w])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+ScheduleCache::ScheduleCache(const std::string& directory)
+    : directory_(directory)
+{
+}
+
+bool ScheduleCache::load(const std::string& source_path, ParsedSchedule& schedule) const {
+    try {
+        SourceStamp stamp;
+        if (!stat_source(source_path, stamp)) {
+            return false;
+        }
+        
+        std::string entry_path = get_entry_path(source_path);
+        MappedFile entry;
+        if (!entry.open(entry_path)) {
+            return false;
+        }
+        
+        EntryReader reader(entry.data(), entry.size());
+        std::string cached_path;
+        if (!reader.check_header() || !reader.read_string(reader.header().source_path, cached_path) ||
+            cached_path != source_path) {
+            LOG_WARNING("Ignoring unusable schedule cache entry: " + entry_path);
+            return false;
+        }
+        
+        const Header& header = reader.header();
+        if (header.source_size != stamp.size) {
+            return false;
+        }
+        
+        // Same size and time, and written well after the source changed: trust it
+        auto entry_mtime = std::filesystem::last_write_time(entry_path).time_since_epoch().count();
+        bool racy = stamp.mtime + racy_window().count() >= entry_mtime;
+        bool touched = header.source_mtime != stamp.mtime;
+        if (racy || touched) {
+            uint64_t hash = 0;
+            if (!hash_source(source_path, hash) || hash != header.source_hash) {
+                return false;
+            }
+        }
+        
+        ParsedSchedule cached;
+        if (!decode_entry(reader, cached)) {
+            LOG_WARNING("Ignoring unusable schedule cache entry: " + entry_path);
+            return false;
+        }
+        entry.close();
+        
+        if (touched) {
+            // Same contents under a new time; record it so the next start skips the hash
+            std::fstream file(entry_path, std::ios::binary | std::ios::in | std::ios::out);
+            file.seekp(offsetof(Header, source_mtime));
+            file.write(reinterpret_cast<const char*>(&stamp.mtime), sizeof(stamp.mtime));
+        }
+        
+        schedule = std::move(cached);
+        return true;
+        
+    } catch (const std::exception& e) {
+        LOG_WARNING("Failed to read schedule cache for " + source_path + ": " + std::string(e.what()));
+        return false;
+    }
+}
+
+bool ScheduleCache::store(const std::string& source_path, const SourceStamp& stamp, const ParsedSchedule& schedule) const {
+    try {
+        uint64_t source_hash = 0;
+        SourceStamp current;
+        if (!hash_source(source_path, source_hash) || !stat_source(source_path, current) || current != stamp) {
+            return false;   // Changed while it was parsed; the next load parses again
+        }
+        
+        // Shared strings are looked up by view, so their texts outlive the writer
+        std::unordered_map<const CalendarRule*, std::string> calendar_texts;
+        EntryWriter writer;
+        auto add_calendar = [&calendar_texts, &writer](const std::shared_ptr<const CalendarRule>& calendar) {
+            if (!calendar) {
+                return StringRef{0, 0};
+            }
+            auto it = calendar_texts.find(calendar.get());
+            if (it == calendar_texts.end()) {
+                it = calendar_texts.emplace(calendar.get(), calendar->to_text()).first;
+            }
+            return writer.add_shared_string(it->second);
+        };
+        
+        Header header = {};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.format_version = FORMAT_VERSION;
+        header.byte_order = BYTE_ORDER_MARK;
+        header.source_size = stamp.size;
+        header.source_mtime = stamp.mtime;
+        header.source_hash = source_hash;
+        header.source_path = writer.add_string(source_path);
+        header.version = writer.add_string(schedule.version);
+        header.timezone = writer.add_string(schedule.timezone);
+        header.default_idle = writer.add_string(schedule.default_idle);
+        
+        std::vector<PlaylistRecord> playlists;
+        std::vector<ItemRecord> items;
+        playlists.reserve(schedule.playlists.size());
+        for (const auto& playlist : schedule.playlists) {
+            PlaylistRecord record = {};
+            record.name = writer.add_string(playlist.name);
+            record.default_idle = writer.add_shared_string(playlist.default_idle);
+            record.calendar = add_calendar(playlist.calendar);
+            record.first_item = static_cast<uint32_t>(items.size());
+            record.item_count = static_cast<uint32_t>(playlist.items.size());
+            record.days = playlist.days.mask();
+            record.enabled = playlist.enabled ? 1 : 0;
+            record.trigger_mode = static_cast<uint8_t>(playlist.trigger_mode);
+            record.priority = playlist.priority;
+            playlists.push_back(record);
+            
+            for (const auto& item : playlist.items) {
+                ItemRecord item_record = {};
+                item_record.name = writer.add_string(item.name);
+                item_record.time = writer.add_shared_string(item.time);
+                item_record.source = writer.add_shared_string(item.source);
+                item_record.file_path = writer.add_string(item.file_path);
+                item_record.scene = writer.add_shared_string(item.scene);
+                item_record.calendar = add_calendar(item.calendar);
+                item_record.duration = item.duration;
+                item_record.days = item.days.mask();
+                item_record.loop = item.loop ? 1 : 0;
+                item_record.trigger_mode = static_cast<uint8_t>(item.trigger_mode);
+                item_record.priority = item.priority;
+                items.push_back(item_record);
+            }
+        }
+        
+        std::vector<StringRef> warnings;
+        warnings.reserve(schedule.warnings.size());
+        for (const auto& warning : schedule.warnings) {
+            warnings.push_back(writer.add_string(warning));
+        }
+        
+        if (!writer.strings_fit() || items.size() > UINT32_MAX) {
+            return false;
+        }
+        header.playlist_count = static_cast<uint32_t>(playlists.size());
+        header.item_count = static_cast<uint32_t>(items.size());
+        header.warning_count = static_cast<uint32_t>(warnings.size());
+        header.playlists_offset = writer.add_section(playlists);
+        header.items_offset = writer.add_section(items);
+        header.warnings_offset = writer.add_section(warnings);
+        const std::vector<char>& data = writer.finish(header);
+        
+        // Written aside and renamed over the old entry, so readers never see half of one
+        std::filesystem::create_directories(directory_);
+        std::string entry_path = get_entry_path(source_path);
+        std::string temp_path = entry_path + ".tmp";
+        {
+            std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+            if (!file.write(data.data(), static_cast<std::streamsize>(data.size()))) {
+                LOG_WARNING("Failed to write schedule cache entry: " + temp_path);
+                return false;
+            }
+        }
+        std::filesystem::rename(temp_path, entry_path);
+        return true;
+        
+    } catch (const std::exception& e) {
+        LOG_WARNING("Failed to write schedule cache for " + source_path + ": " + std::string(e.what()));
+        return false;
+    }
+}
+
+void ScheduleCache::remove(const std::string& source_path) const {
+    std::error_code error;
+    std::filesystem::remove(get_entry_path(source_path), error);
+}
+
+const std::string& ScheduleCache::get_directory() const {
+    return directory_;
+}
+
+std::string ScheduleCache::get_entry_path(const std::string& source_path) const {
+    // Named after the source path; the path itself is checked against the header
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin",
+             static_cast<unsigned long long>(hash_bytes(HASH_SEED, source_path.data(), source_path.size())));
+    return (std::filesystem::path(directory_) / name).string();
+}
+
+bool ScheduleCache::stat_source(const std::string& source_path, SourceStamp& stamp) {
+    std::error_code error;
+    auto size = std::filesystem::file_size(source_path, error);
+    if (error) {
+        return false;
+    }
+    auto mtime = std::filesystem::last_write_time(source_path, error);
+    if (error) {
+        return false;
+    }
+    
+    stamp.size = size;
+    stamp.mtime = mtime.time_since_epoch().count();
+    return true;
+}
+
+bool ScheduleCache::hash_source(const std::string& source_path, uint64_t& hash) {
+    std::ifstream file(source_path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    
+    std::vector<char> buffer(JsonReader::DEFAULT_BUFFER_SIZE);
+    hash = HASH_SEED;
+    while (file) {
+        file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        hash = hash_bytes(hash, buffer.data(), static_cast<size_t>(file.gcount()));
+    }
+    return file.eof();
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+struct ParsedSchedule;
+
+// Size and modification time of a schedule file when it was read
+struct SourceStamp {
+    uint64_t size;
+    int64_t mtime;      // last_write_time ticks
+    
+    SourceStamp() : size(0), mtime(0) {}
+    
+    bool operator==(const SourceStamp& other) const {
+        return size == other.size && mtime == other.mtime;
+    }
+    bool operator!=(const SourceStamp& other) const {
+        return !(*this == other);
+    }
+};
+
+// Parsed schedule files persisted as flat binary entries, one per source
+// file, so a restart maps them instead of parsing JSON again.
+//
+// An entry is keyed by the source's path, size, modification time and a
+// hash of its contents. Size and time alone decide while the source is
+// clearly older than the entry; when it was modified close to the entry
+// being written (or its time changed but not its size) the contents are
+// hashed to be sure. Entries written by another format version or byte
+// order, truncated or otherwise inconsistent are ignored and replaced on
+// the next parse.
+class ScheduleCache {
+public:
+    // Bump whenever the layout below or what the parser produces changes
+    static constexpr uint32_t FORMAT_VERSION = 4;
+    
+    explicit ScheduleCache(const std::string& directory);
+    
+    // Fills schedule from the entry for source_path if it still matches the file
+    bool load(const std::string& source_path, ParsedSchedule& schedule) const;
+    
+    // Writes the entry for source_path. stamp is the source's, taken before
+    // parsing; nothing is written if the file has changed since.
+    bool store(const std::string& source_path, const SourceStamp& stamp, const ParsedSchedule& schedule) const;
+    
+    void remove(const std::string& source_path) const;
+    
+    const std::string& get_directory() const;
+    std::string get_entry_path(const std::string& source_path) const;
+    
+    static bool stat_source(const std::string& source_path, SourceStamp& stamp);
+    static bool hash_source(const std::string& source_path, uint64_t& hash);
+
+private:
+    std::string directory_;
+};
@@ -0,0 +1,490 @@
+#include "schedule-calendar.h"
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+const char* const WEEKDAY_CODES[7] = {"SU", "MO", "TU", "WE", "TH", "FR", "SA"};
+
+// A COUNT is settled by walking the recurrence at most this far
+const int COUNT_SEARCH_DAYS = 100 * 366;
+
+std::vector<std::string> split(const std::string& text, char separator) {
+    std::vector<std::string> parts;
+    size_t begin = 0;
+    while (begin <= text.size()) {
+        size_t end = text.find(separator, begin);
+        if (end == std::string::npos) {
+            end = text.size();
+        }
+        parts.push_back(text.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return parts;
+}
+
+bool parse_int(const std::string& text, int min, int max, int& value) {
+    if (text.empty() || text.size() > 9) {
+        return false;
+    }
+    size_t digits = (text[0] == '-' || text[0] == '+') ? 1 : 0;
+    if (digits == text.size()) {
+        return false;
+    }
+    for (size_t i = digits; i < text.size(); ++i) {
+        if (!std::isdigit(static_cast<unsigned char>(text[i]))) {
+            return false;
+        }
+    }
+    value = std::atoi(text.c_str());
+    return value >= min && value <= max;
+}
+
+// Monday-based week number, as RRULE counts weeks by default (WKST=MO)
+int week_of(CivilDay day) {
+    int shifted = day + 3;      // 1970-01-05 was a Monday
+    return shifted >= 0 ? shifted / 7 : (shifted - 6) / 7;
+}
+
+}
+
+CalendarRule::CalendarRule()
+    : frequency_(Frequency::None)
+    , interval_(1)
+    , count_(0)
+    , has_start_(false)
+    , start_(0)
+    , until_(INT32_MAX)
+    , by_month_(0)
+{
+}
+
+bool CalendarRule::add_dates(const std::string& value, std::string& error) {
+    Range range;
+    if (!parse_range(value, range)) {
+        error = "invalid date \"" + value + "\"";
+        return false;
+    }
+    dates_.push_back(range);
+    return true;
+}
+
+bool CalendarRule::add_exception(const std::string& value, std::string& error) {
+    Range range;
+    if (!parse_range(value, range)) {
+        error = "invalid date \"" + value + "\"";
+        return false;
+    }
+    exceptions_.push_back(range);
+    return true;
+}
+
+bool CalendarRule::set_start(const std::string& date, std::string& error) {
+    if (!parse_date(date, start_)) {
+        error = "invalid date \"" + date + "\"";
+        return false;
+    }
+    has_start_ = true;
+    return true;
+}
+
+bool CalendarRule::set_recurrence(const std::string& rrule, std::string& error) {
+    std::string text;
+    for (char c : rrule) {
+        if (!std::isspace(static_cast<unsigned char>(c))) {
+            text += static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        }
+    }
+    if (text.compare(0, 6, "RRULE:") == 0) {
+        text.erase(0, 6);
+    }
+    
+    frequency_ = Frequency::None;
+    interval_ = 1;
+    count_ = 0;
+    until_ = INT32_MAX;
+    by_day_.clear();
+    by_month_day_.clear();
+    by_month_ = 0;
+    
+    bool has_until = false;
+    for (const auto& part : split(text, ';')) {
+        if (part.empty()) {
+            continue;
+        }
+        size_t equals = part.find('=');
+        std::string key = part.substr(0, equals);
+        std::string value = equals == std::string::npos ? "" : part.substr(equals + 1);
+        
+        bool ok = true;
+        if (key == "FREQ") {
+            if (value == "DAILY") {
+                frequency_ = Frequency::Daily;
+            } else if (value == "WEEKLY") {
+                frequency_ = Frequency::Weekly;
+            } else if (value == "MONTHLY") {
+                frequency_ = Frequency::Monthly;
+            } else if (value == "YEARLY") {
+                frequency_ = Frequency::Yearly;
+            } else {
+                ok = false;
+            }
+        } else if (key == "INTERVAL") {
+            ok = parse_int(value, 1, 9999, interval_);
+        } else if (key == "COUNT") {
+            ok = parse_int(value, 1, 100000, count_);
+        } else if (key == "UNTIL") {
+            // A date-time UNTIL is cut to its date
+            ok = parse_date(value.substr(0, value.find('T')), until_);
+            has_until = true;
+        } else if (key == "BYDAY") {
+            for (const auto& entry : split(value, ',')) {
+                ByDay by_day = {0, -1};
+                if (entry.size() < 2) {
+                    ok = false;
+                    break;
+                }
+                std::string code = entry.substr(entry.size() - 2);
+                for (int weekday = 0; weekday < 7; ++weekday) {
+                    if (code == WEEKDAY_CODES[weekday]) {
+                        by_day.weekday = weekday;
+                    }
+                }
+                std::string ordinal = entry.substr(0, entry.size() - 2);
+                if (by_day.weekday < 0 ||
+                    (!ordinal.empty() && (!parse_int(ordinal, -53, 53, by_day.ordinal) || by_day.ordinal == 0))) {
+                    ok = false;
+                    break;
+                }
+                by_day_.push_back(by_day);
+            }
+        } else if (key == "BYMONTHDAY") {
+            for (const auto& entry : split(value, ',')) {
+                int mday = 0;
+                if (!parse_int(entry, -31, 31, mday) || mday == 0) {
+                    ok = false;
+                    break;
+                }
+                by_month_day_.push_back(mday);
+            }
+        } else if (key == "BYMONTH") {
+            for (const auto& entry : split(value, ',')) {
+                int month = 0;
+                if (!parse_int(entry, 1, 12, month)) {
+                    ok = false;
+                    break;
+                }
+                by_month_ |= static_cast<uint16_t>(1u << month);
+            }
+        } else if (key == "WKST") {
+            // Only matters to weekly rules with an interval; weeks start on Monday here
+            ok = value == "MO";
+        } else {
+            error = "unsupported \"rrule\" part \"" + key + "\"";
+            return false;
+        }
+        
+        if (!ok) {
+            error = "invalid \"rrule\" part \"" + part + "\"";
+            return false;
+        }
+    }
+    
+    if (frequency_ == Frequency::None) {
+        error = "\"rrule\" needs a FREQ";
+        return false;
+    }
+    if (count_ > 0 && has_until) {
+        error = "\"rrule\" may have COUNT or UNTIL, not both";
+        return false;
+    }
+    bool ordinals = std::any_of(by_day_.begin(), by_day_.end(), [](const ByDay& by_day) { return by_day.ordinal != 0; });
+    if (ordinals && frequency_ != Frequency::Monthly && frequency_ != Frequency::Yearly) {
+        error = "numbered BYDAY entries need a MONTHLY or YEARLY \"rrule\"";
+        return false;
+    }
+    
+    rrule_ = text;
+    return true;
+}
+
+bool CalendarRule::finish(std::string& error) {
+    if (frequency_ != Frequency::None && !has_start_) {
+        error = "\"rrule\" needs \"dtstart\"";
+        return false;
+    }
+    
+    normalize(dates_);
+    normalize(exceptions_);
+    
+    if (count_ > 0) {
+        // Counted from the start, exceptions included, like RFC 5545 does
+        int found = 0;
+        for (CivilDay day = start_; day <= start_ + COUNT_SEARCH_DAYS; ++day) {
+            if (matches_pattern(day) && ++found == count_) {
+                until_ = day;
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+bool CalendarRule::occurs_on(CivilDay day) const {
+    if (in_ranges(exceptions_, day)) {
+        return false;
+    }
+    if (dates_.empty() && frequency_ == Frequency::None) {
+        return true;
+    }
+    if (in_ranges(dates_, day)) {
+        return true;
+    }
+    return frequency_ != Frequency::None && day >= start_ && day <= until_ && matches_pattern(day);
+}
+
+bool CalendarRule::empty() const {
+    return dates_.empty() && exceptions_.empty() && frequency_ == Frequency::None;
+}
+
+std::string CalendarRule::to_text() const {
+    auto ranges_text = [](const std::vector<Range>& ranges) {
+        std::string text;
+        for (const auto& range : ranges) {
+            text += (text.empty() ? "" : ",") + format_date(range.first);
+            if (range.last != range.first) {
+                text += ".." + format_date(range.last);
+            }
+        }
+        return text;
+    };
+    
+    std::string text;
+    if (!dates_.empty()) {
+        text += "DATES:" + ranges_text(dates_) + "\n";
+    }
+    if (!exceptions_.empty()) {
+        text += "EXDATE:" + ranges_text(exceptions_) + "\n";
+    }
+    if (has_start_) {
+        text += "DTSTART:" + format_date(start_) + "\n";
+    }
+    if (frequency_ != Frequency::None) {
+        text += "RRULE:" + rrule_ + "\n";
+    }
+    return text;
+}
+
+bool CalendarRule::from_text(const std::string& text, CalendarRule& rule, std::string& error) {
+    rule = CalendarRule();
+    for (const auto& line : split(text, '\n')) {
+        if (line.empty()) {
+            continue;
+        }
+        size_t colon = line.find(':');
+        std::string name = line.substr(0, colon);
+        std::string value = colon == std::string::npos ? "" : line.substr(colon + 1);
+        
+        bool ok = true;
+        if (name == "DATES" || name == "EXDATE") {
+            for (const auto& entry : split(value, ',')) {
+                ok = ok && (name == "DATES" ? rule.add_dates(entry, error) : rule.add_exception(entry, error));
+            }
+        } else if (name == "DTSTART") {
+            ok = rule.set_start(value, error);
+        } else if (name == "RRULE") {
+            ok = rule.set_recurrence(value, error);
+        } else {
+            error = "unknown calendar line \"" + line + "\"";
+            ok = false;
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return rule.finish(error);
+}
+
+CivilDay CalendarRule::from_civil(int year, int month, int mday) {
+    year -= month <= 2;
+    int era = (year >= 0 ? year : year - 399) / 400;
+    int year_of_era = year - era * 400;
+    int day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + mday - 1;
+    int day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+}
+
+void CalendarRule::to_civil(CivilDay day, int& year, int& month, int& mday) {
+    int shifted = day + 719468;
+    int era = (shifted >= 0 ? shifted : shifted - 146096) / 146097;
+    int day_of_era = shifted - era * 146097;
+    int year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    int day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    int month_index = (5 * day_of_year + 2) / 153;
+    mday = day_of_year - (153 * month_index + 2) / 5 + 1;
+    month = month_index < 10 ? month_index + 3 : month_index - 9;
+    year = year_of_era + era * 400 + (month <= 2);
+}
+
+CivilDay CalendarRule::from_tm(const std::tm& local) {
+    return from_civil(local.tm_year + 1900, local.tm_mon + 1, local.tm_mday);
+}
+
+int CalendarRule::weekday(CivilDay day) {
+    return day >= -4 ? (day + 4) % 7 : (day + 5) % 7 + 6;
+}
+
+int CalendarRule::days_in_month(int year, int month) {
+    static const int days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    return month == 2 && leap ? 29 : days[month - 1];
+}
+
+bool CalendarRule::parse_date(const std::string& text, CivilDay& day) {
+    std::string digits;
+    if (text.size() == 10 && text[4] == '-' && text[7] == '-') {
+        digits = text.substr(0, 4) + text.substr(5, 2) + text.substr(8, 2);
+    } else if (text.size() == 8) {
+        digits = text;
+    } else {
+        return false;
+    }
+    
+    int year = 0;
+    int month = 0;
+    int mday = 0;
+    if (!parse_int(digits.substr(0, 4), 1, 9999, year) || !parse_int(digits.substr(4, 2), 1, 12, month) ||
+        !parse_int(digits.substr(6, 2), 1, days_in_month(year, month), mday)) {
+        return false;
+    }
+    day = from_civil(year, month, mday);
+    return true;
+}
+
+std::string CalendarRule::format_date(CivilDay day) {
+    int year = 0;
+    int month = 0;
+    int mday = 0;
+    to_civil(day, year, month, mday);
+    
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%04d-%02d-%02d", year, month, mday);
+    return buffer;
+}
+
+bool CalendarRule::parse_range(const std::string& value, Range& range) {
+    size_t dots = value.find("..");
+    if (dots == std::string::npos) {
+        if (!parse_date(value, range.first)) {
+            return false;
+        }
+        range.last = range.first;
+        return true;
+    }
+    return parse_date(value.substr(0, dots), range.first) && parse_date(value.substr(dots + 2), range.last) &&
+           range.first <= range.last;
+}
+
+void CalendarRule::normalize(std::vector<Range>& ranges) {
+    // Sorted and without overlaps, so a lookup is one binary search
+    std::sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) { return a.first < b.first; });
+    std::vector<Range> merged;
+    for (const auto& range : ranges) {
+        if (!merged.empty() && range.first <= merged.back().last + 1) {
+            merged.back().last = std::max(merged.back().last, range.last);
+        } else {
+            merged.push_back(range);
+        }
+    }
+    ranges = std::move(merged);
+}
+
+bool CalendarRule::in_ranges(const std::vector<Range>& ranges, CivilDay day) {
+    auto after = std::upper_bound(ranges.begin(), ranges.end(), day,
+                                  [](CivilDay value, const Range& range) { return value < range.first; });
+    return after != ranges.begin() && (after - 1)->last >= day;
+}
+
+bool CalendarRule::matches_pattern(CivilDay day) const {
+    // The recurrence alone, ignoring UNTIL, COUNT and exceptions
+    if (day < start_) {
+        return false;
+    }
+    
+    int year = 0;
+    int month = 0;
+    int mday = 0;
+    to_civil(day, year, month, mday);
+    int start_year = 0;
+    int start_month = 0;
+    int start_mday = 0;
+    to_civil(start_, start_year, start_month, start_mday);
+    
+    if (by_month_ && !(by_month_ & (1u << month))) {
+        return false;
+    }
+    if (!by_month_day_.empty()) {
+        int length = days_in_month(year, month);
+        bool found = false;
+        for (int wanted : by_month_day_) {
+            found = found || mday == (wanted > 0 ? wanted : length + wanted + 1);
+        }
+        if (!found) {
+            return false;
+        }
+    }
+    if (!by_day_.empty() && !matches_by_day(day, year, month, mday)) {
+        return false;
+    }
+    
+    switch (frequency_) {
+    case Frequency::Daily:
+        return (day - start_) % interval_ == 0;
+    case Frequency::Weekly:
+        if ((week_of(day) - week_of(start_)) % interval_ != 0) {
+            return false;
+        }
+        return !by_day_.empty() || weekday(day) == weekday(start_);
+    case Frequency::Monthly:
+        if (((year - start_year) * 12 + month - start_month) % interval_ != 0) {
+            return false;
+        }
+        return !by_day_.empty() || !by_month_day_.empty() || mday == start_mday;
+    case Frequency::Yearly:
+        if ((year - start_year) % interval_ != 0) {
+            return false;
+        }
+        if (by_day_.empty() && by_month_day_.empty()) {
+            return (by_month_ || month == start_month) && mday == start_mday;
+        }
+        return true;
+    case Frequency::None:
+        break;
+    }
+    return false;
+}
+
+bool CalendarRule::matches_by_day(CivilDay day, int year, int month, int mday) const {
+    int this_weekday = weekday(day);
+    
+    // Numbered entries count within the month, or within the year for a
+    // yearly rule that names no month
+    bool in_year = frequency_ == Frequency::Yearly && !by_month_;
+    int position = in_year ? day - from_civil(year, 1, 1) : mday - 1;
+    int length = in_year ? from_civil(year + 1, 1, 1) - from_civil(year, 1, 1) : days_in_month(year, month);
+    
+    for (const auto& by_day : by_day_) {
+        if (by_day.weekday != this_weekday) {
+            continue;
+        }
+        if (by_day.ordinal == 0 ||
+            (by_day.ordinal > 0 && position / 7 + 1 == by_day.ordinal) ||
+            (by_day.ordinal < 0 && (length - 1 - position) / 7 + 1 == -by_day.ordinal)) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+// Days since 1970-01-01; every calendar date is handled as one
+using CivilDay = int32_t;
+
+// Dates something runs on beyond its weekdays: absolute dates, date ranges,
+// an RRULE-style recurrence (RFC 5545, the date parts of it) and exception
+// dates, which win over all of the others. An empty rule matches every day;
+// one with only exceptions matches every day but those.
+//
+// Dates are local calendar dates: no times, no time zones.
+class CalendarRule {
+public:
+    enum class Frequency { None, Daily, Weekly, Monthly, Yearly };
+    
+    CalendarRule();
+    
+    // Each takes "YYYY-MM-DD" or a range "YYYY-MM-DD..YYYY-MM-DD" (inclusive).
+    // False, with error set, when malformed.
+    bool add_dates(const std::string& value, std::string& error);
+    bool add_exception(const std::string& value, std::string& error);
+    
+    // FREQ, INTERVAL, COUNT, UNTIL, BYDAY, BYMONTHDAY and BYMONTH, e.g.
+    // "FREQ=MONTHLY;BYDAY=-1FR" or "FREQ=WEEKLY;INTERVAL=2;BYDAY=MO,TH;UNTIL=20271231"
+    bool set_recurrence(const std::string& rrule, std::string& error);
+    bool set_start(const std::string& date, std::string& error);       // DTSTART, which a recurrence needs
+    
+    // Checks the fields together and settles COUNT into a last date; call
+    // once every field is set, before asking occurs_on
+    bool finish(std::string& error);
+    
+    bool occurs_on(CivilDay day) const;
+    bool empty() const;
+    
+    // Canonical text of the rule; from_text reads it back (the schedule cache stores it)
+    std::string to_text() const;
+    static bool from_text(const std::string& text, CalendarRule& rule, std::string& error);
+    
+    bool operator==(const CalendarRule& other) const { return to_text() == other.to_text(); }
+    bool operator!=(const CalendarRule& other) const { return !(*this == other); }
+    
+    // Date arithmetic, proleptic Gregorian
+    static CivilDay from_civil(int year, int month, int mday);
+    static void to_civil(CivilDay day, int& year, int& month, int& mday);
+    static CivilDay from_tm(const std::tm& local);
+    static int weekday(CivilDay day);       // Sunday = 0, like tm_wday
+    static int days_in_month(int year, int month);
+    static bool parse_date(const std::string& text, CivilDay& day);      // YYYY-MM-DD or YYYYMMDD
+    static std::string format_date(CivilDay day);
+
+private:
+    struct Range {
+        CivilDay first;
+        CivilDay last;
+    };
+    
+    struct ByDay {
+        int ordinal;            // 2 = second of the month (or year), -1 = last; 0 = every one
+        int weekday;
+    };
+    
+    static bool parse_range(const std::string& value, Range& range);
+    static void normalize(std::vector<Range>& ranges);
+    static bool in_ranges(const std::vector<Range>& ranges, CivilDay day);
+    bool matches_pattern(CivilDay day) const;
+    bool matches_by_day(CivilDay day, int year, int month, int mday) const;
+    
+    std::vector<Range> dates_;          // Sorted and merged once finished
+    std::vector<Range> exceptions_;
+    
+    // Recurrence
+    std::string rrule_;                 // As given, upper-cased
+    Frequency frequency_;
+    int interval_;
+    int count_;                         // 0: no COUNT
+    bool has_start_;
+    CivilDay start_;
+    CivilDay until_;                    // Last day it may occur; COUNT ends up here too
+    std::vector<ByDay> by_day_;
+    std::vector<int> by_month_day_;     // -1 = last day of the month
+    uint16_t by_month_;                 // Bit n set: month n (1-12)
+};
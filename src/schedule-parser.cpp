@@ -0,0 +1,532 @@
+#include "schedule-parser.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+class ScheduleParser::Handler : public JsonHandler {
+public:
+    Handler(const JsonReader& reader, ParsedSchedule& schedule)
+        : reader_(reader)
+        , schedule_(schedule)
+        , field_(Field::Other)
+        , has_version_(false)
+        , has_playlists_(false)
+        , file_mode_(TriggerMode::Minute)
+        , frame_rate_(0.0)
+        , playlist_days_set_(false)
+        , playlist_mode_set_(false)
+        , item_days_set_(false)
+    {
+    }
+    
+    bool start_object() override {
+        if (!check(ValueType::Object)) {
+            return false;
+        }
+        
+        switch (top()) {
+        case Context::Document:
+            stack_.push_back(Context::Root);
+            return true;
+        case Context::Playlists:
+            playlist_ = Playlist();
+            playlist_calendar_ = CalendarRule();
+            playlist_days_set_ = false;
+            playlist_mode_set_ = false;
+            item_days_set_flags_.clear();
+            stack_.push_back(Context::Playlist);
+            return true;
+        case Context::Items:
+            item_ = ScheduledItem();
+            item_calendar_ = CalendarRule();
+            item_days_set_ = false;
+            item_position_ = reader_.get_token_position();
+            stack_.push_back(Context::Item);
+            return true;
+        default:
+            stack_.push_back(Context::Skip);
+            return true;
+        }
+    }
+    
+    bool end_object() override {
+        Context context = top();
+        stack_.pop_back();
+        
+        switch (context) {
+        case Context::Root:
+            if (!has_version_) {
+                return fail("missing \"version\"");
+            }
+            if (!has_playlists_) {
+                return fail("missing \"playlists\"");
+            }
+            return true;
+        case Context::Playlist:
+            return end_playlist();
+        case Context::Item:
+            return end_item();
+        default:
+            return true;
+        }
+    }
+    
+    bool start_array() override {
+        if (!check(ValueType::Array)) {
+            return false;
+        }
+        
+        Context context = Context::Skip;
+        if (top() == Context::Root && field_ == Field::Playlists) {
+            context = Context::Playlists;
+            has_playlists_ = true;
+        } else if (top() == Context::Playlist && field_ == Field::Items) {
+            context = Context::Items;
+        } else if (top() == Context::Playlist && field_ == Field::Days) {
+            context = Context::PlaylistDays;
+            playlist_.days.clear();
+            playlist_days_set_ = true;
+        } else if (top() == Context::Item && field_ == Field::Days) {
+            context = Context::ItemDays;
+            item_.days.clear();
+            item_days_set_ = true;
+        } else if ((top() == Context::Playlist || top() == Context::Item) && field_ == Field::Dates) {
+            context = Context::Dates;
+        } else if ((top() == Context::Playlist || top() == Context::Item) && field_ == Field::Except) {
+            context = Context::ExceptDates;
+        }
+        
+        stack_.push_back(context);
+        return true;
+    }
+    
+    bool end_array() override {
+        stack_.pop_back();
+        return true;
+    }
+    
+    bool key(const std::string& name) override {
+        // Resolved once here; the value callbacks only switch on it
+        key_ = name;
+        field_ = Field::Other;
+        for (const auto& known : FIELDS) {
+            if (known.context == top() && name == known.name) {
+                field_ = known.field;
+                break;
+            }
+        }
+        return true;
+    }
+    
+    bool string_value(const std::string& value) override {
+        if (!check(ValueType::String)) {
+            return false;
+        }
+        
+        switch (top()) {
+        case Context::PlaylistDays:
+            return add_day(value, playlist_.days);
+        case Context::ItemDays:
+            return add_day(value, item_.days);
+        case Context::Dates:
+            return calendar_field(&CalendarRule::add_dates, value);
+        case Context::ExceptDates:
+            return calendar_field(&CalendarRule::add_exception, value);
+        default:
+            break;
+        }
+        
+        switch (field_) {
+        case Field::Version:
+            schedule_.version = value;
+            has_version_ = true;
+            return true;
+        case Field::Timezone:       schedule_.timezone = value; return true;
+        case Field::DefaultIdle:    schedule_.default_idle = value; return true;
+        case Field::FileTriggerMode:
+            return parse_trigger_mode(value, file_mode_);
+        case Field::PlaylistName:   playlist_.name = value; return true;
+        case Field::PlaylistTriggerMode:
+            playlist_mode_set_ = true;
+            return parse_trigger_mode(value, playlist_.trigger_mode);
+        case Field::ItemName:       item_.name = value; return true;
+        case Field::Time:           item_.time = value; return true;
+        case Field::Source:         item_.source = value; return true;
+        case Field::File:           item_.file_path = value; return true;
+        case Field::Scene:          item_.scene = value; return true;
+        case Field::Rrule:          return calendar_field(&CalendarRule::set_recurrence, value);
+        case Field::Dtstart:        return calendar_field(&CalendarRule::set_start, value);
+        default:
+            return true;
+        }
+    }
+    
+    bool number_value(double value) override {
+        if (!check(ValueType::Number)) {
+            return false;
+        }
+        
+        if (field_ == Field::FrameRate) {
+            if (!(value > 0) || value > MAX_FRAME_RATE) {
+                return fail("\"frame_rate\" must be above 0 and at most " + std::to_string(MAX_FRAME_RATE));
+            }
+            frame_rate_ = value;
+        } else if (field_ == Field::Duration) {
+            if (!(value >= 0) || value > MAX_DURATION) {
+                return fail("\"duration\" must be from 0 to " + std::to_string(MAX_DURATION) + " seconds");
+            }
+            item_.duration = static_cast<int>(value);
+        } else if (field_ == Field::Priority) {
+            if (value != std::floor(value) || std::fabs(value) > MAX_PRIORITY) {
+                return fail("\"priority\" must be a whole number from -" + std::to_string(MAX_PRIORITY) +
+                            " to " + std::to_string(MAX_PRIORITY));
+            }
+            (top() == Context::Item ? item_.priority : playlist_.priority) = static_cast<int>(value);
+        }
+        return true;
+    }
+    
+    bool bool_value(bool value) override {
+        if (!check(ValueType::Bool)) {
+            return false;
+        }
+        
+        if (field_ == Field::Enabled) {
+            playlist_.enabled = value;
+        } else if (field_ == Field::Loop) {
+            item_.loop = value;
+        }
+        return true;
+    }
+    
+    bool null_value() override {
+        // Same as leaving the key out; not allowed as an array's entry
+        switch (top()) {
+        case Context::Root:
+        case Context::Playlist:
+        case Context::Item:
+        case Context::Skip:
+            return true;
+        default:
+            return check(ValueType::Any);
+        }
+    }
+    
+    // Fills in what playlists and items inherit, once the whole file is known
+    void finish() {
+        convert_timecodes();
+        
+        for (size_t i = 0; i < schedule_.playlists.size(); ++i) {
+            auto& playlist = schedule_.playlists[i];
+            if (!playlist_mode_set_flags_[i]) {
+                playlist.trigger_mode = file_mode_;
+            }
+            playlist.default_idle = schedule_.default_idle;
+            
+            for (auto& item : playlist.items) {
+                item.trigger_mode = playlist.trigger_mode;
+            }
+        }
+    }
+
+private:
+    enum class Context {
+        Document, Root, Playlists, Playlist, PlaylistDays, Items, Item, ItemDays,
+        Dates, ExceptDates,     // Of the playlist or item below them
+        Skip
+    };
+    enum class ValueType { Any, Object, Array, String, Number, Bool };
+    
+    // Keys the format knows, per object they appear in
+    enum class Field {
+        Other, Version, Timezone, DefaultIdle, FileTriggerMode, FrameRate, Playlists,
+        PlaylistName, Enabled, Days, PlaylistTriggerMode, Items,
+        ItemName, Time, Source, File, Duration, Loop, Scene,
+        Dates, Except, Rrule, Dtstart, Priority
+    };
+    
+    struct KnownField {
+        Context context;
+        const char* name;
+        Field field;
+        ValueType type;
+    };
+    
+    static constexpr KnownField FIELDS[] = {
+        {Context::Root, "version", Field::Version, ValueType::String},
+        {Context::Root, "timezone", Field::Timezone, ValueType::String},
+        {Context::Root, "default_idle", Field::DefaultIdle, ValueType::String},
+        {Context::Root, "trigger_mode", Field::FileTriggerMode, ValueType::String},
+        {Context::Root, "frame_rate", Field::FrameRate, ValueType::Number},
+        {Context::Root, "playlists", Field::Playlists, ValueType::Array},
+        {Context::Playlist, "name", Field::PlaylistName, ValueType::String},
+        {Context::Playlist, "enabled", Field::Enabled, ValueType::Bool},
+        {Context::Playlist, "days", Field::Days, ValueType::Array},
+        {Context::Playlist, "trigger_mode", Field::PlaylistTriggerMode, ValueType::String},
+        {Context::Playlist, "items", Field::Items, ValueType::Array},
+        {Context::Playlist, "dates", Field::Dates, ValueType::Array},
+        {Context::Playlist, "except", Field::Except, ValueType::Array},
+        {Context::Playlist, "rrule", Field::Rrule, ValueType::String},
+        {Context::Playlist, "dtstart", Field::Dtstart, ValueType::String},
+        {Context::Playlist, "priority", Field::Priority, ValueType::Number},
+        {Context::Item, "name", Field::ItemName, ValueType::String},
+        {Context::Item, "time", Field::Time, ValueType::String},
+        {Context::Item, "source", Field::Source, ValueType::String},
+        {Context::Item, "file", Field::File, ValueType::String},
+        {Context::Item, "duration", Field::Duration, ValueType::Number},
+        {Context::Item, "loop", Field::Loop, ValueType::Bool},
+        {Context::Item, "scene", Field::Scene, ValueType::String},
+        {Context::Item, "days", Field::Days, ValueType::Array},
+        {Context::Item, "dates", Field::Dates, ValueType::Array},
+        {Context::Item, "except", Field::Except, ValueType::Array},
+        {Context::Item, "rrule", Field::Rrule, ValueType::String},
+        {Context::Item, "dtstart", Field::Dtstart, ValueType::String},
+        {Context::Item, "priority", Field::Priority, ValueType::Number},
+    };
+    
+    Context top() const {
+        return stack_.empty() ? Context::Document : stack_.back();
+    }
+    
+    ValueType expected_type() const {
+        switch (top()) {
+        case Context::Document:
+        case Context::Playlists:
+        case Context::Items:
+            return ValueType::Object;
+        case Context::PlaylistDays:
+        case Context::ItemDays:
+        case Context::Dates:
+        case Context::ExceptDates:
+            return ValueType::String;
+        case Context::Root:
+        case Context::Playlist:
+        case Context::Item:
+            for (const auto& known : FIELDS) {
+                if (known.field == field_ && known.context == top()) {
+                    return known.type;
+                }
+            }
+            return ValueType::Any;
+        case Context::Skip:
+            return ValueType::Any;
+        }
+        return ValueType::Any;
+    }
+    
+    std::string describe() const {
+        switch (top()) {
+        case Context::Document:     return "the schedule";
+        case Context::Playlists:    return "each entry of \"playlists\"";
+        case Context::Items:        return "each entry of \"items\"";
+        case Context::PlaylistDays:
+        case Context::ItemDays:     return "each entry of \"days\"";
+        case Context::Dates:        return "each entry of \"dates\"";
+        case Context::ExceptDates:  return "each entry of \"except\"";
+        default:                    return "\"" + key_ + "\"";
+        }
+    }
+    
+    bool check(ValueType actual) {
+        ValueType expected = expected_type();
+        if (expected == ValueType::Any || expected == actual) {
+            return true;
+        }
+        
+        static const char* names[] = {"anything", "an object", "an array", "a string", "a number", "true or false"};
+        return fail(describe() + " must be " + names[static_cast<int>(expected)]);
+    }
+    
+    bool parse_trigger_mode(const std::string& value, TriggerMode& mode) {
+        if (value == "minute") {
+            mode = TriggerMode::Minute;
+        } else if (value == "frame") {
+            mode = TriggerMode::Frame;
+        } else {
+            return fail("\"trigger_mode\" must be \"minute\" or \"frame\"");
+        }
+        return true;
+    }
+    
+    bool add_day(const std::string& value, DaySet& days) {
+        // The schedule editor writes "Monday"
+        std::string day = value;
+        std::transform(day.begin(), day.end(), day.begin(), [](unsigned char c) { return std::tolower(c); });
+        if (!days.add(day)) {
+            return fail("unknown day \"" + value + "\"");
+        }
+        return true;
+    }
+    
+    // Calendar fields go to whichever of the playlist or item is being read
+    bool calendar_field(bool (CalendarRule::*add)(const std::string&, std::string&), const std::string& value) {
+        Context owner = top();
+        if (owner == Context::Dates || owner == Context::ExceptDates) {
+            owner = stack_[stack_.size() - 2];
+        }
+        CalendarRule& rule = owner == Context::Item ? item_calendar_ : playlist_calendar_;
+        
+        std::string error;
+        if (!(rule.*add)(value, error)) {
+            return fail(error);
+        }
+        return true;
+    }
+    
+    bool finish_calendar(CalendarRule& rule, std::shared_ptr<const CalendarRule>& calendar) {
+        if (rule.empty()) {
+            return true;
+        }
+        
+        std::string error;
+        if (!rule.finish(error)) {
+            return fail(error);
+        }
+        calendar = std::make_shared<const CalendarRule>(std::move(rule));
+        return true;
+    }
+    
+    bool end_item() {
+        if (!finish_calendar(item_calendar_, item_.calendar)) {
+            return false;
+        }
+        
+        std::string problem;
+        if (item_.name.empty()) {
+            problem = "no \"name\"";
+        } else if (item_.source.empty()) {
+            problem = "no \"source\"";
+        } else if (ScheduleTimeline::time_to_ms(item_.time) < 0 && !ScheduleTimeline::is_timecode(item_.time)) {
+            problem = "invalid \"time\" \"" + item_.time + "\"";
+        }
+        
+        if (!problem.empty()) {
+            schedule_.warnings.push_back(item_position_.to_string() + ": item skipped, " + problem);
+            return true;
+        }
+        
+        // "frame_rate" may come after the playlists
+        if (ScheduleTimeline::is_timecode(item_.time)) {
+            timecodes_.push_back(Timecode{schedule_.playlists.size(), playlist_.items.size(), item_position_});
+        }
+        
+        item_days_set_flags_.push_back(item_days_set_);
+        playlist_.items.push_back(std::move(item_));
+        return true;
+    }
+    
+    // Timecode starts as the millisecond their frame starts in, at the file's frame rate
+    void convert_timecodes() {
+        std::vector<size_t> invalid;
+        for (size_t i = 0; i < timecodes_.size(); ++i) {
+            auto& item = schedule_.playlists[timecodes_[i].playlist].items[timecodes_[i].item];
+            int32_t ms = ScheduleTimeline::time_to_ms(item.time, frame_rate_);
+            if (ms >= 0) {
+                item.time = ScheduleTimeline::format_time(ms);
+                continue;
+            }
+            
+            std::string problem = frame_rate_ > 0.0
+                ? "frame past \"frame_rate\" in \"time\" \"" + item.time + "\""
+                : "timecode \"time\" \"" + item.time + "\" without a \"frame_rate\"";
+            schedule_.warnings.push_back(timecodes_[i].position.to_string() + ": item skipped, " + problem);
+            invalid.push_back(i);
+        }
+        
+        // Last first, so the indices of the others still hold
+        for (auto it = invalid.rbegin(); it != invalid.rend(); ++it) {
+            auto& items = schedule_.playlists[timecodes_[*it].playlist].items;
+            items.erase(items.begin() + timecodes_[*it].item);
+        }
+    }
+    
+    bool end_playlist() {
+        if (!finish_calendar(playlist_calendar_, playlist_.calendar)) {
+            return false;
+        }
+        if (!playlist_days_set_) {
+            playlist_.days = DaySet::every_day();
+        }
+        
+        for (size_t i = 0; i < playlist_.items.size(); ++i) {
+            if (!item_days_set_flags_[i]) {
+                playlist_.items[i].days = playlist_.days;
+            }
+            if (!playlist_.items[i].calendar) {
+                playlist_.items[i].calendar = playlist_.calendar;
+            }
+        }
+        
+        playlist_mode_set_flags_.push_back(playlist_mode_set_);
+        schedule_.playlists.push_back(std::move(playlist_));
+        return true;
+    }
+    
+    const JsonReader& reader_;
+    ParsedSchedule& schedule_;
+    std::vector<Context> stack_;
+    std::string key_;           // Latest key seen, at whatever depth
+    Field field_;               // What key_ is, in the object it was seen in
+    
+    bool has_version_;
+    bool has_playlists_;
+    TriggerMode file_mode_;
+    double frame_rate_;         // 0 when the file gives none
+    
+    // Items timed by timecode, converted once the frame rate is known
+    struct Timecode {
+        size_t playlist;
+        size_t item;
+        JsonPosition position;
+    };
+    std::vector<Timecode> timecodes_;
+    std::vector<bool> playlist_mode_set_flags_;     // Per finished playlist
+    
+    // Playlist being read
+    Playlist playlist_;
+    CalendarRule playlist_calendar_;
+    bool playlist_days_set_;
+    bool playlist_mode_set_;
+    std::vector<bool> item_days_set_flags_;         // Per item kept so far
+    
+    // Item being read
+    ScheduledItem item_;
+    CalendarRule item_calendar_;
+    bool item_days_set_;
+    JsonPosition item_position_;
+};
+
+ScheduleParser::ScheduleParser(size_t buffer_size)
+    : reader_(buffer_size)
+{
+}
+
+bool ScheduleParser::parse_file(const std::string& file_path, ParsedSchedule& schedule) {
+    schedule = ParsedSchedule();
+    Handler handler(reader_, schedule);
+    if (!reader_.parse_file(file_path, handler)) {
+        return false;
+    }
+    
+    handler.finish();
+    return true;
+}
+
+bool ScheduleParser::parse_string(const std::string& json, ParsedSchedule& schedule) {
+    schedule = ParsedSchedule();
+    Handler handler(reader_, schedule);
+    if (!reader_.parse_string(json, handler)) {
+        return false;
+    }
+    
+    handler.finish();
+    return true;
+}
+
+const std::string& ScheduleParser::get_error() const {
+    return reader_.get_error();
+}
+
+uint64_t ScheduleParser::get_bytes_read() const {
+    return reader_.get_bytes_read();
+}
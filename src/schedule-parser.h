@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "playlist-manager.h"
+#include "utils/json-reader.h"
+
+// Everything one schedule file declares
+struct ParsedSchedule {
+    std::string version;
+    std::string timezone;
+    std::string default_idle;
+    std::vector<Playlist> playlists;
+    std::vector<std::string> warnings;  // Items left out, with where they are
+};
+
+// Reads schedule files in the format of sample-schedule.json in one streaming
+// pass. Items inherit their playlist's days and calendar dates (unless they
+// give their own) and trigger mode, playlists the file's trigger mode and
+// idle content. Items timed by "HH:MM:SS:FF" timecode get the millisecond
+// their frame starts in, at the file's "frame_rate". Items missing a name,
+// source or valid time are skipped with a warning; anything else malformed
+// fails the file with the line and column of the problem.
+class ScheduleParser {
+public:
+    static constexpr int MAX_PRIORITY = 1000000;      // "priority" runs from -MAX_PRIORITY to MAX_PRIORITY
+    static constexpr int MAX_FRAME_RATE = 1000;
+    static constexpr int MAX_DURATION = 7 * 24 * 3600;    // Seconds; the schedule repeats weekly
+    
+    explicit ScheduleParser(size_t buffer_size = JsonReader::DEFAULT_BUFFER_SIZE);
+    
+    bool parse_file(const std::string& file_path, ParsedSchedule& schedule);
+    bool parse_string(const std::string& json, ParsedSchedule& schedule);
+    
+    // "line 12, column 20: ..." for the last failed parse
+    const std::string& get_error() const;
+    
+    // Bytes read by the last parse
+    uint64_t get_bytes_read() const;
+
+private:
+    class Handler;
+    
+    JsonReader reader_;
+    
+    // Prevent copying
+    ScheduleParser(const ScheduleParser&) = delete;
+    ScheduleParser& operator=(const ScheduleParser&) = delete;
+};
@@ -0,0 +1,878 @@
+#include "schedule-timeline.h"
+#include "playlist-manager.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+const char* const DAY_NAMES[ScheduleTimeline::DAYS_PER_WEEK] = {
+    "sunday", "monday", "tuesday", "wednesday", "thursday", "friday", "saturday"
+};
+
+const uint8_t EVERY_DAY = (1u << ScheduleTimeline::DAYS_PER_WEEK) - 1;
+
+bool entry_before(const ScheduleTimeline::Entry& entry, int32_t ms) {
+    return entry.start_ms < ms;
+}
+
+bool before_entry(int32_t ms, const ScheduleTimeline::Entry& entry) {
+    return ms < entry.start_ms;
+}
+
+// Reads count digits at time[at], false unless all are there
+bool read_digits(const std::string& time, size_t at, size_t count, int& value) {
+    if (at + count > time.size()) {
+        return false;
+    }
+    value = 0;
+    for (size_t i = at; i < at + count; ++i) {
+        if (time[i] < '0' || time[i] > '9') {
+            return false;
+        }
+        value = value * 10 + (time[i] - '0');
+    }
+    return true;
+}
+
+// H:MM or HH:MM and then :SS when present; the position after what was read, 0 if invalid
+size_t read_clock(const std::string& time, int32_t& ms, bool& has_seconds) {
+    size_t colon = time.find(':');
+    if (colon == std::string::npos || colon == 0 || colon > 2) {
+        return 0;
+    }
+    
+    int hour = 0;
+    int minute = 0;
+    if (!read_digits(time, 0, colon, hour) || !read_digits(time, colon + 1, 2, minute) ||
+        hour > 23 || minute > 59) {
+        return 0;
+    }
+    ms = (hour * 60 + minute) * 60 * 1000;
+    
+    size_t at = colon + 3;
+    has_seconds = at < time.size() && time[at] == ':';
+    if (!has_seconds) {
+        return at;
+    }
+    int second = 0;
+    if (!read_digits(time, at + 1, 2, second) || second > 59) {
+        return 0;
+    }
+    ms += second * 1000;
+    return at + 3;
+}
+
+}
+
+DaySet::DaySet(std::initializer_list<std::string> days)
+    : mask_(0)
+{
+    for (const auto& day : days) {
+        add(day);
+    }
+}
+
+DaySet DaySet::from_mask(uint8_t mask) {
+    DaySet days;
+    days.mask_ = mask & EVERY_DAY;
+    return days;
+}
+
+DaySet DaySet::every_day() {
+    return from_mask(EVERY_DAY);
+}
+
+bool DaySet::add(const std::string& day) {
+    int weekday = ScheduleTimeline::day_index(day);
+    if (weekday < 0) {
+        return false;
+    }
+    add(weekday);
+    return true;
+}
+
+void DaySet::add(int weekday) {
+    if (weekday >= 0 && weekday < ScheduleTimeline::DAYS_PER_WEEK) {
+        mask_ |= static_cast<uint8_t>(1u << weekday);
+    }
+}
+
+bool DaySet::contains(int weekday) const {
+    return weekday >= 0 && weekday < ScheduleTimeline::DAYS_PER_WEEK && (mask_ >> weekday) & 1u;
+}
+
+size_t DaySet::size() const {
+    size_t count = 0;
+    for (uint8_t rest = mask_; rest; rest &= rest - 1) {
+        ++count;
+    }
+    return count;
+}
+
+std::vector<std::string> DaySet::names() const {
+    std::vector<std::string> result;
+    for (int weekday = 0; weekday < ScheduleTimeline::DAYS_PER_WEEK; ++weekday) {
+        if (contains(weekday)) {
+            result.push_back(DAY_NAMES[weekday]);
+        }
+    }
+    return result;
+}
+
+ScheduleTimeline::ScheduleTimeline()
+    : item_count_(0)
+    , first_day_(0)
+{
+    static const std::shared_ptr<const Day> empty = std::make_shared<const Day>();
+    days_.fill(empty);
+}
+
+void ScheduleTimeline::build(const std::vector<std::shared_ptr<const ScheduledItem>>& items,
+                             CivilDay first_day, int horizon_days) {
+    items_.clear();
+    day_masks_.clear();
+    dated_.clear();
+    
+    items_.reserve(items.size());
+    day_masks_.reserve(items.size());
+    
+    std::array<std::shared_ptr<Day>, DAYS_PER_WEEK> days;
+    for (auto& day : days) {
+        day = std::make_shared<Day>();
+    }
+    
+    for (const auto& item : items) {
+        int32_t start = 0;
+        uint8_t mask = 0;
+        if (!schedule_of(*item, start, mask)) {
+            continue;
+        }
+        
+        uint32_t index = static_cast<uint32_t>(items_.size());
+        items_.push_back(item);
+        day_masks_.push_back(mask);
+        if (item->calendar) {
+            dated_.push_back(index);
+            continue;
+        }
+        for (int weekday = 0; weekday < DAYS_PER_WEEK; ++weekday) {
+            if (mask & (1u << weekday)) {
+                days[weekday]->entries.push_back(Entry{start, index});
+            }
+        }
+    }
+    item_count_ = items_.size();
+    
+    // Stable, so items sharing a start keep their order in items. Each day
+    // settles on its own first, which decides what it carries past midnight.
+    std::array<std::vector<bool>, DAYS_PER_WEEK> dropped;
+    for (int weekday = 0; weekday < DAYS_PER_WEEK; ++weekday) {
+        auto& entries = days[weekday]->entries;
+        std::stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+            return a.start_ms < b.start_ms;
+        });
+        
+        dropped[weekday] = settle_alone(*days[weekday]);
+        days_[weekday] = days[weekday];
+    }
+    for (int weekday = 0; weekday < DAYS_PER_WEEK; ++weekday) {
+        build_slots(*days[weekday], std::move(dropped[weekday]), weekdays_before(weekday));
+    }
+    
+    first_day_ = first_day;
+    dates_.assign(std::max(horizon_days, 0), nullptr);
+    expand_dates(std::vector<bool>(dates_.size(), true));
+}
+
+void ScheduleTimeline::patch(const ScheduleTimeline& previous,
+                             const std::vector<std::shared_ptr<const ScheduledItem>>& removed,
+                             const std::vector<std::shared_ptr<const ScheduledItem>>& added,
+                             const std::vector<std::pair<std::shared_ptr<const ScheduledItem>,
+                                                         std::shared_ptr<const ScheduledItem>>>& replaced) {
+    items_ = previous.items_;
+    day_masks_ = previous.day_masks_;
+    item_count_ = previous.item_count_;
+    days_ = previous.days_;
+    dated_ = previous.dated_;
+    first_day_ = previous.first_day_;
+    dates_ = previous.dates_;
+    
+    // Dates of the horizon a calendar item comes onto or leaves
+    std::vector<bool> redo(dates_.size(), false);
+    auto mark_dates = [this, &redo](const ScheduledItem& item, uint8_t mask) {
+        for (size_t offset = 0; offset < dates_.size(); ++offset) {
+            CivilDay day = first_day_ + static_cast<CivilDay>(offset);
+            if ((mask & (1u << CalendarRule::weekday(day))) && item.calendar->occurs_on(day)) {
+                redo[offset] = true;
+            }
+        }
+    };
+    
+    // Same id, start and days: the entries and slots stay as they are
+    if (!replaced.empty()) {
+        std::unordered_map<const ScheduledItem*, const std::shared_ptr<const ScheduledItem>*> moved;
+        for (const auto& pair : replaced) {
+            moved.emplace(pair.first.get(), &pair.second);
+        }
+        
+        for (auto& item : items_) {
+            auto it = item ? moved.find(item.get()) : moved.end();
+            if (it != moved.end()) {
+                item = *it->second;
+            }
+        }
+    }
+    
+    // Removed items leave a gap, so the indices in untouched days stay valid
+    uint8_t touched = 0;
+    if (!removed.empty()) {
+        std::unordered_set<const ScheduledItem*> gone;
+        for (const auto& item : removed) {
+            gone.insert(item.get());
+        }
+        
+        for (size_t index = 0; index < items_.size(); ++index) {
+            if (items_[index] && gone.count(items_[index].get())) {
+                if (items_[index]->calendar) {
+                    mark_dates(*items_[index], day_masks_[index]);
+                } else {
+                    touched |= day_masks_[index];
+                }
+                items_[index].reset();
+                day_masks_[index] = 0;
+                --item_count_;
+            }
+        }
+    }
+    
+    std::array<std::vector<Entry>, DAYS_PER_WEEK> added_entries;
+    for (const auto& item : added) {
+        int32_t start = 0;
+        uint8_t mask = 0;
+        if (!schedule_of(*item, start, mask)) {
+            continue;
+        }
+        
+        uint32_t index = static_cast<uint32_t>(items_.size());
+        items_.push_back(item);
+        day_masks_.push_back(mask);
+        ++item_count_;
+        if (item->calendar) {
+            dated_.push_back(index);
+            mark_dates(*item, mask);
+            continue;
+        }
+        touched |= mask;
+        for (int weekday = 0; weekday < DAYS_PER_WEEK; ++weekday) {
+            if (mask & (1u << weekday)) {
+                added_entries[weekday].push_back(Entry{start, index});
+            }
+        }
+    }
+    
+    if (items_.size() - item_count_ > item_count_) {
+        // More gaps than items: start over from the items left, in id order
+        std::vector<std::shared_ptr<const ScheduledItem>> live;
+        live.reserve(item_count_);
+        for (const auto& item : items_) {
+            if (item) {
+                live.push_back(item);
+            }
+        }
+        std::sort(live.begin(), live.end(), [](const std::shared_ptr<const ScheduledItem>& a,
+                                               const std::shared_ptr<const ScheduledItem>& b) {
+            return a->id < b->id;
+        });
+        build(live, first_day_, static_cast<int>(dates_.size()));
+        return;
+    }
+    
+    // Same order as build() gives
+    auto before = [this](const Entry& a, const Entry& b) {
+        return comes_before(a, b);
+    };
+    
+    // Days a touched one carries something else into past midnight are settled again too
+    std::array<std::shared_ptr<Day>, DAYS_PER_WEEK> rebuilt;
+    std::array<std::vector<bool>, DAYS_PER_WEEK> dropped;
+    uint8_t resettle = touched;
+    for (int weekday = 0; weekday < DAYS_PER_WEEK; ++weekday) {
+        if (!(touched & (1u << weekday))) {
+            continue;
+        }
+        
+        const auto& old_entries = days_[weekday]->entries;
+        std::vector<Entry> kept;
+        kept.reserve(old_entries.size());
+        for (const auto& entry : old_entries) {
+            if (items_[entry.item]) {
+                kept.push_back(entry);
+            }
+        }
+        
+        auto& new_entries = added_entries[weekday];
+        std::sort(new_entries.begin(), new_entries.end(), before);
+        
+        auto day = std::make_shared<Day>();
+        day->entries.reserve(kept.size() + new_entries.size());
+        std::merge(kept.begin(), kept.end(), new_entries.begin(), new_entries.end(),
+                   std::back_inserter(day->entries), before);
+        dropped[weekday] = settle_alone(*day);
+        
+        const auto& old_overnight = days_[weekday]->overnight;
+        if (!(day->overnight == old_overnight)) {
+            int reach = std::max(days_reached(old_overnight), days_reached(day->overnight));
+            for (int ahead = 1; ahead <= reach; ++ahead) {
+                resettle |= static_cast<uint8_t>(1u << ((weekday + ahead) % DAYS_PER_WEEK));
+            }
+        }
+        rebuilt[weekday] = day;
+    }
+    
+    for (int weekday = 0; weekday < DAYS_PER_WEEK; ++weekday) {
+        if ((resettle & (1u << weekday)) && !rebuilt[weekday]) {
+            rebuilt[weekday] = std::make_shared<Day>();
+            rebuilt[weekday]->entries = days_[weekday]->entries;
+            dropped[weekday] = settle_alone(*rebuilt[weekday]);
+        }
+    }
+    for (int weekday = 0; weekday < DAYS_PER_WEEK; ++weekday) {
+        if (rebuilt[weekday]) {
+            days_[weekday] = rebuilt[weekday];
+        }
+    }
+    for (int weekday = 0; weekday < DAYS_PER_WEEK; ++weekday) {
+        if (rebuilt[weekday]) {
+            build_slots(*rebuilt[weekday], std::move(dropped[weekday]), weekdays_before(weekday));
+        }
+    }
+    
+    // Dates hold their weekday's entries as well, and start with what the days before carry
+    for (size_t offset = 0; offset < dates_.size(); ++offset) {
+        int weekday = CalendarRule::weekday(first_day_ + static_cast<CivilDay>(offset));
+        if (resettle & (1u << weekday)) {
+            redo[offset] = true;
+        }
+    }
+    expand_dates(redo);
+}
+
+void ScheduleTimeline::advance(CivilDay first_day) {
+    if (first_day == first_day_) {
+        return;
+    }
+    
+    // Dates still in the horizon move along; only the new ones are expanded
+    std::vector<std::shared_ptr<const Day>> dates(dates_.size());
+    std::vector<bool> redo(dates_.size(), false);
+    for (size_t offset = 0; offset < dates.size(); ++offset) {
+        int64_t old_offset = static_cast<int64_t>(first_day) + static_cast<int64_t>(offset) - first_day_;
+        if (old_offset >= 0 && old_offset < static_cast<int64_t>(dates_.size())) {
+            dates[offset] = dates_[old_offset];
+        } else {
+            redo[offset] = true;
+        }
+    }
+    first_day_ = first_day;
+    dates_ = std::move(dates);
+    expand_dates(redo);
+}
+
+CivilDay ScheduleTimeline::get_first_day() const {
+    return first_day_;
+}
+
+int ScheduleTimeline::get_horizon_days() const {
+    return static_cast<int>(dates_.size());
+}
+
+void ScheduleTimeline::expand_dates(const std::vector<bool>& redo) {
+    if (dated_.empty()) {
+        // Nothing to expand: every date answers with its weekday
+        std::fill(dates_.begin(), dates_.end(), nullptr);
+        return;
+    }
+    
+    // A date carrying something else past midnight changes the dates after it
+    size_t follows_change = 0;     // Dates before this offset are settled again
+    for (size_t offset = 0; offset < dates_.size(); ++offset) {
+        if (!redo[offset] && offset >= follows_change) {
+            continue;
+        }
+        
+        CivilDay day = first_day_ + static_cast<CivilDay>(offset);
+        std::shared_ptr<const Day> previous = day_on(day);
+        dates_[offset] = expand_date(day);
+        const auto& overnight = day_on(day)->overnight;
+        if (!(overnight == previous->overnight)) {
+            int reach = std::max(days_reached(overnight), days_reached(previous->overnight));
+            follows_change = std::max(follows_change, offset + 1 + reach);
+        }
+    }
+}
+
+std::shared_ptr<const ScheduleTimeline::Day> ScheduleTimeline::expand_date(CivilDay day) const {
+    int weekday = CalendarRule::weekday(day);
+    std::vector<Entry> dated;
+    for (uint32_t index : dated_) {
+        const auto& item = items_[index];
+        if (item && (day_masks_[index] & (1u << weekday)) && item->calendar->occurs_on(day)) {
+            dated.push_back(Entry{time_to_ms(item->time), index});
+        }
+    }
+    
+    // Only its weekday's items: the weekday answers, unless the dates before
+    // carry something else into it
+    Before days_before = dates_before(day);
+    if (dated.empty() && carried_into(days_before) == carried_into(weekdays_before(weekday))) {
+        return nullptr;
+    }
+    
+    auto before = [this](const Entry& a, const Entry& b) {
+        return comes_before(a, b);
+    };
+    std::sort(dated.begin(), dated.end(), before);
+    
+    const auto& weekly = days_[weekday]->entries;
+    auto result = std::make_shared<Day>();
+    result->entries.reserve(weekly.size() + dated.size());
+    std::merge(weekly.begin(), weekly.end(), dated.begin(), dated.end(), std::back_inserter(result->entries), before);
+    build_slots(*result, settle_alone(*result), days_before);
+    return result;
+}
+
+const std::shared_ptr<const ScheduleTimeline::Day>& ScheduleTimeline::day_on(CivilDay day) const {
+    int64_t offset = static_cast<int64_t>(day) - first_day_;
+    if (offset >= 0 && offset < static_cast<int64_t>(dates_.size()) && dates_[offset]) {
+        return dates_[offset];
+    }
+    return days_[CalendarRule::weekday(day)];
+}
+
+bool ScheduleTimeline::comes_before(const Entry& a, const Entry& b) const {
+    if (a.start_ms != b.start_ms) {
+        return a.start_ms < b.start_ms;
+    }
+    return items_[a.item]->id < items_[b.item]->id;
+}
+
+std::vector<bool> ScheduleTimeline::settle_alone(Day& day) const {
+    return find_conflicts(day, {}, &day.overnight);
+}
+
+void ScheduleTimeline::build_slots(Day& day, std::vector<bool> dropped, const Before& before) const {
+    // Settled again with whatever the days before still have on
+    std::vector<Overnight> carried = carried_into(before);
+    if (!carried.empty()) {
+        dropped = find_conflicts(day, carried, nullptr);
+    }
+    
+    day.slots.clear();
+    for (size_t position = 0; position < day.entries.size(); ++position) {
+        const Entry& entry = day.entries[position];
+        if (dropped[position]) {
+            continue;
+        }
+        if (day.slots.empty() || day.slots.back().to_ms() != entry.start_ms) {
+            day.slots.emplace_back(entry.start_ms);
+        }
+        day.slots.back().item_ids.push_back(items_[entry.item]->id);
+    }
+}
+
+std::vector<bool> ScheduleTimeline::find_conflicts(Day& day, const std::vector<Overnight>& carried,
+                                                   std::vector<Overnight>* overnight) const {
+    // One sweep in start order, keeping per source the items still on it, and
+    // the items whose scene is on air
+    const size_t CARRIED = SIZE_MAX;
+    struct Running {
+        int32_t start;          // Milliseconds since midnight, negative when carried in
+        int64_t end;
+        uint32_t item;
+        size_t position;        // In day.entries, CARRIED for items of the days before
+        bool stopped;           // Never started or cut short on its source
+        bool on_scene;
+    };
+    std::vector<Running> running;
+    std::unordered_map<std::string_view, std::vector<size_t>> on_source;
+    std::vector<size_t> on_scene;
+    std::vector<bool> dropped(day.entries.size(), false);
+    day.conflicts.clear();
+    
+    auto start_running = [&](const Running& entry) {
+        const ScheduledItem& item = *items_[entry.item];
+        if (!item.source.empty()) {
+            on_source[item.source].push_back(running.size());
+        }
+        if (entry.on_scene) {
+            on_scene.push_back(running.size());
+        }
+        running.push_back(entry);
+    };
+    for (const auto& item : carried) {
+        start_running(Running{item.start_ms, item.end_ms, item.item, CARRIED, false, item.on_scene});
+    }
+    
+    std::vector<size_t> meets;
+    for (size_t position = 0; position < day.entries.size(); ++position) {
+        const Entry& entry = day.entries[position];
+        const ScheduledItem& item = *items_[entry.item];
+        bool takes_scene = !item.scene.empty();
+        if (item.source.empty() && !takes_scene) {
+            continue;
+        }
+        int32_t start = entry.start_ms;
+        int64_t end = start + item.get_duration_ms();
+        
+        auto gone = [&](size_t index) {
+            const Running& other = running[index];
+            return other.stopped || (other.start < start && other.end <= start);
+        };
+        
+        // Whom it meets: the items on its source, and those with another scene on air
+        meets.clear();
+        if (!item.source.empty()) {
+            auto& playing = on_source[item.source];
+            playing.erase(std::remove_if(playing.begin(), playing.end(), gone), playing.end());
+            for (size_t index : playing) {
+                if (running[index].item != entry.item) {
+                    meets.push_back(index);
+                }
+            }
+        }
+        if (takes_scene) {
+            on_scene.erase(std::remove_if(on_scene.begin(), on_scene.end(), [&](size_t index) {
+                return gone(index) || !running[index].on_scene;
+            }), on_scene.end());
+            for (size_t index : on_scene) {
+                const Running& other = running[index];
+                if (other.item != entry.item && items_[other.item]->scene != item.scene &&
+                    std::find(meets.begin(), meets.end(), index) == meets.end()) {
+                    meets.push_back(index);
+                }
+            }
+        }
+        
+        // Kept off by a higher priority, or an equal one that started with it
+        bool loses = false;
+        for (size_t index : meets) {
+            const Running& other = running[index];
+            if (outranks(other.item, entry.item) || (!outranks(entry.item, other.item) && other.start == start)) {
+                day.conflicts.push_back(Conflict{other.item, entry.item, start, true});
+                loses = true;
+            }
+        }
+        if (loses) {
+            dropped[position] = true;
+            continue;
+        }
+        
+        // Otherwise it takes the source or scene over; whatever started with
+        // it never starts, and another scene goes off air with its source
+        // still playing
+        for (size_t index : meets) {
+            Running& other = running[index];
+            bool together = other.start == start;
+            day.conflicts.push_back(Conflict{entry.item, other.item, start, together});
+            if (together) {
+                dropped[other.position] = true;
+            }
+            if (together || (!item.source.empty() && items_[other.item]->source == item.source)) {
+                other.stopped = true;
+            } else {
+                other.on_scene = false;
+            }
+        }
+        start_running(Running{start, end, entry.item, position, false, takes_scene});
+    }
+    
+    if (overnight) {
+        overnight->clear();
+        for (const auto& item : running) {
+            if (item.position != CARRIED && !item.stopped && item.end > MS_PER_DAY) {
+                overnight->push_back(Overnight{item.start, item.end, item.item, item.on_scene});
+            }
+        }
+    }
+    return dropped;
+}
+
+std::vector<ScheduleTimeline::Overnight> ScheduleTimeline::carried_into(const Before& before) {
+    std::vector<Overnight> carried;
+    for (int back = 1; back < DAYS_PER_WEEK; ++back) {
+        int64_t shift = static_cast<int64_t>(back) * MS_PER_DAY;
+        for (const auto& item : before[back - 1]->overnight) {
+            if (item.end_ms > shift) {
+                carried.push_back(Overnight{static_cast<int32_t>(item.start_ms - shift), item.end_ms - shift,
+                                            item.item, item.on_scene});
+            }
+        }
+    }
+    return carried;
+}
+
+int ScheduleTimeline::days_reached(const std::vector<Overnight>& overnight) {
+    int64_t latest = 0;
+    for (const auto& item : overnight) {
+        latest = std::max(latest, item.end_ms);
+    }
+    return latest > 0 ? static_cast<int>(std::min<int64_t>((latest - 1) / MS_PER_DAY, DAYS_PER_WEEK - 1)) : 0;
+}
+
+ScheduleTimeline::Before ScheduleTimeline::weekdays_before(int weekday) const {
+    Before before;
+    for (int back = 1; back < DAYS_PER_WEEK; ++back) {
+        before[back - 1] = days_[(weekday + DAYS_PER_WEEK - back) % DAYS_PER_WEEK].get();
+    }
+    return before;
+}
+
+ScheduleTimeline::Before ScheduleTimeline::dates_before(CivilDay day) const {
+    Before before;
+    for (int back = 1; back < DAYS_PER_WEEK; ++back) {
+        before[back - 1] = day_on(day - back).get();
+    }
+    return before;
+}
+
+bool ScheduleTimeline::outranks(uint32_t a, uint32_t b) const {
+    const ScheduledItem& first = *items_[a];
+    const ScheduledItem& second = *items_[b];
+    if (first.playlist_priority != second.playlist_priority) {
+        return first.playlist_priority > second.playlist_priority;
+    }
+    return first.priority > second.priority;
+}
+
+bool ScheduleTimeline::schedule_of(const ScheduledItem& item, int32_t& start, uint8_t& mask) {
+    start = time_to_ms(item.time);
+    if (start < 0) {
+        return false;
+    }
+    
+    mask = item.days.mask();
+    return mask != 0;
+}
+
+size_t ScheduleTimeline::get_item_count() const {
+    return item_count_;
+}
+
+const std::shared_ptr<const ScheduledItem>& ScheduleTimeline::get_item(uint32_t index) const {
+    return items_[index];
+}
+
+uint8_t ScheduleTimeline::get_day_mask(uint32_t index) const {
+    return day_masks_[index];
+}
+
+const std::vector<ScheduleTimeline::Entry>& ScheduleTimeline::get_entries(int weekday) const {
+    static const std::vector<Entry> none;
+    return (weekday >= 0 && weekday < DAYS_PER_WEEK) ? days_[weekday]->entries : none;
+}
+
+const std::vector<TimeSlot>& ScheduleTimeline::get_slots(int weekday) const {
+    static const std::vector<TimeSlot> none;
+    return (weekday >= 0 && weekday < DAYS_PER_WEEK) ? days_[weekday]->slots : none;
+}
+
+std::shared_ptr<const std::vector<TimeSlot>> ScheduleTimeline::share_slots(int weekday) const {
+    static const auto none = std::make_shared<const std::vector<TimeSlot>>();
+    if (weekday < 0 || weekday >= DAYS_PER_WEEK) {
+        return none;
+    }
+    
+    // Aliases the day, which owns the slots
+    const auto& day = days_[weekday];
+    return std::shared_ptr<const std::vector<TimeSlot>>(day, &day->slots);
+}
+
+const std::vector<ScheduleTimeline::Conflict>& ScheduleTimeline::get_conflicts(int weekday) const {
+    static const std::vector<Conflict> none;
+    return (weekday >= 0 && weekday < DAYS_PER_WEEK) ? days_[weekday]->conflicts : none;
+}
+
+const std::vector<ScheduleTimeline::Conflict>& ScheduleTimeline::get_conflicts_on(CivilDay day) const {
+    return day_on(day)->conflicts;
+}
+
+size_t ScheduleTimeline::get_conflict_count() const {
+    size_t count = 0;
+    for (const auto& day : days_) {
+        count += day->conflicts.size();
+    }
+    return count;
+}
+
+const std::vector<ScheduleTimeline::Entry>& ScheduleTimeline::get_entries_on(CivilDay day) const {
+    return day_on(day)->entries;
+}
+
+const std::vector<TimeSlot>& ScheduleTimeline::get_slots_on(CivilDay day) const {
+    return day_on(day)->slots;
+}
+
+std::shared_ptr<const std::vector<TimeSlot>> ScheduleTimeline::share_slots_on(CivilDay day) const {
+    const auto& shared = day_on(day);
+    return std::shared_ptr<const std::vector<TimeSlot>>(shared, &shared->slots);
+}
+
+ScheduleTimeline::Range ScheduleTimeline::get_entries_at(int weekday, int32_t ms) const {
+    const auto& entries = get_entries(weekday);
+    const Entry* begin = entries.data();
+    const Entry* end = begin + entries.size();
+    
+    const Entry* first = std::lower_bound(begin, end, ms, entry_before);
+    return Range{first, std::upper_bound(first, end, ms, before_entry)};
+}
+
+ScheduleTimeline::Range ScheduleTimeline::get_entries_on_air(int weekday, int32_t ms) const {
+    const auto& entries = get_entries(weekday);
+    const Entry* begin = entries.data();
+    const Entry* end = begin + entries.size();
+    
+    const Entry* next = std::upper_bound(begin, end, ms, before_entry);
+    if (next == begin) {
+        return Range{next, next};
+    }
+    
+    return Range{std::lower_bound(begin, next, (next - 1)->start_ms, entry_before), next};
+}
+
+ScheduleTimeline::Range ScheduleTimeline::get_entries_after(int weekday, int32_t ms, size_t count) const {
+    const auto& entries = get_entries(weekday);
+    const Entry* begin = entries.data();
+    const Entry* end = begin + entries.size();
+    
+    const Entry* first = std::upper_bound(begin, end, ms, before_entry);
+    if (static_cast<size_t>(end - first) <= count) {
+        return Range{first, end};
+    }
+    
+    // Finish the slot the count-th entry is in, like the trigger always did
+    const Entry* last = first + count;
+    if (count > 0) {
+        last = std::upper_bound(last - 1, end, (last - 1)->start_ms, before_entry);
+    }
+    return Range{first, last};
+}
+
+bool ScheduleTimeline::get_next_trigger(int weekday, int32_t ms, int32_t& slot_ms, int& days_ahead) const {
+    if (weekday < 0 || weekday >= DAYS_PER_WEEK) {
+        return false;
+    }
+    
+    // Today after ms, then each following day from midnight, back round to today
+    for (int ahead = 0; ahead <= DAYS_PER_WEEK; ++ahead) {
+        const auto& entries = days_[(weekday + ahead) % DAYS_PER_WEEK]->entries;
+        auto next = ahead == 0
+            ? std::upper_bound(entries.begin(), entries.end(), ms, before_entry)
+            : entries.begin();
+        
+        if (next != entries.end()) {
+            slot_ms = next->start_ms;
+            days_ahead = ahead;
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+bool ScheduleTimeline::get_next_trigger_on(CivilDay day, int32_t ms, int32_t& slot_ms, int& days_ahead) const {
+    // A week round like above, or to the end of the horizon when that is further
+    int64_t horizon_left = static_cast<int64_t>(first_day_) + static_cast<int64_t>(dates_.size()) - day;
+    int last = static_cast<int>(std::max<int64_t>(DAYS_PER_WEEK, std::min<int64_t>(horizon_left, dates_.size())));
+    for (int ahead = 0; ahead <= last; ++ahead) {
+        const auto& entries = day_on(day + ahead)->entries;
+        auto next = ahead == 0
+            ? std::upper_bound(entries.begin(), entries.end(), ms, before_entry)
+            : entries.begin();
+        
+        if (next != entries.end()) {
+            slot_ms = next->start_ms;
+            days_ahead = ahead;
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+int ScheduleTimeline::day_index(const std::string& day) {
+    for (int weekday = 0; weekday < DAYS_PER_WEEK; ++weekday) {
+        if (day == DAY_NAMES[weekday]) {
+            return weekday;
+        }
+    }
+    return -1;
+}
+
+int32_t ScheduleTimeline::time_to_ms(const std::string& time, double frame_rate) {
+    // Without going through exceptions: this runs for every item of every build
+    int32_t ms = 0;
+    bool has_seconds = false;
+    size_t at = read_clock(time, ms, has_seconds);
+    if (at == 0) {
+        return -1;
+    }
+    if (at == time.size()) {
+        return ms;
+    }
+    
+    // A fraction or frame of the second
+    size_t digits = time.size() - at - 1;
+    int part = 0;
+    if (!has_seconds || digits < 1 || digits > 3 || !read_digits(time, at + 1, digits, part)) {
+        return -1;
+    }
+    
+    if (time[at] == '.') {
+        for (size_t i = digits; i < 3; ++i) {
+            part *= 10;
+        }
+        return ms + part;
+    }
+    
+    // Timecode: frame part of the second, down to the millisecond it starts in
+    if (time[at] != ':' || digits != 2 || !is_timecode(time) || frame_rate <= 0.0 || part >= frame_rate) {
+        return -1;
+    }
+    return ms + static_cast<int32_t>(part * 1000.0 / frame_rate);
+}
+
+bool ScheduleTimeline::is_timecode(const std::string& time) {
+    int32_t ms = 0;
+    bool has_seconds = false;
+    int frame = 0;
+    size_t at = read_clock(time, ms, has_seconds);
+    return at != 0 && has_seconds && at + 3 == time.size() && time[at] == ':' && time.find(':') == 2 &&
+           read_digits(time, at + 1, 2, frame);
+}
+
+std::string ScheduleTimeline::format_time(int32_t ms) {
+    if (ms < 0 || ms >= MS_PER_DAY) {
+        ms = 0;
+    }
+    
+    int32_t seconds = ms / 1000;
+    char buffer[16];
+    if (ms % 1000 != 0) {
+        snprintf(buffer, sizeof(buffer), "%02d:%02d:%02d.%03d", seconds / 3600, seconds / 60 % 60, seconds % 60,
+                 ms % 1000);
+    } else if (seconds % 60 != 0) {
+        snprintf(buffer, sizeof(buffer), "%02d:%02d:%02d", seconds / 3600, seconds / 60 % 60, seconds % 60);
+    } else {
+        snprintf(buffer, sizeof(buffer), "%02d:%02d", seconds / 3600, seconds / 60 % 60);
+    }
+    return std::string(buffer);
+}
+
+std::string TimeSlot::to_string() const {
+    return ScheduleTimeline::format_time(start_ms);
+}
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "schedule-calendar.h"
+
+struct ScheduledItem;
+
+struct TimeSlot {
+    int32_t start_ms;           // Milliseconds since local midnight
+    std::vector<std::string> item_ids;
+    
+    explicit TimeSlot(int32_t ms = 0) : start_ms(ms) {}
+    
+    bool operator<(const TimeSlot& other) const {
+        return start_ms < other.start_ms;
+    }
+    
+    int32_t to_ms() const {
+        return start_ms;
+    }
+    
+    std::string to_string() const;      // As ScheduleTimeline::format_time
+};
+
+// Weekdays something runs on, a bit each, numbered like tm_wday (sunday = 0).
+// Replaces a list of day names per item: a byte instead of a vector of strings.
+class DaySet {
+public:
+    DaySet() : mask_(0) {}
+    DaySet(std::initializer_list<std::string> days);    // Unknown names are ignored
+    
+    static DaySet from_mask(uint8_t mask);
+    static DaySet every_day();
+    
+    bool add(const std::string& day);   // False when not a weekday name
+    void add(int weekday);
+    bool contains(int weekday) const;
+    bool empty() const { return mask_ == 0; }
+    size_t size() const;
+    uint8_t mask() const { return mask_; }
+    void clear() { mask_ = 0; }
+    
+    std::vector<std::string> names() const;     // Sunday first
+    
+    bool operator==(const DaySet& other) const { return mask_ == other.mask_; }
+    bool operator!=(const DaySet& other) const { return mask_ != other.mask_; }
+
+private:
+    uint8_t mask_;
+};
+
+// A week of schedule compiled for lookups by time. Every item gets a day mask
+// and one (start, item index) entry per weekday it runs on, the start in
+// milliseconds since midnight; each weekday's entries are sorted by start, so
+// "what is on at T", "the next N after T" and "the next trigger" are binary
+// searches instead of walks over every item, however fine the start times.
+//
+// Built once per published ScheduleSnapshot and immutable afterwards. A
+// reload patches the previous timeline instead: weekdays the change does not
+// touch are shared with it, not copied, and removed items leave a gap in the
+// item indices until there are more gaps than items.
+// Weekdays are numbered like tm_wday, sunday = 0.
+//
+// Items with a calendar rule (dates, ranges, recurrences) are not part of the
+// weekdays: they are expanded date by date, only over a horizon of days from
+// a first date, into days of their own that also hold that weekday's items.
+// Dates outside the horizon, or without such items, answer with the weekday.
+// advance() moves the horizon on, expanding only the dates it gains.
+//
+// Each day also records where items overlap, from their start and duration
+// (the detected one of items without their own): two items driving the same
+// source, or two items switching the channel to different scenes, since the
+// one switching last would take the programme. An item running past
+// midnight is still on at the start of the days after; whether it was
+// dropped or cut short is settled on the day it starts.
+// Of two such items the higher priority wins (playlist priority, then the
+// item's own); at equal priority the one that started first keeps the
+// source or scene, or the first by id when both start together, unless the
+// other one starts later and cuts in. A loser that would start while the
+// winner is on is dropped from the day's slots, so it is never fired.
+class ScheduleTimeline {
+public:
+    static constexpr int DAYS_PER_WEEK = 7;
+    static constexpr int32_t MS_PER_DAY = 24 * 60 * 60 * 1000;
+    static constexpr int DEFAULT_HORIZON_DAYS = 14;
+    
+    struct Entry {
+        int32_t start_ms;       // Since midnight
+        uint32_t item;          // Index into the timeline's items
+    };
+    
+    // Two items wanting one source or the programme at once, indices into the timeline's items
+    struct Conflict {
+        uint32_t winner;
+        uint32_t loser;
+        int32_t start_ms;       // Where they meet: the later of the two starts
+        bool dropped;           // The loser is not fired; otherwise the winner cuts it short
+    };
+    
+    ScheduleTimeline();
+    
+    // Items with an invalid time or no known day are left out. Items sharing
+    // a start keep their order in items, which is expected to be by id.
+    // Calendar items are expanded for horizon_days from first_day.
+    void build(const std::vector<std::shared_ptr<const ScheduledItem>>& items,
+               CivilDay first_day = 0, int horizon_days = 0);
+    
+    // previous, less the removed items (matched by pointer) and plus the added
+    // ones. Gives the same lookups as a build from scratch. Each replaced pair
+    // is an identical item held elsewhere now: (old, new) pointers, swapped
+    // without touching any weekday.
+    void patch(const ScheduleTimeline& previous,
+               const std::vector<std::shared_ptr<const ScheduledItem>>& removed,
+               const std::vector<std::shared_ptr<const ScheduledItem>>& added,
+               const std::vector<std::pair<std::shared_ptr<const ScheduledItem>,
+                                           std::shared_ptr<const ScheduledItem>>>& replaced = {});
+    
+    // Starts the horizon at first_day, keeping the dates still in it
+    void advance(CivilDay first_day);
+    CivilDay get_first_day() const;
+    int get_horizon_days() const;
+    
+    size_t get_item_count() const;
+    const std::shared_ptr<const ScheduledItem>& get_item(uint32_t index) const;
+    uint8_t get_day_mask(uint32_t index) const;     // Bit n set: runs on weekday n
+    
+    // One weekday, in start order: single entries and grouped into slots.
+    // Calendar items are not in them; see the date lookups below.
+    const std::vector<Entry>& get_entries(int weekday) const;
+    const std::vector<TimeSlot>& get_slots(int weekday) const;
+    
+    // The same slots, kept alive by the caller. Equal pointers from two
+    // timelines mean the weekday did not change between them.
+    std::shared_ptr<const std::vector<TimeSlot>> share_slots(int weekday) const;
+    
+    // One date: its weekday plus the calendar items on it, within the horizon
+    const std::vector<Entry>& get_entries_on(CivilDay day) const;
+    const std::vector<TimeSlot>& get_slots_on(CivilDay day) const;
+    std::shared_ptr<const std::vector<TimeSlot>> share_slots_on(CivilDay day) const;
+    
+    // Overlaps on one weekday or date, in start order
+    const std::vector<Conflict>& get_conflicts(int weekday) const;
+    const std::vector<Conflict>& get_conflicts_on(CivilDay day) const;
+    size_t get_conflict_count() const;      // Over the weekdays
+    
+    // Run of one weekday's entries, pointing into the timeline
+    struct Range {
+        const Entry* first;
+        const Entry* last;
+        
+        const Entry* begin() const { return first; }
+        const Entry* end() const { return last; }
+        size_t size() const { return last - first; }
+        bool empty() const { return first == last; }
+    };
+    
+    // Times below are milliseconds since midnight, like the entries' starts
+    
+    // Entries starting exactly at ms
+    Range get_entries_at(int weekday, int32_t ms) const;
+    
+    // What is on at ms: the latest slot started at or before it, empty before the day's first
+    Range get_entries_on_air(int weekday, int32_t ms) const;
+    
+    // At least count entries starting after ms the same day (whole slots, fewer if the day ends)
+    Range get_entries_after(int weekday, int32_t ms, size_t count) const;
+    
+    // Start of the first slot after ms, looking up to a week ahead.
+    // days_ahead is 0 for later today; false when the week is empty.
+    bool get_next_trigger(int weekday, int32_t ms, int32_t& slot_ms, int& days_ahead) const;
+    bool get_next_trigger_on(CivilDay day, int32_t ms, int32_t& slot_ms, int& days_ahead) const;
+    
+    // Parsing shared with the lookups: -1 when not a weekday
+    static int day_index(const std::string& day);
+    
+    // Start of "HH:MM", "HH:MM:SS", "HH:MM:SS.mmm" (one to three digits of
+    // fraction) or, at frame_rate frames a second, "HH:MM:SS:FF" timecode,
+    // rounded down to the millisecond. -1 when invalid, for timecode without
+    // a frame rate or with a frame past the second's last.
+    static int32_t time_to_ms(const std::string& time, double frame_rate = 0.0);
+    static bool is_timecode(const std::string& time);       // HH:MM:SS:FF, whatever the frame
+    
+    // Shortest of "HH:MM", "HH:MM:SS" and "HH:MM:SS.mmm" giving ms exactly
+    static std::string format_time(int32_t ms);
+
+private:
+    struct Day;
+    
+    // An item still on at midnight, timed from the start of its own day
+    struct Overnight {
+        int32_t start_ms;
+        int64_t end_ms;         // Past MS_PER_DAY
+        uint32_t item;
+        bool on_scene;          // Still holding the programme with its scene
+        
+        bool operator==(const Overnight& other) const {
+            return start_ms == other.start_ms && end_ms == other.end_ms && item == other.item &&
+                   on_scene == other.on_scene;
+        }
+    };
+    using Before = std::array<const Day*, DAYS_PER_WEEK - 1>;     // The days before one, nearest first
+    
+    struct Day {
+        std::vector<Entry> entries;
+        std::vector<TimeSlot> slots;        // Entries less the dropped ones
+        std::vector<Conflict> conflicts;
+        std::vector<Overnight> overnight;   // Settled on the day alone
+    };
+    
+    std::vector<bool> settle_alone(Day& day) const;     // True per entry when dropped
+    void build_slots(Day& day, std::vector<bool> dropped, const Before& before) const;
+    std::vector<bool> find_conflicts(Day& day, const std::vector<Overnight>& carried,
+                                     std::vector<Overnight>* overnight) const;
+    static std::vector<Overnight> carried_into(const Before& before);
+    static int days_reached(const std::vector<Overnight>& overnight);     // Days after its own it is still on
+    Before weekdays_before(int weekday) const;
+    Before dates_before(CivilDay day) const;
+    bool outranks(uint32_t a, uint32_t b) const;
+    void expand_dates(const std::vector<bool>& redo);
+    std::shared_ptr<const Day> expand_date(CivilDay day) const;       // Null when no calendar item is on
+    const std::shared_ptr<const Day>& day_on(CivilDay day) const;
+    bool comes_before(const Entry& a, const Entry& b) const;     // By start, then by id
+    static bool schedule_of(const ScheduledItem& item, int32_t& start, uint8_t& mask);     // False if never on
+    
+    std::vector<std::shared_ptr<const ScheduledItem>> items_;  // Null where an item was removed
+    std::vector<uint8_t> day_masks_;
+    size_t item_count_;
+    std::array<std::shared_ptr<const Day>, DAYS_PER_WEEK> days_;
+    
+    // Calendar items, and the horizon they are expanded over
+    std::vector<uint32_t> dated_;       // Item indices, removed ones included until the next build
+    CivilDay first_day_;
+    std::vector<std::shared_ptr<const Day>> dates_;    // From first_day_; null: same as the weekday
+};
@@ -1,52 +1,103 @@
 #include "scheduler-core.h"
 #include "playlist-manager.h"
-#include "media-controller.h"
+#include "media-probe.h"
 #include "time-trigger.h"
 #include "utils/config.h"
 #include "utils/logger.h"
+#include <util/platform.h>
 #include <chrono>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
 
 SchedulerCore::SchedulerCore()
     : running_(false)
     , enabled_(true)
     , should_reload_(false)
-    , check_interval_seconds_(1)
-    , last_check_time_(std::chrono::steady_clock::now())
+    , should_rearm_(false)
+    , should_refresh_(false)
+    , should_join_(false)
+    , join_since_ns_(0)
+    , load_ns_(0)
+    , clock_(Clock::system())
+    , probe_listener_(0)
+    , preroll_seconds_(5)
 {
 }
 
 SchedulerCore::~SchedulerCore() {
     stop();
+    
+    if (probe_listener_ != 0) {
+        MediaProbe::shared()->remove_listener(probe_listener_);
+    }
+    
+    // Unregister from the video tick before the components it calls into go away
+    if (frame_trigger_) {
+        frame_trigger_->cleanup();
+    }
+}
+
+void SchedulerCore::set_clock(std::shared_ptr<Clock> clock) {
+    clock_ = clock ? clock : Clock::system();
+    deadlines_.set_clock(clock_);
 }
 
 bool SchedulerCore::initialize() {
     LOG_INFO("Initializing scheduler core");
+    load_ns_ = os_gettime_ns();
     
     try {
-        // Initialize components
-        playlist_manager_ = std::make_unique<PlaylistManager>();
-        if (!playlist_manager_->initialize()) {
-            LOG_ERROR("Failed to initialize playlist manager");
-            return false;
+        // One channel per distinct channel name in the schedule files
+        std::vector<std::string> channel_names;
+        for (const auto& file_info : Config::get_schedule_files()) {
+            std::string name = file_info.channel.empty() ? Config::DEFAULT_CHANNEL : file_info.channel;
+            if (std::find(channel_names.begin(), channel_names.end(), name) == channel_names.end()) {
+                channel_names.push_back(name);
+            }
+        }
+        if (channel_names.empty()) {
+            channel_names.push_back(Config::DEFAULT_CHANNEL);
         }
         
-        media_controller_ = std::make_unique<MediaController>();
-        if (!media_controller_->initialize()) {
-            LOG_ERROR("Failed to initialize media controller");
-            return false;
+        for (const auto& name : channel_names) {
+            size_t index = channels_.size();
+            auto channel = std::make_unique<Channel>(name, index);
+            channel->set_clock(clock_);
+            if (!channel->initialize()) {
+                LOG_ERROR("Failed to initialize channel " + name);
+                return false;
+            }
+            
+            // Back-to-back items chain on the end of the previous file, not on the clock
+            channel->get_media_controller()->set_media_event_callback(
+                [this, index](const std::string& source_name, const std::string& event) {
+                    on_media_event(index, source_name, event);
+                });
+            channels_.push_back(std::move(channel));
         }
         
-        time_trigger_ = std::make_unique<TimeTrigger>();
-        if (!time_trigger_->initialize()) {
-            LOG_ERROR("Failed to initialize time trigger");
+        // Channels publish the durations of newly probed files themselves, their
+        // listeners run before this one; the deadlines only follow once woken
+        probe_listener_ = MediaProbe::shared()->add_listener([this](const std::vector<std::string>&) {
+            should_refresh_ = true;
+            wake_scheduler();
+        });
+        
+        frame_trigger_ = std::make_unique<FrameTrigger>();
+        frame_trigger_->set_clock(clock_);
+        if (!frame_trigger_->initialize([this](size_t channel, const std::string& item_id) {
+                on_frame_trigger(channel, item_id);
+            })) {
+            LOG_ERROR("Failed to initialize frame trigger");
             return false;
         }
         
         // Load configuration
         enabled_ = Config::is_enabled();
-        check_interval_seconds_ = Config::get_check_interval_seconds();
+        preroll_seconds_ = Config::get_preroll_seconds();
         
-        LOG_INFO("Scheduler core initialized successfully");
+        LOG_INFO("Scheduler core initialized with " + std::to_string(channels_.size()) + " channel(s)");
         return true;
         
     } catch (const std::exception& e) {
@@ -64,6 +115,11 @@ void SchedulerCore::start() {
     LOG_INFO("Starting scheduler");
     running_ = true;
     
+    // Pick up whatever should be on air by now instead of waiting for the next slot
+    join_since_ns_ = load_ns_;
+    should_join_ = true;
+    should_rearm_ = true;
+    
     // Start scheduler thread
     scheduler_thread_ = std::make_unique<std::thread>(&SchedulerCore::scheduler_loop, this);
     
@@ -79,13 +135,18 @@ void SchedulerCore::stop() {
     running_ = false;
     
     // Wake up the scheduler thread
-    cv_.notify_all();
+    wake_scheduler();
     
     // Wait for thread to finish
     if (scheduler_thread_ && scheduler_thread_->joinable()) {
         scheduler_thread_->join();
     }
     
+    if (frame_trigger_) {
+        frame_trigger_->disarm_all();
+    }
+    disarm_items();
+    
     LOG_INFO("Scheduler stopped");
 }
 
@@ -95,8 +156,14 @@ void SchedulerCore::toggle_enabled() {
     
     LOG_INFO("Scheduler " + std::string(enabled_ ? "enabled" : "disabled"));
     
-    // Wake up scheduler thread to apply change
-    cv_.notify_all();
+    // Wake up scheduler thread to re-arm (or drop) its deadlines, joining
+    // the programme in progress when coming back on
+    if (enabled_) {
+        join_since_ns_ = os_gettime_ns();
+        should_join_ = true;
+    }
+    should_rearm_ = true;
+    wake_scheduler();
 }
 
 bool SchedulerCore::is_running() const {
@@ -109,18 +176,17 @@ bool SchedulerCore::is_enabled() const {
 
 void SchedulerCore::reload_schedules() {
     should_reload_ = true;
-    cv_.notify_all();
+    wake_scheduler();
     LOG_INFO("Schedule reload requested");
 }
 
 void SchedulerCore::force_check() {
-    cv_.notify_all();
+    should_rearm_ = true;
+    wake_scheduler();
     LOG_DEBUG("Force check requested");
 }
 
 std::string SchedulerCore::get_status() const {
-    std::lock_guard<std::mutex> lock(status_mutex_);
-    
     if (!running_) {
         return "Stopped";
     }
@@ -132,14 +198,159 @@ std::string SchedulerCore::get_status() const {
     return "Running";
 }
 
+std::shared_ptr<const ChannelStatus> SchedulerCore::get_status_snapshot() const {
+    if (channels_.empty()) {
+        return std::make_shared<const ChannelStatus>();
+    }
+    return channels_.front()->get_status_snapshot();
+}
+
 std::string SchedulerCore::get_current_item() const {
-    std::lock_guard<std::mutex> lock(status_mutex_);
-    return current_item_id_;
+    return channels_.empty() ? std::string() : channels_.front()->get_current_item();
 }
 
 std::string SchedulerCore::get_next_item() const {
-    std::lock_guard<std::mutex> lock(status_mutex_);
-    return next_item_id_;
+    return channels_.empty() ? std::string() : channels_.front()->get_next_item();
+}
+
+std::string SchedulerCore::get_arming_state() const {
+    return channels_.empty() ? std::string("None") : channels_.front()->get_arming_state();
+}
+
+std::vector<ChannelStatus> SchedulerCore::get_channel_statuses() const {
+    std::vector<ChannelStatus> statuses;
+    statuses.reserve(channels_.size());
+    for (const auto& channel : channels_) {
+        statuses.push_back(channel->get_status());
+    }
+    return statuses;
+}
+
+std::vector<FrameTriggerRecord> SchedulerCore::get_frame_trigger_records() const {
+    if (!frame_trigger_) {
+        return {};
+    }
+    return frame_trigger_->get_records();
+}
+
+std::vector<StartLatencyRecord> SchedulerCore::get_start_latency_records() const {
+    std::vector<StartLatencyRecord> records;
+    for (const auto& channel : channels_) {
+        auto channel_records = channel->get_start_latency_records();
+        records.insert(records.end(), channel_records.begin(), channel_records.end());
+    }
+    return records;
+}
+
+std::vector<JoinRecord> SchedulerCore::get_join_records() const {
+    std::vector<JoinRecord> records;
+    for (const auto& channel : channels_) {
+        auto channel_records = channel->get_join_records();
+        records.insert(records.end(), channel_records.begin(), channel_records.end());
+    }
+    return records;
+}
+
+std::vector<LatencyBreakdown> SchedulerCore::get_latency_histograms() const {
+    std::vector<LatencyBreakdown> breakdowns;
+    for (const auto& channel : channels_) {
+        auto channel_breakdowns = channel->get_latency_histograms();
+        breakdowns.insert(breakdowns.end(), channel_breakdowns.begin(), channel_breakdowns.end());
+    }
+    return breakdowns;
+}
+
+bool SchedulerCore::dump_latency_histograms(const std::string& path) const {
+    try {
+        std::ofstream file(path);
+        if (!file.is_open()) {
+            LOG_ERROR("Failed to open latency histogram file: " + path);
+            return false;
+        }
+        
+        auto breakdowns = get_latency_histograms();
+        
+        // All sources of each channel merged, listed under source "*"
+        for (const auto& channel : channels_) {
+            LatencyBreakdown merged{channel->get_name(), "*", StageHistograms()};
+            for (const auto& breakdown : breakdowns) {
+                if (breakdown.channel == merged.channel) {
+                    for (size_t stage = 0; stage < LATENCY_STAGE_COUNT; ++stage) {
+                        merged.stages[stage].merge(breakdown.stages[stage]);
+                    }
+                }
+            }
+            breakdowns.push_back(merged);
+        }
+        
+        file << "channel,source,stage,count,min_us,p50_us,p90_us,p99_us,p99.9_us,max_us,mean_us\n";
+        file << std::fixed << std::setprecision(1);
+        for (const auto& breakdown : breakdowns) {
+            for (size_t stage = 0; stage < LATENCY_STAGE_COUNT; ++stage) {
+                const auto& histogram = breakdown.stages[stage];
+                if (histogram.get_count() == 0) {
+                    continue;
+                }
+                
+                file << breakdown.channel << "," << breakdown.source << ","
+                     << latency_stage_name(static_cast<LatencyStage>(stage)) << "," << histogram.get_count() << ","
+                     << histogram.get_min() / 1000.0 << "," << histogram.get_percentile(50.0) / 1000.0 << ","
+                     << histogram.get_percentile(90.0) / 1000.0 << "," << histogram.get_percentile(99.0) / 1000.0 << ","
+                     << histogram.get_percentile(99.9) / 1000.0 << "," << histogram.get_max() / 1000.0 << ","
+                     << histogram.get_mean() / 1000.0 << "\n";
+            }
+        }
+        
+        LOG_INFO("Latency histograms written to " + path);
+        return true;
+        
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception writing latency histograms: " + std::string(e.what()));
+        return false;
+    }
+}
+
+CommandQueueStats SchedulerCore::get_command_queue_stats() const {
+    CommandQueueStats total;
+    for (const auto& channel : channels_) {
+        auto stats = channel->get_command_queue_stats();
+        total.depth += stats.depth;
+        total.max_depth = std::max(total.max_depth, stats.max_depth);
+        total.submitted += stats.submitted;
+        total.completed += stats.completed;
+        total.last_wait_ns = std::max(total.last_wait_ns, stats.last_wait_ns);
+        total.max_wait_ns = std::max(total.max_wait_ns, stats.max_wait_ns);
+        total.last_run_ns = std::max(total.last_run_ns, stats.last_run_ns);
+        total.max_run_ns = std::max(total.max_run_ns, stats.max_run_ns);
+    }
+    return total;
+}
+
+std::vector<AsRunEntry> SchedulerCore::get_as_run_log() const {
+    std::vector<AsRunEntry> log;
+    for (const auto& channel : channels_) {
+        auto channel_log = channel->get_as_run_log();
+        log.insert(log.end(), channel_log.begin(), channel_log.end());
+    }
+    std::stable_sort(log.begin(), log.end(), [](const AsRunEntry& a, const AsRunEntry& b) {
+        return a.time < b.time;
+    });
+    return log;
+}
+
+std::shared_ptr<const ScheduleSnapshot> SchedulerCore::get_schedule_snapshot() const {
+    if (channels_.empty()) {
+        return std::make_shared<const ScheduleSnapshot>();
+    }
+    return channels_.front()->get_schedule_snapshot();
+}
+
+size_t SchedulerCore::get_channel_count() const {
+    return channels_.size();
+}
+
+Channel* SchedulerCore::get_channel(size_t index) {
+    return index < channels_.size() ? channels_[index].get() : nullptr;
 }
 
 void SchedulerCore::scheduler_loop() {
@@ -147,22 +358,45 @@ void SchedulerCore::scheduler_loop() {
     
     while (running_) {
         try {
-            if (enabled_) {
-                // Check if we need to reload schedules
-                if (should_reload_) {
-                    should_reload_ = false;
-                    playlist_manager_->reload_schedules();
-                    LOG_INFO("Schedules reloaded");
+            // Check if we need to reload schedules
+            if (should_reload_) {
+                should_reload_ = false;
+                bool changed = false;
+                for (auto& channel : channels_) {
+                    changed = channel->reload_schedules() || changed;
                 }
                 
-                // Check and execute scheduled items
-                check_and_execute_schedules();
+                // A full re-arm about to happen covers the reload as well
+                if (changed && !should_rearm_) {
+                    patch_deadlines();
+                }
+                LOG_INFO(changed ? "Schedules reloaded" : "Schedules reloaded, nothing changed");
             }
             
-            // Wait for next check interval or notification
+            if (should_refresh_.exchange(false)) {
+                for (auto& channel : channels_) {
+                    channel->refresh_schedule();
+                }
+                if (!should_rearm_) {
+                    patch_deadlines();
+                }
+            }
+            
+            if (should_rearm_) {
+                should_rearm_ = false;
+                arm_deadlines(should_join_.exchange(false) ? join_since_ns_.load() : 0);
+            }
+            
+            // Sleep until the next deadline or a notification
             std::unique_lock<std::mutex> lock(cv_mutex_);
-            cv_.wait_for(lock, std::chrono::seconds(check_interval_seconds_), 
-                        [this] { return !running_ || should_reload_; });
+            bool due = deadlines_.wait(cv_, lock, [this] {
+                return !running_ || should_reload_ || should_rearm_ || should_refresh_;
+            });
+            lock.unlock();
+            
+            if (due && running_) {
+                process_due_deadlines();
+            }
             
         } catch (const std::exception& e) {
             LOG_ERROR("Exception in scheduler loop: " + std::string(e.what()));
@@ -173,77 +407,93 @@ void SchedulerCore::scheduler_loop() {
     LOG_INFO("Scheduler loop ended");
 }
 
-void SchedulerCore::check_and_execute_schedules() {
-    auto now = std::chrono::steady_clock::now();
+void SchedulerCore::arm_deadlines(uint64_t join_since_ns) {
+    deadlines_.clear();
+    frame_trigger_->disarm_all();
+    disarm_items();
     
-    // Check if enough time has passed since last check
-    auto time_since_last_check = std::chrono::duration_cast<std::chrono::seconds>(
-        now - last_check_time_);
+    if (!enabled_) {
+        LOG_DEBUG("Scheduler disabled, no deadlines armed");
+        return;
+    }
+    
+    for (auto& channel : channels_) {
+        channel->arm_deadlines(deadlines_, preroll_seconds_, join_since_ns);
+    }
     
-    if (time_since_last_check.count() < check_interval_seconds_) {
+    // Every channel's day is rebuilt at midnight
+    Deadline rearm;
+    rearm.kind = Deadline::Kind::Rearm;
+    rearm.when = deadlines_.to_steady_time(TimeTrigger::get_next_midnight(*clock_));
+    deadlines_.push(rearm);
+    
+    LOG_DEBUG("Armed " + std::to_string(deadlines_.size()) + " deadlines across " +
+              std::to_string(channels_.size()) + " channel(s)");
+}
+
+void SchedulerCore::patch_deadlines() {
+    if (!enabled_) {
         return;
     }
     
-    last_check_time_ = now;
+    for (auto& channel : channels_) {
+        channel->patch_deadlines(deadlines_, preroll_seconds_, *frame_trigger_);
+    }
+}
+
+void SchedulerCore::process_due_deadlines() {
+    auto now = clock_->steady_now();
+    auto due = deadlines_.pop_due(now);
     
-    try {
-        // Get current time-based items that should execute
-        auto current_items = time_trigger_->get_current_items();
-        auto next_items = time_trigger_->get_next_items();
-        
-        // Update status
-        {
-            std::lock_guard<std::mutex> lock(status_mutex_);
-            next_item_id_ = next_items.empty() ? "None" : next_items[0];
+    for (const auto& deadline : due) {
+        if (deadline.kind == Deadline::Kind::Rearm) {
+            should_rearm_ = true;
+            continue;
         }
         
-        // Execute current items
-        for (const auto& item_id : current_items) {
-            // Check if this item is already playing
-            std::lock_guard<std::mutex> lock(status_mutex_);
-            if (current_item_id_ != item_id) {
-                execute_scheduled_item(item_id);
-                current_item_id_ = item_id;
-            }
+        if (deadline.channel >= channels_.size()) {
+            continue;
         }
         
-        // Handle idle state if no current items
-        if (current_items.empty()) {
-            std::lock_guard<std::mutex> lock(status_mutex_);
-            if (!current_item_id_.empty() && current_item_id_ != "idle") {
-                execute_scheduled_item("idle");
-                current_item_id_ = "idle";
-            }
+        if (deadline.kind == Deadline::Kind::Trigger) {
+            auto lateness = std::chrono::duration_cast<std::chrono::microseconds>(now - deadline.when);
+            LOG_DEBUG("Deadline for slot " + ScheduleTimeline::format_time(deadline.slot_ms) + " on channel " +
+                      channels_[deadline.channel]->get_name() + " reached " +
+                      std::to_string(lateness.count()) + "us late");
         }
         
-    } catch (const std::exception& e) {
-        LOG_ERROR("Exception during schedule check: " + std::string(e.what()));
+        channels_[deadline.channel]->handle_deadline(deadline, *frame_trigger_);
     }
 }
 
-void SchedulerCore::execute_scheduled_item(const std::string& item_id) {
-    try {
-        LOG_INFO("Executing scheduled item: " + item_id);
-        
-        if (item_id == "idle") {
-            // Play default idle content
-            media_controller_->play_idle_content();
-            return;
-        }
-        
-        // Get item details from playlist manager
-        auto item = playlist_manager_->get_item(item_id);
-        if (!item) {
-            LOG_WARNING("Scheduled item not found: " + item_id);
-            return;
-        }
-        
-        // Execute media control actions
-        media_controller_->execute_item(*item);
-        
-        LOG_INFO("Successfully executed scheduled item: " + item_id);
-        
-    } catch (const std::exception& e) {
-        LOG_ERROR("Failed to execute scheduled item " + item_id + ": " + std::string(e.what()));
+void SchedulerCore::disarm_items() {
+    for (auto& channel : channels_) {
+        channel->disarm_items();
+    }
+}
+
+void SchedulerCore::on_frame_trigger(size_t channel, const std::string& item_id) {
+    // Runs on the OBS video thread
+    if (channel < channels_.size()) {
+        channels_[channel]->on_frame_trigger(item_id);
     }
 }
+
+void SchedulerCore::on_media_event(size_t channel, const std::string& source_name, const std::string& event) {
+    // Runs on the thread OBS signalled from, the source's media thread for "ended"
+    if (event != "ended" || !running_ || !enabled_) {
+        return;
+    }
+    
+    if (channel < channels_.size()) {
+        channels_[channel]->on_media_ended(source_name);
+    }
+}
+
+void SchedulerCore::wake_scheduler() {
+    // Taking the lock orders the flag update before the waiter's predicate check
+    {
+        std::lock_guard<std::mutex> lock(cv_mutex_);
+    }
+    cv_.notify_all();
+}
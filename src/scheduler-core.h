@@ -8,16 +8,21 @@
 #include <chrono>
 #include <mutex>
 #include <condition_variable>
-
-class PlaylistManager;
-class MediaController;
-class TimeTrigger;
+#include "channel.h"
+#include "frame-trigger.h"
+#include "media-controller.h"
+#include "utils/deadline-queue.h"
+#include "utils/clock.h"
 
 class SchedulerCore {
 public:
     SchedulerCore();
     ~SchedulerCore();
     
+    // Clock the whole scheduler runs on, set before initialize(). Defaults
+    // to the system clock; tests inject a simulated one.
+    void set_clock(std::shared_ptr<Clock> clock);
+    
     bool initialize();
     void start();
     void stop();
@@ -29,35 +34,74 @@ public:
     void reload_schedules();
     void force_check();
     
-    // Status information
+    // Status information (item getters report the first channel). None of
+    // these block behind the scheduler thread.
     std::string get_status() const;
+    std::shared_ptr<const ChannelStatus> get_status_snapshot() const;
     std::string get_current_item() const;
     std::string get_next_item() const;
+    std::string get_arming_state() const;
+    std::vector<ChannelStatus> get_channel_statuses() const;
+    std::vector<FrameTriggerRecord> get_frame_trigger_records() const;
+    std::vector<StartLatencyRecord> get_start_latency_records() const;
+    
+    // Items picked up mid-programme on start or re-enable, with the time from
+    // plugin load (or re-enable) until they were back on air
+    std::vector<JoinRecord> get_join_records() const;
+    
+    // Trigger latency per channel and source, for each stage from scheduled
+    // instant to first played frame. The dump writes one percentile summary
+    // line per channel, source and stage, plus all sources of a channel merged.
+    std::vector<LatencyBreakdown> get_latency_histograms() const;
+    bool dump_latency_histograms(const std::string& path) const;
+    
+    // OBS command queues of all channels, depths summed and latencies maxed
+    CommandQueueStats get_command_queue_stats() const;
+    
+    // As-run log of all channels, ordered by air time
+    std::vector<AsRunEntry> get_as_run_log() const;
+    
+    // First channel's compiled schedule, for the UI
+    std::shared_ptr<const ScheduleSnapshot> get_schedule_snapshot() const;
+    
+    // Channel access
+    size_t get_channel_count() const;
+    Channel* get_channel(size_t index);
 
 private:
     void scheduler_loop();
-    void check_and_execute_schedules();
-    void execute_scheduled_item(const std::string& item_id);
+    void arm_deadlines(uint64_t join_since_ns);
+    void patch_deadlines();     // After a reload that changed something
+    void process_due_deadlines();
+    void disarm_items();
+    void on_frame_trigger(size_t channel, const std::string& item_id);
+    void on_media_event(size_t channel, const std::string& source_name, const std::string& event);
+    void wake_scheduler();
     
     std::unique_ptr<std::thread> scheduler_thread_;
     std::atomic<bool> running_;
     std::atomic<bool> enabled_;
     std::atomic<bool> should_reload_;
+    std::atomic<bool> should_rearm_;
+    std::atomic<bool> should_refresh_;      // The media probe published durations
+    std::atomic<bool> should_join_;
+    std::atomic<uint64_t> join_since_ns_;   // Recovery reference for the next join
+    uint64_t load_ns_;
     
-    std::unique_ptr<PlaylistManager> playlist_manager_;
-    std::unique_ptr<MediaController> media_controller_;
-    std::unique_ptr<TimeTrigger> time_trigger_;
+    // One entry per configured channel, all driven by the single scheduler thread
+    std::vector<std::unique_ptr<Channel>> channels_;
+    std::unique_ptr<FrameTrigger> frame_trigger_;
+    std::shared_ptr<Clock> clock_;
+    int probe_listener_;
     
-    mutable std::mutex status_mutex_;
-    std::string current_item_id_;
-    std::string next_item_id_;
-    std::chrono::steady_clock::time_point last_check_time_;
+    // Upcoming deadlines of every channel, only touched by the scheduler thread
+    DeadlineQueue deadlines_;
     
     std::condition_variable cv_;
     std::mutex cv_mutex_;
     
     // Configuration
-    int check_interval_seconds_;
+    int preroll_seconds_;
     
     // Prevent copying
     SchedulerCore(const SchedulerCore&) = delete;
@@ -0,0 +1,201 @@
+#include "source-registry.h"
+#include "utils/logger.h"
+#include <cstring>
+#include <vector>
+
+SourceRegistry::SourceRegistry()
+    : started_(false)
+{
+}
+
+SourceRegistry::~SourceRegistry() {
+    stop();
+}
+
+void SourceRegistry::start() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (started_) {
+            return;
+        }
+        started_ = true;
+    }
+    
+    // Connected before listing, so a source created in between is not missed
+    signal_handler_t* handler = obs_get_signal_handler();
+    if (handler) {
+        signal_handler_connect(handler, "source_create", &SourceRegistry::source_created, this);
+        signal_handler_connect(handler, "source_remove", &SourceRegistry::source_removed, this);
+        signal_handler_connect(handler, "source_destroy", &SourceRegistry::source_removed, this);
+        signal_handler_connect(handler, "source_rename", &SourceRegistry::source_renamed, this);
+    }
+    
+    auto add_source = [](void* data, obs_source_t* source) {
+        static_cast<SourceRegistry*>(data)->add(source);
+        return true;
+    };
+    obs_enum_sources(add_source, this);
+    obs_enum_scenes(add_source, this);
+    
+    LOG_DEBUG("Source registry listed " + std::to_string(size()) + " sources");
+}
+
+void SourceRegistry::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!started_) {
+            return;
+        }
+        started_ = false;
+    }
+    
+    signal_handler_t* handler = obs_get_signal_handler();
+    if (handler) {
+        signal_handler_disconnect(handler, "source_create", &SourceRegistry::source_created, this);
+        signal_handler_disconnect(handler, "source_remove", &SourceRegistry::source_removed, this);
+        signal_handler_disconnect(handler, "source_destroy", &SourceRegistry::source_removed, this);
+        signal_handler_disconnect(handler, "source_rename", &SourceRegistry::source_renamed, this);
+    }
+    
+    clear();
+}
+
+bool SourceRegistry::is_started() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return started_;
+}
+
+obs_source_t* SourceRegistry::find(const std::string& name, Kind kind) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(name);
+    if (it == entries_.end() || it->second.kind != kind) {
+        return nullptr;
+    }
+    return it->second.source;
+}
+
+obs_scene_t* SourceRegistry::find_scene(const std::string& name) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(name);
+    if (it == entries_.end()) {
+        return nullptr;
+    }
+    return it->second.scene;
+}
+
+size_t SourceRegistry::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+void SourceRegistry::set_removed_callback(RemovedCallback callback) {
+    std::lock_guard<std::mutex> lock(callback_mutex_);
+    removed_callback_ = callback;
+}
+
+SourceRegistry::Kind SourceRegistry::get_kind(obs_source_t* source) {
+    const char* source_id = obs_source_get_id(source);
+    if (source_id && (strcmp(source_id, "ffmpeg_source") == 0 ||
+                      strcmp(source_id, "media_source") == 0 ||
+                      strcmp(source_id, "vlc_source") == 0)) {
+        return Kind::Media;
+    }
+    return obs_scene_from_source(source) ? Kind::Scene : Kind::Other;
+}
+
+void SourceRegistry::add(obs_source_t* source) {
+    const char* name = source ? obs_source_get_name(source) : nullptr;
+    if (!name || !*name) {
+        return;
+    }
+    
+    Kind kind = get_kind(source);
+    Entry entry{source, obs_source_get_weak_source(source),
+                kind == Kind::Scene ? obs_scene_from_source(source) : nullptr, kind};
+    
+    obs_weak_source_t* replaced = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto result = entries_.emplace(name, entry);
+        if (!result.second) {
+            replaced = result.first->second.weak;
+            result.first->second = entry;
+        }
+    }
+    obs_weak_source_release(replaced);
+}
+
+void SourceRegistry::remove(obs_source_t* source) {
+    const char* name = source ? obs_source_get_name(source) : nullptr;
+    if (!name) {
+        return;
+    }
+    
+    // source_remove and source_destroy both arrive for a listed source, only the first finds it
+    obs_weak_source_t* weak = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(name);
+        if (it == entries_.end() || !obs_weak_source_references_source(it->second.weak, source)) {
+            return;
+        }
+        weak = it->second.weak;
+        entries_.erase(it);
+    }
+    obs_weak_source_release(weak);
+    
+    RemovedCallback callback;
+    {
+        std::lock_guard<std::mutex> lock(callback_mutex_);
+        callback = removed_callback_;
+    }
+    if (callback) {
+        callback(source);
+    }
+}
+
+void SourceRegistry::rename(obs_source_t* source, const std::string& prev_name, const std::string& new_name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(prev_name);
+    if (it == entries_.end() || !obs_weak_source_references_source(it->second.weak, source)) {
+        return;
+    }
+    
+    Entry entry = it->second;
+    entries_.erase(it);
+    entries_[new_name] = entry;
+}
+
+void SourceRegistry::clear() {
+    std::vector<obs_weak_source_t*> weak_sources;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        weak_sources.reserve(entries_.size());
+        for (const auto& pair : entries_) {
+            weak_sources.push_back(pair.second.weak);
+        }
+        entries_.clear();
+    }
+    for (auto* weak : weak_sources) {
+        obs_weak_source_release(weak);
+    }
+}
+
+void SourceRegistry::source_created(void* data, calldata_t* cd) {
+    auto* source = static_cast<obs_source_t*>(calldata_ptr(cd, "source"));
+    static_cast<SourceRegistry*>(data)->add(source);
+}
+
+void SourceRegistry::source_removed(void* data, calldata_t* cd) {
+    auto* source = static_cast<obs_source_t*>(calldata_ptr(cd, "source"));
+    static_cast<SourceRegistry*>(data)->remove(source);
+}
+
+void SourceRegistry::source_renamed(void* data, calldata_t* cd) {
+    auto* source = static_cast<obs_source_t*>(calldata_ptr(cd, "source"));
+    const char* prev_name = calldata_string(cd, "prev_name");
+    const char* new_name = calldata_string(cd, "new_name");
+    if (source && prev_name && new_name) {
+        static_cast<SourceRegistry*>(data)->rename(source, prev_name, new_name);
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <cstddef>
+#include <obs-module.h>
+
+// Name lookup for the sources and scenes OBS has right now. Filled from
+// obs_enum_sources/obs_enum_scenes on start, then kept current by the global
+// source_create, source_remove, source_destroy and source_rename signals, so
+// a lookup is one hash probe and never finds a source that was removed or
+// renamed away. Only weak references are held: removing a source in OBS
+// frees it as it would without the plugin.
+class SourceRegistry {
+public:
+    enum class Kind {
+        Other,
+        Media,      // ffmpeg_source, media_source or vlc_source
+        Scene       // Anything obs_scene_from_source accepts, groups included
+    };
+    
+    // Called once a listed source left OBS, on whichever thread OBS signalled
+    // from, while the source is still valid and without the registry's lock
+    using RemovedCallback = std::function<void(obs_source_t* source)>;
+    
+    SourceRegistry();
+    ~SourceRegistry();
+    
+    // Connects to the global signals, then lists the existing sources
+    void start();
+    void stop();
+    bool is_started() const;
+    
+    // The source listed under the name if it is of the given kind, nullptr
+    // otherwise. No reference is taken: the pointer stays good until OBS
+    // removes the source, which the removed callback reports.
+    obs_source_t* find(const std::string& name, Kind kind) const;
+    obs_scene_t* find_scene(const std::string& name) const;
+    size_t size() const;
+    
+    void set_removed_callback(RemovedCallback callback);
+    
+    static Kind get_kind(obs_source_t* source);
+
+private:
+    struct Entry {
+        obs_source_t* source;
+        obs_weak_source_t* weak;
+        obs_scene_t* scene;         // Set for Kind::Scene
+        Kind kind;
+    };
+    
+    void add(obs_source_t* source);
+    void remove(obs_source_t* source);
+    void rename(obs_source_t* source, const std::string& prev_name, const std::string& new_name);
+    void clear();
+    
+    static void source_created(void* data, calldata_t* cd);
+    static void source_removed(void* data, calldata_t* cd);
+    static void source_renamed(void* data, calldata_t* cd);
+    
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Entry> entries_;
+    bool started_;
+    
+    // Separate from mutex_ so the callback may look sources up again
+    std::mutex callback_mutex_;
+    RemovedCallback removed_callback_;
+    
+    // Prevent copying
+    SourceRegistry(const SourceRegistry&) = delete;
+    SourceRegistry& operator=(const SourceRegistry&) = delete;
+};
@@ -8,7 +8,11 @@
 #include <iomanip>
 
 TimeTrigger::TimeTrigger()
-    : cached_minutes_(-1)
+    : schedule_(std::make_shared<const std::vector<TimeSlot>>())
+    , schedule_version_(0)
+    , playlist_manager_(nullptr)
+    , clock_(Clock::system())
+    , cached_ms_(-1)
     , last_update_(std::chrono::steady_clock::time_point::min())
     , check_tolerance_seconds_(30)
 {
@@ -24,11 +28,17 @@ bool TimeTrigger::initialize() {
     LOG_INFO("Initializing time trigger");
     
     try {
-        // Get playlist manager instance
-        playlist_manager_ = std::make_unique<PlaylistManager>();
-        if (!playlist_manager_->initialize()) {
-            LOG_ERROR("Failed to initialize playlist manager in time trigger");
-            return false;
+        // Load the channel's files ourselves unless a manager was handed in
+        if (!playlist_manager_) {
+            owned_playlist_manager_ = std::make_unique<PlaylistManager>();
+            owned_playlist_manager_->set_channel(channel_);
+            owned_playlist_manager_->set_clock(clock_);
+            if (!owned_playlist_manager_->initialize()) {
+                LOG_ERROR("Failed to initialize playlist manager in time trigger");
+                owned_playlist_manager_.reset();
+                return false;
+            }
+            playlist_manager_ = owned_playlist_manager_.get();
         }
         
         // Load configuration
@@ -49,47 +59,54 @@ bool TimeTrigger::initialize() {
     }
 }
 
+void TimeTrigger::set_channel(const std::string& channel) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    channel_ = channel;
+}
+
+void TimeTrigger::set_playlist_manager(PlaylistManager* playlist_manager) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    playlist_manager_ = playlist_manager;
+}
+
+void TimeTrigger::set_clock(std::shared_ptr<Clock> clock) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    clock_ = clock ? clock : Clock::system();
+}
+
 void TimeTrigger::cleanup() {
     std::lock_guard<std::mutex> lock(mutex_);
     
-    if (playlist_manager_) {
-        playlist_manager_->cleanup();
-        playlist_manager_.reset();
+    if (owned_playlist_manager_) {
+        owned_playlist_manager_->cleanup();
+        owned_playlist_manager_.reset();
     }
+    playlist_manager_ = nullptr;
     
-    schedule_.clear();
+    schedule_ = std::make_shared<const std::vector<TimeSlot>>();
     
     LOG_INFO("Time trigger cleaned up");
 }
 
 void TimeTrigger::update_schedule() {
     std::lock_guard<std::mutex> lock(mutex_);
-    
-    // Check if we need to update (day changed or schedule is empty)
-    update_cache();
-    
-    if (schedule_.empty() || !is_same_day(cached_day_, get_current_day())) {
-        rebuild_schedule();
-        update_cache();
-    }
+    refresh_schedule();
 }
 
 std::vector<std::string> TimeTrigger::get_current_items() {
     std::lock_guard<std::mutex> lock(mutex_);
     
-    update_schedule();
+    refresh_schedule();
     
-    int current_minutes = get_current_minutes();
-    return get_items_at_time(current_minutes);
+    return get_items_at_time(get_current_ms());
 }
 
 std::vector<std::string> TimeTrigger::get_next_items() {
     std::lock_guard<std::mutex> lock(mutex_);
     
-    update_schedule();
+    refresh_schedule();
     
-    int current_minutes = get_current_minutes();
-    auto items = get_items_after_time(current_minutes, 1);
+    auto items = get_items_after_time(get_current_ms(), 1);
     
     return items;
 }
@@ -97,15 +114,68 @@ std::vector<std::string> TimeTrigger::get_next_items() {
 std::vector<std::string> TimeTrigger::get_upcoming_items(int count) {
     std::lock_guard<std::mutex> lock(mutex_);
     
-    update_schedule();
+    refresh_schedule();
+    
+    return get_items_after_time(get_current_ms(), count);
+}
+
+std::vector<TimeSlot> TimeTrigger::get_remaining_slots() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    refresh_schedule();
+    
+    // Include the slots of the current minute so a just-started slot still fires
+    int32_t current_ms = get_current_ms();
+    int32_t minute_start = current_ms - current_ms % 60000;
+    auto first = std::lower_bound(schedule_->begin(), schedule_->end(), minute_start,
+        [](const TimeSlot& slot, int32_t ms) { return slot.to_ms() < ms; });
+    
+    return std::vector<TimeSlot>(first, schedule_->end());
+}
+
+std::shared_ptr<const std::vector<TimeSlot>> TimeTrigger::get_day_slots() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    refresh_schedule();
+    return schedule_;
+}
+
+bool TimeTrigger::get_current_slot(TimeSlot& slot) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    refresh_schedule();
+    
+    int32_t current_ms = get_current_ms();
+    auto next = std::upper_bound(schedule_->begin(), schedule_->end(), current_ms,
+        [](int32_t ms, const TimeSlot& slot) { return ms < slot.to_ms(); });
+    
+    if (next == schedule_->begin()) {
+        return false;
+    }
     
-    int current_minutes = get_current_minutes();
-    return get_items_after_time(current_minutes, count);
+    slot = *(next - 1);
+    return true;
+}
+
+bool TimeTrigger::get_next_slot(TimeSlot& slot) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    refresh_schedule();
+    
+    int32_t current_ms = get_current_ms();
+    auto next = std::upper_bound(schedule_->begin(), schedule_->end(), current_ms,
+        [](int32_t ms, const TimeSlot& slot) { return ms < slot.to_ms(); });
+    
+    if (next == schedule_->end()) {
+        return false;
+    }
+    
+    slot = *next;
+    return true;
 }
 
 std::string TimeTrigger::get_current_time() const {
-    auto now = std::time(nullptr);
-    auto tm = *std::localtime(&now);
+    auto tm = clock_->local_time();
     
     std::stringstream ss;
     ss << std::put_time(&tm, "%H:%M");
@@ -113,23 +183,49 @@ std::string TimeTrigger::get_current_time() const {
 }
 
 std::string TimeTrigger::get_current_day() const {
-    auto now = std::time(nullptr);
-    auto tm = *std::localtime(&now);
+    auto tm = clock_->local_time();
     
     static const std::vector<std::string> days = {"sunday", "monday", "tuesday", "wednesday", "thursday", "friday", "saturday"};
     return days[tm.tm_wday];
 }
 
-int TimeTrigger::get_current_minutes() const {
-    auto now = std::time(nullptr);
-    auto tm = *std::localtime(&now);
-    return tm.tm_hour * 60 + tm.tm_min;
+CivilDay TimeTrigger::get_current_date() const {
+    return CalendarRule::from_tm(clock_->local_time());
+}
+
+int32_t TimeTrigger::get_current_ms() const {
+    return clock_->local_ms();
+}
+
+std::chrono::system_clock::time_point TimeTrigger::get_slot_time(const TimeSlot& slot) const {
+    auto tm = clock_->local_time();
+    
+    int32_t seconds = slot.to_ms() / 1000;
+    tm.tm_hour = seconds / 3600;
+    tm.tm_min = seconds / 60 % 60;
+    tm.tm_sec = seconds % 60;
+    tm.tm_isdst = -1; // Let mktime resolve DST for the slot itself
+    
+    return std::chrono::system_clock::from_time_t(std::mktime(&tm)) +
+           std::chrono::milliseconds(slot.to_ms() % 1000);
+}
+
+std::chrono::system_clock::time_point TimeTrigger::get_next_midnight(const Clock& clock) {
+    auto tm = clock.local_time();
+    
+    tm.tm_mday += 1;
+    tm.tm_hour = 0;
+    tm.tm_min = 0;
+    tm.tm_sec = 0;
+    tm.tm_isdst = -1;
+    
+    return std::chrono::system_clock::from_time_t(std::mktime(&tm));
 }
 
 void TimeTrigger::rebuild_schedule() {
     LOG_INFO("Rebuilding time schedule");
     
-    schedule_.clear();
+    schedule_ = std::make_shared<const std::vector<TimeSlot>>();
     
     if (!playlist_manager_) {
         LOG_ERROR("Playlist manager not initialized");
@@ -137,156 +233,130 @@ void TimeTrigger::rebuild_schedule() {
     }
     
     try {
-        std::string current_day = get_current_day();
+        // Everything below comes from this one snapshot, whatever reloads meanwhile
+        auto snapshot = playlist_manager_->get_snapshot();
+        schedule_version_ = snapshot->version;
         
-        // Get all items for current day
-        auto day_items = playlist_manager_->get_items_for_day(current_day);
+        // Today's slots (its weekday's and any dated items') were grouped and
+        // sorted when it was published; shared with the snapshot, not copied
+        schedule_ = snapshot->timeline.share_slots_on(get_current_date());
         
-        // Group items by time
-        std::map<int, std::vector<std::string>> time_to_items;
-        
-        for (const auto& item : day_items) {
-            int time_minutes = time_string_to_minutes(item->time);
-            if (time_minutes >= 0 && time_minutes < 24 * 60) {
-                time_to_items[time_minutes].push_back(item->id);
-            }
-        }
-        
-        // Build schedule vector
-        for (const auto& pair : time_to_items) {
-            TimeSlot slot;
-            slot.hour = pair.first / 60;
-            slot.minute = pair.first % 60;
-            slot.item_ids = pair.second;
-            schedule_.push_back(slot);
-        }
-        
-        // Sort schedule by time
-        std::sort(schedule_.begin(), schedule_.end());
-        
-        LOG_INFO("Schedule rebuilt with " + std::to_string(schedule_.size()) + " time slots");
+        LOG_INFO("Schedule rebuilt with " + std::to_string(schedule_->size()) + " time slots");
         
     } catch (const std::exception& e) {
         LOG_ERROR("Exception rebuilding schedule: " + std::string(e.what()));
     }
 }
 
+void TimeTrigger::reload_schedule() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    // A shared manager is reloaded by its owner
+    if (owned_playlist_manager_) {
+        owned_playlist_manager_->reload_schedules();
+    }
+    
+    rebuild_schedule();
+    update_cache();
+}
+
 void TimeTrigger::clear_schedule() {
     std::lock_guard<std::mutex> lock(mutex_);
-    schedule_.clear();
+    schedule_ = std::make_shared<const std::vector<TimeSlot>>();
     LOG_INFO("Schedule cleared");
 }
 
 size_t TimeTrigger::get_schedule_size() const {
     std::lock_guard<std::mutex> lock(mutex_);
-    return schedule_.size();
+    return schedule_->size();
 }
 
 bool TimeTrigger::is_schedule_empty() const {
     std::lock_guard<std::mutex> lock(mutex_);
-    return schedule_.empty();
+    return schedule_->empty();
 }
 
 std::string TimeTrigger::get_next_trigger_time() const {
     std::lock_guard<std::mutex> lock(mutex_);
     
-    if (schedule_.empty()) {
+    if (!playlist_manager_) {
         return "No schedule";
     }
     
-    int current_minutes = get_current_minutes();
+    // Looks past today in the latest snapshot: the next slot may be any day of the coming week
+    auto snapshot = playlist_manager_->get_snapshot();
+    CivilDay today = get_current_date();
+    int32_t slot_ms = 0;
+    int days_ahead = 0;
+    if (!snapshot->timeline.get_next_trigger_on(today, get_current_ms(), slot_ms, days_ahead)) {
+        return "No schedule";
+    }
     
-    for (const auto& slot : schedule_) {
-        int slot_minutes = slot.to_minutes();
-        if (slot_minutes > current_minutes) {
-            return slot.to_string();
-        }
+    std::string time = ScheduleTimeline::format_time(slot_ms);
+    if (days_ahead == 0) {
+        return time;
+    }
+    if (days_ahead == 1) {
+        return time + " (tomorrow)";
+    }
+    
+    if (days_ahead > ScheduleTimeline::DAYS_PER_WEEK) {
+        return time + " (" + CalendarRule::format_date(today + days_ahead) + ")";
     }
     
-    // If no slot found for today, return first slot for tomorrow
-    if (!schedule_.empty()) {
-        return schedule_[0].to_string() + " (tomorrow)";
+    static const std::vector<std::string> days = {"sunday", "monday", "tuesday", "wednesday", "thursday", "friday", "saturday"};
+    std::string day = days[CalendarRule::weekday(today + days_ahead)];
+    return time + (days_ahead < ScheduleTimeline::DAYS_PER_WEEK ? " (" + day + ")" : " (next " + day + ")");
+}
+
+void TimeTrigger::refresh_schedule() {
+    // Rebuild when the day changed since the last update or a new schedule was published
+    bool new_day = !is_same_day(cached_day_, get_current_day());
+    if (new_day && playlist_manager_) {
+        // Dated items of the day that just came into the horizon
+        playlist_manager_->advance_horizon();
+    }
+    
+    bool republished = playlist_manager_ && playlist_manager_->get_snapshot()->version != schedule_version_;
+    if (republished || new_day) {
+        rebuild_schedule();
     }
     
-    return "No schedule";
+    update_cache();
 }
 
 void TimeTrigger::update_cache() {
     cached_day_ = get_current_day();
-    cached_minutes_ = get_current_minutes();
-    last_update_ = std::chrono::steady_clock::now();
+    cached_ms_ = get_current_ms();
+    last_update_ = clock_->steady_now();
 }
 
-std::vector<std::string> TimeTrigger::get_items_at_time(int minutes) const {
+std::vector<std::string> TimeTrigger::get_items_at_time(int32_t ms) const {
     std::vector<std::string> result;
     
-    for (const auto& slot : schedule_) {
-        int slot_minutes = slot.to_minutes();
-        
-        // Check if this slot should trigger now (within tolerance)
-        int diff = std::abs(minutes - slot_minutes);
-        if (diff <= check_tolerance_seconds_ / 60) {
-            result.insert(result.end(), slot.item_ids.begin(), slot.item_ids.end());
-        }
+    // Slots that should trigger now (within tolerance)
+    int32_t tolerance = check_tolerance_seconds_ * 1000;
+    auto it = std::lower_bound(schedule_->begin(), schedule_->end(), ms - tolerance,
+        [](const TimeSlot& slot, int32_t ms) { return slot.to_ms() < ms; });
+    
+    for (; it != schedule_->end() && it->to_ms() <= ms + tolerance; ++it) {
+        result.insert(result.end(), it->item_ids.begin(), it->item_ids.end());
     }
     
     return result;
 }
 
-std::vector<std::string> TimeTrigger::get_items_after_time(int minutes, int max_count) const {
+std::vector<std::string> TimeTrigger::get_items_after_time(int32_t ms, int max_count) const {
     std::vector<std::string> result;
     
-    for (const auto& slot : schedule_) {
-        int slot_minutes = slot.to_minutes();
-        
-        if (slot_minutes > minutes) {
-            result.insert(result.end(), slot.item_ids.begin(), slot.item_ids.end());
-            
-            if (result.size() >= static_cast<size_t>(max_count)) {
-                break;
-            }
-        }
-    }
+    auto it = std::upper_bound(schedule_->begin(), schedule_->end(), ms,
+        [](int32_t ms, const TimeSlot& slot) { return ms < slot.to_ms(); });
     
-    return result;
-}
-
-int TimeTrigger::time_string_to_minutes(const std::string& time_str) const {
-    try {
-        size_t colon_pos = time_str.find(':');
-        if (colon_pos == std::string::npos) {
-            return -1;
-        }
-        
-        std::string hour_str = time_str.substr(0, colon_pos);
-        std::string minute_str = time_str.substr(colon_pos + 1);
-        
-        int hour = std::stoi(hour_str);
-        int minute = std::stoi(minute_str);
-        
-        if (hour < 0 || hour > 23 || minute < 0 || minute > 59) {
-            return -1;
-        }
-        
-        return hour * 60 + minute;
-        
-    } catch (const std::exception& e) {
-        LOG_ERROR("Exception parsing time string '" + time_str + "': " + std::string(e.what()));
-        return -1;
+    for (; it != schedule_->end() && result.size() < static_cast<size_t>(max_count); ++it) {
+        result.insert(result.end(), it->item_ids.begin(), it->item_ids.end());
     }
-}
-
-std::string TimeTrigger::minutes_to_time_string(int minutes) const {
-    if (minutes < 0 || minutes >= 24 * 60) {
-        return "00:00";
-    }
-    
-    int hour = minutes / 60;
-    int minute = minutes % 60;
     
-    std::stringstream ss;
-    ss << std::setfill('0') << std::setw(2) << hour << ":" << std::setfill('0') << std::setw(2) << minute;
-    return ss.str();
+    return result;
 }
 
 bool TimeTrigger::is_same_day(const std::string& day1, const std::string& day2) const {
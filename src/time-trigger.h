@@ -5,35 +5,12 @@
 #include <chrono>
 #include <memory>
 #include <mutex>
+#include <cstdint>
+#include "schedule-timeline.h"
+#include "utils/clock.h"
 
 class PlaylistManager;
 
-struct TimeSlot {
-    int hour;
-    int minute;
-    std::vector<std::string> item_ids;
-    
-    TimeSlot(int h = 0, int m = 0) : hour(h), minute(m) {}
-    
-    bool operator<(const TimeSlot& other) const {
-        if (hour != other.hour) return hour < other.hour;
-        return minute < other.minute;
-    }
-    
-    int to_minutes() const {
-        return hour * 60 + minute;
-    }
-    
-    std::string to_string() const {
-        char buffer[16]; // Larger buffer for safety
-        // Ensure hour and minute are within valid ranges
-        int safe_hour = (hour >= 0 && hour <= 23) ? hour : 0;
-        int safe_minute = (minute >= 0 && minute <= 59) ? minute : 0;
-        snprintf(buffer, sizeof(buffer), "%02d:%02d", safe_hour, safe_minute);
-        return std::string(buffer);
-    }
-};
-
 class TimeTrigger {
 public:
     TimeTrigger();
@@ -42,19 +19,38 @@ public:
     bool initialize();
     void cleanup();
     
+    // Channel whose schedule this trigger follows, set before initialize()
+    void set_channel(const std::string& channel);
+    
+    // Follow an existing (non-owned) manager's schedule snapshots instead of
+    // loading a private copy of the channel's files, set before initialize().
+    // Channels always hand theirs in; the private copy is for standalone use.
+    void set_playlist_manager(PlaylistManager* playlist_manager);
+    
+    // Clock the schedule is evaluated against, set before initialize()
+    void set_clock(std::shared_ptr<Clock> clock);
+    
     // Core functionality
     void update_schedule();
     std::vector<std::string> get_current_items();
     std::vector<std::string> get_next_items();
     std::vector<std::string> get_upcoming_items(int count = 5);
+    std::vector<TimeSlot> get_remaining_slots();
+    std::shared_ptr<const std::vector<TimeSlot>> get_day_slots();  // All of today's, shared with the snapshot
+    bool get_current_slot(TimeSlot& slot);      // Latest slot started today, false if none yet
+    bool get_next_slot(TimeSlot& slot);         // First slot after now, false if none left today
     
     // Time utilities
     std::string get_current_time() const;
     std::string get_current_day() const;
-    int get_current_minutes() const;
+    CivilDay get_current_date() const;
+    int32_t get_current_ms() const;     // Since local midnight
+    std::chrono::system_clock::time_point get_slot_time(const TimeSlot& slot) const;
+    static std::chrono::system_clock::time_point get_next_midnight(const Clock& clock);
     
     // Schedule management
     void rebuild_schedule();
+    void reload_schedule();
     void clear_schedule();
     
     // Status
@@ -64,31 +60,34 @@ public:
 
 private:
     mutable std::mutex mutex_;
-    std::vector<TimeSlot> schedule_;
-    std::unique_ptr<PlaylistManager> playlist_manager_;
+    std::shared_ptr<const std::vector<TimeSlot>> schedule_;      // Today's slots, owned by the snapshot
+    uint64_t schedule_version_;     // ScheduleSnapshot version schedule_ was built from
+    std::unique_ptr<PlaylistManager> owned_playlist_manager_;
+    PlaylistManager* playlist_manager_;
+    std::shared_ptr<Clock> clock_;
     
     // Cache for current state
     std::string cached_day_;
-    int cached_minutes_;
+    int32_t cached_ms_;
     std::chrono::steady_clock::time_point last_update_;
     
     // Configuration
+    std::string channel_;
     std::string timezone_;
     int check_tolerance_seconds_; // How close to the exact time we should trigger
     
     // Internal methods
+    void refresh_schedule();
     void update_cache();
-    std::vector<std::string> get_items_at_time(int minutes) const;
-    std::vector<std::string> get_items_after_time(int minutes, int max_count = 10) const;
+    std::vector<std::string> get_items_at_time(int32_t ms) const;
+    std::vector<std::string> get_items_after_time(int32_t ms, int max_count = 10) const;
     
     // Time conversion utilities
-    int time_string_to_minutes(const std::string& time_str) const;
-    std::string minutes_to_time_string(int minutes) const;
     bool is_same_day(const std::string& day1, const std::string& day2) const;
     
     // Schedule building
     void build_schedule_from_playlists();
-    void add_items_to_schedule(const std::vector<std::string>& item_ids, int time_minutes);
+    void add_items_to_schedule(const std::vector<std::string>& item_ids, int32_t time_ms);
     
     // Prevent copying
     TimeTrigger(const TimeTrigger&) = delete;
@@ -1,11 +1,13 @@
 #include "schedule-editor.h"
 #include "media-controller.h"
+#include "media-probe.h"
+#include "playlist-manager.h"
+#include "schedule-parser.h"
 #include "utils/logger.h"
 #include <QApplication>
 #include <QDesktopServices>
 #include <QUrl>
 #include <QJsonParseError>
-#include <QRegularExpression>
 #include <QStandardPaths>
 
 // Static constants
@@ -22,12 +24,19 @@ ScheduleEditor::ScheduleEditor(const std::string& file_path, QWidget *parent)
     , tab_widget_(nullptr)
     , file_path_(file_path)
     , current_item_row_(-1)
+    , probe_listener_(0)
 {
     setWindowTitle("Schedule Editor");
     setModal(true);
     resize(1000, 700);
     
     setup_ui();
+    
+    // Probes finish on a probe thread; the table is updated on the UI thread
+    probe_listener_ = MediaProbe::shared()->add_listener([this](const std::vector<std::string>&) {
+        QMetaObject::invokeMethod(this, [this]() { update_detected_durations(); }, Qt::QueuedConnection);
+    });
+    
     load_schedule_file();
     
     if (file_path_.empty()) {
@@ -38,6 +47,7 @@ ScheduleEditor::ScheduleEditor(const std::string& file_path, QWidget *parent)
 }
 
 ScheduleEditor::~ScheduleEditor() {
+    MediaProbe::shared()->remove_listener(probe_listener_);
 }
 
 void ScheduleEditor::setup_ui() {
@@ -177,7 +187,7 @@ void ScheduleEditor::setup_items_tab() {
     
     form_layout->addWidget(new QLabel("Time:", this), 1, 0);
     item_time_edit_ = new QTimeEdit(this);
-    item_time_edit_->setDisplayFormat("HH:mm");
+    item_time_edit_->setDisplayFormat("HH:mm:ss.zzz");
     form_layout->addWidget(item_time_edit_, 1, 1);
     
     form_layout->addWidget(new QLabel("Media Source:", this), 2, 0);
@@ -370,12 +380,11 @@ void ScheduleEditor::update_items_table() {
         items_table_->setItem(row, 2, new QTableWidgetItem(item["source"].toString()));
         items_table_->setItem(row, 3, new QTableWidgetItem(item["file"].toString()));
         
-        int duration = item["duration"].toInt(0);
-        QString duration_str = duration > 0 ? QString::number(duration) : "Auto";
-        items_table_->setItem(row, 4, new QTableWidgetItem(duration_str));
-        
+        items_table_->setItem(row, 4, new QTableWidgetItem());
         items_table_->setItem(row, 5, new QTableWidgetItem(item["loop"].toBool() ? "Yes" : "No"));
     }
+    update_detected_durations();
+    request_detected_durations();
     
     if (items_table_->rowCount() > 0) {
         items_table_->selectRow(0);
@@ -521,6 +530,7 @@ void ScheduleEditor::on_browse_media_file_clicked() {
     
     if (!file_path.isEmpty()) {
         item_file_edit_->setText(file_path);
+        MediaProbe::shared()->request({file_path.toStdString()});
     }
 }
 
@@ -595,7 +605,38 @@ void ScheduleEditor::on_duplicate_item_clicked() {
 void ScheduleEditor::on_validate_schedule_clicked() {
     bool is_valid = validate_json_structure();
     
+    // Overlaps show once the schedule is compiled the way the plugin does it
+    QStringList conflicts;
     if (is_valid) {
+        ScheduleParser parser;
+        ParsedSchedule schedule;
+        if (parser.parse_string(generate_schedule_json().toStdString(), schedule)) {
+            PlaylistManager manager;
+            manager.set_cache_directory("");
+            manager.add_playlists(file_path_, std::move(schedule.playlists));
+            for (const auto& conflict : manager.get_conflicts()) {
+                std::string day = DaySet::from_mask(static_cast<uint8_t>(1u << conflict.weekday)).names()[0];
+                conflicts << QString::fromStdString(day + " " + conflict.time + ": \"" + conflict.winner->name +
+                                                    "\" over \"" + conflict.loser->name + "\" on " +
+                                                    conflict.winner->source +
+                                                    (conflict.dropped ? " (not fired)" : " (cut short)"));
+            }
+        } else {
+            is_valid = false;
+            show_error_message("Schedule Error", QString::fromStdString(parser.get_error()));
+        }
+    }
+    
+    if (is_valid && !conflicts.isEmpty()) {
+        validation_status_label_->setText(QString("Schedule is valid, %1 overlap(s) ⚠").arg(conflicts.size()));
+        validation_status_label_->setStyleSheet("QLabel { color: orange; font-weight: bold; }");
+        const int shown = 20;
+        QString details = conflicts.mid(0, shown).join("\n");
+        if (conflicts.size() > shown) {
+            details += QString("\n... and %1 more").arg(conflicts.size() - shown);
+        }
+        show_warning_message("Overlapping Items", details);
+    } else if (is_valid) {
         validation_status_label_->setText("Schedule is valid ✓");
         validation_status_label_->setStyleSheet("QLabel { color: green; font-weight: bold; }");
     } else {
@@ -632,14 +673,18 @@ void ScheduleEditor::populate_item_form(int row) {
     
     item_name_edit_->setText(item["name"].toString());
     
-    QTime time = QTime::fromString(item["time"].toString(), "HH:mm");
-    item_time_edit_->setTime(time);
+    // Timecode at the file's frame rate, like the parser reads it
+    int32_t ms = ScheduleTimeline::time_to_ms(item["time"].toString().toStdString(),
+                                              schedule_data_["frame_rate"].toDouble(0.0));
+    item_time_edit_->setTime(ms >= 0 ? QTime::fromMSecsSinceStartOfDay(ms) : QTime(9, 0));
     
     QString source = item["source"].toString();
     int source_index = item_source_combo_->findText(source);
     item_source_combo_->setCurrentIndex(source_index >= 0 ? source_index : 0);
     
     item_file_edit_->setText(item["file"].toString());
+    QString detected = describe_detected_duration(item["file"].toString());
+    item_duration_spinbox_->setSpecialValueText(detected.isEmpty() ? "Auto-detect" : "Auto-detect (" + detected + ")");
     item_duration_spinbox_->setValue(item["duration"].toInt(0));
     item_loop_checkbox_->setChecked(item["loop"].toBool());
     
@@ -740,10 +785,9 @@ bool ScheduleEditor::validate_item(const QJsonObject& item) const {
         }
     }
     
-    // Validate time format
-    QString time_str = item["time"].toString();
-    QRegularExpression time_regex(R"(^([01]?[0-9]|2[0-3]):[0-5][0-9]$)");
-    if (!time_regex.match(time_str).hasMatch()) {
+    // Validate time format: HH:MM[:SS[.mmm]], or timecode at the file's frame rate
+    std::string time = item["time"].toString().toStdString();
+    if (ScheduleTimeline::time_to_ms(time, schedule_data_["frame_rate"].toDouble(0.0)) < 0) {
         return false;
     }
     
@@ -821,4 +865,52 @@ void ScheduleEditor::update_scenes() {
     item_scene_combo_->addItem("Scene 2");
 }
 
+void ScheduleEditor::request_detected_durations() {
+    std::vector<std::string> files;
+    for (const auto& value : get_current_items()) {
+        QJsonObject item = value.toObject();
+        if (item["duration"].toInt(0) <= 0 && !item["file"].toString().isEmpty()) {
+            files.push_back(item["file"].toString().toStdString());
+        }
+    }
+    MediaProbe::shared()->request(files);
+}
+
+void ScheduleEditor::update_detected_durations() {
+    // Only the duration column; the selection and the form stay as they are
+    QJsonArray items = get_current_items();
+    for (int row = 0; row < items_table_->rowCount() && row < items.size(); ++row) {
+        QJsonObject item = items[row].toObject();
+        int duration = item["duration"].toInt(0);
+        QString text = QString::number(duration);
+        if (duration <= 0) {
+            QString detected = item["loop"].toBool() ? QString() : describe_detected_duration(item["file"].toString());
+            text = detected.isEmpty() ? "Auto" : "Auto (" + detected + ")";
+        }
+        items_table_->item(row, 4)->setText(text);
+    }
+}
+
+QString ScheduleEditor::describe_detected_duration(const QString& file_path) const {
+    MediaInfo info;
+    if (file_path.isEmpty() || !MediaProbe::shared()->lookup(file_path.toStdString(), info) || info.duration_ms <= 0) {
+        return QString();
+    }
+    
+    int64_t seconds = (info.duration_ms + 500) / 1000;
+    QString text = seconds >= 3600
+        ? QString("%1:%2:%3").arg(seconds / 3600).arg(seconds / 60 % 60, 2, 10, QChar('0')).arg(seconds % 60, 2, 10, QChar('0'))
+        : QString("%1:%2").arg(seconds / 60).arg(seconds % 60, 2, 10, QChar('0'));
+    if (info.has_video()) {
+        text += QString(", %1x%2").arg(info.width).arg(info.height);
+        if (info.fps_den > 0) {
+            text += QString(" @ %1").arg(static_cast<double>(info.fps_num) / info.fps_den, 0, 'f', 2);
+        }
+    }
+    if (info.has_audio()) {
+        text += QString(", %1 ch %2 Hz").arg(info.audio_channels).arg(info.sample_rate);
+    }
+    return text;
+}
+
 #include "schedule-editor.moc"
@@ -111,6 +111,7 @@ private:
     QJsonObject schedule_data_;
     QString current_playlist_id_;
     int current_item_row_;
+    int probe_listener_;        // Refreshes the detected durations as files are probed
     
     // Constants
     static const QStringList DAYS_OF_WEEK;
@@ -136,4 +137,9 @@ private:
     // Media source helpers
     void update_media_sources();
     void update_scenes();
+    
+    // Detected durations of items without one, from the shared media probe
+    void request_detected_durations();
+    void update_detected_durations();
+    QString describe_detected_duration(const QString& file_path) const;
 };
@@ -1,11 +1,13 @@
 #include "settings-dialog.h"
 #include "scheduler-core.h"
 #include "media-controller.h"
+#include "playlist-manager.h"
 #include "utils/config.h"
 #include "utils/logger.h"
 #include <QApplication>
 #include <QDesktopServices>
 #include <QUrl>
+#include <QDateTime>
 
 // Global scheduler instance (should be defined in plugin-main.cpp)
 extern SchedulerCore* scheduler;
@@ -84,13 +86,19 @@ void SettingsDialog::setup_general_tab() {
     check_interval_spinbox_->setValue(1);
     basic_layout->addWidget(check_interval_spinbox_, 1, 1);
     
-    basic_layout->addWidget(new QLabel("Timezone:", this), 2, 0);
+    basic_layout->addWidget(new QLabel("Pre-roll (seconds, 0 = off):", this), 2, 0);
+    preroll_spinbox_ = new QSpinBox(this);
+    preroll_spinbox_->setRange(0, 60);
+    preroll_spinbox_->setValue(5);
+    basic_layout->addWidget(preroll_spinbox_, 2, 1);
+    
+    basic_layout->addWidget(new QLabel("Timezone:", this), 3, 0);
     timezone_edit_ = new QLineEdit(this);
     timezone_edit_->setText("UTC");
-    basic_layout->addWidget(timezone_edit_, 2, 1);
+    basic_layout->addWidget(timezone_edit_, 3, 1);
     
     debug_mode_checkbox_ = new QCheckBox("Enable Debug Mode", this);
-    basic_layout->addWidget(debug_mode_checkbox_, 3, 0, 1, 2);
+    basic_layout->addWidget(debug_mode_checkbox_, 4, 0, 1, 2);
     
     layout->addWidget(basic_group);
     
@@ -194,13 +202,25 @@ void SettingsDialog::setup_status_tab() {
     next_trigger_label_ = new QLabel("None", this);
     scheduler_layout->addWidget(next_trigger_label_, 3, 1);
     
-    scheduler_layout->addWidget(new QLabel("Total Items:", this), 4, 0);
+    scheduler_layout->addWidget(new QLabel("Pre-roll:", this), 4, 0);
+    arming_state_label_ = new QLabel("None", this);
+    scheduler_layout->addWidget(arming_state_label_, 4, 1);
+    
+    scheduler_layout->addWidget(new QLabel("Last Trigger:", this), 5, 0);
+    last_trigger_label_ = new QLabel("None", this);
+    scheduler_layout->addWidget(last_trigger_label_, 5, 1);
+    
+    scheduler_layout->addWidget(new QLabel("Command Queue:", this), 6, 0);
+    command_queue_label_ = new QLabel("Idle", this);
+    scheduler_layout->addWidget(command_queue_label_, 6, 1);
+    
+    scheduler_layout->addWidget(new QLabel("Total Items:", this), 7, 0);
     total_items_label_ = new QLabel("0", this);
-    scheduler_layout->addWidget(total_items_label_, 4, 1);
+    scheduler_layout->addWidget(total_items_label_, 7, 1);
     
-    scheduler_layout->addWidget(new QLabel("Active Items:", this), 5, 0);
+    scheduler_layout->addWidget(new QLabel("Active Items:", this), 8, 0);
     active_items_label_ = new QLabel("0", this);
-    scheduler_layout->addWidget(active_items_label_, 5, 1);
+    scheduler_layout->addWidget(active_items_label_, 8, 1);
     
     layout->addWidget(scheduler_group);
     
@@ -285,6 +305,7 @@ void SettingsDialog::load_settings() {
     // Load general settings
     enabled_checkbox_->setChecked(Config::is_enabled());
     check_interval_spinbox_->setValue(Config::get_check_interval_seconds());
+    preroll_spinbox_->setValue(Config::get_preroll_seconds());
     timezone_edit_->setText(QString::fromStdString(Config::get_timezone()));
     debug_mode_checkbox_->setChecked(Config::is_debug_mode());
     
@@ -303,6 +324,7 @@ void SettingsDialog::save_settings() {
     // Save general settings
     Config::set_enabled(enabled_checkbox_->isChecked());
     Config::set_check_interval_seconds(check_interval_spinbox_->value());
+    Config::set_preroll_seconds(preroll_spinbox_->value());
     Config::set_timezone(timezone_edit_->text().toStdString());
     Config::set_debug_mode(debug_mode_checkbox_->isChecked());
 }
@@ -325,17 +347,45 @@ void SettingsDialog::update_status_display() {
         return;
     }
     
-    // Update scheduler status
+    // Update scheduler status from one snapshot so the labels agree with each other
+    auto status = scheduler->get_status_snapshot();
     scheduler_status_label_->setText(QString::fromStdString(scheduler->get_status()));
-    current_item_label_->setText(QString::fromStdString(scheduler->get_current_item()));
-    next_item_label_->setText(QString::fromStdString(scheduler->get_next_item()));
-    
-    // Update item counts (these would need to be implemented in scheduler)
-    total_items_label_->setText("N/A");
-    active_items_label_->setText("N/A");
+    current_item_label_->setText(QString::fromStdString(status->current_item));
+    next_item_label_->setText(QString::fromStdString(status->next_item));
+    arming_state_label_->setText(status->armed_item.empty() ? QString("None") :
+                                 "Armed: " + QString::fromStdString(status->armed_item));
+    
+    if (status->last_trigger_time.time_since_epoch().count() == 0) {
+        last_trigger_label_->setText("None");
+    } else {
+        auto time = std::chrono::system_clock::to_time_t(status->last_trigger_time);
+        last_trigger_label_->setText(QDateTime::fromSecsSinceEpoch(time).toString("HH:mm:ss"));
+    }
     
-    // Update next trigger time (would need to be implemented)
-    next_trigger_label_->setText("N/A");
+    auto queue = scheduler->get_command_queue_stats();
+    command_queue_label_->setText(QString("%1 pending, last wait %2 ms, last run %3 ms")
+                                  .arg(queue.depth)
+                                  .arg(queue.last_wait_ns / 1000000.0, 0, 'f', 1)
+                                  .arg(queue.last_run_ns / 1000000.0, 0, 'f', 1));
+    
+    // Item counts from the schedule snapshot, read without locking the loader
+    auto schedule = scheduler->get_schedule_snapshot();
+    QDate date = QDate::currentDate();
+    CivilDay today = CalendarRule::from_civil(date.year(), date.month(), date.day());
+    int active_items = static_cast<int>(schedule->timeline.get_entries_on(today).size());
+    total_items_label_->setText(QString::number(schedule->items.size()));
+    active_items_label_->setText(QString::number(active_items));
+    
+    // Next trigger time, from the same snapshot's timeline
+    QTime now = QTime::currentTime();
+    int32_t slot_ms = 0;
+    int days_ahead = 0;
+    if (schedule->timeline.get_next_trigger_on(today, now.msecsSinceStartOfDay(), slot_ms, days_ahead)) {
+        QString time = QString::fromStdString(ScheduleTimeline::format_time(slot_ms));
+        next_trigger_label_->setText(days_ahead == 0 ? time : time + QString(" (+%1d)").arg(days_ahead));
+    } else {
+        next_trigger_label_->setText("N/A");
+    }
 }
 
 void SettingsDialog::update_media_sources() {
@@ -61,6 +61,7 @@ private:
     // General tab
     QCheckBox* enabled_checkbox_;
     QSpinBox* check_interval_spinbox_;
+    QSpinBox* preroll_spinbox_;
     QLineEdit* timezone_edit_;
     QCheckBox* debug_mode_checkbox_;
     QCheckBox* auto_switch_scenes_checkbox_;
@@ -81,6 +82,9 @@ private:
     QLabel* total_items_label_;
     QLabel* active_items_label_;
     QLabel* next_trigger_label_;
+    QLabel* arming_state_label_;
+    QLabel* last_trigger_label_;
+    QLabel* command_queue_label_;
     QTextEdit* log_text_edit_;
     QPushButton* toggle_scheduler_button_;
     QPushButton* reload_schedules_button_;
@@ -0,0 +1,47 @@
+#include "clock.h"
+
+bool Clock::is_realtime() const {
+    return true;
+}
+
+std::tm Clock::local_time() const {
+    auto now = std::chrono::system_clock::to_time_t(this->now());
+    return *std::localtime(&now);
+}
+
+int32_t Clock::local_ms() const {
+    // One reading for both the seconds and their fraction
+    auto now = this->now();
+    auto seconds = std::chrono::system_clock::to_time_t(now);
+    std::tm tm = *std::localtime(&seconds);
+    auto fraction = std::chrono::duration_cast<std::chrono::milliseconds>(
+        now - std::chrono::system_clock::from_time_t(seconds)).count();
+    return ((tm.tm_hour * 60 + tm.tm_min) * 60 + tm.tm_sec) * 1000 + static_cast<int32_t>(fraction);
+}
+
+Clock::SteadyTime Clock::to_steady_time(SystemTime time) const {
+    auto offset = time - now();
+    return steady_now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(offset);
+}
+
+std::shared_ptr<Clock> Clock::system() {
+    static const std::shared_ptr<Clock> instance = std::make_shared<SystemClock>();
+    return instance;
+}
+
+Clock::SystemTime SystemClock::now() const {
+    return std::chrono::system_clock::now();
+}
+
+Clock::SteadyTime SystemClock::steady_now() const {
+    return std::chrono::steady_clock::now();
+}
+
+bool SystemClock::wait_until(std::condition_variable& cv, std::unique_lock<std::mutex>& lock,
+                             SteadyTime when, const std::function<bool()>& interrupted) {
+    if (when == SteadyTime::max()) {
+        cv.wait(lock, interrupted);
+        return false;
+    }
+    return !cv.wait_until(lock, when, interrupted);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <condition_variable>
+
+// Source of "now" for everything that schedules against the wall clock.
+// Production code runs on SystemClock; tests and soak runs inject a
+// simulated clock so days of playout pass in seconds.
+class Clock {
+public:
+    using SystemTime = std::chrono::system_clock::time_point;
+    using SteadyTime = std::chrono::steady_clock::time_point;
+    
+    virtual ~Clock() = default;
+    
+    // Wall-clock time, used to place slots on the local calendar
+    virtual SystemTime now() const = 0;
+    
+    // Monotonic time, used for deadlines
+    virtual SteadyTime steady_now() const = 0;
+    
+    // Blocks on cv until steady_now() reaches when or interrupted() becomes
+    // true. Returns false when interrupted. SteadyTime::max() waits for the
+    // interruption only.
+    virtual bool wait_until(std::condition_variable& cv, std::unique_lock<std::mutex>& lock,
+                            SteadyTime when, const std::function<bool()>& interrupted) = 0;
+    
+    // False when time only moves while every thread sleeps, so busy-waiting
+    // on it would never finish
+    virtual bool is_realtime() const;
+    
+    // now() broken down in local time
+    std::tm local_time() const;
+    
+    // now() as milliseconds since local midnight
+    int32_t local_ms() const;
+    
+    // Maps a wall-clock instant onto the monotonic clock
+    SteadyTime to_steady_time(SystemTime time) const;
+    
+    // Shared instance backed by the system clocks
+    static std::shared_ptr<Clock> system();
+};
+
+class SystemClock : public Clock {
+public:
+    SystemTime now() const override;
+    SteadyTime steady_now() const override;
+    bool wait_until(std::condition_variable& cv, std::unique_lock<std::mutex>& lock,
+                    SteadyTime when, const std::function<bool()>& interrupted) override;
+};
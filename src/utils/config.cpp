@@ -18,10 +18,13 @@ std::string Config::config_path_;
 
 bool Config::enabled_ = true;
 int Config::check_interval_seconds_ = 1;
+int Config::preroll_seconds_ = 5;
 std::string Config::timezone_ = "UTC";
 bool Config::debug_mode_ = false;
 std::vector<Config::ScheduleFile> Config::schedule_files_;
 
+const std::string Config::DEFAULT_CHANNEL = "main";
+
 void Config::load() {
     std::lock_guard<std::mutex> lock(mutex_);
     
@@ -31,7 +34,7 @@ void Config::load() {
     if (!file.is_open()) {
         LOG_INFO("Config file not found, creating default configuration");
         load_default_config();
-        save();
+        save_locked();
         return;
     }
     
@@ -69,6 +72,21 @@ void Config::load() {
             }
         }
         
+        // Parse pre-roll lead time
+        size_t preroll_pos = content.find("\"preroll_seconds\":");
+        if (preroll_pos != std::string::npos) {
+            size_t colon_pos = content.find(":", preroll_pos);
+            size_t value_start = content.find_first_not_of(" \t\n\r", colon_pos + 1);
+            if (value_start != std::string::npos) {
+                std::string value = content.substr(value_start);
+                size_t value_end = value.find_first_of(",}\n\r");
+                if (value_end != std::string::npos) {
+                    value = value.substr(0, value_end);
+                    preroll_seconds_ = std::stoi(value);
+                }
+            }
+        }
+        
         // Parse timezone
         size_t timezone_pos = content.find("\"timezone\":");
         if (timezone_pos != std::string::npos) {
@@ -92,6 +110,9 @@ void Config::load() {
             }
         }
         
+        // Parse schedule files
+        parse_schedule_files(content);
+        
         LOG_INFO("Configuration loaded successfully");
         
     } catch (const std::exception& e) {
@@ -102,7 +123,10 @@ void Config::load() {
 
 void Config::save() {
     std::lock_guard<std::mutex> lock(mutex_);
-    
+    save_locked();
+}
+
+void Config::save_locked() {
     std::ofstream file(config_path_);
     if (!file.is_open()) {
         LOG_ERROR("Failed to open config file for writing: " + config_path_);
@@ -113,6 +137,7 @@ void Config::save() {
         file << "{\n";
         file << "  \"enabled\": " << (enabled_ ? "true" : "false") << ",\n";
         file << "  \"check_interval_seconds\": " << check_interval_seconds_ << ",\n";
+        file << "  \"preroll_seconds\": " << preroll_seconds_ << ",\n";
         file << "  \"timezone\": \"" << escape_json_string(timezone_) << "\",\n";
         file << "  \"debug_mode\": " << (debug_mode_ ? "true" : "false") << ",\n";
         file << "  \"schedule_files\": [\n";
@@ -122,7 +147,8 @@ void Config::save() {
             file << "    {\n";
             file << "      \"path\": \"" << escape_json_string(sched_file.path) << "\",\n";
             file << "      \"enabled\": " << (sched_file.enabled ? "true" : "false") << ",\n";
-            file << "      \"name\": \"" << escape_json_string(sched_file.name) << "\"\n";
+            file << "      \"name\": \"" << escape_json_string(sched_file.name) << "\",\n";
+            file << "      \"channel\": \"" << escape_json_string(sched_file.channel) << "\"\n";
             file << "    }";
             if (i < schedule_files_.size() - 1) {
                 file << ",";
@@ -171,6 +197,15 @@ std::string Config::get_default_schedule_path() {
     return "schedule.json";
 }
 
+std::string Config::get_schedule_cache_path() {
+    std::string config_path = get_config_path();
+    size_t separator = config_path.find_last_of("/\\");
+    if (separator == std::string::npos) {
+        return "schedule-cache";
+    }
+    return config_path.substr(0, separator + 1) + "schedule-cache";
+}
+
 std::vector<Config::ScheduleFile> Config::get_schedule_files() {
     std::lock_guard<std::mutex> lock(mutex_);
     return schedule_files_;
@@ -185,7 +220,7 @@ void Config::add_schedule_file(const ScheduleFile& file) {
     
     if (it == schedule_files_.end()) {
         schedule_files_.push_back(file);
-        save();
+        save_locked();
         LOG_INFO("Added schedule file: " + file.path);
     }
 }
@@ -198,7 +233,7 @@ void Config::remove_schedule_file(const std::string& path) {
     
     if (it != schedule_files_.end()) {
         schedule_files_.erase(it);
-        save();
+        save_locked();
         LOG_INFO("Removed schedule file: " + path);
     }
 }
@@ -211,7 +246,7 @@ void Config::update_schedule_file(const ScheduleFile& file) {
     
     if (it != schedule_files_.end()) {
         *it = file;
-        save();
+        save_locked();
         LOG_INFO("Updated schedule file: " + file.path);
     }
 }
@@ -224,7 +259,7 @@ bool Config::is_enabled() {
 void Config::set_enabled(bool enabled) {
     std::lock_guard<std::mutex> lock(mutex_);
     enabled_ = enabled;
-    save();
+    save_locked();
 }
 
 int Config::get_check_interval_seconds() {
@@ -235,7 +270,18 @@ int Config::get_check_interval_seconds() {
 void Config::set_check_interval_seconds(int interval) {
     std::lock_guard<std::mutex> lock(mutex_);
     check_interval_seconds_ = interval;
-    save();
+    save_locked();
+}
+
+int Config::get_preroll_seconds() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return preroll_seconds_;
+}
+
+void Config::set_preroll_seconds(int seconds) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    preroll_seconds_ = seconds;
+    save_locked();
 }
 
 std::string Config::get_timezone() {
@@ -246,7 +292,7 @@ std::string Config::get_timezone() {
 void Config::set_timezone(const std::string& timezone) {
     std::lock_guard<std::mutex> lock(mutex_);
     timezone_ = timezone;
-    save();
+    save_locked();
 }
 
 bool Config::is_debug_mode() {
@@ -257,12 +303,13 @@ bool Config::is_debug_mode() {
 void Config::set_debug_mode(bool enabled) {
     std::lock_guard<std::mutex> lock(mutex_);
     debug_mode_ = enabled;
-    save();
+    save_locked();
 }
 
 void Config::load_default_config() {
     enabled_ = true;
     check_interval_seconds_ = 1;
+    preroll_seconds_ = 5;
     timezone_ = "UTC";
     debug_mode_ = false;
     schedule_files_.clear();
@@ -275,6 +322,64 @@ void Config::load_default_config() {
     schedule_files_.push_back(default_file);
 }
 
+void Config::parse_schedule_files(const std::string& content) {
+    size_t files_pos = content.find("\"schedule_files\":");
+    if (files_pos == std::string::npos) {
+        return;
+    }
+    
+    size_t array_start = content.find("[", files_pos);
+    size_t array_end = content.find("]", files_pos);
+    if (array_start == std::string::npos || array_end == std::string::npos) {
+        return;
+    }
+    
+    schedule_files_.clear();
+    
+    // Each entry is a flat object, so the next '}' closes it
+    size_t object_start = content.find("{", array_start);
+    while (object_start != std::string::npos && object_start < array_end) {
+        size_t object_end = content.find("}", object_start);
+        if (object_end == std::string::npos) {
+            break;
+        }
+        
+        std::string object = content.substr(object_start, object_end - object_start + 1);
+        
+        ScheduleFile sched_file;
+        sched_file.path = extract_string_value(object, "path");
+        sched_file.name = extract_string_value(object, "name");
+        sched_file.channel = extract_string_value(object, "channel");
+        sched_file.enabled = object.find("\"enabled\": false") == std::string::npos;
+        
+        if (!sched_file.path.empty()) {
+            schedule_files_.push_back(sched_file);
+        }
+        
+        object_start = content.find("{", object_end);
+    }
+}
+
+std::string Config::extract_string_value(const std::string& object, const std::string& key) {
+    size_t key_pos = object.find("\"" + key + "\":");
+    if (key_pos == std::string::npos) {
+        return "";
+    }
+    
+    size_t value_start = object.find("\"", object.find(":", key_pos));
+    if (value_start == std::string::npos) {
+        return "";
+    }
+    
+    // Skip escaped quotes inside the value
+    size_t value_end = value_start + 1;
+    while (value_end < object.length() && object[value_end] != '"') {
+        value_end += (object[value_end] == '\\') ? 2 : 1;
+    }
+    
+    return unescape_json_string(object.substr(value_start + 1, value_end - value_start - 1));
+}
+
 std::string Config::escape_json_string(const std::string& str) {
     std::string result;
     for (char c : str) {
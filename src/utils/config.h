@@ -11,13 +11,17 @@ public:
         std::string path;
         bool enabled;
         std::string name;
+        std::string channel;    // Output channel fed by this file (empty = default channel)
     };
+    
+    static const std::string DEFAULT_CHANNEL;
 
     static void load();
     static void save();
     
     static std::string get_config_path();
     static std::string get_default_schedule_path();
+    static std::string get_schedule_cache_path();   // Directory next to config.json
     
     // Schedule file management
     static std::vector<ScheduleFile> get_schedule_files();
@@ -32,6 +36,9 @@ public:
     static int get_check_interval_seconds();
     static void set_check_interval_seconds(int interval);
     
+    static int get_preroll_seconds();
+    static void set_preroll_seconds(int seconds);
+    
     static std::string get_timezone();
     static void set_timezone(const std::string& timezone);
     
@@ -45,11 +52,15 @@ private:
     // Configuration data
     static bool enabled_;
     static int check_interval_seconds_;
+    static int preroll_seconds_;
     static std::string timezone_;
     static bool debug_mode_;
     static std::vector<ScheduleFile> schedule_files_;
     
     static void load_default_config();
+    static void save_locked();      // Writes the file, caller holds mutex_
+    static void parse_schedule_files(const std::string& content);
+    static std::string extract_string_value(const std::string& object, const std::string& key);
     static std::string escape_json_string(const std::string& str);
     static std::string unescape_json_string(const std::string& str);
 };
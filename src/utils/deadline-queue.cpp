@@ -0,0 +1,107 @@
+#include "deadline-queue.h"
+#include <thread>
+
+DeadlineQueue::DeadlineQueue()
+    : clock_(Clock::system())
+    , spin_window_(std::chrono::microseconds(1500))
+    , wakeup_count_(0)
+{
+}
+
+void DeadlineQueue::set_clock(std::shared_ptr<Clock> clock) {
+    clock_ = clock ? clock : Clock::system();
+}
+
+void DeadlineQueue::push(const Deadline& deadline) {
+    heap_.push(deadline);
+}
+
+void DeadlineQueue::clear() {
+    heap_ = std::priority_queue<Deadline>();
+}
+
+size_t DeadlineQueue::remove_if(const std::function<bool(const Deadline&)>& predicate) {
+    // The heap cannot drop from the middle, so rebuild it from the survivors
+    std::vector<Deadline> kept;
+    kept.reserve(heap_.size());
+    size_t removed = 0;
+    while (!heap_.empty()) {
+        if (predicate(heap_.top())) {
+            removed++;
+        } else {
+            kept.push_back(heap_.top());
+        }
+        heap_.pop();
+    }
+    
+    heap_ = std::priority_queue<Deadline>(std::less<Deadline>(), std::move(kept));
+    return removed;
+}
+
+bool DeadlineQueue::empty() const {
+    return heap_.empty();
+}
+
+size_t DeadlineQueue::size() const {
+    return heap_.size();
+}
+
+const Deadline& DeadlineQueue::top() const {
+    return heap_.top();
+}
+
+std::vector<Deadline> DeadlineQueue::pop_due(SteadyTime now) {
+    std::vector<Deadline> due;
+    
+    while (!heap_.empty() && heap_.top().when <= now) {
+        due.push_back(heap_.top());
+        heap_.pop();
+    }
+    
+    return due;
+}
+
+bool DeadlineQueue::wait(std::condition_variable& cv, std::unique_lock<std::mutex>& lock,
+                         const std::function<bool()>& interrupted) {
+    if (heap_.empty()) {
+        // Nothing scheduled - sleep until somebody re-arms us
+        clock_->wait_until(cv, lock, SteadyTime::max(), interrupted);
+        wakeup_count_++;
+        return false;
+    }
+    
+    const auto deadline = heap_.top().when;
+    
+    // A simulated clock only advances while we sleep, so never spin on it
+    const auto spin_window = clock_->is_realtime() ? spin_window_ : std::chrono::microseconds(0);
+    const auto coarse_deadline = deadline - spin_window;
+    
+    if (clock_->steady_now() < coarse_deadline) {
+        if (!clock_->wait_until(cv, lock, coarse_deadline, interrupted)) {
+            wakeup_count_++;
+            return false;
+        }
+    }
+    
+    // Spin out the remaining window without holding the lock
+    lock.unlock();
+    while (clock_->steady_now() < deadline) {
+        std::this_thread::yield();
+    }
+    lock.lock();
+    
+    wakeup_count_++;
+    return true;
+}
+
+void DeadlineQueue::set_spin_window(std::chrono::microseconds window) {
+    spin_window_ = window;
+}
+
+size_t DeadlineQueue::get_wakeup_count() const {
+    return wakeup_count_;
+}
+
+DeadlineQueue::SteadyTime DeadlineQueue::to_steady_time(std::chrono::system_clock::time_point time) const {
+    return clock_->to_steady_time(time);
+}
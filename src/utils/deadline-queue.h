@@ -0,0 +1,82 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <vector>
+#include <queue>
+#include <chrono>
+#include <mutex>
+#include <memory>
+#include <functional>
+#include <condition_variable>
+#include "clock.h"
+
+// A single point in time the scheduler has to wake up for.
+struct Deadline {
+    enum class Kind {
+        Trigger,    // Start the items of a time slot
+        Idle,       // Fall back to idle content after the slot ended
+        Preroll,    // Load the slot's items paused and hidden ahead of time
+        FrameArm,   // Hand frame-accurate items over to the video tick
+        Rearm       // Rebuild the deadline set (e.g. at midnight)
+    };
+    
+    std::chrono::steady_clock::time_point when;
+    std::chrono::system_clock::time_point scheduled_time; // Wall-clock slot instant
+    Kind kind;
+    size_t channel;                     // Index of the channel the deadline belongs to
+    int32_t slot_ms;                    // Milliseconds since local midnight of the slot
+    std::vector<std::string> item_ids;
+    
+    Deadline() : kind(Kind::Trigger), channel(0), slot_ms(-1) {}
+    
+    // Reversed so std::priority_queue behaves as a min-heap
+    bool operator<(const Deadline& other) const {
+        return when > other.when;
+    }
+};
+
+class DeadlineQueue {
+public:
+    using SteadyTime = Clock::SteadyTime;
+    
+    DeadlineQueue();
+    
+    // Clock deadlines are waited on, the system clock by default
+    void set_clock(std::shared_ptr<Clock> clock);
+    
+    void push(const Deadline& deadline);
+    void clear();
+    
+    // Drops every deadline matching the predicate, returns how many
+    size_t remove_if(const std::function<bool(const Deadline&)>& predicate);
+    
+    bool empty() const;
+    size_t size() const;
+    const Deadline& top() const;
+    
+    // Removes and returns every deadline that is due at the given time
+    std::vector<Deadline> pop_due(SteadyTime now);
+    
+    // Blocks until the earliest deadline is due or interrupted() becomes true.
+    // Returns true when a deadline is due, false when interrupted. With an
+    // empty queue this only returns on interruption.
+    bool wait(std::condition_variable& cv, std::unique_lock<std::mutex>& lock,
+              const std::function<bool()>& interrupted);
+    
+    // The last stretch before a deadline is spun instead of slept, so wakeups
+    // land within a fraction of a millisecond regardless of timer slack.
+    void set_spin_window(std::chrono::microseconds window);
+    
+    // Statistics
+    size_t get_wakeup_count() const;
+    
+    // Maps a wall-clock instant onto the steady clock deadlines are kept in
+    SteadyTime to_steady_time(std::chrono::system_clock::time_point time) const;
+
+private:
+    std::shared_ptr<Clock> clock_;
+    std::priority_queue<Deadline> heap_;
+    std::chrono::microseconds spin_window_;
+    size_t wakeup_count_;
+};
@@ -0,0 +1,520 @@
+#include "json-reader.h"
+#include <algorithm>
+#include <fstream>
+#include <locale>
+#include <sstream>
+
+namespace {
+
+void append_utf8(std::string& out, uint32_t code) {
+    if (code < 0x80) {
+        out += static_cast<char>(code);
+    } else if (code < 0x800) {
+        out += static_cast<char>(0xC0 | (code >> 6));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+        out += static_cast<char>(0xE0 | (code >> 12));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (code >> 18));
+        out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    }
+}
+
+bool is_digit(int c) {
+    return c >= '0' && c <= '9';
+}
+
+// Byte classes for the two hot loops: whitespace, and bytes that end a plain run in a string
+enum : uint8_t { PLAIN = 0, SPACE = 1, NEWLINE = 2, STRING_STOP = 4 };
+
+struct ByteClasses {
+    uint8_t classes[256];
+    
+    ByteClasses() : classes() {
+        classes[' '] = classes['\t'] = classes['\r'] = SPACE;
+        classes['\n'] = NEWLINE;
+        for (int c = 0; c < 0x20; ++c) {
+            classes[c] |= STRING_STOP;
+        }
+        classes['"'] = classes['\\'] = STRING_STOP;
+    }
+};
+
+const ByteClasses byte_classes;
+
+}
+
+JsonReader::JsonReader(size_t buffer_size)
+    : input_(nullptr)
+    , buffer_(std::max<size_t>(buffer_size, 16))
+    , base_(nullptr)
+    , cursor_(nullptr)
+    , end_(nullptr)
+    , buffer_offset_(0)
+    , line_start_(0)
+    , line_(1)
+    , token_offset_(0)
+    , token_line_(1)
+    , token_line_start_(0)
+{
+}
+
+bool JsonReader::parse_file(const std::string& file_path, JsonHandler& handler) {
+    std::ifstream file(file_path, std::ios::binary);
+    if (!file.is_open()) {
+        error_position_ = JsonPosition();
+        error_ = "cannot open " + file_path;
+        return false;
+    }
+    
+    return parse_stream(file, handler);
+}
+
+bool JsonReader::parse_stream(std::istream& input, JsonHandler& handler) {
+    input_ = &input;
+    base_ = cursor_ = end_ = buffer_.data();
+    
+    bool parsed = parse_document(handler);
+    input_ = nullptr;
+    return parsed;
+}
+
+bool JsonReader::parse_string(const std::string& text, JsonHandler& handler) {
+    input_ = nullptr;
+    base_ = cursor_ = text.data();
+    end_ = text.data() + text.size();
+    
+    return parse_document(handler);
+}
+
+const std::string& JsonReader::get_error() const {
+    return error_;
+}
+
+const JsonPosition& JsonReader::get_error_position() const {
+    return error_position_;
+}
+
+JsonPosition JsonReader::get_token_position() const {
+    JsonPosition position;
+    position.line = token_line_;
+    position.column = static_cast<size_t>(token_offset_ - token_line_start_) + 1;
+    return position;
+}
+
+uint64_t JsonReader::get_bytes_read() const {
+    return offset();
+}
+
+bool JsonReader::parse_document(JsonHandler& handler) {
+    buffer_offset_ = 0;
+    line_start_ = 0;
+    line_ = 1;
+    mark_token();
+    error_.clear();
+    error_position_ = JsonPosition();
+    
+    if (!skip_whitespace()) {
+        return syntax_error("empty document");
+    }
+    
+    if (!parse_value(handler, 0)) {
+        return false;
+    }
+    
+    if (skip_whitespace()) {
+        return syntax_error("unexpected content after the document");
+    }
+    
+    return true;
+}
+
+bool JsonReader::parse_value(JsonHandler& handler, size_t depth) {
+    if (!skip_whitespace()) {
+        return syntax_error("unexpected end of input");
+    }
+    
+    mark_token();
+    int c = peek();
+    switch (c) {
+    case '{':
+        return parse_object(handler, depth + 1);
+    case '[':
+        return parse_array(handler, depth + 1);
+    case '"':
+        if (!read_string(scratch_)) {
+            return false;
+        }
+        return handler.string_value(scratch_) || handler_error(handler);
+    case 't':
+        return read_literal("true") && (handler.bool_value(true) || handler_error(handler));
+    case 'f':
+        return read_literal("false") && (handler.bool_value(false) || handler_error(handler));
+    case 'n':
+        return read_literal("null") && (handler.null_value() || handler_error(handler));
+    default:
+        break;
+    }
+    
+    if (c == '-' || is_digit(c)) {
+        double value = 0.0;
+        return read_number(value) && (handler.number_value(value) || handler_error(handler));
+    }
+    
+    return syntax_error(std::string("unexpected character '") + static_cast<char>(c) + "'");
+}
+
+bool JsonReader::parse_object(JsonHandler& handler, size_t depth) {
+    if (depth > MAX_DEPTH) {
+        return syntax_error("nested deeper than " + std::to_string(MAX_DEPTH) + " levels");
+    }
+    
+    next();     // '{'
+    if (!handler.start_object()) {
+        return handler_error(handler);
+    }
+    
+    if (!skip_whitespace()) {
+        return syntax_error("unterminated object");
+    }
+    
+    if (peek() != '}') {
+        for (;;) {
+            if (!skip_whitespace() || peek() != '"') {
+                return syntax_error("expected a key string");
+            }
+            
+            mark_token();
+            if (!read_string(scratch_)) {
+                return false;
+            }
+            if (!handler.key(scratch_)) {
+                return handler_error(handler);
+            }
+            
+            if (!skip_whitespace() || peek() != ':') {
+                return syntax_error("expected ':' after key");
+            }
+            next();
+            
+            if (!parse_value(handler, depth)) {
+                return false;
+            }
+            
+            if (!skip_whitespace()) {
+                return syntax_error("unterminated object");
+            }
+            if (peek() == '}') {
+                break;
+            }
+            if (peek() != ',') {
+                return syntax_error("expected ',' or '}' in object");
+            }
+            next();
+        }
+    }
+    
+    mark_token();
+    next();     // '}'
+    return handler.end_object() || handler_error(handler);
+}
+
+bool JsonReader::parse_array(JsonHandler& handler, size_t depth) {
+    if (depth > MAX_DEPTH) {
+        return syntax_error("nested deeper than " + std::to_string(MAX_DEPTH) + " levels");
+    }
+    
+    next();     // '['
+    if (!handler.start_array()) {
+        return handler_error(handler);
+    }
+    
+    if (!skip_whitespace()) {
+        return syntax_error("unterminated array");
+    }
+    
+    if (peek() != ']') {
+        for (;;) {
+            if (!parse_value(handler, depth)) {
+                return false;
+            }
+            
+            if (!skip_whitespace()) {
+                return syntax_error("unterminated array");
+            }
+            if (peek() == ']') {
+                break;
+            }
+            if (peek() != ',') {
+                return syntax_error("expected ',' or ']' in array");
+            }
+            next();
+        }
+    }
+    
+    mark_token();
+    next();     // ']'
+    return handler.end_array() || handler_error(handler);
+}
+
+bool JsonReader::read_string(std::string& out) {
+    next();     // Opening quote
+    out.clear();
+    
+    for (;;) {
+        // Copy runs of plain characters straight out of the buffer
+        const char* run = cursor_;
+        while (cursor_ < end_ && !(byte_classes.classes[static_cast<unsigned char>(*cursor_)] & STRING_STOP)) {
+            ++cursor_;
+        }
+        out.append(run, cursor_ - run);
+        
+        if (out.size() > MAX_STRING_LENGTH) {
+            return syntax_error("string longer than " + std::to_string(MAX_STRING_LENGTH) + " bytes");
+        }
+        
+        if (cursor_ == end_) {
+            if (!refill()) {
+                return syntax_error("unterminated string");
+            }
+            continue;
+        }
+        
+        char c = *cursor_;
+        if (c == '"') {
+            ++cursor_;
+            return true;
+        }
+        if (c == '\\') {
+            ++cursor_;
+            if (!read_escape(out)) {
+                return false;
+            }
+            continue;
+        }
+        return syntax_error("control character in string");
+    }
+}
+
+bool JsonReader::read_escape(std::string& out) {
+    int c = next();
+    switch (c) {
+    case '"':   out += '"'; return true;
+    case '\\':  out += '\\'; return true;
+    case '/':   out += '/'; return true;
+    case 'b':   out += '\b'; return true;
+    case 'f':   out += '\f'; return true;
+    case 'n':   out += '\n'; return true;
+    case 'r':   out += '\r'; return true;
+    case 't':   out += '\t'; return true;
+    case 'u':
+        break;
+    case -1:
+        return syntax_error("unterminated string");
+    default:
+        return syntax_error("invalid escape sequence");
+    }
+    
+    uint32_t code = 0;
+    if (!read_hex4(code)) {
+        return false;
+    }
+    
+    // Characters past the BMP come as a surrogate pair
+    if (code >= 0xDC00 && code <= 0xDFFF) {
+        return syntax_error("unpaired surrogate in \\u escape");
+    }
+    if (code >= 0xD800 && code <= 0xDBFF) {
+        uint32_t low = 0;
+        if (next() != '\\' || next() != 'u') {
+            return syntax_error("unpaired surrogate in \\u escape");
+        }
+        if (!read_hex4(low)) {
+            return false;
+        }
+        if (low < 0xDC00 || low > 0xDFFF) {
+            return syntax_error("unpaired surrogate in \\u escape");
+        }
+        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+    }
+    
+    append_utf8(out, code);
+    return true;
+}
+
+bool JsonReader::read_hex4(uint32_t& code) {
+    code = 0;
+    for (int i = 0; i < 4; ++i) {
+        int c = next();
+        code <<= 4;
+        if (is_digit(c)) {
+            code |= c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            code |= c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            code |= c - 'A' + 10;
+        } else {
+            return syntax_error("invalid \\u escape");
+        }
+    }
+    return true;
+}
+
+bool JsonReader::read_number(double& value) {
+    // -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+    char text[64];
+    size_t length = 0;
+    bool integral = true;
+    auto take = [&]() {
+        int c = next();
+        if (length < sizeof(text) - 1) {
+            text[length] = static_cast<char>(c);
+        }
+        length++;
+    };
+    
+    if (peek() == '-') {
+        take();
+    }
+    
+    if (peek() == '0') {
+        take();
+    } else if (is_digit(peek())) {
+        while (is_digit(peek())) {
+            take();
+        }
+    } else {
+        return syntax_error("invalid number");
+    }
+    
+    if (peek() == '.') {
+        integral = false;
+        take();
+        if (!is_digit(peek())) {
+            return syntax_error("invalid number: digits expected after '.'");
+        }
+        while (is_digit(peek())) {
+            take();
+        }
+    }
+    
+    if (peek() == 'e' || peek() == 'E') {
+        integral = false;
+        take();
+        if (peek() == '+' || peek() == '-') {
+            take();
+        }
+        if (!is_digit(peek())) {
+            return syntax_error("invalid number: digits expected in exponent");
+        }
+        while (is_digit(peek())) {
+            take();
+        }
+    }
+    
+    if (length >= sizeof(text)) {
+        return syntax_error("number longer than " + std::to_string(sizeof(text) - 1) + " characters");
+    }
+    text[length] = '\0';
+    
+    // Integers (every number in a schedule) without the locale-aware conversion
+    if (integral && length <= 18) {
+        bool negative = text[0] == '-';
+        int64_t integer = 0;
+        for (size_t i = negative ? 1 : 0; i < length; ++i) {
+            integer = integer * 10 + (text[i] - '0');
+        }
+        value = static_cast<double>(negative ? -integer : integer);
+        return true;
+    }
+    
+    std::istringstream stream(text);
+    stream.imbue(std::locale::classic());
+    stream >> value;
+    return true;
+}
+
+bool JsonReader::read_literal(const char* literal) {
+    for (const char* c = literal; *c; ++c) {
+        if (next() != *c) {
+            return syntax_error(std::string("invalid literal, expected '") + literal + "'");
+        }
+    }
+    return true;
+}
+
+bool JsonReader::refill() {
+    if (!input_) {
+        return false;
+    }
+    
+    buffer_offset_ += end_ - base_;
+    input_->read(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    base_ = cursor_ = buffer_.data();
+    end_ = base_ + input_->gcount();
+    return cursor_ < end_;
+}
+
+bool JsonReader::skip_whitespace() {
+    for (;;) {
+        while (cursor_ < end_) {
+            uint8_t type = byte_classes.classes[static_cast<unsigned char>(*cursor_)];
+            if (type & SPACE) {
+                ++cursor_;
+            } else if (type & NEWLINE) {
+                ++cursor_;
+                line_++;
+                line_start_ = offset();
+            } else {
+                return true;
+            }
+        }
+        
+        if (!refill()) {
+            return false;
+        }
+    }
+}
+
+int JsonReader::peek() {
+    if (cursor_ == end_ && !refill()) {
+        return -1;
+    }
+    return static_cast<unsigned char>(*cursor_);
+}
+
+int JsonReader::next() {
+    int c = peek();
+    if (c >= 0) {
+        ++cursor_;
+    }
+    return c;
+}
+
+uint64_t JsonReader::offset() const {
+    return buffer_offset_ + static_cast<uint64_t>(cursor_ - base_);
+}
+
+void JsonReader::mark_token() {
+    token_offset_ = offset();
+    token_line_ = line_;
+    token_line_start_ = line_start_;
+}
+
+bool JsonReader::syntax_error(const std::string& message) {
+    error_position_.line = line_;
+    error_position_.column = static_cast<size_t>(offset() - line_start_) + 1;
+    error_ = error_position_.to_string() + ": " + message;
+    return false;
+}
+
+bool JsonReader::handler_error(JsonHandler& handler) {
+    error_position_ = get_token_position();
+    const std::string& message = handler.get_error();
+    error_ = error_position_.to_string() + ": " + (message.empty() ? "rejected by the handler" : message);
+    return false;
+}
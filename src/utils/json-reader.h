@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+// Receives a JSON document's events in order. Returning false from any
+// callback stops the parse; fail() records why.
+class JsonHandler {
+public:
+    virtual ~JsonHandler() = default;
+    
+    virtual bool start_object() = 0;
+    virtual bool end_object() = 0;
+    virtual bool start_array() = 0;
+    virtual bool end_array() = 0;
+    virtual bool key(const std::string& name) = 0;
+    virtual bool string_value(const std::string& value) = 0;
+    virtual bool number_value(double value) = 0;
+    virtual bool bool_value(bool value) = 0;
+    virtual bool null_value() = 0;
+    
+    const std::string& get_error() const { return error_; }
+
+protected:
+    bool fail(const std::string& message) {
+        error_ = message;
+        return false;
+    }
+
+private:
+    std::string error_;
+};
+
+struct JsonPosition {
+    size_t line;        // 1-based
+    size_t column;      // 1-based, in bytes
+    
+    JsonPosition() : line(1), column(1) {}
+    
+    std::string to_string() const {
+        return "line " + std::to_string(line) + ", column " + std::to_string(column);
+    }
+};
+
+// Single-pass SAX-style JSON reader. Input is pulled through a fixed-size
+// buffer, so memory stays bounded by the buffer, the longest string and the
+// nesting depth, whatever the document size; both of the latter are capped.
+class JsonReader {
+public:
+    static constexpr size_t DEFAULT_BUFFER_SIZE = 64 * 1024;
+    static constexpr size_t MAX_DEPTH = 64;
+    static constexpr size_t MAX_STRING_LENGTH = 1024 * 1024;
+    
+    explicit JsonReader(size_t buffer_size = DEFAULT_BUFFER_SIZE);
+    
+    bool parse_file(const std::string& file_path, JsonHandler& handler);
+    bool parse_stream(std::istream& input, JsonHandler& handler);
+    bool parse_string(const std::string& text, JsonHandler& handler);
+    
+    // Why and where the last parse stopped ("line 3, column 7: ...")
+    const std::string& get_error() const;
+    const JsonPosition& get_error_position() const;
+    
+    // Where the value or key currently being reported starts
+    JsonPosition get_token_position() const;
+    
+    // Bytes consumed by the last parse
+    uint64_t get_bytes_read() const;
+
+private:
+    bool parse_document(JsonHandler& handler);
+    bool parse_value(JsonHandler& handler, size_t depth);
+    bool parse_object(JsonHandler& handler, size_t depth);
+    bool parse_array(JsonHandler& handler, size_t depth);
+    bool read_string(std::string& out);
+    bool read_escape(std::string& out);
+    bool read_hex4(uint32_t& code);
+    bool read_number(double& value);
+    bool read_literal(const char* literal);
+    
+    bool refill();
+    bool skip_whitespace();     // False at end of input
+    int peek();                 // -1 at end of input
+    int next();
+    uint64_t offset() const;
+    void mark_token();
+    
+    bool syntax_error(const std::string& message);
+    bool handler_error(JsonHandler& handler);
+    
+    std::istream* input_;
+    std::vector<char> buffer_;
+    const char* base_;          // Start of the bytes in hand: buffer_, or the whole string
+    const char* cursor_;
+    const char* end_;
+    uint64_t buffer_offset_;    // Input offset of the buffer's first byte
+    uint64_t line_start_;       // Input offset where the current line starts
+    size_t line_;
+    uint64_t token_offset_;
+    size_t token_line_;
+    uint64_t token_line_start_;
+    std::string scratch_;       // Reused for keys and string values
+    
+    std::string error_;
+    JsonPosition error_position_;
+    
+    // Prevent copying
+    JsonReader(const JsonReader&) = delete;
+    JsonReader& operator=(const JsonReader&) = delete;
+};
@@ -0,0 +1,131 @@
+#include "latency-histogram.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+LatencyHistogram::LatencyHistogram()
+    : count_(0)
+    , min_(std::numeric_limits<int64_t>::max())
+    , max_(0)
+    , sum_(0.0)
+{
+}
+
+void LatencyHistogram::record(int64_t value_ns) {
+    value_ns = std::max<int64_t>(0, value_ns);
+    
+    if (counts_.empty()) {
+        counts_.assign(BUCKET_COUNT, 0);
+    }
+    
+    counts_[bucket_index(value_ns)]++;
+    count_++;
+    min_ = std::min(min_, value_ns);
+    max_ = std::max(max_, value_ns);
+    sum_ += static_cast<double>(value_ns);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    if (other.count_ == 0) {
+        return;
+    }
+    
+    if (counts_.empty()) {
+        counts_.assign(BUCKET_COUNT, 0);
+    }
+    
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        counts_[i] += other.counts_[i];
+    }
+    count_ += other.count_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+    sum_ += other.sum_;
+}
+
+void LatencyHistogram::reset() {
+    counts_.clear();
+    count_ = 0;
+    min_ = std::numeric_limits<int64_t>::max();
+    max_ = 0;
+    sum_ = 0.0;
+}
+
+uint64_t LatencyHistogram::get_count() const {
+    return count_;
+}
+
+int64_t LatencyHistogram::get_min() const {
+    return count_ ? min_ : 0;
+}
+
+int64_t LatencyHistogram::get_max() const {
+    return max_;
+}
+
+double LatencyHistogram::get_mean() const {
+    return count_ ? sum_ / static_cast<double>(count_) : 0.0;
+}
+
+int64_t LatencyHistogram::get_percentile(double percentile) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    
+    percentile = std::min(100.0, std::max(0.0, percentile));
+    uint64_t rank = static_cast<uint64_t>(std::ceil(percentile / 100.0 * static_cast<double>(count_)));
+    rank = std::max<uint64_t>(1, rank);
+    
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        seen += counts_[i];
+        if (seen == count_) {
+            // The bucket holding the largest sample, which is known exactly
+            return max_;
+        }
+        if (seen >= rank) {
+            // Report the bucket's top, but never beyond what was actually seen
+            return std::min(std::max(bucket_upper(i), min_), max_);
+        }
+    }
+    
+    return max_;
+}
+
+size_t LatencyHistogram::bucket_index(int64_t value_ns) {
+    if (value_ns < 2 * SUB_BUCKETS) {
+        return static_cast<size_t>(value_ns);
+    }
+    
+    value_ns = std::min(value_ns, (int64_t(1) << MAX_MAGNITUDE) - 1);
+
+    int magnitude = MAX_MAGNITUDE - 1;
+    while (!(value_ns >> magnitude)) {
+        magnitude--;
+    }
+
+    int shift = magnitude - SUB_BUCKET_BITS;
+    int64_t sub_bucket = (value_ns >> shift) - SUB_BUCKETS;
+    return static_cast<size_t>(2 * SUB_BUCKETS + (shift - 1) * SUB_BUCKETS + sub_bucket);
+}
+
+int64_t LatencyHistogram::bucket_upper(size_t index) {
+    if (index < static_cast<size_t>(2 * SUB_BUCKETS)) {
+        return static_cast<int64_t>(index);
+    }
+    
+    int64_t offset = static_cast<int64_t>(index) - 2 * SUB_BUCKETS;
+    int shift = static_cast<int>(offset / SUB_BUCKETS) + 1;
+    int64_t top = offset % SUB_BUCKETS + SUB_BUCKETS;
+    return ((top + 1) << shift) - 1;
+}
+
+const char* latency_stage_name(LatencyStage stage) {
+    switch (stage) {
+    case LatencyStage::Wakeup:      return "wakeup";
+    case LatencyStage::Dispatch:    return "dispatch";
+    case LatencyStage::Start:       return "start";
+    case LatencyStage::Total:       return "total";
+    }
+    return "unknown";
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Log-linear latency histogram in the spirit of HdrHistogram: values below 256ns
+// are counted exactly, above that every power of two is split into 128
+// sub-buckets, so any recorded value is resolved to within 1%. Values past
+// about a minute share the last bucket (min/max stay exact).
+//
+// Not thread-safe; owners guard it with their own mutex.
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+    
+    void record(int64_t value_ns);
+    void merge(const LatencyHistogram& other);
+    void reset();
+    
+    uint64_t get_count() const;
+    int64_t get_min() const;
+    int64_t get_max() const;
+    double get_mean() const;
+    
+    // Smallest recorded value (to bucket precision) that percentile percent of
+    // the samples are at or below; 0 when empty
+    int64_t get_percentile(double percentile) const;
+
+private:
+    static size_t bucket_index(int64_t value_ns);
+    static int64_t bucket_upper(size_t index);
+    
+    static constexpr int SUB_BUCKET_BITS = 7;
+    static constexpr int64_t SUB_BUCKETS = int64_t(1) << SUB_BUCKET_BITS;
+    static constexpr int MAX_MAGNITUDE = 36;    // Values from 2^36ns (~69s) up share the last bucket
+    static constexpr size_t BUCKET_COUNT = 2 * SUB_BUCKETS + (MAX_MAGNITUDE - SUB_BUCKET_BITS - 1) * SUB_BUCKETS;
+    
+    std::vector<uint64_t> counts_;  // Allocated on the first record
+    uint64_t count_;
+    int64_t min_;
+    int64_t max_;
+    double sum_;
+};
+
+// Stages of a trigger, each measured from the end of the previous one:
+// scheduled instant -> scheduler wakeup -> OBS commands issued -> media playing.
+// Total runs from the scheduled instant to the first played frame.
+enum class LatencyStage {
+    Wakeup,
+    Dispatch,
+    Start,
+    Total
+};
+
+constexpr size_t LATENCY_STAGE_COUNT = 4;
+
+const char* latency_stage_name(LatencyStage stage);
+
+using StageHistograms = std::array<LatencyHistogram, LATENCY_STAGE_COUNT>;
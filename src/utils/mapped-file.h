@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Read-only view of a whole file mapped into memory. Pages are read in by
+// the OS as they are touched, so opening costs the same whatever the size.
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+    
+    bool open(const std::string& file_path);
+    void close();
+    
+    bool is_open() const;
+    const char* data() const;
+    size_t size() const;
+
+private:
+#ifdef _WIN32
+    HANDLE file_;
+    HANDLE mapping_;
+#else
+    int fd_;
+#endif
+    const char* data_;
+    size_t size_;
+    
+    // Prevent copying
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+};
@@ -0,0 +1,114 @@
+#include "worker-pool.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+WorkerPool::WorkerPool(size_t threads)
+    : thread_count_(threads ? threads : std::max<size_t>(std::thread::hardware_concurrency(), 1))
+    , running_(0)
+    , stopping_(false)
+{
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    work_cv_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+size_t WorkerPool::get_thread_count() const {
+    return thread_count_;
+}
+
+void WorkerPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        start();
+        tasks_.push_back(std::move(task));
+    }
+    work_cv_.notify_one();
+}
+
+void WorkerPool::for_each(size_t count, const std::function<void(size_t)>& task) {
+    // Every thread taking part claims the next index until none are left
+    std::atomic<size_t> next{0};
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    auto drain = [&]() {
+        for (size_t index = next++; index < count; index = next++) {
+            try {
+                task(index);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+    };
+    
+    // The calling thread is one of the helpers, so one task runs inline
+    size_t helpers = count > 1 ? std::min(thread_count_, count) - 1 : 0;
+    std::mutex done_mutex;
+    std::condition_variable done_cv;
+    size_t done = 0;
+    for (size_t i = 0; i < helpers; ++i) {
+        submit([&]() {
+            drain();
+            std::lock_guard<std::mutex> lock(done_mutex);
+            if (++done == helpers) {
+                done_cv.notify_one();
+            }
+        });
+    }
+    
+    drain();
+    std::unique_lock<std::mutex> lock(done_mutex);
+    done_cv.wait(lock, [&]() { return done == helpers; });
+    
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void WorkerPool::wait_idle() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_cv_.wait(lock, [this]() { return tasks_.empty() && running_ == 0; });
+}
+
+void WorkerPool::start() {
+    // Called with mutex_ held
+    if (!threads_.empty()) {
+        return;
+    }
+    threads_.reserve(thread_count_);
+    for (size_t i = 0; i < thread_count_; ++i) {
+        threads_.emplace_back(&WorkerPool::worker_loop, this);
+    }
+}
+
+void WorkerPool::worker_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        work_cv_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+        if (tasks_.empty()) {
+            return;
+        }
+        
+        auto task = std::move(tasks_.front());
+        tasks_.pop_front();
+        running_++;
+        lock.unlock();
+        task();
+        lock.lock();
+        running_--;
+        if (tasks_.empty() && running_ == 0) {
+            idle_cv_.notify_all();
+        }
+    }
+}
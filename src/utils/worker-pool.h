@@ -0,0 +1,48 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed number of threads taking tasks off one queue. The threads start
+// with the first task, so a pool that is never used costs nothing.
+class WorkerPool {
+public:
+    // 0 threads: one per core
+    explicit WorkerPool(size_t threads = 0);
+    ~WorkerPool();
+    
+    size_t get_thread_count() const;
+    
+    // Queues a task for whichever thread is free first
+    void submit(std::function<void()> task);
+    
+    // Calls task(0) .. task(count - 1) on the workers and the calling thread,
+    // returning once every call did. The first exception thrown by a call
+    // is rethrown here, after the others finished.
+    void for_each(size_t count, const std::function<void(size_t)>& task);
+    
+    // Blocks until the queue is empty and no task is running
+    void wait_idle();
+
+private:
+    void start();
+    void worker_loop();
+    
+    mutable std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable idle_cv_;
+    std::deque<std::function<void()>> tasks_;
+    std::vector<std::thread> threads_;
+    size_t thread_count_;
+    size_t running_;
+    bool stopping_;
+    
+    // Prevent copying
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+};
@@ -0,0 +1,166 @@
+// Measures how the single scheduler event loop scales with the number of channels.
+//
+// 1, 8 and 64 channels are built against the in-memory OBS mock, each with its
+// own sources and a playlist that switches item every few frames. A simulated
+// 60 fps clock is stepped frame by frame; on every frame the loop pops the due
+// deadlines and hands them to their channels. Reported is the cost of that
+// dispatch per frame and per switch, next to the 16.7 ms frame budget. The OBS
+// calls themselves run afterwards from the command queue and are only counted.
+//
+// Usage: bench_channels [frames] [switch_every_frames]
+
+#include "channel.h"
+#include "frame-trigger.h"
+#include "playlist-manager.h"
+#include "utils/deadline-queue.h"
+#include "mocks/obs-mock.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+using SteadyClock = std::chrono::steady_clock;
+
+static constexpr size_t ITEMS_PER_CHANNEL = 8;
+static constexpr size_t SOURCES_PER_CHANNEL = 2;
+
+struct RunResult {
+    std::vector<double> tick_us;    // Dispatch cost of frames that had work
+    size_t switches = 0;
+    size_t obs_calls = 0;
+    double total_ms = 0.0;
+};
+
+static std::vector<std::unique_ptr<Channel>> make_channels(size_t count) {
+    obs_mock::reset();
+    obs_mock::create_scene("Program");
+    obs_mock::set_current_scene("Program");
+    
+    std::vector<std::unique_ptr<Channel>> channels;
+    for (size_t c = 0; c < count; ++c) {
+        std::string name = "channel-" + std::to_string(c);
+        
+        for (size_t s = 0; s < SOURCES_PER_CHANNEL; ++s) {
+            std::string source = name + "-source-" + std::to_string(s);
+            obs_mock::create_media_source(source);
+            obs_mock::add_to_scene("Program", source);
+        }
+        
+        auto channel = std::make_unique<Channel>(name, c);
+        channel->initialize();
+        
+        Playlist playlist;
+        playlist.name = name;
+        for (size_t i = 0; i < ITEMS_PER_CHANNEL; ++i) {
+            ScheduledItem item;
+            item.name = name + "-item-" + std::to_string(i);
+            char time[8];
+            snprintf(time, sizeof(time), "%02zu:%02zu", i / 60, i % 60);
+            item.time = time;
+            item.source = name + "-source-" + std::to_string(i % SOURCES_PER_CHANNEL);
+            item.file_path = "/media/" + item.name + ".mp4";
+            playlist.items.push_back(item);
+        }
+        channel->get_playlist_manager()->add_playlist(name + ".json", playlist);
+        
+        channels.push_back(std::move(channel));
+    }
+    
+    return channels;
+}
+
+static RunResult run(size_t channel_count, size_t frames, size_t switch_every) {
+    auto channels = make_channels(channel_count);
+    FrameTrigger frame_trigger;
+    
+    const auto frame = std::chrono::nanoseconds(1000000000 / 60);
+    const auto start = SteadyClock::now();
+    
+    // Every channel switches item every switch_every frames, staggered so the
+    // channels do not all land on the same frame
+    DeadlineQueue deadlines;
+    for (size_t c = 0; c < channels.size(); ++c) {
+        std::vector<std::string> item_ids;
+        for (const auto& playlist : channels[c]->get_playlist_manager()->get_playlists()) {
+            for (const auto& item : playlist.items) {
+                item_ids.push_back(item.id);
+            }
+        }
+        
+        size_t n = 0;
+        for (size_t f = c % switch_every; f < frames; f += switch_every, ++n) {
+            Deadline deadline;
+            deadline.kind = Deadline::Kind::Trigger;
+            deadline.channel = c;
+            deadline.when = start + frame * f;
+            deadline.item_ids.push_back(item_ids[n % item_ids.size()]);
+            deadlines.push(deadline);
+        }
+    }
+    
+    RunResult result;
+    obs_mock::reset_call_count();
+    auto run_start = SteadyClock::now();
+    
+    for (size_t f = 0; f < frames; ++f) {
+        auto tick_start = SteadyClock::now();
+        
+        auto due = deadlines.pop_due(start + frame * f);
+        for (const auto& deadline : due) {
+            channels[deadline.channel]->handle_deadline(deadline, frame_trigger);
+        }
+        
+        if (!due.empty()) {
+            result.tick_us.push_back(
+                std::chrono::duration<double, std::micro>(SteadyClock::now() - tick_start).count());
+            result.switches += due.size();
+        }
+        
+        // The queued OBS calls run on the (mock) UI thread, outside the loop's time
+        obs_mock::run_pending_tasks();
+    }
+    
+    result.total_ms = std::chrono::duration<double, std::milli>(SteadyClock::now() - run_start).count();
+    result.obs_calls = obs_mock::get_call_count();
+    return result;
+}
+
+static double percentile(std::vector<double> values, double p) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t index = static_cast<size_t>(p * (values.size() - 1));
+    return values[index];
+}
+
+int main(int argc, char** argv) {
+    size_t frames = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 3600;
+    size_t switch_every = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 30;
+    if (frames == 0) {
+        frames = 3600;
+    }
+    if (switch_every == 0) {
+        switch_every = 1;
+    }
+    
+    const double frame_budget_us = 1000000.0 / 60;
+    
+    for (size_t channel_count : {1, 8, 64}) {
+        auto result = run(channel_count, frames, switch_every);
+        double per_switch_us = result.switches ? result.total_ms * 1000.0 / result.switches : 0.0;
+        double p99 = percentile(result.tick_us, 0.99);
+        
+        printf("channels=%3zu switches=%6zu per-switch=%7.2fus obs-calls/switch=%5.1f "
+               "busy-frame p50=%8.2fus p99=%8.2fus max=%8.2fus (p99 %.2f%% of frame)\n",
+               channel_count, result.switches, per_switch_us,
+               result.switches ? static_cast<double>(result.obs_calls) / result.switches : 0.0,
+               percentile(result.tick_us, 0.50), p99, percentile(result.tick_us, 1.0),
+               100.0 * p99 / frame_budget_us);
+    }
+    
+    return 0;
+}
@@ -0,0 +1,135 @@
+// Measures how long the scheduler thread is blocked per trigger, with the OBS
+// calls made synchronously (the previous MediaController path) versus handed
+// to the command queue as one batch.
+//
+// OBS calls are slowed down by the mock to stand in for calls that wait on
+// the graphics thread. The queued variant runs batches on the mock UI thread
+// and reports queue wait, batch run time and per-command cost from the
+// returned futures. Triggers are either paced or submitted as one burst.
+//
+// Usage: bench_command_queue [triggers] [obs_call_delay_us]
+
+#include "media-controller.h"
+#include "playlist-manager.h"
+#include "mocks/obs-mock.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+using SteadyClock = std::chrono::steady_clock;
+
+static double percentile(std::vector<double> values, double p) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t index = static_cast<size_t>(p * (values.size() - 1));
+    return values[index];
+}
+
+static std::vector<ScheduledItem> make_items() {
+    obs_mock::reset();
+    obs_mock::create_scene("Program");
+    obs_mock::set_current_scene("Program");
+    
+    std::vector<ScheduledItem> items;
+    for (int i = 0; i < 4; ++i) {
+        ScheduledItem item;
+        item.id = "item-" + std::to_string(i);
+        item.name = item.id;
+        item.source = "source-" + std::to_string(i);
+        item.file_path = "/media/" + item.id + ".mp4";
+        obs_mock::create_media_source(item.source);
+        obs_mock::add_to_scene("Program", item.source);
+        items.push_back(item);
+    }
+    return items;
+}
+
+static void run_sync(size_t triggers, std::chrono::microseconds delay, std::chrono::milliseconds interval) {
+    auto items = make_items();
+    MediaController media;
+    media.initialize();
+    obs_mock::set_call_delay(delay);
+    
+    std::vector<double> blocked_us;
+    for (size_t n = 0; n < triggers; ++n) {
+        const auto& item = items[n % items.size()];
+        auto start = SteadyClock::now();
+        media.set_source_visibility(item.source, true);
+        media.play_media(item.source, item.file_path);
+        blocked_us.push_back(std::chrono::duration<double, std::micro>(SteadyClock::now() - start).count());
+        std::this_thread::sleep_for(interval);
+    }
+    
+    printf("sync   interval=%3lldms blocked p50=%9.1fus p99=%9.1fus max=%9.1fus\n",
+           static_cast<long long>(interval.count()), percentile(blocked_us, 0.50),
+           percentile(blocked_us, 0.99), percentile(blocked_us, 1.0));
+}
+
+static void run_queued(size_t triggers, std::chrono::microseconds delay, std::chrono::milliseconds interval) {
+    auto items = make_items();
+    MediaController media;
+    media.initialize();
+    obs_mock::set_call_delay(delay);
+    obs_mock::start_task_thread();
+    
+    std::vector<double> blocked_us;
+    std::vector<std::future<BatchResult>> futures;
+    for (size_t n = 0; n < triggers; ++n) {
+        auto start = SteadyClock::now();
+        futures.push_back(media.execute_item_async(items[n % items.size()]));
+        blocked_us.push_back(std::chrono::duration<double, std::micro>(SteadyClock::now() - start).count());
+        if (interval.count() > 0) {
+            std::this_thread::sleep_for(interval);
+        }
+    }
+    
+    std::vector<double> wait_us;
+    std::vector<double> run_us;
+    std::map<std::string, std::pair<double, size_t>> per_command;
+    for (auto& future : futures) {
+        BatchResult result = future.get();
+        wait_us.push_back((result.started_ns - result.enqueued_ns) / 1000.0);
+        run_us.push_back((result.finished_ns - result.started_ns) / 1000.0);
+        for (const auto& command : result.commands) {
+            per_command[command.name].first += command.duration_ns / 1000.0;
+            per_command[command.name].second++;
+        }
+    }
+    
+    obs_mock::stop_task_thread();
+    auto stats = media.get_command_queue_stats();
+    
+    printf("queued interval=%3lldms blocked p50=%9.1fus p99=%9.1fus max=%9.1fus | "
+           "wait p50=%9.1fus p99=%9.1fus run p50=%8.1fus max-depth=%zu\n",
+           static_cast<long long>(interval.count()), percentile(blocked_us, 0.50),
+           percentile(blocked_us, 0.99), percentile(blocked_us, 1.0),
+           percentile(wait_us, 0.50), percentile(wait_us, 0.99), percentile(run_us, 0.50),
+           stats.max_depth);
+    
+    for (const auto& pair : per_command) {
+        printf("         %-12s avg=%8.1fus\n", pair.first.c_str(), pair.second.first / pair.second.second);
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t triggers = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200;
+    int delay_us = argc > 2 ? std::atoi(argv[2]) : 200;
+    if (triggers == 0) {
+        triggers = 200;
+    }
+    const auto delay = std::chrono::microseconds(std::max(delay_us, 0));
+    
+    run_sync(triggers, delay, std::chrono::milliseconds(5));
+    run_queued(triggers, delay, std::chrono::milliseconds(5));
+    run_queued(triggers, delay, std::chrono::milliseconds(0));
+    
+    return 0;
+}
@@ -0,0 +1,150 @@
+// Compares the fixed-interval polling loop against the deadline-driven loop.
+//
+// For a sparse and a dense schedule this reports how often each loop wakes up
+// (extrapolated to wakeups per hour) and how late items are triggered.
+//
+// Usage: bench_deadline_loop [window_seconds]
+
+#include "utils/deadline-queue.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using SteadyClock = std::chrono::steady_clock;
+
+struct RunResult {
+    size_t wakeups = 0;
+    std::vector<double> lateness_ms;
+};
+
+static std::vector<SteadyClock::time_point> make_schedule(SteadyClock::time_point start,
+                                                          std::chrono::milliseconds window,
+                                                          size_t count) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<long long> offset(100, window.count() - 100);
+    
+    std::vector<SteadyClock::time_point> schedule;
+    for (size_t i = 0; i < count; ++i) {
+        schedule.push_back(start + std::chrono::milliseconds(offset(rng)));
+    }
+    std::sort(schedule.begin(), schedule.end());
+    return schedule;
+}
+
+// The old loop: wake every interval and fire whatever became due
+static RunResult run_polling(const std::vector<SteadyClock::time_point>& schedule,
+                             SteadyClock::time_point end, std::chrono::milliseconds interval) {
+    RunResult result;
+    size_t next = 0;
+    
+    while (SteadyClock::now() < end) {
+        std::this_thread::sleep_for(interval);
+        result.wakeups++;
+        
+        auto now = SteadyClock::now();
+        while (next < schedule.size() && schedule[next] <= now) {
+            result.lateness_ms.push_back(
+                std::chrono::duration<double, std::milli>(now - schedule[next]).count());
+            next++;
+        }
+    }
+    
+    return result;
+}
+
+static RunResult run_deadline(const std::vector<SteadyClock::time_point>& schedule,
+                              SteadyClock::time_point end) {
+    RunResult result;
+    DeadlineQueue deadlines;
+    std::condition_variable cv;
+    std::mutex mutex;
+    
+    for (const auto& when : schedule) {
+        Deadline deadline;
+        deadline.when = when;
+        deadlines.push(deadline);
+    }
+    
+    // Stand-in for the midnight re-arm so the loop terminates
+    Deadline stop;
+    stop.kind = Deadline::Kind::Rearm;
+    stop.when = end;
+    deadlines.push(stop);
+    
+    bool done = false;
+    while (!done) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!deadlines.wait(cv, lock, [] { return false; })) {
+            continue;
+        }
+        
+        auto now = SteadyClock::now();
+        for (const auto& deadline : deadlines.pop_due(now)) {
+            if (deadline.kind == Deadline::Kind::Rearm) {
+                done = true;
+                continue;
+            }
+            result.lateness_ms.push_back(
+                std::chrono::duration<double, std::milli>(now - deadline.when).count());
+        }
+    }
+    
+    result.wakeups = deadlines.get_wakeup_count();
+    return result;
+}
+
+static double percentile(std::vector<double> values, double p) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t index = static_cast<size_t>(p * (values.size() - 1));
+    return values[index];
+}
+
+static void report(const char* schedule_name, const char* loop_name,
+                   const RunResult& result, std::chrono::milliseconds window) {
+    double wakeups_per_hour = result.wakeups * 3600000.0 / window.count();
+    printf("%-8s %-10s items=%5zu wakeups=%6zu wakeups/h=%10.0f "
+           "late p50=%8.3fms p99=%8.3fms max=%8.3fms\n",
+           schedule_name, loop_name, result.lateness_ms.size(), result.wakeups, wakeups_per_hour,
+           percentile(result.lateness_ms, 0.50), percentile(result.lateness_ms, 0.99),
+           percentile(result.lateness_ms, 1.0));
+}
+
+int main(int argc, char** argv) {
+    int window_seconds = argc > 1 ? std::atoi(argv[1]) : 10;
+    if (window_seconds < 2) {
+        window_seconds = 2;
+    }
+    const auto window = std::chrono::milliseconds(window_seconds * 1000);
+    
+    struct Scenario {
+        const char* name;
+        size_t items;
+    };
+    const Scenario scenarios[] = {
+        {"sparse", 2},
+        {"dense", static_cast<size_t>(window_seconds) * 20},
+    };
+    
+    for (const auto& scenario : scenarios) {
+        auto start = SteadyClock::now();
+        auto schedule = make_schedule(start, window, scenario.items);
+        report(scenario.name, "polling",
+               run_polling(schedule, start + window, std::chrono::seconds(1)), window);
+        
+        start = SteadyClock::now();
+        schedule = make_schedule(start, window, scenario.items);
+        report(scenario.name, "deadline", run_deadline(schedule, start + window), window);
+    }
+    
+    return 0;
+}
@@ -0,0 +1,274 @@
+// Measures how much memory a schedule costs per item.
+//
+// Builds playlists in memory the way the parser hands them over (a file per
+// playlist, every item with its own name and media file, sources and day
+// sets repeating), then counts the heap bytes still held: by the parsed
+// playlists alone, and by a PlaylistManager once it has published them
+// (working copy, snapshot with its item map and timeline).
+//
+// The items alone are also laid out two ways: as the ScheduledItems the
+// manager keeps, and as columns with source, scene and file interned into
+// 32-bit ids of a symbol table and times held as milliseconds.
+//
+// Usage: bench_item_memory [playlists] [items_per_playlist]
+
+#include "playlist-manager.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using SteadyClock = std::chrono::steady_clock;
+
+// Live heap bytes, counted in the global allocation functions
+static std::atomic<long long> live_bytes{0};
+static constexpr size_t HEADER = alignof(std::max_align_t);
+
+void* operator new(size_t size) {
+    char* block = static_cast<char*>(std::malloc(size + HEADER));
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    *reinterpret_cast<size_t*>(block) = size;
+    live_bytes += static_cast<long long>(size);
+    return block + HEADER;
+}
+
+void operator delete(void* pointer) noexcept {
+    if (!pointer) {
+        return;
+    }
+    char* block = static_cast<char*>(pointer) - HEADER;
+    live_bytes -= static_cast<long long>(*reinterpret_cast<size_t*>(block));
+    std::free(block);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    operator delete(pointer);
+}
+
+static std::vector<Playlist> make_playlists(size_t playlists, size_t items) {
+    std::vector<Playlist> result(playlists);
+    for (size_t p = 0; p < playlists; ++p) {
+        Playlist& playlist = result[p];
+        playlist.name = "Playlist " + std::to_string(p);
+        if (p % 3 == 0) {
+            playlist.days = {"monday", "tuesday", "wednesday", "thursday", "friday"};
+        } else if (p % 3 == 1) {
+            playlist.days = {"saturday", "sunday"};
+        } else {
+            playlist.days = {"monday", "wednesday", "friday"};
+        }
+        playlist.items.resize(items);
+        for (size_t i = 0; i < items; ++i) {
+            size_t minute = (p * 7 + i) % 1440;
+            char time[8];
+            snprintf(time, sizeof(time), "%02zu:%02zu", minute / 60, minute % 60);
+            
+            ScheduledItem& item = playlist.items[i];
+            item.name = "Segment " + std::to_string(p) + "." + std::to_string(i);
+            item.time = time;
+            item.source = "Source_" + std::to_string(i % 16);
+            item.file_path = "/media/segments/segment_" + std::to_string(p) + "_" + std::to_string(i) + ".mp4";
+            item.duration = static_cast<int>(i % 3600);
+            item.days = playlist.days;
+        }
+    }
+    return result;
+}
+
+// Names interned into dense 32-bit ids
+struct SymbolTable {
+    std::unordered_map<std::string, uint32_t> ids;
+    std::vector<std::string> names;
+    
+    uint32_t intern(const std::string& name) {
+        auto it = ids.find(name);
+        if (it != ids.end()) {
+            return it->second;
+        }
+        uint32_t id = static_cast<uint32_t>(names.size());
+        ids.emplace(name, id);
+        names.push_back(name);
+        return id;
+    }
+};
+
+// Every field of ScheduledItem as its own array, indexed by item. File
+// paths go into the symbol table too, or stay strings of their own.
+struct ItemColumns {
+    explicit ItemColumns(bool intern_files) : intern_files(intern_files) {}
+    
+    bool intern_files;
+    SymbolTable symbols;
+    std::vector<std::string> ids;
+    std::vector<std::string> names;
+    std::vector<int32_t> start_ms;
+    std::vector<uint32_t> sources;
+    std::vector<uint32_t> files;
+    std::vector<std::string> file_paths;
+    std::vector<uint32_t> scenes;
+    std::vector<int32_t> durations;
+    std::vector<int64_t> detected_durations_ms;
+    std::vector<uint8_t> days;
+    std::vector<uint8_t> flags;         // Loop and trigger mode
+    std::vector<std::shared_ptr<const CalendarRule>> calendars;
+    std::vector<int32_t> priorities;
+    std::vector<int32_t> playlist_priorities;
+    
+    void reserve(size_t count) {
+        ids.reserve(count);
+        names.reserve(count);
+        start_ms.reserve(count);
+        sources.reserve(count);
+        if (intern_files) {
+            files.reserve(count);
+        } else {
+            file_paths.reserve(count);
+        }
+        scenes.reserve(count);
+        durations.reserve(count);
+        detected_durations_ms.reserve(count);
+        days.reserve(count);
+        flags.reserve(count);
+        calendars.reserve(count);
+        priorities.reserve(count);
+        playlist_priorities.reserve(count);
+    }
+    
+    void add(const ScheduledItem& item) {
+        ids.push_back(item.id);
+        names.push_back(item.name);
+        start_ms.push_back(ScheduleTimeline::time_to_ms(item.time));
+        sources.push_back(symbols.intern(item.source));
+        if (intern_files) {
+            files.push_back(symbols.intern(item.file_path));
+        } else {
+            file_paths.push_back(item.file_path);
+        }
+        scenes.push_back(symbols.intern(item.scene));
+        durations.push_back(item.duration);
+        detected_durations_ms.push_back(item.detected_duration_ms);
+        days.push_back(item.days.mask());
+        flags.push_back(static_cast<uint8_t>(item.loop | (item.trigger_mode == TriggerMode::Frame) << 1));
+        calendars.push_back(item.calendar);
+        priorities.push_back(item.priority);
+        playlist_priorities.push_back(item.playlist_priority);
+    }
+};
+
+// Ids as the manager assigns them: 11 characters, held inline
+static void assign_ids(std::vector<Playlist>& playlists) {
+    size_t next = 0;
+    for (auto& playlist : playlists) {
+        for (auto& item : playlist.items) {
+            char id[12];
+            snprintf(id, sizeof(id), "%011zx", next++);
+            item.id = id;
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t playlists = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100;
+    size_t items_per_playlist = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1000;
+    if (playlists == 0) {
+        playlists = 100;
+    }
+    if (items_per_playlist == 0) {
+        items_per_playlist = 1000;
+    }
+    double total = static_cast<double>(playlists * items_per_playlist);
+    
+    long long before = live_bytes;
+    std::vector<Playlist> parsed = make_playlists(playlists, items_per_playlist);
+    long long parsed_bytes = live_bytes - before;
+    parsed.clear();
+    parsed.shrink_to_fit();
+    
+    size_t item_count = 0;
+    double publish_ms = 0.0;
+    long long manager_bytes = 0;
+    {
+        PlaylistManager manager;
+        manager.set_cache_directory("");
+        before = live_bytes;
+        
+        // Handed over like a load does, a file at a time
+        auto start = SteadyClock::now();
+        std::vector<Playlist> input = make_playlists(playlists, items_per_playlist);
+        for (size_t p = 0; p < input.size(); ++p) {
+            manager.add_playlist("playlist-" + std::to_string(p) + ".json", std::move(input[p]));
+        }
+        input.clear();
+        input.shrink_to_fit();
+        publish_ms = std::chrono::duration<double, std::milli>(SteadyClock::now() - start).count();
+        
+        manager_bytes = live_bytes - before;
+        item_count = manager.get_total_items();
+    }
+    
+    // The items alone, in either layout
+    std::vector<Playlist> source_playlists = make_playlists(playlists, items_per_playlist);
+    assign_ids(source_playlists);
+    size_t count = playlists * items_per_playlist;
+    
+    before = live_bytes;
+    long long item_bytes = 0;
+    {
+        std::vector<ScheduledItem> items;
+        items.reserve(count);
+        for (const auto& playlist : source_playlists) {
+            items.insert(items.end(), playlist.items.begin(), playlist.items.end());
+        }
+        item_bytes = live_bytes - before;
+    }
+    
+    auto measure_columns = [&](bool intern_files) {
+        long long start = live_bytes;
+        ItemColumns columns(intern_files);
+        columns.reserve(count);
+        for (const auto& playlist : source_playlists) {
+            for (const auto& item : playlist.items) {
+                columns.add(item);
+            }
+        }
+        return live_bytes - start;
+    };
+    long long column_bytes = measure_columns(true);
+    long long partial_bytes = measure_columns(false);
+    
+    // The share of that the symbol table holds
+    before = live_bytes;
+    long long symbol_bytes = 0;
+    size_t symbols = 0;
+    {
+        SymbolTable table;
+        for (const auto& playlist : source_playlists) {
+            for (const auto& item : playlist.items) {
+                table.intern(item.source);
+                table.intern(item.file_path);
+                table.intern(item.scene);
+            }
+        }
+        symbol_bytes = live_bytes - before;
+        symbols = table.names.size();
+    }
+    source_playlists.clear();
+    
+    printf("playlists=%zu items=%zu\n", playlists, item_count);
+    printf("parsed playlists   %8.0f B/item\n", parsed_bytes / total);
+    printf("playlist manager   %8.0f B/item  (%.1f MB, %.0fms to load)\n",
+           manager_bytes / total, manager_bytes / (1024.0 * 1024.0), publish_ms);
+    printf("ScheduledItem      %8.0f B/item  (%zu inline, %.0f on the heap)\n",
+           item_bytes / total, sizeof(ScheduledItem), item_bytes / total - sizeof(ScheduledItem));
+    printf("interned columns   %8.0f B/item  (%.0f of them the symbol table, %zu names)\n",
+           column_bytes / total, symbol_bytes / total, symbols);
+    printf("  files as strings %8.0f B/item  (only sources and scenes interned)\n", partial_bytes / total);
+    return item_count == playlists * items_per_playlist ? 0 : 1;
+}
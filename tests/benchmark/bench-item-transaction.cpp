@@ -0,0 +1,203 @@
+// Measures how many frames an item's changes are spread over when it goes on
+// air.
+//
+// Two scenes on the OBS mock each hold one media source, hidden between items.
+// Items alternate between them while a video thread renders at 60 fps, and
+// every libobs call is slowed down to stand in for calls that wait on the
+// graphics thread. Each item is put on air two ways: with the separate
+// controller calls execute_item used to make (switch_to_scene, then
+// set_source_visibility, then play_media, each looking its scene and source
+// up again), and as one ItemTransaction run on the mock UI thread by
+// execute_item_async, which waits for the next frame when its changes would
+// not fit before it. Reports the frames rendered between the first and the
+// last change, how many items had a frame rendered in between (a viewer could
+// see the scene switched but the media not yet started), and how long the
+// changes took, waits and lookups included.
+//
+// Usage: bench_item_transaction [items] [obs_call_delay_us]
+
+#include "media-controller.h"
+#include "playlist-manager.h"
+#include "mocks/obs-mock.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+using SteadyClock = std::chrono::steady_clock;
+
+struct Summary {
+    std::vector<int64_t> frames;
+    std::vector<double> apply_us;
+};
+
+// Renders frames at 60 fps until stopped, as the OBS video thread would
+class VideoThread {
+public:
+    VideoThread() : running_(true), thread_([this]() { run(); }) {}
+    
+    ~VideoThread() {
+        running_ = false;
+        thread_.join();
+    }
+
+private:
+    void run() {
+        auto next = SteadyClock::now();
+        while (running_) {
+            obs_mock::tick();
+            next += std::chrono::microseconds(16667);
+            std::this_thread::sleep_until(next);
+        }
+    }
+    
+    std::atomic<bool> running_;
+    std::thread thread_;
+};
+
+static std::vector<ScheduledItem> make_items(size_t count) {
+    obs_mock::reset();
+    obs_mock::create_scene("Program");
+    obs_mock::create_scene("Studio");
+    obs_mock::set_current_scene("Program");
+    obs_mock::create_media_source("Promo");
+    obs_mock::create_media_source("News");
+    obs_mock::add_to_scene("Program", "Promo");
+    obs_mock::add_to_scene("Studio", "News");
+    
+    std::vector<ScheduledItem> items;
+    for (size_t i = 0; i < count; ++i) {
+        ScheduledItem item;
+        item.id = "item-" + std::to_string(i);
+        item.name = item.id;
+        item.scene = i % 2 ? "Studio" : "Program";
+        item.source = i % 2 ? "News" : "Promo";
+        item.file_path = "/media/" + item.id + ".mp4";
+        items.push_back(item);
+    }
+    return items;
+}
+
+// Takes the item off air again, and waits a varying share of a frame so
+// items do not all start in the same phase of the video clock
+static void hide_between_items(const ScheduledItem& item, size_t index) {
+    obs_source_t* source = obs_get_source_by_name(item.source.c_str());
+    obs_source_media_stop(source);
+    obs_source_release(source);
+    
+    obs_source_t* scene_source = obs_get_source_by_name(item.scene.c_str());
+    obs_scene_enum_items(obs_scene_from_source(scene_source), [](obs_scene_t*, obs_sceneitem_t* scene_item, void*) {
+        obs_sceneitem_set_visible(scene_item, false);
+        return true;
+    }, nullptr);
+    obs_source_release(scene_source);
+    
+    std::this_thread::sleep_for(std::chrono::microseconds(1000 + (index * 7919) % 16667));
+}
+
+static Summary run_separate(size_t count, std::chrono::microseconds delay) {
+    auto items = make_items(count);
+    MediaController media;
+    media.initialize();
+    VideoThread video;
+    obs_mock::set_call_delay(delay);
+    
+    Summary summary;
+    for (size_t i = 0; i < items.size(); ++i) {
+        const auto& item = items[i];
+        hide_between_items(item, i);
+        
+        auto start = SteadyClock::now();
+        uint32_t first_frame = obs_get_total_frames();
+        media.switch_to_scene(item.scene);
+        media.set_source_visibility(item.source, true);
+        media.play_media(item.source, item.file_path);
+        uint32_t last_frame = obs_get_total_frames();
+        
+        summary.frames.push_back(static_cast<int64_t>(last_frame - first_frame));
+        summary.apply_us.push_back(std::chrono::duration<double, std::micro>(SteadyClock::now() - start).count());
+    }
+    
+    obs_mock::set_call_delay(std::chrono::microseconds(0));
+    media.cleanup();
+    return summary;
+}
+
+static Summary run_transaction(size_t count, std::chrono::microseconds delay) {
+    auto items = make_items(count);
+    obs_mock::start_task_thread();
+    MediaController media;
+    media.initialize();
+    VideoThread video;
+    obs_mock::set_call_delay(delay);
+    
+    Summary summary;
+    for (size_t i = 0; i < items.size(); ++i) {
+        const auto& item = items[i];
+        hide_between_items(item, i);
+        
+        BatchResult result = media.execute_item_async(item).get();
+        for (const auto& command : result.commands) {
+            if (command.name == "apply") {
+                summary.apply_us.push_back(command.duration_ns / 1000.0);
+            }
+        }
+    }
+    
+    // Each record appears once the item's first frame is out
+    obs_mock::set_call_delay(std::chrono::microseconds(0));
+    auto deadline = SteadyClock::now() + std::chrono::seconds(5);
+    while (media.get_start_latency_records().size() < items.size() && SteadyClock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    for (const auto& record : media.get_start_latency_records()) {
+        summary.frames.push_back(record.apply_frames);
+    }
+    
+    media.cleanup();
+    obs_mock::stop_task_thread();
+    return summary;
+}
+
+static void report(const char* label, const Summary& summary) {
+    int64_t max_frames = 0;
+    size_t torn = 0;
+    double total_frames = 0.0;
+    for (int64_t frames : summary.frames) {
+        max_frames = std::max(max_frames, frames);
+        torn += frames > 0;
+        total_frames += static_cast<double>(frames);
+    }
+    std::vector<double> apply_us = summary.apply_us;
+    std::sort(apply_us.begin(), apply_us.end());
+    double median_us = apply_us.empty() ? 0.0 : apply_us[apply_us.size() / 2];
+    double max_us = apply_us.empty() ? 0.0 : apply_us.back();
+    
+    printf("%-12s frames between first and last change: mean %.2f max %lld, %zu of %zu items torn, "
+           "changes took %.0fus median, %.0fus max\n",
+           label, summary.frames.empty() ? 0.0 : total_frames / summary.frames.size(),
+           static_cast<long long>(max_frames), torn, summary.frames.size(), median_us, max_us);
+}
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200;
+    long delay_us = argc > 2 ? std::strtol(argv[2], nullptr, 10) : 500;
+    if (count == 0) {
+        count = 200;
+    }
+    if (delay_us < 0) {
+        delay_us = 500;
+    }
+    
+    printf("items=%zu obs_call_delay=%ldus fps=60\n", count, delay_us);
+    Summary separate = run_separate(count, std::chrono::microseconds(delay_us));
+    Summary transaction = run_transaction(count, std::chrono::microseconds(delay_us));
+    report("separate", separate);
+    report("transaction", transaction);
+    
+    return transaction.frames.size() == count ? 0 : 1;
+}
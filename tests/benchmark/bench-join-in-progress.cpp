@@ -0,0 +1,137 @@
+// Measures how fast a restarted scheduler gets the right frame back on air.
+//
+// OBS comes back up part-way into a 30 minute item that is followed by the
+// next item on the hour. Without join-in-progress the channel stays dark (or
+// on whatever was left loaded) until that next slot; with it, startup loads the
+// running item hidden, seeks it to where the programme is by now and reveals
+// it once the media clock is there. The schedule runs on a SimulatedClock
+// frozen at the restart instant; the media side runs on the mock's real clock
+// at 60 fps, with the given file open and seek latencies.
+//
+// Reported per restart offset: recovery from plugin load until the revealed
+// frame, how far the revealed frame is off the programme, and how long the
+// channel would have stayed dark waiting for the next slot. (A restart within
+// the slot's first minute used to start the item from the top instead, late.)
+//
+// Usage: bench_join_in_progress [open_ms] [seek_ms]
+
+#include "scheduler-core.h"
+#include "playlist-manager.h"
+#include "mocks/obs-mock.h"
+#include "mocks/simulated-clock.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using SteadyClock = std::chrono::steady_clock;
+using SystemTime = std::chrono::system_clock::time_point;
+
+static SystemTime monday_at(int minutes, int seconds) {
+    // 2024-01-01 was a Monday
+    std::tm tm = {};
+    tm.tm_year = 124;
+    tm.tm_mday = 1;
+    tm.tm_hour = minutes / 60;
+    tm.tm_min = minutes % 60;
+    tm.tm_sec = seconds;
+    tm.tm_isdst = -1;
+    return std::chrono::system_clock::from_time_t(std::mktime(&tm));
+}
+
+struct RunResult {
+    bool joined;
+    double recovery_ms;
+    long long seek_error_ms;
+    double dark_without_join_s;
+};
+
+static RunResult run(int restart_seconds, int open_ms, int seek_ms) {
+    obs_mock::reset();
+    obs_mock::create_scene("Program");
+    obs_mock::set_current_scene("Program");
+    obs_mock::create_media_source("Media");
+    obs_mock::add_to_scene("Program", "Media");
+    obs_mock::set_media_duration("Media", 1800 * 1000);
+    obs_mock::set_media_latency(std::chrono::milliseconds(open_ms), std::chrono::milliseconds(seek_ms));
+    obs_mock::start_task_thread();
+    
+    const auto slot = monday_at(8 * 60, 0);
+    const auto next_slot = monday_at(9 * 60, 0);
+    const auto restart = slot + std::chrono::seconds(restart_seconds);
+    auto clock = std::make_shared<SimulatedClock>(restart);
+    
+    RunResult result{false, 0.0, 0, std::chrono::duration<double>(next_slot - restart).count()};
+    
+    SchedulerCore scheduler;
+    scheduler.set_clock(clock);
+    if (!scheduler.initialize()) {
+        obs_mock::stop_task_thread();
+        return result;
+    }
+    
+    Playlist playlist;
+    playlist.name = "Morning";
+    ScheduledItem news;
+    news.name = "News";
+    news.time = "08:00";
+    news.source = "Media";
+    news.file_path = "/media/news.mp4";
+    news.duration = 1800;
+    news.days = {"monday"};
+    playlist.items.push_back(news);
+    ScheduledItem magazine = news;
+    magazine.name = "Magazine";
+    magazine.time = "09:00";
+    magazine.file_path = "/media/magazine.mp4";
+    playlist.items.push_back(magazine);
+    scheduler.get_channel(0)->get_playlist_manager()->add_playlist("morning.json", playlist);
+    
+    scheduler.start();
+    
+    // Render at 60 fps until the item is back, or give up after 15 s
+    auto give_up = SteadyClock::now() + std::chrono::seconds(15);
+    auto next_frame = SteadyClock::now();
+    while (scheduler.get_join_records().empty() && SteadyClock::now() < give_up) {
+        obs_mock::tick();
+        next_frame += std::chrono::microseconds(16667);
+        std::this_thread::sleep_until(next_frame);
+    }
+    
+    scheduler.stop();
+    obs_mock::stop_task_thread();
+    
+    auto records = scheduler.get_join_records();
+    if (!records.empty() && records[0].revealed) {
+        result.joined = true;
+        result.recovery_ms = records[0].recovery_ns / 1e6;
+        result.seek_error_ms = records[0].seek_error_ms;
+    }
+    return result;
+}
+
+int main(int argc, char** argv) {
+    int open_ms = argc > 1 ? std::atoi(argv[1]) : 150;
+    int seek_ms = argc > 2 ? std::atoi(argv[2]) : 80;
+    
+    printf("open=%dms seek=%dms, 30min item at 08:00, next slot 09:00\n", open_ms, seek_ms);
+    
+    bool all_joined = true;
+    for (int restart_seconds : {90, 600, 1500, 1790}) {
+        RunResult result = run(restart_seconds, open_ms, seek_ms);
+        all_joined = all_joined && result.joined;
+        
+        if (result.joined) {
+            printf("restart=+%4ds recovery=%7.1fms seek-error=%+3lldms dark-without-join=%6.0fs\n",
+                   restart_seconds, result.recovery_ms, result.seek_error_ms, result.dark_without_join_s);
+        } else {
+            printf("restart=+%4ds NOT JOINED dark-without-join=%6.0fs\n",
+                   restart_seconds, result.dark_without_join_s);
+        }
+    }
+    
+    return all_joined ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+// Measures detecting the durations of the media files a schedule refers to.
+//
+// Writes the given number of small files and a day of items without a
+// duration spread over them, on a handful of sources. A stand-in for
+// libavformat sleeps for the given time per file, about what opening a file
+// and reading its stream info takes on a network share, and reads the
+// duration from the file's size. For each probe pool size, reports how long
+// the schedule took to publish, how long until every duration was published
+// after it, and the overlaps on a source that only show with the durations.
+// Then reports how long a restart takes to read the results back from the
+// persisted cache, and how many files it had to probe again.
+//
+// Usage: bench_media_probe [files] [items] [probe_ms]
+
+#include "media-probe.h"
+#include "playlist-manager.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using SteadyClock = std::chrono::steady_clock;
+
+static const char* DIRECTORY = "bench_media_probe";
+static const int SOURCES = 4;
+
+static double ms_since(SteadyClock::time_point start) {
+    return std::chrono::duration<double, std::milli>(SteadyClock::now() - start).count();
+}
+
+// One to ten minutes long, a second per byte
+static std::vector<std::string> write_files(size_t count) {
+    std::filesystem::remove_all(DIRECTORY);
+    std::filesystem::create_directories(DIRECTORY);
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < count; ++i) {
+        paths.push_back(std::string(DIRECTORY) + "/clip-" + std::to_string(i) + ".mp4");
+        std::ofstream(paths.back()) << std::string(60 * (1 + i % 10), 'x');
+    }
+    return paths;
+}
+
+static std::vector<Playlist> make_schedule(const std::vector<std::string>& files, size_t items) {
+    Playlist playlist;
+    playlist.name = "Day";
+    for (size_t i = 0; i < items; ++i) {
+        ScheduledItem item;
+        item.name = "Item " + std::to_string(i);
+        int32_t ms = static_cast<int32_t>(i * static_cast<int64_t>(ScheduleTimeline::MS_PER_DAY) / items);
+        item.time = ScheduleTimeline::format_time(ms / 1000 * 1000);
+        item.source = "Source " + std::to_string(i % SOURCES);
+        item.file_path = files[i % files.size()];
+        item.days = DaySet{"monday"};
+        playlist.items.push_back(item);
+    }
+    return {playlist};
+}
+
+static MediaProbe::ProbeFunction make_probe(std::chrono::microseconds delay, std::atomic<size_t>& probes) {
+    return [delay, &probes](const std::string& path, MediaInfo& info, std::string& error) {
+        std::this_thread::sleep_for(delay);
+        probes++;
+        SourceStamp stamp;
+        if (!ScheduleCache::stat_source(path, stamp)) {
+            error = "No such file";
+            return false;
+        }
+        info.duration_ms = static_cast<int64_t>(stamp.size) * 1000;
+        info.width = 1920;
+        info.height = 1080;
+        info.fps_num = 30;
+        info.fps_den = 1;
+        info.audio_channels = 2;
+        info.sample_rate = 48000;
+        return true;
+    };
+}
+
+static size_t count_detected(const PlaylistManager& manager) {
+    size_t detected = 0;
+    for (const auto& pair : manager.get_snapshot()->items) {
+        detected += pair.second->get_duration_ms() > 0;
+    }
+    return detected;
+}
+
+int main(int argc, char** argv) {
+    size_t file_count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 500;
+    size_t item_count = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 2000;
+    double probe_ms = argc > 3 ? std::strtod(argv[3], nullptr) : 5.0;
+    if (file_count == 0) {
+        file_count = 500;
+    }
+    if (item_count == 0) {
+        item_count = 2000;
+    }
+    if (probe_ms < 0) {
+        probe_ms = 5.0;
+    }
+    auto delay = std::chrono::microseconds(static_cast<int64_t>(probe_ms * 1000));
+    
+    auto files = write_files(file_count);
+    auto schedule = make_schedule(files, item_count);
+    printf("files=%zu items=%zu probe=%.1fms sources=%d\n", file_count, item_count, probe_ms, SOURCES);
+    
+    bool ok = true;
+    for (size_t threads : {1, 2, 4, 8}) {
+        std::filesystem::remove(std::string(DIRECTORY) + "/media-probe.bin");
+        std::atomic<size_t> probes{0};
+        auto probe = std::make_shared<MediaProbe>(DIRECTORY, threads);
+        probe->set_probe_function(make_probe(delay, probes));
+        
+        PlaylistManager manager;
+        manager.set_media_probe(probe);
+        auto start = SteadyClock::now();
+        manager.add_playlists("bench.json", schedule);
+        double publish_ms = ms_since(start);
+        size_t conflicts_before = manager.get_conflicts().size();
+        size_t detected_before = count_detected(manager);
+        
+        probe->wait_idle();
+        double detect_ms = ms_since(start);
+        size_t detected = count_detected(manager);
+        size_t conflicts = manager.get_conflicts().size();
+        
+        printf("%zu threads  published in %7.2fms (%zu durations known, %zu conflicts)  "
+               "all durations after %8.1fms (%zu probes, %zu known, %zu conflicts)\n",
+               threads, publish_ms, detected_before, conflicts_before, detect_ms, probes.load(), detected,
+               conflicts);
+        ok = ok && probes == file_count && detected == item_count && conflicts > conflicts_before;
+        manager.cleanup();
+    }
+    
+    // Restart: the cache written by the last run above is read back
+    std::atomic<size_t> probes{0};
+    auto probe = std::make_shared<MediaProbe>(DIRECTORY);
+    probe->set_probe_function(make_probe(delay, probes));
+    auto start = SteadyClock::now();
+    size_t loaded = probe->load();
+    double load_ms = ms_since(start);
+    
+    PlaylistManager manager;
+    manager.set_media_probe(probe);
+    start = SteadyClock::now();
+    manager.add_playlists("bench.json", schedule);
+    double publish_ms = ms_since(start);
+    probe->wait_idle();
+    size_t detected = count_detected(manager);
+    
+    printf("restart    cache of %zu files read in %.2fms, published in %.2fms with %zu of %zu durations, "
+           "%zu probes\n", loaded, load_ms, publish_ms, detected, item_count, probes.load());
+    ok = ok && loaded == file_count && detected == item_count && probes == 0;
+    manager.cleanup();
+    
+    std::filesystem::remove_all(DIRECTORY);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,171 @@
+// Measures how long an item takes to go on air after its trigger, with and
+// without pre-roll.
+//
+// One scene on the OBS mock holds two media sources, and items alternate
+// between them so the next one is always off air. A video thread renders at
+// 60 fps, and opening a file takes the given time on the mock, as demuxing
+// the first frames does in OBS. In the first run every item is loaded and
+// started at its trigger. In the second run each item is armed halfway
+// through the previous one, like the scheduler's pre-roll deadline, so its
+// trigger only reveals and unpauses it. Reports the start latency the
+// controller records for each item, from the trigger until the media clock
+// first advanced.
+//
+// Usage: bench_preroll_latency [items] [item_ms] [open_ms]
+
+#include "media-controller.h"
+#include "playlist-manager.h"
+#include "mocks/obs-mock.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+using SteadyClock = std::chrono::steady_clock;
+
+static const char* SOURCES[] = {"Player A", "Player B"};
+
+struct Summary {
+    size_t items = 0;
+    double median_ms = 0;
+    double p95_ms = 0;
+    double max_ms = 0;
+    size_t prerolled = 0;
+};
+
+// Renders frames at 60 fps until stopped; the controller samples start
+// latency from the tick
+class VideoThread {
+public:
+    VideoThread() : running_(true), thread_([this]() { run(); }) {}
+    
+    ~VideoThread() {
+        stop();
+    }
+    
+    void stop() {
+        running_ = false;
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+private:
+    void run() {
+        auto next = SteadyClock::now();
+        while (running_) {
+            obs_mock::tick();
+            next += std::chrono::microseconds(16667);
+            std::this_thread::sleep_until(next);
+        }
+    }
+    
+    std::atomic<bool> running_;
+    std::thread thread_;
+};
+
+static std::vector<ScheduledItem> make_items(size_t count) {
+    obs_mock::reset();
+    obs_mock::use_real_time();
+    obs_mock::create_scene("Program");
+    obs_mock::set_current_scene("Program");
+    for (const char* source : SOURCES) {
+        obs_mock::create_media_source(source);
+        obs_mock::add_to_scene("Program", source);
+    }
+    
+    std::vector<ScheduledItem> items;
+    for (size_t i = 0; i < count; ++i) {
+        ScheduledItem item;
+        item.id = "item-" + std::to_string(i);
+        item.name = item.id;
+        item.scene = "Program";
+        item.source = SOURCES[i % 2];
+        item.file_path = "/media/" + item.id + ".mp4";
+        items.push_back(item);
+    }
+    return items;
+}
+
+static double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+static Summary run(size_t count, std::chrono::milliseconds item_length, std::chrono::milliseconds open_delay,
+                   bool preroll) {
+    auto items = make_items(count);
+    obs_mock::set_media_latency(open_delay, std::chrono::milliseconds(0));
+    obs_mock::start_task_thread();
+    MediaController media;
+    media.initialize();
+    VideoThread video;
+    
+    auto preroll_lead = item_length / 2;
+    auto trigger = SteadyClock::now() + item_length;
+    for (const auto& item : items) {
+        if (preroll) {
+            std::this_thread::sleep_until(trigger - preroll_lead);
+            media.arm_item(item);
+        }
+        
+        std::this_thread::sleep_until(trigger);
+        media.execute_item_async(item);
+        trigger += item_length;
+    }
+    
+    // Let the last item reach its first frame
+    std::this_thread::sleep_until(trigger + open_delay * 2);
+    video.stop();
+    
+    Summary summary;
+    std::vector<double> latencies;
+    for (const auto& record : media.get_start_latency_records()) {
+        latencies.push_back(record.latency_ns / 1e6);
+        summary.prerolled += record.prerolled;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    summary.items = latencies.size();
+    summary.median_ms = percentile(latencies, 0.5);
+    summary.p95_ms = percentile(latencies, 0.95);
+    summary.max_ms = latencies.empty() ? 0 : latencies.back();
+    
+    media.cleanup();
+    obs_mock::stop_task_thread();
+    return summary;
+}
+
+static void report(const char* label, const Summary& summary) {
+    printf("%-8s trigger to first frame: median %.1f ms, p95 %.1f ms, max %.1f ms over %zu items (%zu pre-rolled)\n",
+           label, summary.median_ms, summary.p95_ms, summary.max_ms, summary.items, summary.prerolled);
+}
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 40;
+    long item_ms = argc > 2 ? std::strtol(argv[2], nullptr, 10) : 400;
+    long open_ms = argc > 3 ? std::strtol(argv[3], nullptr, 10) : 80;
+    if (count < 1) {
+        count = 40;
+    }
+    if (item_ms <= 0) {
+        item_ms = 400;
+    }
+    if (open_ms < 0) {
+        open_ms = 80;
+    }
+    
+    printf("items=%zu item=%ldms open=%ldms fps=60\n", count, item_ms, open_ms);
+    Summary cold = run(count, std::chrono::milliseconds(item_ms), std::chrono::milliseconds(open_ms), false);
+    Summary armed = run(count, std::chrono::milliseconds(item_ms), std::chrono::milliseconds(open_ms), true);
+    report("cold", cold);
+    report("preroll", armed);
+    
+    return armed.items == count && armed.median_ms < cold.median_ms ? 0 : 1;
+}
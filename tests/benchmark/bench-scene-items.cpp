@@ -0,0 +1,145 @@
+// Measures finding scene items by source name and changing their visibility
+// in large scenes.
+//
+// Builds one scene of 500, 1,000 ... items up to the given count on the OBS
+// mock and looks random sources up the way the controller used to (walking
+// the scene and comparing every item's source name) and through the
+// signal-driven index. Then shows and hides a group of items, one lookup and
+// one change at a time as before, and as one batch applied in a single
+// obs_scene_atomic_update, and reports the time and the libobs calls each
+// took.
+//
+// Usage: bench_scene_items [max_items] [batch]
+
+#include "scene-item-index.h"
+#include "mocks/obs-mock.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using SteadyClock = std::chrono::steady_clock;
+
+static constexpr size_t LOOKUPS = 20000;
+
+static double us_per_call(SteadyClock::time_point start, size_t calls) {
+    return std::chrono::duration<double, std::micro>(SteadyClock::now() - start).count() / calls;
+}
+
+// The lookup the controller did before the index, one walk over the scene
+static obs_sceneitem_t* walk_scene(obs_scene_t* scene, const std::string& source_name) {
+    std::pair<std::string, obs_sceneitem_t*> search_data(source_name, nullptr);
+    obs_scene_enum_items(scene, [](obs_scene_t*, obs_sceneitem_t* item, void* data) {
+        auto* search = static_cast<std::pair<std::string, obs_sceneitem_t*>*>(data);
+        obs_source_t* source = obs_sceneitem_get_source(item);
+        const char* name = source ? obs_source_get_name(source) : nullptr;
+        if (name && search->first == name) {
+            search->second = item;
+            obs_sceneitem_addref(item);
+            return false;
+        }
+        return true;
+    }, &search_data);
+    return search_data.second;
+}
+
+int main(int argc, char** argv) {
+    size_t max_items = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000;
+    size_t batch_size = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 32;
+    if (max_items < 500) {
+        max_items = 2000;
+    }
+    if (batch_size == 0) {
+        batch_size = 32;
+    }
+    
+    printf("lookups=%zu batch=%zu\n", LOOKUPS, batch_size);
+    bool ok = true;
+    for (size_t count = 500; count <= max_items; count *= 2) {
+        obs_mock::reset();
+        obs_mock::create_scene("Program");
+        std::vector<std::string> names;
+        for (size_t i = 0; i < count; ++i) {
+            names.push_back("Source " + std::to_string(i));
+            obs_mock::create_media_source(names.back());
+            obs_mock::add_to_scene("Program", names.back());
+        }
+        obs_source_t* scene_source = obs_get_source_by_name("Program");
+        obs_scene_t* scene = obs_scene_from_source(scene_source);
+        
+        std::mt19937 random(42);
+        std::uniform_int_distribution<size_t> pick(0, count - 1);
+        std::vector<size_t> picks(LOOKUPS);
+        for (auto& index : picks) {
+            index = pick(random);
+        }
+        
+        size_t found_walk = 0;
+        obs_mock::reset_call_count();
+        auto start = SteadyClock::now();
+        for (size_t index : picks) {
+            obs_sceneitem_t* item = walk_scene(scene, names[index]);
+            if (item) {
+                found_walk++;
+                obs_sceneitem_release(item);
+            }
+        }
+        double walk_us = us_per_call(start, LOOKUPS);
+        double walk_calls = static_cast<double>(obs_mock::get_call_count()) / LOOKUPS;
+        
+        SceneItemIndex index;
+        index.start();
+        start = SteadyClock::now();
+        index.find(scene, names[0]);
+        double build_us = us_per_call(start, 1);
+        
+        size_t found_index = 0;
+        obs_mock::reset_call_count();
+        start = SteadyClock::now();
+        for (size_t pick_index : picks) {
+            found_index += index.find(scene, names[pick_index]) != nullptr;
+        }
+        double index_us = us_per_call(start, LOOKUPS);
+        double index_calls = static_cast<double>(obs_mock::get_call_count()) / LOOKUPS;
+        
+        // Hide a spread of items one by one, then show them again as one batch
+        std::vector<SceneItemIndex::VisibilityChange> changes;
+        for (size_t i = 0; i < batch_size && i < count; ++i) {
+            changes.emplace_back(names[i * count / batch_size], true);
+        }
+        
+        obs_mock::reset_call_count();
+        start = SteadyClock::now();
+        for (const auto& change : changes) {
+            obs_sceneitem_t* item = walk_scene(scene, change.first);
+            obs_sceneitem_set_visible(item, false);
+            obs_sceneitem_release(item);
+        }
+        double one_by_one_us = us_per_call(start, 1);
+        size_t one_by_one_calls = obs_mock::get_call_count();
+        
+        size_t updates = obs_mock::get_atomic_update_count();
+        obs_mock::reset_call_count();
+        start = SteadyClock::now();
+        size_t applied = index.set_visible(scene, changes);
+        double batch_us = us_per_call(start, 1);
+        size_t batch_calls = obs_mock::get_call_count();
+        updates = obs_mock::get_atomic_update_count() - updates;
+        
+        printf("%5zu items  walk %8.2fus/lookup (%.0f calls)  index %6.3fus/lookup (%.0f calls, built in %.0fus)\n",
+               count, walk_us, walk_calls, index_us, index_calls, build_us);
+        printf("             %zu changes one by one %9.1fus (%zu calls, %zu updates)  batched %7.1fus (%zu calls, %zu update)\n",
+               changes.size(), one_by_one_us, one_by_one_calls, changes.size(), batch_us, batch_calls, updates);
+        
+        for (const auto& change : changes) {
+            ok = ok && obs_mock::is_visible("Program", change.first) && index.is_visible(scene, change.first);
+        }
+        ok = ok && found_walk == LOOKUPS && found_index == LOOKUPS && applied == changes.size() && updates == 1;
+        index.stop();
+        obs_source_release(scene_source);
+    }
+    return ok ? 0 : 1;
+}
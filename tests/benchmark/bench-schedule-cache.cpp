@@ -0,0 +1,172 @@
+// Compares cold and warm schedule loads.
+//
+// Writes a schedule in the format of sample-schedule.json of about the
+// given size, then reads it the way PlaylistManager does at startup: cold,
+// with no cache entry (parse the JSON, then write the entry), and warm, from
+// the entry the cold read left behind. Also reports mapping the entry on its
+// own and whole PlaylistManager loads (which add ids and the snapshot) both
+// ways.
+//
+// Usage: bench_schedule_cache [megabytes]
+
+#include "playlist-manager.h"
+#include "schedule-cache.h"
+#include "schedule-parser.h"
+#include "utils/mapped-file.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using SteadyClock = std::chrono::steady_clock;
+
+static constexpr size_t ITEMS_PER_PLAYLIST = 1000;
+static constexpr int RUNS = 3;
+
+static size_t write_schedule(const std::string& path, size_t target_bytes) {
+    static const char* day_sets[] = {
+        R"("monday", "tuesday", "wednesday", "thursday", "friday")",
+        R"("saturday", "sunday")",
+        R"("monday", "wednesday", "friday")"
+    };
+    
+    std::ofstream file(path, std::ios::binary);
+    file << "{\n  \"version\": \"1.0\",\n  \"timezone\": \"America/New_York\",\n"
+         << "  \"default_idle\": \"idle_video.mp4\",\n  \"playlists\": [\n";
+    
+    size_t items = 0;
+    for (size_t p = 0; static_cast<size_t>(file.tellp()) < target_bytes; ++p) {
+        file << (p ? ",\n" : "") << "    {\n      \"name\": \"Playlist " << p << "\",\n"
+             << "      \"enabled\": true,\n      \"days\": [" << day_sets[p % 3] << "],\n"
+             << "      \"items\": [\n";
+        
+        for (size_t i = 0; i < ITEMS_PER_PLAYLIST; ++i, ++items) {
+            char time[8];
+            snprintf(time, sizeof(time), "%02zu:%02zu", (items / 60) % 24, items % 60);
+            file << (i ? ",\n" : "") << "        {\n"
+                 << "          \"name\": \"Segment " << items << "\",\n"
+                 << "          \"time\": \"" << time << "\",\n"
+                 << "          \"source\": \"Source_" << items % 16 << "\",\n"
+                 << "          \"file\": \"C:\\\\videos\\\\segment_" << items << ".mp4\",\n"
+                 << "          \"duration\": " << (items % 3600) << ",\n"
+                 << "          \"loop\": " << (items % 7 == 0 ? "true" : "false") << ",\n"
+                 << "          \"scene\": \"Scene_" << items % 8 << "\"\n"
+                 << "        }";
+        }
+        file << "\n      ]\n    }";
+    }
+    file << "\n  ]\n}\n";
+    
+    return items;
+}
+
+static double elapsed_ms(SteadyClock::time_point start) {
+    return std::chrono::duration<double, std::milli>(SteadyClock::now() - start).count();
+}
+
+static size_t count_items(const ParsedSchedule& schedule) {
+    size_t items = 0;
+    for (const auto& playlist : schedule.playlists) {
+        items += playlist.items.size();
+    }
+    return items;
+}
+
+int main(int argc, char** argv) {
+    size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100;
+    if (megabytes == 0) {
+        megabytes = 100;
+    }
+    
+    auto temp = std::filesystem::temp_directory_path();
+    std::string path = (temp / "bench-schedule-cache.json").string();
+    std::string cache_directory = (temp / "bench-schedule-cache").string();
+    std::filesystem::remove_all(cache_directory);
+    
+    size_t items = write_schedule(path, megabytes * 1024 * 1024);
+    double file_mb = static_cast<double>(std::filesystem::file_size(path)) / (1024.0 * 1024.0);
+    
+    // Let the source age past the cache's racy window, as it would between two starts
+    std::filesystem::last_write_time(path, std::filesystem::last_write_time(path) - std::chrono::hours(1));
+    
+    ScheduleCache cache(cache_directory);
+    printf("file=%.1fMB items=%zu\n", file_mb, items);
+    
+    bool ok = true;
+    double cold_best = 0.0;
+    double store_best = 0.0;
+    for (int run = 0; run < RUNS && ok; ++run) {
+        cache.remove(path);
+        
+        auto start = SteadyClock::now();
+        SourceStamp stamp;
+        ScheduleCache::stat_source(path, stamp);
+        ScheduleParser parser;
+        ParsedSchedule schedule;
+        ok = parser.parse_file(path, schedule);
+        auto store_start = SteadyClock::now();
+        ok = ok && cache.store(path, stamp, schedule);
+        double store_ms = elapsed_ms(store_start);
+        double ms = elapsed_ms(start);
+        
+        if (!ok || count_items(schedule) != items) {
+            printf("cold read failed: %s\n", parser.get_error().c_str());
+            ok = false;
+            break;
+        }
+        cold_best = run == 0 ? ms : std::min(cold_best, ms);
+        store_best = run == 0 ? store_ms : std::min(store_best, store_ms);
+    }
+    
+    double warm_best = 0.0;
+    double map_best = 0.0;
+    for (int run = 0; run < RUNS && ok; ++run) {
+        auto map_start = SteadyClock::now();
+        MappedFile entry;
+        ok = entry.open(cache.get_entry_path(path));
+        volatile char first = ok ? entry.data()[0] : 0;
+        (void)first;
+        double map_ms = elapsed_ms(map_start);
+        entry.close();
+        
+        auto start = SteadyClock::now();
+        ParsedSchedule schedule;
+        ok = ok && cache.load(path, schedule);
+        double ms = elapsed_ms(start);
+        
+        if (!ok || count_items(schedule) != items) {
+            printf("warm read missed the cache\n");
+            ok = false;
+            break;
+        }
+        warm_best = run == 0 ? ms : std::min(warm_best, ms);
+        map_best = run == 0 ? map_ms : std::min(map_best, map_ms);
+    }
+    
+    if (ok) {
+        double entry_mb = static_cast<double>(std::filesystem::file_size(cache.get_entry_path(path))) / (1024.0 * 1024.0);
+        printf("cold    %8.1fms  (parse JSON, then %.1fms writing a %.1fMB entry)\n",
+               cold_best, store_best, entry_mb);
+        printf("warm    %8.1fms  (%.1fx faster)\n", warm_best, cold_best / warm_best);
+        printf("map     %8.3fms  (open and map the entry alone)\n", map_best);
+        
+        for (bool warm : {false, true}) {
+            if (!warm) {
+                cache.remove(path);
+            }
+            PlaylistManager manager;
+            manager.set_cache_directory(cache_directory);
+            auto start = SteadyClock::now();
+            ok = manager.load_schedule_file(path) && ok;
+            printf("%s %8.1fms  (PlaylistManager, with ids and snapshot of %zu items)\n",
+                   warm ? "load warm" : "load cold", elapsed_ms(start), manager.get_total_items());
+        }
+    }
+    
+    std::filesystem::remove(path);
+    std::filesystem::remove_all(cache_directory);
+    return ok ? 0 : 1;
+}
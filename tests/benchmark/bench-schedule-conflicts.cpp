@@ -0,0 +1,87 @@
+// Measures finding the overlaps of a schedule as its timeline is built.
+//
+// Spreads items over a number of playlists of differing priority, sharing a
+// few dozen sources, at random milliseconds with random durations (some unknown),
+// so that a good part of them collide. Builds the timeline, which finds and
+// settles every overlap per weekday, for growing item counts up to the
+// given one, and reports the time per item and what was found.
+//
+// Usage: bench_schedule_conflicts [max_items] [sources]
+
+#include "playlist-manager.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using SteadyClock = std::chrono::steady_clock;
+
+static constexpr size_t PLAYLISTS = 500;
+
+static std::vector<std::shared_ptr<const ScheduledItem>> make_items(size_t count, size_t sources) {
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int32_t> start_ms(0, ScheduleTimeline::MS_PER_DAY - 1);
+    std::uniform_int_distribution<int> duration(0, 3600);
+    std::uniform_int_distribution<size_t> source(0, sources - 1);
+    std::uniform_int_distribution<int> day_mask(1, 127);
+    
+    std::vector<std::shared_ptr<const ScheduledItem>> items;
+    items.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        auto item = std::make_shared<ScheduledItem>();
+        char id[16];
+        snprintf(id, sizeof(id), "%010zu", i);
+        
+        item->id = id;
+        item->name = "Item " + std::to_string(i);
+        item->time = ScheduleTimeline::format_time(start_ms(random));
+        item->source = "Source_" + std::to_string(source(random));
+        item->duration = i % 10 == 0 ? 0 : duration(random);
+        item->days = DaySet::from_mask(static_cast<uint8_t>(day_mask(random)));
+        item->playlist_priority = static_cast<int>((i % PLAYLISTS) % 5);
+        item->priority = static_cast<int>(i % 3);
+        items.push_back(std::move(item));
+    }
+    return items;
+}
+
+int main(int argc, char** argv) {
+    size_t max_items = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    size_t sources = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 64;
+    if (max_items == 0) {
+        max_items = 1000000;
+    }
+    if (sources == 0) {
+        sources = 64;
+    }
+    
+    printf("sources=%zu playlists=%zu\n", sources, PLAYLISTS);
+    bool ok = true;
+    for (size_t count = 10000; count <= max_items; count *= 10) {
+        auto items = make_items(count, sources);
+        
+        auto start = SteadyClock::now();
+        ScheduleTimeline timeline;
+        timeline.build(items);
+        double ms = std::chrono::duration<double, std::milli>(SteadyClock::now() - start).count();
+        
+        size_t entries = 0;
+        size_t fired = 0;
+        size_t dropped = 0;
+        for (int weekday = 0; weekday < ScheduleTimeline::DAYS_PER_WEEK; ++weekday) {
+            entries += timeline.get_entries(weekday).size();
+            for (const auto& slot : timeline.get_slots(weekday)) {
+                fired += slot.item_ids.size();
+            }
+            for (const auto& conflict : timeline.get_conflicts(weekday)) {
+                dropped += conflict.dropped;
+            }
+        }
+        printf("%8zu items  %9.2fms  (%.2fus/item; %zu entries, %zu overlaps, %zu dropped)\n",
+               count, ms, ms * 1000.0 / count, entries, timeline.get_conflict_count(), dropped);
+        ok = ok && timeline.get_item_count() == count && fired + dropped == entries;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,145 @@
+// Measures a startup load of many schedule files against the threads reading them.
+//
+// Writes the given number of schedule files (one show each), then loads all
+// of them into a fresh manager the way initialize() does, with 1, 2, 4 ...
+// threads up to one per core: parsed from JSON with no cache, and again
+// from a warm schedule cache. Reports the wall time, the speedup over one
+// thread, and the per-file read times the manager recorded. Loading and
+// publishing one file at a time is the baseline.
+//
+// Usage: bench_schedule_load [files] [items_per_file]
+
+#include "playlist-manager.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using SteadyClock = std::chrono::steady_clock;
+
+static constexpr int RUNS = 3;
+
+static void write_file(const std::string& path, size_t file, size_t items) {
+    static const char* day_sets[] = {
+        R"("monday", "tuesday", "wednesday", "thursday", "friday")",
+        R"("saturday", "sunday")",
+        R"("monday", "wednesday", "friday")"
+    };
+    
+    std::ofstream out(path, std::ios::binary);
+    out << "{\n  \"version\": \"1.0\",\n  \"playlists\": [\n    {\n"
+        << "      \"name\": \"Show " << file << "\",\n"
+        << "      \"days\": [" << day_sets[file % 3] << "],\n      \"items\": [\n";
+    
+    for (size_t i = 0; i < items; ++i) {
+        size_t minute = (file * 7 + i) % 1440;
+        char time[8];
+        snprintf(time, sizeof(time), "%02zu:%02zu", minute / 60, minute % 60);
+        out << (i ? ",\n" : "") << "        {\"name\": \"Segment " << file << "." << i << "\", "
+            << "\"time\": \"" << time << "\", \"source\": \"Source_" << i % 16 << "\", "
+            << "\"file\": \"segment_" << file << "_" << i << ".mp4\", \"duration\": " << (i % 3600) << "}";
+    }
+    out << "\n      ]\n    }\n  ]\n}\n";
+}
+
+struct LoadResult {
+    double wall_ms = 0.0;
+    double read_ms = 0.0;       // Sum of the per-file read times
+    double slowest_ms = 0.0;
+    size_t items = 0;
+};
+
+static LoadResult load(const std::vector<std::string>& paths, size_t threads, const std::string& cache) {
+    LoadResult best;
+    for (int run = 0; run < RUNS; ++run) {
+        PlaylistManager manager;
+        manager.set_cache_directory(cache);
+        manager.set_load_threads(threads);
+        
+        auto start = SteadyClock::now();
+        manager.reload_files(paths);
+        LoadResult result;
+        result.wall_ms = std::chrono::duration<double, std::milli>(SteadyClock::now() - start).count();
+        for (const auto& time : manager.get_load_times()) {
+            result.read_ms += time.read_us / 1000.0;
+            result.slowest_ms = std::max(result.slowest_ms, time.read_us / 1000.0);
+        }
+        result.items = manager.get_total_items();
+        if (run == 0 || result.wall_ms < best.wall_ms) {
+            best = result;
+        }
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    size_t files = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 500;
+    size_t items_per_file = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 200;
+    if (files == 0) {
+        files = 500;
+    }
+    if (items_per_file == 0) {
+        items_per_file = 200;
+    }
+    
+    auto directory = std::filesystem::temp_directory_path() / "bench-schedule-load";
+    auto cache = directory / "cache";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(cache);
+    
+    std::vector<std::string> paths;
+    for (size_t f = 0; f < files; ++f) {
+        paths.push_back((directory / ("show-" + std::to_string(f) + ".json")).string());
+        write_file(paths.back(), f, items_per_file);
+    }
+    
+    size_t cores = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    std::vector<size_t> thread_counts;
+    for (size_t threads = 1; threads < cores; threads *= 2) {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(cores);
+    
+    printf("files=%zu items=%zu cores=%zu\n", files, files * items_per_file, cores);
+    
+    // Baseline: a file at a time, each published on its own, as startup used to
+    double one_by_one_ms = 0.0;
+    for (int run = 0; run < RUNS; ++run) {
+        PlaylistManager manager;
+        manager.set_cache_directory("");
+        auto start = SteadyClock::now();
+        for (const auto& path : paths) {
+            manager.load_schedule_file(path);
+        }
+        double ms = std::chrono::duration<double, std::milli>(SteadyClock::now() - start).count();
+        one_by_one_ms = run == 0 ? ms : std::min(one_by_one_ms, ms);
+    }
+    printf("one file at a time     %9.2fms\n", one_by_one_ms);
+    
+    bool ok = true;
+    for (const char* mode : {"parsed", "cached"}) {
+        std::string cache_directory = std::string(mode) == "cached" ? cache.string() : "";
+        if (!cache_directory.empty()) {
+            load(paths, cores, cache_directory);     // Fills the cache
+        }
+        
+        double single_ms = 0.0;
+        for (size_t threads : thread_counts) {
+            LoadResult result = load(paths, threads, cache_directory);
+            if (threads == 1) {
+                single_ms = result.wall_ms;
+            }
+            printf("%s, %2zu thread(s)  %9.2fms  (%.1fx; files read in %.2fms total, slowest %.2fms)\n",
+                   mode, threads, result.wall_ms, single_ms / result.wall_ms, result.read_ms, result.slowest_ms);
+            ok = ok && result.items == files * items_per_file;
+        }
+    }
+    
+    std::filesystem::remove_all(directory);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,206 @@
+// Measures schedule lookups by time: the compiled week timeline against the
+// linear scans it replaced.
+//
+// A snapshot of 100, 10k and 1M items is built the way PlaylistManager
+// publishes one, items at random milliseconds of the day on random weekdays.
+// The same random (weekday, millisecond) queries are then answered both ways:
+//   for-time  items starting at T (PlaylistManager::get_items_for_time)
+//   on-air    items of the latest slot started at or before T
+//   after     the next 10 items after T (TimeTrigger::get_items_after_time)
+//   next      the next trigger time (TimeTrigger::get_next_trigger_time)
+// The old code walked the snapshot's item map, comparing day strings, or the
+// day's slot vector and copied the matches out; the timeline answers with
+// binary searches, handing back a run of its entries. Both answers are checked
+// against each other.
+//
+// Reported per item count: compile time, and ns per lookup old vs new.
+//
+// Usage: bench_schedule_lookup [queries]
+
+#include "playlist-manager.h"
+#include "schedule-timeline.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using SteadyClock = std::chrono::steady_clock;
+
+static const std::vector<std::string> DAY_NAMES = {
+    "sunday", "monday", "tuesday", "wednesday", "thursday", "friday", "saturday"
+};
+
+struct Query {
+    int weekday;
+    int32_t ms;
+    std::string time;
+};
+
+static std::shared_ptr<ScheduleSnapshot> make_snapshot(size_t count, std::mt19937& rng, double& compile_ms) {
+    auto snapshot = std::make_shared<ScheduleSnapshot>();
+    std::uniform_int_distribution<int32_t> start_ms(0, ScheduleTimeline::MS_PER_DAY - 1);
+    std::uniform_int_distribution<int> day_mask(1, 127);
+    
+    for (size_t i = 0; i < count; ++i) {
+        auto item = std::make_shared<ScheduledItem>();
+        item->id = "i" + std::to_string(i);
+        item->time = ScheduleTimeline::format_time(start_ms(rng));
+        item->days = DaySet::from_mask(static_cast<uint8_t>(day_mask(rng)));
+        snapshot->items[item->id] = item;
+    }
+    
+    // As in PlaylistManager::publish_snapshot
+    auto start = SteadyClock::now();
+    std::vector<std::shared_ptr<const ScheduledItem>> items;
+    items.reserve(snapshot->items.size());
+    for (const auto& pair : snapshot->items) {
+        items.push_back(pair.second);
+    }
+    snapshot->timeline.build(items);
+    compile_ms = std::chrono::duration<double, std::milli>(SteadyClock::now() - start).count();
+    
+    return snapshot;
+}
+
+// The scans as they were before the timeline
+static size_t old_for_time(const ScheduleSnapshot& snapshot, const std::string& time, const std::string& day) {
+    std::vector<std::shared_ptr<const ScheduledItem>> result;
+    for (const auto& pair : snapshot.items) {
+        const auto& item = pair.second;
+        bool day_match = item->days.contains(ScheduleTimeline::day_index(day));
+        if (day_match && item->time == time) {
+            result.push_back(item);
+        }
+    }
+    return result.size();
+}
+
+static size_t old_on_air(const std::vector<TimeSlot>& schedule, int32_t ms) {
+    const TimeSlot* current = nullptr;
+    for (const auto& slot : schedule) {
+        if (slot.to_ms() <= ms) {
+            current = &slot;
+        }
+    }
+    std::vector<std::string> result;
+    if (current) {
+        result = current->item_ids;
+    }
+    return result.size();
+}
+
+static size_t old_after(const std::vector<TimeSlot>& schedule, int32_t ms, size_t max_count) {
+    std::vector<std::string> result;
+    for (const auto& slot : schedule) {
+        if (slot.to_ms() > ms) {
+            result.insert(result.end(), slot.item_ids.begin(), slot.item_ids.end());
+            if (result.size() >= max_count) {
+                break;
+            }
+        }
+    }
+    return result.size();
+}
+
+static size_t old_next(const std::vector<TimeSlot>& schedule, int32_t ms) {
+    for (const auto& slot : schedule) {
+        if (slot.to_ms() > ms) {
+            return slot.to_ms();
+        }
+    }
+    return 0;   // Then it guessed tomorrow's first slot from today's
+}
+
+// Runs lookup over the first n queries, returns ns per query and a checksum of the answers
+static double measure(const std::vector<Query>& queries, size_t n, const std::function<size_t(const Query&)>& lookup,
+                      size_t& checksum) {
+    checksum = 0;
+    auto start = SteadyClock::now();
+    for (size_t i = 0; i < n; ++i) {
+        checksum += lookup(queries[i]);
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(SteadyClock::now() - start).count();
+    return elapsed / static_cast<double>(n);
+}
+
+int main(int argc, char** argv) {
+    size_t max_queries = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    if (max_queries == 0) {
+        max_queries = 100000;
+    }
+    
+    std::mt19937 rng(42);
+    std::vector<Query> queries(max_queries);
+    std::uniform_int_distribution<int> weekday(0, ScheduleTimeline::DAYS_PER_WEEK - 1);
+    std::uniform_int_distribution<int32_t> ms(0, ScheduleTimeline::MS_PER_DAY - 1);
+    for (auto& query : queries) {
+        query.weekday = weekday(rng);
+        query.ms = ms(rng);
+        query.time = ScheduleTimeline::format_time(query.ms);
+    }
+    
+    printf("queries<=%zu (the linear scans get fewer at large sizes)\n", max_queries);
+    
+    bool all_match = true;
+    for (size_t count : {100, 10000, 1000000}) {
+        double compile_ms = 0.0;
+        auto snapshot = make_snapshot(count, rng, compile_ms);
+        const auto& timeline = snapshot->timeline;
+        
+        // Old code scanned a full week's worth of items per query; keep its run time bounded
+        size_t old_queries = std::min(max_queries, std::max<size_t>(20, 20000000 / count));
+        
+        printf("items=%7zu compile=%8.2fms\n", count, compile_ms);
+        
+        struct Lookup {
+            const char* name;
+            std::function<size_t(const Query&)> old_way;
+            std::function<size_t(const Query&)> new_way;
+        };
+        std::vector<Lookup> lookups = {
+            {"for-time",
+             [&](const Query& q) { return old_for_time(*snapshot, q.time, DAY_NAMES[q.weekday]); },
+             [&](const Query& q) {
+                 return timeline.get_entries_at(ScheduleTimeline::day_index(DAY_NAMES[q.weekday]),
+                                                ScheduleTimeline::time_to_ms(q.time)).size();
+             }},
+            {"on-air",
+             [&](const Query& q) { return old_on_air(timeline.get_slots(q.weekday), q.ms); },
+             [&](const Query& q) { return timeline.get_entries_on_air(q.weekday, q.ms).size(); }},
+            {"after",
+             [&](const Query& q) { return old_after(timeline.get_slots(q.weekday), q.ms, 10); },
+             [&](const Query& q) { return timeline.get_entries_after(q.weekday, q.ms, 10).size(); }},
+            {"next",
+             [&](const Query& q) { return old_next(timeline.get_slots(q.weekday), q.ms); },
+             [&](const Query& q) {
+                 int32_t slot_ms = 0;
+                 int days_ahead = 0;
+                 timeline.get_next_trigger(q.weekday, q.ms, slot_ms, days_ahead);
+                 return days_ahead == 0 ? static_cast<size_t>(slot_ms) : size_t(0);
+             }},
+        };
+        
+        for (const auto& lookup : lookups) {
+            size_t old_sum = 0;
+            size_t new_sum = 0;
+            size_t check_sum = 0;
+            double old_ns = measure(queries, old_queries, lookup.old_way, old_sum);
+            double new_ns = measure(queries, max_queries, lookup.new_way, new_sum);
+            measure(queries, old_queries, lookup.new_way, check_sum);
+            
+            bool match = old_sum == check_sum;
+            all_match = all_match && match;
+            
+            printf("  %-8s old=%12.1fns new=%9.1fns speedup=%9.1fx%s\n", lookup.name, old_ns, new_ns,
+                   old_ns / new_ns, match ? "" : " MISMATCH");
+        }
+    }
+    
+    return all_match ? 0 : 1;
+}
@@ -0,0 +1,115 @@
+// Measures schedule file parsing throughput.
+//
+// Writes a schedule in the format of sample-schedule.json (pretty-printed the
+// same way) of about the given size to a temporary file, then streams it
+// through ScheduleParser a few times and reports the best run. The reader
+// holds one buffer of the given size however large the file is. A last run
+// loads the file through PlaylistManager, which adds assigning ids and
+// publishing the schedule snapshot.
+//
+// Usage: bench_schedule_parse [megabytes] [buffer_kb]
+
+#include "playlist-manager.h"
+#include "schedule-parser.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using SteadyClock = std::chrono::steady_clock;
+
+static constexpr size_t ITEMS_PER_PLAYLIST = 1000;
+
+static size_t write_schedule(const std::string& path, size_t target_bytes) {
+    static const char* day_sets[] = {
+        R"("monday", "tuesday", "wednesday", "thursday", "friday")",
+        R"("saturday", "sunday")",
+        R"("monday", "wednesday", "friday")"
+    };
+    
+    std::ofstream file(path, std::ios::binary);
+    file << "{\n  \"version\": \"1.0\",\n  \"timezone\": \"America/New_York\",\n"
+         << "  \"default_idle\": \"idle_video.mp4\",\n  \"playlists\": [\n";
+    
+    size_t items = 0;
+    for (size_t p = 0; static_cast<size_t>(file.tellp()) < target_bytes; ++p) {
+        file << (p ? ",\n" : "") << "    {\n      \"name\": \"Playlist " << p << "\",\n"
+             << "      \"enabled\": true,\n      \"days\": [" << day_sets[p % 3] << "],\n"
+             << "      \"items\": [\n";
+        
+        for (size_t i = 0; i < ITEMS_PER_PLAYLIST; ++i, ++items) {
+            char time[8];
+            snprintf(time, sizeof(time), "%02zu:%02zu", (items / 60) % 24, items % 60);
+            file << (i ? ",\n" : "") << "        {\n"
+                 << "          \"name\": \"Segment " << items << "\",\n"
+                 << "          \"time\": \"" << time << "\",\n"
+                 << "          \"source\": \"Source_" << items % 16 << "\",\n"
+                 << "          \"file\": \"C:\\\\videos\\\\segment_" << items << ".mp4\",\n"
+                 << "          \"duration\": " << (items % 3600) << ",\n"
+                 << "          \"loop\": " << (items % 7 == 0 ? "true" : "false") << ",\n"
+                 << "          \"scene\": \"Scene_" << items % 8 << "\"\n"
+                 << "        }";
+        }
+        file << "\n      ]\n    }";
+    }
+    file << "\n  ]\n}\n";
+    
+    return items;
+}
+
+int main(int argc, char** argv) {
+    size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100;
+    size_t buffer_kb = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : JsonReader::DEFAULT_BUFFER_SIZE / 1024;
+    if (megabytes == 0) {
+        megabytes = 100;
+    }
+    if (buffer_kb == 0) {
+        buffer_kb = JsonReader::DEFAULT_BUFFER_SIZE / 1024;
+    }
+    
+    std::string path = (std::filesystem::temp_directory_path() / "bench-schedule-parse.json").string();
+    size_t items = write_schedule(path, megabytes * 1024 * 1024);
+    double file_mb = static_cast<double>(std::filesystem::file_size(path)) / (1024.0 * 1024.0);
+    
+    printf("file=%.1fMB items=%zu buffer=%zuKB\n", file_mb, items, buffer_kb);
+    
+    bool ok = true;
+    double best_ms = 0.0;
+    for (int run = 0; run < 3 && ok; ++run) {
+        ScheduleParser parser(buffer_kb * 1024);
+        ParsedSchedule schedule;
+        
+        auto start = SteadyClock::now();
+        ok = parser.parse_file(path, schedule);
+        double ms = std::chrono::duration<double, std::milli>(SteadyClock::now() - start).count();
+        
+        size_t parsed = 0;
+        for (const auto& playlist : schedule.playlists) {
+            parsed += playlist.items.size();
+        }
+        if (!ok || parsed != items) {
+            printf("parse failed: %s (%zu of %zu items)\n", parser.get_error().c_str(), parsed, items);
+            ok = false;
+            break;
+        }
+        
+        best_ms = run == 0 ? ms : std::min(best_ms, ms);
+    }
+    
+    if (ok) {
+        printf("parse   %8.1fms %8.1fMB/s %8.2fM items/s\n", best_ms, file_mb / (best_ms / 1000.0),
+               static_cast<double>(items) / (best_ms * 1000.0));
+        
+        PlaylistManager manager;
+        auto start = SteadyClock::now();
+        ok = manager.load_schedule_file(path);
+        double ms = std::chrono::duration<double, std::milli>(SteadyClock::now() - start).count();
+        printf("load    %8.1fms (parse, ids and snapshot of %zu items)\n", ms, manager.get_total_items());
+    }
+    
+    std::filesystem::remove(path);
+    return ok ? 0 : 1;
+}
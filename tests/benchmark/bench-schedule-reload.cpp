@@ -0,0 +1,144 @@
+// Measures incremental schedule reloads against a full one.
+//
+// Writes the given number of schedule files, loads them all, then moves k
+// items (spread over as many files as possible) a minute later and times
+// the reload that picks the change up: which files changed, which items,
+// and publishing a snapshot with the timeline patched. k runs from none to
+// every item; a full load of every file into a fresh manager is the
+// baseline.
+//
+// Usage: bench_schedule_reload [files] [items_per_file]
+
+#include "playlist-manager.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <string>
+#include <vector>
+
+using SteadyClock = std::chrono::steady_clock;
+
+static constexpr int RUNS = 3;
+
+static double elapsed_ms(SteadyClock::time_point start) {
+    return std::chrono::duration<double, std::milli>(SteadyClock::now() - start).count();
+}
+
+// Item i of the file starts at minute i, or a minute later when shifted
+static void write_file(const std::string& path, size_t file, size_t items, const std::set<size_t>& shifted) {
+    static const char* day_sets[] = {
+        R"("monday", "tuesday", "wednesday", "thursday", "friday")",
+        R"("saturday", "sunday")",
+        R"("monday", "wednesday", "friday")"
+    };
+    
+    std::ofstream out(path, std::ios::binary);
+    out << "{\n  \"version\": \"1.0\",\n  \"playlists\": [\n    {\n"
+        << "      \"name\": \"Playlist " << file << "\",\n"
+        << "      \"days\": [" << day_sets[file % 3] << "],\n      \"items\": [\n";
+    
+    for (size_t i = 0; i < items; ++i) {
+        size_t minute = (file * 7 + i + (shifted.count(i) ? 1 : 0)) % 1440;
+        char time[8];
+        snprintf(time, sizeof(time), "%02zu:%02zu", minute / 60, minute % 60);
+        out << (i ? ",\n" : "") << "        {\"name\": \"Segment " << file << "." << i << "\", "
+            << "\"time\": \"" << time << "\", \"source\": \"Source_" << i % 16 << "\", "
+            << "\"file\": \"segment_" << file << "_" << i << ".mp4\", \"duration\": " << (i % 3600) << "}";
+    }
+    out << "\n      ]\n    }\n  ]\n}\n";
+}
+
+int main(int argc, char** argv) {
+    size_t files = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100;
+    size_t items_per_file = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1000;
+    if (files == 0) {
+        files = 100;
+    }
+    if (items_per_file == 0) {
+        items_per_file = 1000;
+    }
+    size_t total = files * items_per_file;
+    
+    auto directory = std::filesystem::temp_directory_path() / "bench-schedule-reload";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    
+    std::vector<std::string> paths;
+    for (size_t f = 0; f < files; ++f) {
+        paths.push_back((directory / ("schedule-" + std::to_string(f) + ".json")).string());
+        write_file(paths.back(), f, items_per_file, {});
+    }
+    
+    // Baseline: every file parsed and the whole snapshot built
+    double full_best = 0.0;
+    for (int run = 0; run < RUNS; ++run) {
+        PlaylistManager manager;
+        manager.set_cache_directory("");
+        auto start = SteadyClock::now();
+        manager.reload_files(paths);
+        double ms = elapsed_ms(start);
+        full_best = run == 0 ? ms : std::min(full_best, ms);
+    }
+    printf("files=%zu items=%zu\n", files, total);
+    printf("full reload        %9.2fms\n", full_best);
+    
+    PlaylistManager manager;
+    manager.set_cache_directory("");
+    manager.reload_files(paths);
+    
+    bool ok = manager.get_total_items() == total;
+    std::vector<size_t> counts = {0, 1, 10, 100, 1000, 10000, total};
+    for (size_t k : counts) {
+        if (k > total) {
+            continue;
+        }
+        
+        // Round-robin over the files, evenly spaced within each
+        std::vector<std::set<size_t>> shifted(files);
+        size_t per_file = (k + files - 1) / files;
+        size_t stride = per_file ? std::max<size_t>(items_per_file / per_file, 1) : 1;
+        for (size_t n = 0; n < k; ++n) {
+            shifted[n % files].insert((n / files) * stride);
+        }
+        
+        double best = 0.0;
+        size_t retimed = 0;
+        size_t changed_files = 0;
+        for (int run = 0; run < RUNS && ok; ++run) {
+            for (size_t f = 0; f < files; ++f) {
+                if (!shifted[f].empty()) {
+                    write_file(paths[f], f, items_per_file, shifted[f]);
+                    changed_files += run == 0;
+                }
+            }
+            
+            auto start = SteadyClock::now();
+            manager.reload_files(paths);
+            double ms = elapsed_ms(start);
+            best = run == 0 ? ms : std::min(best, ms);
+            retimed = manager.get_snapshot()->changes.retimed.size();
+            if (k > 0 && retimed != k) {
+                printf("reload of %zu items saw %zu retimed\n", k, retimed);
+                ok = false;
+            }
+            
+            // Back to the original schedule, untimed
+            for (size_t f = 0; f < files; ++f) {
+                if (!shifted[f].empty()) {
+                    write_file(paths[f], f, items_per_file, {});
+                }
+            }
+            manager.reload_files(paths);
+        }
+        
+        printf("%7zu retimed   %9.2fms  (%zu of %zu files changed, %.1fx faster than full)\n",
+               k, best, changed_files, files, full_best / best);
+    }
+    
+    std::filesystem::remove_all(directory);
+    return ok ? 0 : 1;
+}
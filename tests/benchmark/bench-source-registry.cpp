@@ -0,0 +1,150 @@
+// Measures resolving sources by name with a collection of a few thousand.
+//
+// Fills the OBS mock with the given number of sources (every tenth a scene)
+// and looks random names up, known and unknown, three ways: asking libobs
+// each time (obs_get_source_by_name, the type check and the release, which
+// the controller did on every cache miss), the std::map of raw pointers the
+// controller kept before, and the signal-driven registry. Then renames and
+// removes a share of the sources, reporting the time per change (the mock's
+// own linear search included), and checks that no lookup finds a stale name
+// afterwards.
+//
+// Usage: bench_source_registry [sources] [lookups]
+
+#include "source-registry.h"
+#include "mocks/obs-mock.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using SteadyClock = std::chrono::steady_clock;
+
+static std::string source_name(size_t index) {
+    return (index % 10 == 0 ? "Scene " : "Media ") + std::to_string(index);
+}
+
+static double ns_per_call(SteadyClock::time_point start, size_t calls) {
+    return std::chrono::duration<double, std::nano>(SteadyClock::now() - start).count() / calls;
+}
+
+static obs_source_t* ask_obs(const std::string& name) {
+    obs_source_t* source = obs_get_source_by_name(name.c_str());
+    if (!source) {
+        return nullptr;
+    }
+    const char* source_id = obs_source_get_id(source);
+    bool media = source_id && strcmp(source_id, "ffmpeg_source") == 0;
+    obs_source_release(source);
+    return media ? source : nullptr;
+}
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000;
+    size_t lookups = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1000000;
+    if (count == 0) {
+        count = 2000;
+    }
+    if (lookups == 0) {
+        lookups = 1000000;
+    }
+    
+    obs_mock::reset();
+    for (size_t i = 0; i < count; ++i) {
+        if (i % 10 == 0) {
+            obs_mock::create_scene(source_name(i));
+        } else {
+            obs_mock::create_media_source(source_name(i));
+        }
+    }
+    
+    // A known name three times in four, in random order
+    std::mt19937 random(42);
+    std::uniform_int_distribution<size_t> pick(0, count * 4 / 3);
+    std::vector<std::string> names;
+    names.reserve(4096);
+    for (size_t i = 0; i < 4096; ++i) {
+        size_t index = pick(random);
+        names.push_back(index < count ? source_name(index) : "Missing " + std::to_string(index));
+    }
+    
+    auto start = SteadyClock::now();
+    SourceRegistry registry;
+    registry.start();
+    printf("sources=%zu lookups=%zu (listed in %.2fms)\n", count, lookups,
+           std::chrono::duration<double, std::milli>(SteadyClock::now() - start).count());
+    
+    // The old cache only ever held names that had been found
+    std::map<std::string, obs_source_t*> cache;
+    for (size_t i = 0; i < count; ++i) {
+        if (i % 10 != 0) {
+            cache[source_name(i)] = registry.find(source_name(i), SourceRegistry::Kind::Media);
+        }
+    }
+    
+    size_t found_obs = 0;
+    start = SteadyClock::now();
+    for (size_t i = 0; i < lookups; ++i) {
+        found_obs += ask_obs(names[i % names.size()]) != nullptr;
+    }
+    double obs_ns = ns_per_call(start, lookups);
+    
+    size_t found_cache = 0;
+    start = SteadyClock::now();
+    for (size_t i = 0; i < lookups; ++i) {
+        auto it = cache.find(names[i % names.size()]);
+        found_cache += it != cache.end() ? 1 : ask_obs(names[i % names.size()]) != nullptr;
+    }
+    double cache_ns = ns_per_call(start, lookups);
+    
+    size_t found_registry = 0;
+    start = SteadyClock::now();
+    for (size_t i = 0; i < lookups; ++i) {
+        found_registry += registry.find(names[i % names.size()], SourceRegistry::Kind::Media) != nullptr;
+    }
+    double registry_ns = ns_per_call(start, lookups);
+    
+    printf("obs_get_source_by_name %9.1fns/lookup  (%zu of %zu found)\n", obs_ns, found_obs, lookups);
+    printf("map cache              %9.1fns/lookup  (%zu of %zu found)\n", cache_ns, found_cache, lookups);
+    printf("registry               %9.1fns/lookup  (%zu of %zu found)\n", registry_ns, found_registry, lookups);
+    
+    // Rename every fourth media source and remove every seventh
+    size_t renamed = 0;
+    start = SteadyClock::now();
+    for (size_t i = 1; i < count; i += 4) {
+        if (i % 10 != 0) {
+            renamed += obs_mock::rename_source(source_name(i), "Renamed " + std::to_string(i));
+        }
+    }
+    double rename_ns = ns_per_call(start, renamed ? renamed : 1);
+    
+    size_t removed = 0;
+    start = SteadyClock::now();
+    for (size_t i = 3; i < count; i += 7) {
+        if (i % 10 != 0 && (i - 1) % 4 != 0) {
+            removed += obs_mock::remove_source(source_name(i));
+        }
+    }
+    double remove_ns = ns_per_call(start, removed ? removed : 1);
+    
+    printf("rename                 %9.1fns/signal  (%zu renamed)\n", rename_ns, renamed);
+    printf("remove                 %9.1fns/signal  (%zu removed)\n", remove_ns, removed);
+    
+    // Every lookup has to agree with what libobs has now
+    size_t stale = 0;
+    for (size_t i = 0; i < count; ++i) {
+        for (const auto& name : {source_name(i), "Renamed " + std::to_string(i)}) {
+            stale += registry.find(name, SourceRegistry::Kind::Media) != ask_obs(name);
+        }
+    }
+    printf("stale lookups after changes: %zu, %zu sources listed\n", stale, registry.size());
+    
+    bool ok = stale == 0 && found_registry == found_obs && found_cache == found_obs &&
+              registry.size() == count - removed;
+    registry.stop();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,203 @@
+// Measures how long status readers wait while the scheduler is executing items.
+//
+// A writer thread keeps switching items on a channel whose OBS calls are made
+// slow by the mock (as a scene switch waiting on the graphics thread would be),
+// while a busy reader thread polls the status as fast as it can. Two variants:
+//
+//   locked   - the previous scheme: one mutex guards the status strings and is
+//              held across synchronous OBS calls, readers take the same mutex
+//   snapshot - Channel::get_status(), which loads the published snapshot, with
+//              the OBS calls running on the mock UI thread
+//
+// Usage: bench_status_snapshot [seconds] [obs_call_delay_us]
+
+#include "channel.h"
+#include "frame-trigger.h"
+#include "media-controller.h"
+#include "playlist-manager.h"
+#include "utils/deadline-queue.h"
+#include "mocks/obs-mock.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using SteadyClock = std::chrono::steady_clock;
+
+struct ReadResult {
+    std::vector<double> read_us;
+    size_t writes = 0;
+};
+
+// The status handling SchedulerCore had before snapshots were published
+struct LockedStatus {
+    std::mutex mutex;
+    std::string current_item;
+    std::string next_item;
+    std::string armed_item;
+};
+
+static std::unique_ptr<Channel> make_channel(std::vector<std::string>& item_ids) {
+    obs_mock::reset();
+    obs_mock::create_scene("Program");
+    obs_mock::set_current_scene("Program");
+    obs_mock::create_media_source("source-a");
+    obs_mock::create_media_source("source-b");
+    obs_mock::add_to_scene("Program", "source-a");
+    obs_mock::add_to_scene("Program", "source-b");
+    
+    auto channel = std::make_unique<Channel>("main", 0);
+    channel->initialize();
+    
+    Playlist playlist;
+    playlist.name = "bench";
+    for (int i = 0; i < 2; ++i) {
+        ScheduledItem item;
+        item.name = "item-" + std::to_string(i);
+        item.time = "00:0" + std::to_string(i);
+        item.source = i == 0 ? "source-a" : "source-b";
+        item.file_path = "/media/" + item.name + ".mp4";
+        playlist.items.push_back(item);
+    }
+    channel->get_playlist_manager()->add_playlist("bench.json", playlist);
+    
+    for (const auto& stored : channel->get_playlist_manager()->get_playlists()) {
+        for (const auto& item : stored.items) {
+            item_ids.push_back(item.id);
+        }
+    }
+    return channel;
+}
+
+template <typename Read>
+static void read_until(const std::atomic<bool>& done, ReadResult& result, Read read) {
+    while (!done) {
+        auto start = SteadyClock::now();
+        read();
+        result.read_us.push_back(
+            std::chrono::duration<double, std::micro>(SteadyClock::now() - start).count());
+    }
+}
+
+static ReadResult run_locked(std::chrono::milliseconds duration, std::chrono::microseconds delay) {
+    std::vector<std::string> item_ids;
+    auto channel = make_channel(item_ids);
+    obs_mock::set_call_delay(delay);
+    
+    LockedStatus status;
+    std::atomic<bool> done{false};
+    ReadResult result;
+    
+    std::thread writer([&] {
+        auto* playlists = channel->get_playlist_manager();
+        auto* media = channel->get_media_controller();
+        for (size_t n = 0; !done; ++n) {
+            std::lock_guard<std::mutex> lock(status.mutex);
+            auto item = playlists->get_item(item_ids[n % item_ids.size()]);
+            media->set_source_visibility(item->source, true);
+            media->play_media(item->source, item->file_path);
+            status.current_item = item->id;
+            status.next_item = item_ids[(n + 1) % item_ids.size()];
+            result.writes++;
+        }
+    });
+    
+    std::thread reader([&] {
+        read_until(done, result, [&] {
+            std::lock_guard<std::mutex> lock(status.mutex);
+            std::string current = status.current_item;
+            std::string next = status.next_item;
+        });
+    });
+    
+    std::this_thread::sleep_for(duration);
+    done = true;
+    writer.join();
+    reader.join();
+    return result;
+}
+
+static ReadResult run_snapshot(std::chrono::milliseconds duration, std::chrono::microseconds delay) {
+    std::vector<std::string> item_ids;
+    auto channel = make_channel(item_ids);
+    obs_mock::set_call_delay(delay);
+    
+    FrameTrigger frame_trigger;
+    std::atomic<bool> done{false};
+    ReadResult result;
+    obs_mock::start_task_thread();
+    
+    std::thread writer([&] {
+        for (size_t n = 0; !done; ++n) {
+            Deadline deadline;
+            deadline.item_ids.push_back(item_ids[n % item_ids.size()]);
+            channel->handle_deadline(deadline, frame_trigger);
+            result.writes++;
+            
+            // Pace the writer to the OBS side like the locked variant is
+            while (!done && channel->get_command_queue_stats().depth > 0) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    
+    std::thread reader([&] {
+        read_until(done, result, [&] {
+            ChannelStatus status = channel->get_status();
+        });
+    });
+    
+    std::this_thread::sleep_for(duration);
+    done = true;
+    writer.join();
+    reader.join();
+    obs_mock::stop_task_thread();
+    return result;
+}
+
+static double percentile(std::vector<double> values, double p) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t index = static_cast<size_t>(p * (values.size() - 1));
+    return values[index];
+}
+
+static void report(const char* name, const ReadResult& result, std::chrono::milliseconds duration) {
+    // Reads that had to wait out (part of) an OBS call
+    size_t stalled = std::count_if(result.read_us.begin(), result.read_us.end(),
+                                   [](double us) { return us > 100.0; });
+    double stalled_ms = 0.0;
+    for (double us : result.read_us) {
+        if (us > 100.0) {
+            stalled_ms += us / 1000.0;
+        }
+    }
+    
+    printf("%-9s reads/s=%10.0f switches=%5zu read p50=%7.3fus p99=%7.3fus max=%10.3fus "
+           "stalls>100us=%5zu stalled=%8.1fms\n",
+           name, result.read_us.size() * 1000.0 / duration.count(), result.writes,
+           percentile(result.read_us, 0.50), percentile(result.read_us, 0.99),
+           percentile(result.read_us, 1.0), stalled, stalled_ms);
+}
+
+int main(int argc, char** argv) {
+    int seconds = argc > 1 ? std::atoi(argv[1]) : 2;
+    int delay_us = argc > 2 ? std::atoi(argv[2]) : 200;
+    if (seconds < 1) {
+        seconds = 1;
+    }
+    const auto duration = std::chrono::milliseconds(seconds * 1000);
+    const auto delay = std::chrono::microseconds(std::max(delay_us, 0));
+    
+    report("locked", run_locked(duration, delay), duration);
+    report("snapshot", run_snapshot(duration, delay), duration);
+    
+    return 0;
+}
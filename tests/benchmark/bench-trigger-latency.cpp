@@ -0,0 +1,189 @@
+// Measures how late scheduled items actually start, stage by stage, under load.
+//
+// 1, 8 and 32 channels are built against the in-memory OBS mock, with every
+// OBS call slowed down by the given delay (as calls waiting on the graphics
+// thread would be). All channels trigger a new item on the same instants, so
+// their batches queue up behind each other on the mock UI thread, while a
+// video thread renders at 60 fps. The deadlines are waited on with the real
+// DeadlineQueue and clock, and each trigger goes through Channel and
+// MediaController as in the plugin.
+//
+// Reported per channel count, from the per-source histograms merged: the
+// wakeup (scheduled instant -> scheduler awake), dispatch (-> OBS calls
+// issued), start (-> media playing) and total stages as p50/p99/p99.9/max.
+//
+// Usage: bench_trigger_latency [rounds] [interval_ms] [obs_call_delay_us]
+
+#include "channel.h"
+#include "frame-trigger.h"
+#include "media-controller.h"
+#include "playlist-manager.h"
+#include "utils/deadline-queue.h"
+#include "utils/latency-histogram.h"
+#include "mocks/obs-mock.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using SteadyClock = std::chrono::steady_clock;
+
+static constexpr size_t ITEMS_PER_CHANNEL = 8;
+static constexpr size_t SOURCES_PER_CHANNEL = 2;
+
+static std::vector<std::unique_ptr<Channel>> make_channels(size_t count) {
+    obs_mock::reset();
+    obs_mock::create_scene("Program");
+    obs_mock::set_current_scene("Program");
+    
+    std::vector<std::unique_ptr<Channel>> channels;
+    for (size_t c = 0; c < count; ++c) {
+        std::string name = "channel-" + std::to_string(c);
+        
+        for (size_t s = 0; s < SOURCES_PER_CHANNEL; ++s) {
+            std::string source = name + "-source-" + std::to_string(s);
+            obs_mock::create_media_source(source);
+            obs_mock::add_to_scene("Program", source);
+        }
+        
+        auto channel = std::make_unique<Channel>(name, c);
+        channel->initialize();
+        
+        Playlist playlist;
+        playlist.name = name;
+        for (size_t i = 0; i < ITEMS_PER_CHANNEL; ++i) {
+            ScheduledItem item;
+            item.name = name + "-item-" + std::to_string(i);
+            char time[8];
+            snprintf(time, sizeof(time), "%02zu:%02zu", i / 60, i % 60);
+            item.time = time;
+            item.source = name + "-source-" + std::to_string(i % SOURCES_PER_CHANNEL);
+            item.file_path = "/media/" + item.name + ".mp4";
+            playlist.items.push_back(item);
+        }
+        channel->get_playlist_manager()->add_playlist(name + ".json", playlist);
+        
+        channels.push_back(std::move(channel));
+    }
+    
+    return channels;
+}
+
+static StageHistograms run(size_t channel_count, size_t rounds, std::chrono::milliseconds interval,
+                           std::chrono::microseconds call_delay) {
+    auto channels = make_channels(channel_count);
+    obs_mock::set_call_delay(call_delay);
+    FrameTrigger frame_trigger;
+    
+    // Every channel switches to its next item on the same instants
+    DeadlineQueue deadlines;
+    const auto start = SteadyClock::now() + std::chrono::milliseconds(100);
+    for (size_t c = 0; c < channels.size(); ++c) {
+        std::vector<std::string> item_ids;
+        for (const auto& playlist : channels[c]->get_playlist_manager()->get_playlists()) {
+            for (const auto& item : playlist.items) {
+                item_ids.push_back(item.id);
+            }
+        }
+        
+        for (size_t r = 0; r < rounds; ++r) {
+            Deadline deadline;
+            deadline.kind = Deadline::Kind::Trigger;
+            deadline.channel = c;
+            deadline.when = start + interval * r;
+            deadline.item_ids.push_back(item_ids[r % item_ids.size()]);
+            deadlines.push(deadline);
+        }
+    }
+    
+    obs_mock::start_task_thread();
+    
+    std::atomic<bool> rendering(true);
+    std::thread video([&rendering] {
+        auto next_frame = SteadyClock::now();
+        while (rendering) {
+            obs_mock::tick();
+            next_frame += std::chrono::nanoseconds(1000000000 / 60);
+            std::this_thread::sleep_until(next_frame);
+        }
+    });
+    
+    // The scheduler thread's loop, minus re-arming
+    std::mutex mutex;
+    std::condition_variable cv;
+    while (!deadlines.empty()) {
+        std::unique_lock<std::mutex> lock(mutex);
+        bool due = deadlines.wait(cv, lock, [] { return false; });
+        lock.unlock();
+        
+        if (due) {
+            for (const auto& deadline : deadlines.pop_due(SteadyClock::now())) {
+                channels[deadline.channel]->handle_deadline(deadline, frame_trigger);
+            }
+        }
+    }
+    
+    // Let the backlog drain and the last items reach their first frame
+    auto started = [&channels] {
+        uint64_t count = 0;
+        for (const auto& channel : channels) {
+            for (const auto& breakdown : channel->get_latency_histograms()) {
+                count += breakdown.stages[static_cast<size_t>(LatencyStage::Start)].get_count();
+            }
+        }
+        return count;
+    };
+    auto give_up = SteadyClock::now() + std::chrono::seconds(30);
+    while (started() < channel_count * rounds && SteadyClock::now() < give_up) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    rendering = false;
+    video.join();
+    obs_mock::stop_task_thread();
+    
+    StageHistograms merged;
+    for (const auto& channel : channels) {
+        for (const auto& breakdown : channel->get_latency_histograms()) {
+            for (size_t stage = 0; stage < LATENCY_STAGE_COUNT; ++stage) {
+                merged[stage].merge(breakdown.stages[stage]);
+            }
+        }
+    }
+    return merged;
+}
+
+int main(int argc, char** argv) {
+    size_t rounds = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 40;
+    long interval_ms = argc > 2 ? std::atol(argv[2]) : 200;
+    long delay_us = argc > 3 ? std::atol(argv[3]) : 20;
+    if (rounds == 0) {
+        rounds = 60;
+    }
+    if (interval_ms <= 0) {
+        interval_ms = 200;
+    }
+    
+    printf("rounds=%zu interval=%ldms obs-call-delay=%ldus\n", rounds, interval_ms, delay_us);
+    
+    for (size_t channel_count : {1, 8, 32}) {
+        auto stages = run(channel_count, rounds, std::chrono::milliseconds(interval_ms),
+                          std::chrono::microseconds(delay_us));
+        
+        for (size_t stage = 0; stage < LATENCY_STAGE_COUNT; ++stage) {
+            const auto& histogram = stages[stage];
+            printf("channels=%2zu %-8s n=%5llu p50=%8.1fus p99=%8.1fus p99.9=%8.1fus max=%8.1fus\n",
+                   channel_count, latency_stage_name(static_cast<LatencyStage>(stage)),
+                   static_cast<unsigned long long>(histogram.get_count()),
+                   histogram.get_percentile(50.0) / 1000.0, histogram.get_percentile(99.0) / 1000.0,
+                   histogram.get_percentile(99.9) / 1000.0, histogram.get_max() / 1000.0);
+        }
+    }
+    
+    return 0;
+}
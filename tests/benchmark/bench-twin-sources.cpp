@@ -0,0 +1,198 @@
+// Measures the frames lost between back-to-back items that play on the same
+// media source.
+//
+// One scene on the OBS mock holds a media source, and in the second run also
+// its twin, while a video thread renders at 60 fps. Opening a file takes the
+// given time on the mock, as demuxing the first frames does in OBS. Items
+// follow each other without a gap, each pre-rolled ahead of its trigger the
+// way the scheduler does it. With the source alone, the on-air source cannot
+// be pre-rolled, so every item reloads it in place. With the pair, every
+// item loads into the hidden twin and goes on air by swapping the two. After
+// every frame, the video thread checks whether a visible source had a
+// picture to show, that is whether it was playing or held on a frame rather
+// than opening a file or stopped. Reports the frames without one, per item
+// change and in total.
+//
+// Usage: bench_twin_sources [items] [item_ms] [open_ms]
+
+#include "media-controller.h"
+#include "playlist-manager.h"
+#include "mocks/obs-mock.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+using SteadyClock = std::chrono::steady_clock;
+
+static const char* SOURCE = "Player";
+
+struct Summary {
+    uint32_t frames = 0;
+    uint32_t black_frames = 0;
+    uint32_t max_gap = 0;       // Longest run of frames without a picture
+    size_t items = 0;
+};
+
+// Renders frames at 60 fps until stopped and counts those where no visible
+// source had a picture, as a viewer would see them
+class VideoThread {
+public:
+    explicit VideoThread(bool twins)
+        : running_(true), black_frames_(0), max_gap_(0), frames_(0), twins_(twins), thread_([this]() { run(); }) {}
+    
+    ~VideoThread() {
+        stop();
+    }
+    
+    void stop() {
+        running_ = false;
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+    
+    uint32_t get_frames() const { return frames_; }
+    uint32_t get_black_frames() const { return black_frames_; }
+    uint32_t get_max_gap() const { return max_gap_; }
+
+private:
+    bool has_picture(const std::string& name) const {
+        if (!obs_mock::is_visible("Program", name)) {
+            return false;
+        }
+        obs_source_t* source = obs_get_source_by_name(name.c_str());
+        obs_media_state state = obs_source_media_get_state(source);
+        obs_source_release(source);
+        return state == OBS_MEDIA_STATE_PLAYING || state == OBS_MEDIA_STATE_PAUSED;
+    }
+    
+    void run() {
+        auto next = SteadyClock::now();
+        uint32_t gap = 0;
+        while (running_) {
+            obs_mock::tick();
+            frames_++;
+            
+            bool picture = has_picture(SOURCE) ||
+                           (twins_ && has_picture(MediaController::get_twin_name(SOURCE)));
+            gap = picture ? 0 : gap + 1;
+            black_frames_ += !picture;
+            max_gap_ = std::max(max_gap_.load(), gap);
+            
+            next += std::chrono::microseconds(16667);
+            std::this_thread::sleep_until(next);
+        }
+    }
+    
+    std::atomic<bool> running_;
+    std::atomic<uint32_t> black_frames_;
+    std::atomic<uint32_t> max_gap_;
+    std::atomic<uint32_t> frames_;
+    bool twins_;
+    std::thread thread_;
+};
+
+static std::vector<ScheduledItem> make_items(size_t count, bool twins) {
+    obs_mock::reset();
+    obs_mock::use_real_time();
+    obs_mock::create_scene("Program");
+    obs_mock::set_current_scene("Program");
+    obs_mock::create_media_source(SOURCE);
+    obs_mock::add_to_scene("Program", SOURCE);
+    if (twins) {
+        obs_mock::create_media_source(MediaController::get_twin_name(SOURCE));
+        obs_mock::add_to_scene("Program", MediaController::get_twin_name(SOURCE));
+    }
+    
+    std::vector<ScheduledItem> items;
+    for (size_t i = 0; i < count; ++i) {
+        ScheduledItem item;
+        item.id = "item-" + std::to_string(i);
+        item.name = item.id;
+        item.scene = "Program";
+        item.source = SOURCE;
+        item.file_path = "/media/" + item.id + ".mp4";
+        items.push_back(item);
+    }
+    return items;
+}
+
+static Summary run(size_t count, std::chrono::milliseconds item_length, std::chrono::milliseconds open_delay,
+                   bool twins) {
+    auto items = make_items(count, twins);
+    obs_mock::set_media_latency(open_delay, std::chrono::milliseconds(0));
+    obs_mock::start_task_thread();
+    MediaController media;
+    media.initialize();
+    
+    // Pre-rolled halfway through the previous item, like the scheduler's
+    // pre-roll deadline; files that open slower than that show up as gaps
+    auto preroll_lead = item_length / 2;
+    
+    // The first item starts from a picture already on air
+    media.execute_item_async(items[0]).get();
+    std::this_thread::sleep_for(open_delay * 2);
+    
+    VideoThread video(twins);
+    auto trigger = SteadyClock::now() + item_length;
+    for (size_t i = 1; i < items.size(); ++i) {
+        const auto& item = items[i];
+        
+        // The scheduler only pre-rolls the on-air source when it has a twin
+        std::this_thread::sleep_until(trigger - preroll_lead);
+        if (media.has_twin_source(item.source)) {
+            media.arm_item(item);
+        }
+        
+        std::this_thread::sleep_until(trigger);
+        media.execute_item_async(item);
+        trigger += item_length;
+    }
+    std::this_thread::sleep_until(trigger);
+    video.stop();
+    
+    Summary summary;
+    summary.frames = video.get_frames();
+    summary.black_frames = video.get_black_frames();
+    summary.max_gap = video.get_max_gap();
+    summary.items = items.size() - 1;
+    
+    media.cleanup();
+    obs_mock::stop_task_thread();
+    return summary;
+}
+
+static void report(const char* label, const Summary& summary) {
+    printf("%-7s %u frames, %u without a picture (%.2f per item change, longest gap %u), over %zu changes\n",
+           label, summary.frames, summary.black_frames,
+           summary.items ? static_cast<double>(summary.black_frames) / summary.items : 0.0, summary.max_gap,
+           summary.items);
+}
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 60;
+    long item_ms = argc > 2 ? std::strtol(argv[2], nullptr, 10) : 250;
+    long open_ms = argc > 3 ? std::strtol(argv[3], nullptr, 10) : 80;
+    if (count < 2) {
+        count = 60;
+    }
+    if (item_ms <= 0) {
+        item_ms = 250;
+    }
+    if (open_ms < 0) {
+        open_ms = 80;
+    }
+    
+    printf("items=%zu item=%ldms open=%ldms fps=60\n", count, item_ms, open_ms);
+    Summary single = run(count, std::chrono::milliseconds(item_ms), std::chrono::milliseconds(open_ms), false);
+    Summary pair = run(count, std::chrono::milliseconds(item_ms), std::chrono::milliseconds(open_ms), true);
+    report("single", single);
+    report("pair", pair);
+    
+    return pair.black_frames == 0 ? 0 : 1;
+}
@@ -0,0 +1,1093 @@
+#include "obs-mock.h"
+#include <obs-frontend-api.h>
+#include <util/platform.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct obs_data {
+    std::map<std::string, std::string> strings;
+};
+
+struct obs_scene;
+struct obs_weak_source;
+
+struct calldata {
+    std::map<std::string, void*> pointers;
+    std::map<std::string, std::string> strings;
+    std::map<std::string, bool> bools;
+};
+
+struct signal_handler {
+    struct Connection {
+        std::string signal;
+        signal_callback_t callback;
+        void* data;
+    };
+    std::vector<Connection> connections;
+};
+
+struct obs_source {
+    std::string name;
+    std::string id;
+    obs_scene* scene = nullptr;
+    obs_data settings;
+    obs_media_state state = OBS_MEDIA_STATE_NONE;
+    int64_t duration_ms = 0;
+    int showing = 0;
+    
+    // Media clock: position_ms at anchor_ns, advancing while playing
+    int64_t position_ms = 0;
+    uint64_t anchor_ns = 0;
+    uint64_t open_ready_ns = 0;         // File still opening before this
+    int64_t pending_seek_ms = -1;       // Seek in flight, lands at seek_ready_ns
+    uint64_t seek_ready_ns = 0;
+    bool end_signalled = false;         // media_ended already sent for this end
+    
+    signal_handler signals;
+    obs_weak_source* weak = nullptr;    // Created on first request
+};
+
+struct obs_weak_source {
+    obs_source* source = nullptr;
+    bool expired = false;               // No strong reference can be had any more
+};
+
+struct obs_scene_item {
+    obs_scene* scene = nullptr;
+    obs_source* source = nullptr;
+    bool visible = true;
+};
+
+struct obs_scene {
+    obs_source* source = nullptr;
+    std::vector<std::unique_ptr<obs_scene_item>> items;
+};
+
+namespace {
+
+using TickFunction = void (*)(void*, float);
+using QueuedTask = std::pair<obs_task_t, void*>;
+
+struct MockState {
+    std::recursive_mutex mutex;
+    std::vector<std::unique_ptr<obs_source>> sources;
+    std::vector<std::unique_ptr<obs_scene>> scenes;
+    std::vector<std::unique_ptr<obs_weak_source>> weak_sources;
+    std::vector<std::unique_ptr<obs_source>> removed_sources;      // Kept so stale pointers stay readable
+    std::vector<std::unique_ptr<obs_scene>> removed_scenes;
+    signal_handler signals;             // Global source_create, source_remove ... signals
+    std::vector<std::pair<TickFunction, void*>> tick_callbacks;
+    obs_source* current_scene = nullptr;
+    obs_source* preview_scene = nullptr;
+    bool studio_mode = false;
+    uint32_t fps_num = 60;
+    uint32_t fps_den = 1;
+    bool frozen_time = false;
+    uint64_t time_ns = 0;
+    uint64_t frame_time_ns = 0;
+    uint32_t total_frames = 0;
+    std::atomic<size_t> calls{0};
+    size_t atomic_updates = 0;
+    std::atomic<long long> call_delay_us{0};
+    uint64_t open_delay_ns = 0;
+    uint64_t seek_delay_ns = 0;
+    
+    // Task queues, guarded by task_mutex so tasks can run while mutex is free
+    std::mutex task_mutex;
+    std::condition_variable task_cv;
+    std::deque<QueuedTask> ui_tasks;
+    std::deque<QueuedTask> graphics_tasks;
+    std::unique_ptr<std::thread> task_thread;
+    bool task_thread_running = false;
+};
+
+thread_local bool in_ui_thread = false;
+thread_local bool in_graphics_thread = false;
+
+MockState& state() {
+    static MockState instance;
+    return instance;
+}
+
+obs_source* find_source(const std::string& name) {
+    for (auto& source : state().sources) {
+        if (source->name == name) {
+            return source.get();
+        }
+    }
+    return nullptr;
+}
+
+// Brings the source's media clock up to now: finishes the open, lands a due
+// seek and folds the played time into position_ms. Caller holds the mutex.
+void settle_media(obs_source* source, uint64_t now_ns) {
+    if (now_ns < source->open_ready_ns) {
+        source->anchor_ns = source->open_ready_ns;
+        return;
+    }
+    
+    if (source->pending_seek_ms >= 0 && now_ns >= source->seek_ready_ns) {
+        source->position_ms = source->pending_seek_ms;
+        source->anchor_ns = source->seek_ready_ns;
+        source->pending_seek_ms = -1;
+    }
+    
+    if (source->state == OBS_MEDIA_STATE_PLAYING && now_ns > source->anchor_ns) {
+        source->position_ms += static_cast<int64_t>((now_ns - source->anchor_ns) / 1000000);
+        source->anchor_ns += (now_ns - source->anchor_ns) / 1000000 * 1000000;
+    } else if (now_ns > source->anchor_ns) {
+        source->anchor_ns = now_ns;
+    }
+    
+    if (source->duration_ms > 0 && source->position_ms >= source->duration_ms) {
+        source->position_ms = source->duration_ms;
+        if (source->state == OBS_MEDIA_STATE_PLAYING) {
+            source->state = OBS_MEDIA_STATE_ENDED;
+        }
+    }
+}
+
+// Calls every connection to the signal, without the mutex held so the
+// callbacks may call back into the mock
+void emit_signal(signal_handler& handler, const std::string& signal, calldata* cd) {
+    std::vector<std::pair<signal_callback_t, void*>> callbacks;
+    {
+        std::lock_guard<std::recursive_mutex> lock(state().mutex);
+        for (const auto& connection : handler.connections) {
+            if (connection.signal == signal) {
+                callbacks.emplace_back(connection.callback, connection.data);
+            }
+        }
+    }
+    for (const auto& callback : callbacks) {
+        callback.first(callback.second, cd);
+    }
+}
+
+void emit_source_signal(const std::string& signal, obs_source* source) {
+    calldata cd;
+    cd.pointers["source"] = source;
+    emit_signal(state().signals, signal, &cd);
+}
+
+// item_add, item_remove and item_visible, sent by the item's scene
+void emit_item_signal(const std::string& signal, obs_scene_item* item) {
+    calldata cd;
+    cd.pointers["scene"] = item->scene;
+    cd.pointers["item"] = item;
+    cd.bools["visible"] = item->visible;
+    emit_signal(item->scene->source->signals, signal, &cd);
+}
+
+void count_call() {
+    state().calls++;
+    
+    long long delay_us = state().call_delay_us;
+    if (delay_us > 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(delay_us));
+    }
+}
+
+} // namespace
+
+namespace obs_mock {
+
+void reset() {
+    auto& s = state();
+    std::lock_guard<std::recursive_mutex> lock(s.mutex);
+    s.scenes.clear();
+    s.sources.clear();
+    s.weak_sources.clear();
+    s.removed_sources.clear();
+    s.removed_scenes.clear();
+    s.signals.connections.clear();
+    s.tick_callbacks.clear();
+    s.current_scene = nullptr;
+    s.preview_scene = nullptr;
+    s.studio_mode = false;
+    s.fps_num = 60;
+    s.fps_den = 1;
+    s.frozen_time = false;
+    s.time_ns = 0;
+    s.frame_time_ns = 0;
+    s.total_frames = 0;
+    s.calls = 0;
+    s.atomic_updates = 0;
+    s.call_delay_us = 0;
+    s.open_delay_ns = 0;
+    s.seek_delay_ns = 0;
+    
+    std::lock_guard<std::mutex> task_lock(s.task_mutex);
+    s.ui_tasks.clear();
+    s.graphics_tasks.clear();
+}
+
+obs_source_t* create_media_source(const std::string& name) {
+    auto& s = state();
+    obs_source* created;
+    {
+        std::lock_guard<std::recursive_mutex> lock(s.mutex);
+        auto source = std::make_unique<obs_source>();
+        source->name = name;
+        source->id = "ffmpeg_source";
+        created = source.get();
+        s.sources.push_back(std::move(source));
+    }
+    emit_source_signal("source_create", created);
+    return created;
+}
+
+obs_source_t* create_scene(const std::string& name) {
+    auto& s = state();
+    obs_source* created;
+    {
+        std::lock_guard<std::recursive_mutex> lock(s.mutex);
+        auto source = std::make_unique<obs_source>();
+        source->name = name;
+        source->id = "scene";
+        auto scene = std::make_unique<obs_scene>();
+        scene->source = source.get();
+        source->scene = scene.get();
+        created = source.get();
+        s.sources.push_back(std::move(source));
+        s.scenes.push_back(std::move(scene));
+    }
+    emit_source_signal("source_create", created);
+    return created;
+}
+
+bool remove_source(const std::string& name) {
+    auto& s = state();
+    obs_source* source;
+    {
+        std::lock_guard<std::recursive_mutex> lock(s.mutex);
+        source = find_source(name);
+        if (!source) {
+            return false;
+        }
+    }
+    
+    // Like obs_source_remove(): listeners hear of it while the source is still whole
+    emit_source_signal("source_remove", source);
+    
+    // Its items go from every scene first, each scene telling its listeners
+    std::vector<obs_scene_item*> items;
+    {
+        std::lock_guard<std::recursive_mutex> lock(s.mutex);
+        for (auto& scene : s.scenes) {
+            for (auto& item : scene->items) {
+                if (item->source == source) {
+                    items.push_back(item.get());
+                }
+            }
+        }
+    }
+    for (auto* item : items) {
+        emit_item_signal("item_remove", item);
+    }
+    
+    {
+        std::lock_guard<std::recursive_mutex> lock(s.mutex);
+        for (auto& scene : s.scenes) {
+            auto& scene_items = scene->items;
+            scene_items.erase(std::remove_if(scene_items.begin(), scene_items.end(),
+                [source](const std::unique_ptr<obs_scene_item>& item) { return item->source == source; }),
+                scene_items.end());
+        }
+        if (s.current_scene == source) {
+            s.current_scene = nullptr;
+        }
+        if (source->weak) {
+            source->weak->expired = true;
+        }
+    }
+    
+    // The last reference goes right away, nothing in the mock holds on to it
+    emit_source_signal("source_destroy", source);
+    
+    std::lock_guard<std::recursive_mutex> lock(s.mutex);
+    auto it = std::find_if(s.sources.begin(), s.sources.end(),
+        [source](const std::unique_ptr<obs_source>& candidate) { return candidate.get() == source; });
+    s.removed_sources.push_back(std::move(*it));
+    s.sources.erase(it);
+    if (source->scene) {
+        auto scene = std::find_if(s.scenes.begin(), s.scenes.end(),
+            [source](const std::unique_ptr<obs_scene>& candidate) { return candidate.get() == source->scene; });
+        s.removed_scenes.push_back(std::move(*scene));
+        s.scenes.erase(scene);
+    }
+    return true;
+}
+
+bool rename_source(const std::string& name, const std::string& new_name) {
+    auto& s = state();
+    obs_source* source;
+    {
+        std::lock_guard<std::recursive_mutex> lock(s.mutex);
+        source = find_source(name);
+        if (!source || find_source(new_name)) {
+            return false;
+        }
+        source->name = new_name;
+    }
+    
+    calldata cd;
+    cd.pointers["source"] = source;
+    cd.strings["prev_name"] = name;
+    cd.strings["new_name"] = new_name;
+    emit_signal(s.signals, "source_rename", &cd);
+    return true;
+}
+
+void add_to_scene(const std::string& scene_name, const std::string& source_name) {
+    auto& s = state();
+    obs_scene_item* added;
+    {
+        std::lock_guard<std::recursive_mutex> lock(s.mutex);
+        obs_source* scene_source = find_source(scene_name);
+        obs_source* source = find_source(source_name);
+        if (!scene_source || !scene_source->scene || !source) {
+            return;
+        }
+        auto item = std::make_unique<obs_scene_item>();
+        item->scene = scene_source->scene;
+        item->source = source;
+        added = item.get();
+        scene_source->scene->items.push_back(std::move(item));
+    }
+    emit_item_signal("item_add", added);
+}
+
+bool remove_from_scene(const std::string& scene_name, const std::string& source_name) {
+    auto& s = state();
+    obs_scene_item* removed = nullptr;
+    {
+        std::lock_guard<std::recursive_mutex> lock(s.mutex);
+        obs_source* scene_source = find_source(scene_name);
+        if (!scene_source || !scene_source->scene) {
+            return false;
+        }
+        for (auto& item : scene_source->scene->items) {
+            if (item->source && item->source->name == source_name) {
+                removed = item.get();
+                break;
+            }
+        }
+    }
+    if (!removed) {
+        return false;
+    }
+    
+    emit_item_signal("item_remove", removed);
+    
+    std::lock_guard<std::recursive_mutex> lock(s.mutex);
+    auto& items = removed->scene->items;
+    items.erase(std::find_if(items.begin(), items.end(),
+        [removed](const std::unique_ptr<obs_scene_item>& item) { return item.get() == removed; }));
+    return true;
+}
+
+void set_current_scene(const std::string& scene_name) {
+    auto& s = state();
+    std::lock_guard<std::recursive_mutex> lock(s.mutex);
+    s.current_scene = find_source(scene_name);
+}
+
+void set_studio_mode(bool enabled) {
+    auto& s = state();
+    std::lock_guard<std::recursive_mutex> lock(s.mutex);
+    s.studio_mode = enabled;
+}
+
+void set_fps(uint32_t fps_num, uint32_t fps_den) {
+    auto& s = state();
+    std::lock_guard<std::recursive_mutex> lock(s.mutex);
+    s.fps_num = fps_num;
+    s.fps_den = fps_den;
+}
+
+void set_time_ns(uint64_t time_ns) {
+    auto& s = state();
+    std::lock_guard<std::recursive_mutex> lock(s.mutex);
+    s.frozen_time = true;
+    s.time_ns = time_ns;
+}
+
+void use_real_time() {
+    auto& s = state();
+    std::lock_guard<std::recursive_mutex> lock(s.mutex);
+    s.frozen_time = false;
+}
+
+void set_call_delay(std::chrono::microseconds delay) {
+    state().call_delay_us = delay.count();
+}
+
+void set_media_duration(const std::string& source_name, int64_t duration_ms) {
+    auto& s = state();
+    std::lock_guard<std::recursive_mutex> lock(s.mutex);
+    obs_source* source = find_source(source_name);
+    if (source) {
+        source->duration_ms = duration_ms;
+    }
+}
+
+void set_media_latency(std::chrono::milliseconds open_delay, std::chrono::milliseconds seek_delay) {
+    auto& s = state();
+    std::lock_guard<std::recursive_mutex> lock(s.mutex);
+    s.open_delay_ns = static_cast<uint64_t>(open_delay.count()) * 1000000;
+    s.seek_delay_ns = static_cast<uint64_t>(seek_delay.count()) * 1000000;
+}
+
+void tick() {
+    auto& s = state();
+    
+    // Each source's media thread notices the end of its file on its own,
+    // before (and not on) the video thread
+    std::vector<std::pair<signal_callback_t, void*>> ended;
+    {
+        std::lock_guard<std::recursive_mutex> lock(s.mutex);
+        uint64_t now_ns = os_gettime_ns();
+        for (auto& source : s.sources) {
+            if (source->scene) {
+                continue;
+            }
+            
+            settle_media(source.get(), now_ns);
+            if (source->state != OBS_MEDIA_STATE_ENDED) {
+                source->end_signalled = false;
+            } else if (!source->end_signalled) {
+                source->end_signalled = true;
+                for (const auto& connection : source->signals.connections) {
+                    if (connection.signal == "media_ended") {
+                        ended.emplace_back(connection.callback, connection.data);
+                    }
+                }
+            }
+        }
+    }
+    for (const auto& callback : ended) {
+        // The real calldata carries the source; the plugin binds it through data instead
+        callback.first(callback.second, nullptr);
+    }
+    
+    in_graphics_thread = true;
+    
+    std::deque<QueuedTask> graphics_tasks;
+    {
+        std::lock_guard<std::mutex> task_lock(s.task_mutex);
+        graphics_tasks.swap(s.graphics_tasks);
+    }
+    for (const auto& task : graphics_tasks) {
+        task.first(task.second);
+    }
+    
+    std::vector<std::pair<TickFunction, void*>> callbacks;
+    float seconds;
+    {
+        std::lock_guard<std::recursive_mutex> lock(s.mutex);
+        s.frame_time_ns = os_gettime_ns();
+        s.total_frames++;
+        callbacks = s.tick_callbacks;
+        seconds = static_cast<float>(s.fps_den) / static_cast<float>(s.fps_num);
+    }
+    
+    // Like the real video thread, callbacks run without the graphics lock held
+    for (const auto& callback : callbacks) {
+        callback.first(callback.second, seconds);
+    }
+    
+    in_graphics_thread = false;
+}
+
+void start_task_thread() {
+    auto& s = state();
+    std::lock_guard<std::mutex> task_lock(s.task_mutex);
+    if (s.task_thread) {
+        return;
+    }
+    
+    s.task_thread_running = true;
+    s.task_thread = std::make_unique<std::thread>([&s]() {
+        in_ui_thread = true;
+        std::unique_lock<std::mutex> lock(s.task_mutex);
+        while (true) {
+            s.task_cv.wait(lock, [&s] { return !s.task_thread_running || !s.ui_tasks.empty(); });
+            if (s.ui_tasks.empty()) {
+                break;
+            }
+            QueuedTask task = s.ui_tasks.front();
+            s.ui_tasks.pop_front();
+            
+            lock.unlock();
+            task.first(task.second);
+            lock.lock();
+            s.task_cv.notify_all();
+        }
+    });
+}
+
+void stop_task_thread() {
+    auto& s = state();
+    std::unique_ptr<std::thread> thread;
+    {
+        std::lock_guard<std::mutex> task_lock(s.task_mutex);
+        s.task_thread_running = false;
+        thread = std::move(s.task_thread);
+    }
+    s.task_cv.notify_all();
+    
+    // Drains whatever is still queued before returning
+    if (thread && thread->joinable()) {
+        thread->join();
+    }
+}
+
+size_t run_pending_tasks() {
+    auto& s = state();
+    std::deque<QueuedTask> tasks;
+    {
+        std::lock_guard<std::mutex> task_lock(s.task_mutex);
+        tasks.swap(s.ui_tasks);
+    }
+    
+    bool was_ui_thread = in_ui_thread;
+    in_ui_thread = true;
+    for (const auto& task : tasks) {
+        task.first(task.second);
+    }
+    in_ui_thread = was_ui_thread;
+    
+    return tasks.size();
+}
+
+size_t get_pending_task_count() {
+    auto& s = state();
+    std::lock_guard<std::mutex> task_lock(s.task_mutex);
+    return s.ui_tasks.size() + s.graphics_tasks.size();
+}
+
+obs_media_state get_media_state(const std::string& source_name) {
+    auto& s = state();
+    std::lock_guard<std::recursive_mutex> lock(s.mutex);
+    obs_source* source = find_source(source_name);
+    return source ? source->state : OBS_MEDIA_STATE_NONE;
+}
+
+int64_t get_media_time(const std::string& source_name) {
+    auto& s = state();
+    std::lock_guard<std::recursive_mutex> lock(s.mutex);
+    obs_source* source = find_source(source_name);
+    if (!source) {
+        return 0;
+    }
+    settle_media(source, os_gettime_ns());
+    return source->position_ms;
+}
+
+bool is_visible(const std::string& scene_name, const std::string& source_name) {
+    auto& s = state();
+    std::lock_guard<std::recursive_mutex> lock(s.mutex);
+    obs_source* scene_source = find_source(scene_name);
+    if (!scene_source || !scene_source->scene) {
+        return false;
+    }
+    for (const auto& item : scene_source->scene->items) {
+        if (item->source && item->source->name == source_name) {
+            return item->visible;
+        }
+    }
+    return false;
+}
+
+int get_showing_count(const std::string& source_name) {
+    auto& s = state();
+    std::lock_guard<std::recursive_mutex> lock(s.mutex);
+    obs_source* source = find_source(source_name);
+    return source ? source->showing : 0;
+}
+
+size_t get_call_count() {
+    return state().calls;
+}
+
+void reset_call_count() {
+    state().calls = 0;
+}
+
+std::string get_current_scene() {
+    auto& s = state();
+    std::lock_guard<std::recursive_mutex> lock(s.mutex);
+    return s.current_scene ? s.current_scene->name : "";
+}
+
+size_t get_atomic_update_count() {
+    std::lock_guard<std::recursive_mutex> lock(state().mutex);
+    return state().atomic_updates;
+}
+
+} // namespace obs_mock
+
+// libobs
+
+void blog(int log_level, const char* format, ...) {
+    UNUSED_PARAMETER(log_level);
+    UNUSED_PARAMETER(format);
+}
+
+uint64_t os_gettime_ns(void) {
+    auto& s = state();
+    {
+        std::lock_guard<std::recursive_mutex> lock(s.mutex);
+        if (s.frozen_time) {
+            return s.time_ns;
+        }
+    }
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+obs_source_t* obs_get_source_by_name(const char* name) {
+    count_call();
+    std::lock_guard<std::recursive_mutex> lock(state().mutex);
+    return name ? find_source(name) : nullptr;
+}
+
+void obs_source_release(obs_source_t* source) {
+    UNUSED_PARAMETER(source);
+    count_call();
+}
+
+obs_source_t* obs_source_get_ref(obs_source_t* source) {
+    count_call();
+    return source;
+}
+
+const char* obs_source_get_name(const obs_source_t* source) {
+    count_call();
+    return source ? source->name.c_str() : nullptr;
+}
+
+const char* obs_source_get_id(const obs_source_t* source) {
+    count_call();
+    return source ? source->id.c_str() : nullptr;
+}
+
+obs_data_t* obs_source_get_settings(const obs_source_t* source) {
+    count_call();
+    return source ? const_cast<obs_data*>(&source->settings) : nullptr;
+}
+
+void obs_source_update(obs_source_t* source, obs_data_t* settings) {
+    count_call();
+    if (!source || !settings) {
+        return;
+    }
+    
+    // A new file reopens the media from the start
+    if (settings->strings.count("local_file") || settings->strings.count("file")) {
+        auto& s = state();
+        std::lock_guard<std::recursive_mutex> lock(s.mutex);
+        uint64_t now_ns = os_gettime_ns();
+        source->position_ms = 0;
+        source->pending_seek_ms = -1;
+        source->open_ready_ns = now_ns + s.open_delay_ns;
+        source->anchor_ns = source->open_ready_ns;
+    }
+}
+
+void obs_data_set_string(obs_data_t* data, const char* name, const char* val) {
+    count_call();
+    if (data && name) {
+        data->strings[name] = val ? val : "";
+    }
+}
+
+const char* obs_data_get_string(obs_data_t* data, const char* name) {
+    count_call();
+    if (!data || !name) {
+        return "";
+    }
+    auto it = data->strings.find(name);
+    return it != data->strings.end() ? it->second.c_str() : "";
+}
+
+void obs_data_release(obs_data_t* data) {
+    UNUSED_PARAMETER(data);
+    count_call();
+}
+
+void obs_source_media_play_pause(obs_source_t* source, bool pause) {
+    count_call();
+    if (source) {
+        std::lock_guard<std::recursive_mutex> lock(state().mutex);
+        settle_media(source, os_gettime_ns());
+        source->state = pause ? OBS_MEDIA_STATE_PAUSED : OBS_MEDIA_STATE_PLAYING;
+    }
+}
+
+void obs_source_media_restart(obs_source_t* source) {
+    count_call();
+    if (source) {
+        std::lock_guard<std::recursive_mutex> lock(state().mutex);
+        source->position_ms = 0;
+        source->pending_seek_ms = -1;
+        source->anchor_ns = std::max(os_gettime_ns(), source->open_ready_ns);
+        source->state = OBS_MEDIA_STATE_PLAYING;
+    }
+}
+
+void obs_source_media_stop(obs_source_t* source) {
+    count_call();
+    if (source) {
+        std::lock_guard<std::recursive_mutex> lock(state().mutex);
+        source->position_ms = 0;
+        source->pending_seek_ms = -1;
+        source->state = OBS_MEDIA_STATE_STOPPED;
+    }
+}
+
+int64_t obs_source_media_get_duration(obs_source_t* source) {
+    count_call();
+    return source ? source->duration_ms : 0;
+}
+
+int64_t obs_source_media_get_time(obs_source_t* source) {
+    count_call();
+    if (!source) {
+        return 0;
+    }
+    std::lock_guard<std::recursive_mutex> lock(state().mutex);
+    settle_media(source, os_gettime_ns());
+    return source->position_ms;
+}
+
+void obs_source_media_set_time(obs_source_t* source, int64_t ms) {
+    count_call();
+    if (source) {
+        std::lock_guard<std::recursive_mutex> lock(state().mutex);
+        uint64_t now_ns = os_gettime_ns();
+        settle_media(source, now_ns);
+        source->pending_seek_ms = std::max<int64_t>(0, ms);
+        source->seek_ready_ns = std::max(now_ns, source->open_ready_ns) + state().seek_delay_ns;
+    }
+}
+
+enum obs_media_state obs_source_media_get_state(obs_source_t* source) {
+    count_call();
+    if (!source) {
+        return OBS_MEDIA_STATE_NONE;
+    }
+    std::lock_guard<std::recursive_mutex> lock(state().mutex);
+    uint64_t now_ns = os_gettime_ns();
+    if (now_ns < source->open_ready_ns) {
+        return OBS_MEDIA_STATE_OPENING;
+    }
+    settle_media(source, now_ns);
+    return source->state;
+}
+
+void obs_source_inc_showing(obs_source_t* source) {
+    count_call();
+    if (source) {
+        source->showing++;
+    }
+}
+
+void obs_source_dec_showing(obs_source_t* source) {
+    count_call();
+    if (source && source->showing > 0) {
+        source->showing--;
+    }
+}
+
+signal_handler_t* obs_source_get_signal_handler(const obs_source_t* source) {
+    count_call();
+    return source ? const_cast<signal_handler*>(&source->signals) : nullptr;
+}
+
+void signal_handler_connect(signal_handler_t* handler, const char* signal, signal_callback_t callback, void* data) {
+    if (handler && signal) {
+        std::lock_guard<std::recursive_mutex> lock(state().mutex);
+        handler->connections.push_back(signal_handler::Connection{signal, callback, data});
+    }
+}
+
+void signal_handler_disconnect(signal_handler_t* handler, const char* signal, signal_callback_t callback,
+                               void* data) {
+    if (handler && signal) {
+        std::lock_guard<std::recursive_mutex> lock(state().mutex);
+        auto& connections = handler->connections;
+        connections.erase(std::remove_if(connections.begin(), connections.end(),
+            [signal, callback, data](const signal_handler::Connection& connection) {
+                return connection.signal == signal && connection.callback == callback && connection.data == data;
+            }), connections.end());
+    }
+}
+
+signal_handler_t* obs_get_signal_handler(void) {
+    return &state().signals;
+}
+
+void* calldata_ptr(const calldata_t* data, const char* name) {
+    if (!data || !name) {
+        return nullptr;
+    }
+    auto it = data->pointers.find(name);
+    return it != data->pointers.end() ? it->second : nullptr;
+}
+
+bool calldata_bool(const calldata_t* data, const char* name) {
+    if (!data || !name) {
+        return false;
+    }
+    auto it = data->bools.find(name);
+    return it != data->bools.end() && it->second;
+}
+
+const char* calldata_string(const calldata_t* data, const char* name) {
+    if (!data || !name) {
+        return nullptr;
+    }
+    auto it = data->strings.find(name);
+    return it != data->strings.end() ? it->second.c_str() : nullptr;
+}
+
+obs_weak_source_t* obs_source_get_weak_source(obs_source_t* source) {
+    count_call();
+    if (!source) {
+        return nullptr;
+    }
+    std::lock_guard<std::recursive_mutex> lock(state().mutex);
+    if (!source->weak) {
+        state().weak_sources.push_back(std::make_unique<obs_weak_source>());
+        source->weak = state().weak_sources.back().get();
+        source->weak->source = source;
+    }
+    return source->weak;
+}
+
+obs_source_t* obs_weak_source_get_source(obs_weak_source_t* weak) {
+    count_call();
+    std::lock_guard<std::recursive_mutex> lock(state().mutex);
+    return weak && !weak->expired ? weak->source : nullptr;
+}
+
+void obs_weak_source_release(obs_weak_source_t* weak) {
+    UNUSED_PARAMETER(weak);
+    count_call();
+}
+
+bool obs_weak_source_references_source(obs_weak_source_t* weak, obs_source_t* source) {
+    std::lock_guard<std::recursive_mutex> lock(state().mutex);
+    return weak && source && weak->source == source;
+}
+
+obs_scene_t* obs_scene_from_source(const obs_source_t* source) {
+    count_call();
+    return source ? source->scene : nullptr;
+}
+
+obs_source_t* obs_scene_get_source(const obs_scene_t* scene) {
+    count_call();
+    return scene ? scene->source : nullptr;
+}
+
+void obs_scene_release(obs_scene_t* scene) {
+    UNUSED_PARAMETER(scene);
+    count_call();
+}
+
+void obs_scene_enum_items(obs_scene_t* scene,
+                          bool (*callback)(obs_scene_t*, obs_sceneitem_t*, void*),
+                          void* param) {
+    count_call();
+    if (!scene) {
+        return;
+    }
+    for (auto& item : scene->items) {
+        if (!callback(scene, item.get(), param)) {
+            break;
+        }
+    }
+}
+
+void obs_scene_atomic_update(obs_scene_t* scene, void (*func)(void* data, obs_scene_t* scene), void* data) {
+    count_call();
+    if (!scene) {
+        return;
+    }
+    
+    // The mock renders nothing in between anyway, the count shows how the changes were grouped
+    std::lock_guard<std::recursive_mutex> lock(state().mutex);
+    state().atomic_updates++;
+    func(data, scene);
+}
+
+obs_source_t* obs_sceneitem_get_source(const obs_sceneitem_t* item) {
+    count_call();
+    return item ? item->source : nullptr;
+}
+
+void obs_sceneitem_addref(obs_sceneitem_t* item) {
+    UNUSED_PARAMETER(item);
+    count_call();
+}
+
+void obs_sceneitem_release(obs_sceneitem_t* item) {
+    UNUSED_PARAMETER(item);
+    count_call();
+}
+
+bool obs_sceneitem_set_visible(obs_sceneitem_t* item, bool visible) {
+    count_call();
+    if (!item) {
+        return false;
+    }
+    
+    bool changed;
+    {
+        std::lock_guard<std::recursive_mutex> lock(state().mutex);
+        changed = item->visible != visible;
+        item->visible = visible;
+    }
+    if (changed) {
+        emit_item_signal("item_visible", item);
+    }
+    return true;
+}
+
+bool obs_sceneitem_visible(const obs_sceneitem_t* item) {
+    count_call();
+    return item && item->visible;
+}
+
+void obs_enum_sources(bool (*enum_proc)(void*, obs_source_t*), void* param) {
+    count_call();
+    std::lock_guard<std::recursive_mutex> lock(state().mutex);
+    for (auto& source : state().sources) {
+        if (!source->scene && !enum_proc(param, source.get())) {
+            break;
+        }
+    }
+}
+
+void obs_enum_scenes(bool (*enum_proc)(void*, obs_source_t*), void* param) {
+    count_call();
+    std::lock_guard<std::recursive_mutex> lock(state().mutex);
+    for (auto& scene : state().scenes) {
+        if (!enum_proc(param, scene->source)) {
+            break;
+        }
+    }
+}
+
+void obs_add_tick_callback(void (*tick)(void* param, float seconds), void* param) {
+    std::lock_guard<std::recursive_mutex> lock(state().mutex);
+    state().tick_callbacks.emplace_back(tick, param);
+}
+
+void obs_remove_tick_callback(void (*tick)(void* param, float seconds), void* param) {
+    std::lock_guard<std::recursive_mutex> lock(state().mutex);
+    auto& callbacks = state().tick_callbacks;
+    callbacks.erase(std::remove(callbacks.begin(), callbacks.end(), std::make_pair(tick, param)),
+                    callbacks.end());
+}
+
+void obs_queue_task(enum obs_task_type type, obs_task_t task, void* param, bool wait) {
+    auto& s = state();
+    
+    // The frontend posts UI tasks that are not waited for to its event loop,
+    // even from the UI thread itself
+    if (obs_in_task_thread(type) && (type != OBS_TASK_UI || wait)) {
+        task(param);
+        return;
+    }
+    
+    std::unique_lock<std::mutex> lock(s.task_mutex);
+    bool threaded = type != OBS_TASK_GRAPHICS && s.task_thread_running;
+    if (wait && !threaded) {
+        // Nothing would ever run it, so behave as if the target thread were idle
+        lock.unlock();
+        task(param);
+        return;
+    }
+    
+    if (!wait) {
+        auto& queue = type == OBS_TASK_GRAPHICS ? s.graphics_tasks : s.ui_tasks;
+        queue.emplace_back(task, param);
+        s.task_cv.notify_all();
+        return;
+    }
+    
+    // Block until the UI thread has run it
+    struct WaitedTask {
+        obs_task_t task;
+        void* param;
+        bool done;
+    };
+    WaitedTask waited{task, param, false};
+    
+    s.ui_tasks.emplace_back([](void* data) {
+        auto* waited = static_cast<WaitedTask*>(data);
+        waited->task(waited->param);
+        std::lock_guard<std::mutex> task_lock(state().task_mutex);
+        waited->done = true;
+    }, &waited);
+    s.task_cv.notify_all();
+    s.task_cv.wait(lock, [&waited] { return waited.done; });
+}
+
+bool obs_in_task_thread(enum obs_task_type type) {
+    if (type == OBS_TASK_GRAPHICS) {
+        return in_graphics_thread;
+    }
+    return type == OBS_TASK_UI && in_ui_thread;
+}
+
+uint64_t obs_get_video_frame_time(void) {
+    std::lock_guard<std::recursive_mutex> lock(state().mutex);
+    return state().frame_time_ns;
+}
+
+uint32_t obs_get_total_frames(void) {
+    std::lock_guard<std::recursive_mutex> lock(state().mutex);
+    return state().total_frames;
+}
+
+bool obs_get_video_info(struct obs_video_info* ovi) {
+    std::lock_guard<std::recursive_mutex> lock(state().mutex);
+    if (!ovi) {
+        return false;
+    }
+    ovi->fps_num = state().fps_num;
+    ovi->fps_den = state().fps_den;
+    return true;
+}
+
+// Frontend API
+
+obs_source_t* obs_frontend_get_current_scene(void) {
+    count_call();
+    std::lock_guard<std::recursive_mutex> lock(state().mutex);
+    return state().current_scene;
+}
+
+void obs_frontend_set_current_scene(obs_source_t* scene) {
+    count_call();
+    std::lock_guard<std::recursive_mutex> lock(state().mutex);
+    if (state().studio_mode) {
+        state().preview_scene = scene;
+    } else {
+        state().current_scene = scene;
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <obs-module.h>
+#include <string>
+#include <chrono>
+#include <cstdint>
+
+// In-memory stand-in for the parts of libobs and the frontend API the plugin
+// calls. Sources, scenes and the video clock live in this process, so the
+// scheduler can be exercised (and benchmarked) without a running OBS.
+namespace obs_mock {
+
+// Drops every source, scene, tick callback, signal connection and call counter
+void reset();
+
+// Creates a media source ("ffmpeg_source") or an empty scene, sending source_create
+obs_source_t* create_media_source(const std::string& name);
+obs_source_t* create_scene(const std::string& name);
+void add_to_scene(const std::string& scene_name, const std::string& source_name);
+bool remove_from_scene(const std::string& scene_name, const std::string& source_name);
+void set_current_scene(const std::string& scene_name);
+
+// In studio mode obs_frontend_set_current_scene() only changes the preview
+// scene, as in OBS, and the programme stays where it was
+void set_studio_mode(bool enabled);
+
+// Removing sends source_remove then source_destroy, renaming sends
+// source_rename, both on the global signal handler like OBS does. A removed
+// source stays readable in memory until reset(), but is gone for libobs.
+// Scenes send item_add, item_remove and item_visible as their items change.
+bool remove_source(const std::string& name);
+bool rename_source(const std::string& name, const std::string& new_name);
+
+// Video clock. By default os_gettime_ns() follows the real monotonic clock;
+// once set_time_ns() is called it returns the frozen value instead.
+void set_fps(uint32_t fps_num, uint32_t fps_den);
+void set_time_ns(uint64_t time_ns);
+void use_real_time();
+
+// Makes every counted libobs call block for the given time, standing in for
+// calls that wait on the graphics or audio thread in a real OBS
+void set_call_delay(std::chrono::microseconds delay);
+
+// Media files: a source's duration (0 = unknown), and how long opening a new
+// file and landing a seek take on the video clock. Media time advances with
+// os_gettime_ns() while the source plays.
+void set_media_duration(const std::string& source_name, int64_t duration_ms);
+void set_media_latency(std::chrono::milliseconds open_delay, std::chrono::milliseconds seek_delay);
+
+// Renders one frame (obs_get_total_frames() counts them). First sends media_ended for every source whose file ran
+// out since the last frame (as the source's media thread would, so not
+// flagged as the graphics thread), then runs queued graphics tasks, stamps
+// the frame time and runs every tick callback, as the graphics thread.
+void tick();
+
+// UI tasks from obs_queue_task() either run on a mock UI thread, or, while
+// that is not started, wait until run_pending_tasks() runs them on the caller
+void start_task_thread();
+void stop_task_thread();
+size_t run_pending_tasks();
+size_t get_pending_task_count();
+
+// Inspection
+std::string get_current_scene();
+obs_media_state get_media_state(const std::string& source_name);
+int64_t get_media_time(const std::string& source_name);
+bool is_visible(const std::string& scene_name, const std::string& source_name);
+int get_showing_count(const std::string& source_name);
+size_t get_call_count();
+void reset_call_count();
+size_t get_atomic_update_count();
+
+} // namespace obs_mock
@@ -0,0 +1,135 @@
+#include "simulated-clock.h"
+#include <algorithm>
+#include <utility>
+
+SimulatedClock::SimulatedClock(SystemTime start)
+    : system_start_(start)
+    , steady_start_(std::chrono::steady_clock::now())
+    , elapsed_(0)
+    , steps_(0)
+{
+}
+
+Clock::SystemTime SimulatedClock::now() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return system_start_ + std::chrono::duration_cast<std::chrono::system_clock::duration>(elapsed_);
+}
+
+Clock::SteadyTime SimulatedClock::steady_now() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return steady_now_locked();
+}
+
+Clock::SteadyTime SimulatedClock::steady_now_locked() const {
+    return steady_start_ + std::chrono::duration_cast<std::chrono::steady_clock::duration>(elapsed_);
+}
+
+bool SimulatedClock::is_realtime() const {
+    return false;
+}
+
+bool SimulatedClock::wait_until(std::condition_variable& cv, std::unique_lock<std::mutex>& lock,
+                                SteadyTime when, const std::function<bool()>& interrupted) {
+    Sleeper sleeper{when, &cv, lock.mutex(), false};
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        sleepers_.push_back(&sleeper);
+    }
+    
+    bool reached = false;
+    while (!interrupted()) {
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            if (steady_now_locked() >= when) {
+                reached = true;
+                break;
+            }
+            // Set while still holding the caller's lock, so advance_to() cannot
+            // notify before we are actually waiting on cv
+            sleeper.asleep = true;
+        }
+        sleepers_changed_.notify_all();
+        
+        cv.wait(lock);
+        
+        std::lock_guard<std::mutex> guard(mutex_);
+        sleeper.asleep = false;
+    }
+    
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        sleepers_.erase(std::find(sleepers_.begin(), sleepers_.end(), &sleeper));
+    }
+    sleepers_changed_.notify_all();
+    
+    return reached;
+}
+
+void SimulatedClock::advance_to(SystemTime time) {
+    std::vector<std::pair<std::condition_variable*, std::mutex*>> due;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(time - system_start_);
+        if (elapsed <= elapsed_) {
+            return;
+        }
+        elapsed_ = elapsed;
+        steps_++;
+        
+        // Sleepers are stack objects that may leave as soon as mutex_ is
+        // released, so only their (long-lived) cv and mutex are kept
+        for (auto* sleeper : sleepers_) {
+            if (sleeper->asleep && sleeper->when <= steady_now_locked()) {
+                sleeper->asleep = false;
+                due.emplace_back(sleeper->cv, sleeper->mutex);
+            }
+        }
+    }
+    
+    for (const auto& waiter : due) {
+        // Taking the sleeper's lock orders the time update before its predicate check
+        {
+            std::lock_guard<std::mutex> lock(*waiter.second);
+        }
+        waiter.first->notify_all();
+    }
+}
+
+void SimulatedClock::advance(std::chrono::nanoseconds duration) {
+    advance_to(now() + std::chrono::duration_cast<std::chrono::system_clock::duration>(duration));
+}
+
+bool SimulatedClock::wait_for_sleepers(size_t count, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return sleepers_changed_.wait_for(lock, timeout, [this, count] {
+        size_t asleep = 0;
+        for (const auto* sleeper : sleepers_) {
+            if (sleeper->asleep && sleeper->when > steady_now_locked()) {
+                asleep++;
+            }
+        }
+        return asleep >= count;
+    });
+}
+
+Clock::SystemTime SimulatedClock::get_next_wakeup() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    auto next = SteadyTime::max();
+    for (const auto* sleeper : sleepers_) {
+        if (sleeper->asleep) {
+            next = std::min(next, sleeper->when);
+        }
+    }
+    
+    if (next == SteadyTime::max()) {
+        return SystemTime::max();
+    }
+    return system_start_ + std::chrono::duration_cast<std::chrono::system_clock::duration>(next - steady_start_);
+}
+
+size_t SimulatedClock::get_step_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return steps_;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "utils/clock.h"
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <condition_variable>
+
+// Clock that only moves when told to. Threads blocked in wait_until()
+// register as sleepers; a driver waits until every thread is asleep (all
+// work for the current instant is done), then jumps straight to the earliest
+// wakeup. A week of schedule runs in as many steps as it has deadlines.
+//
+//   while (clock.now() < end) {
+//       clock.wait_for_sleepers(1, timeout);
+//       obs_mock::run_pending_tasks();
+//       clock.advance_to(std::min(clock.get_next_wakeup(), end));
+//   }
+class SimulatedClock : public Clock {
+public:
+    explicit SimulatedClock(SystemTime start);
+    
+    SystemTime now() const override;
+    SteadyTime steady_now() const override;
+    bool wait_until(std::condition_variable& cv, std::unique_lock<std::mutex>& lock,
+                    SteadyTime when, const std::function<bool()>& interrupted) override;
+    bool is_realtime() const override;
+    
+    // Moves time forward (never backwards) and wakes the sleepers now due
+    void advance_to(SystemTime time);
+    void advance(std::chrono::nanoseconds duration);
+    
+    // Blocks until at least count threads sleep in wait_until() and none of
+    // them is due at the current instant. False on timeout.
+    bool wait_for_sleepers(size_t count, std::chrono::milliseconds timeout);
+    
+    // Earliest instant a sleeper wants to wake at, SystemTime::max() if none
+    SystemTime get_next_wakeup() const;
+    
+    size_t get_step_count() const;
+
+private:
+    struct Sleeper {
+        SteadyTime when;
+        std::condition_variable* cv;
+        std::mutex* mutex;
+        bool asleep;
+    };
+    
+    SteadyTime steady_now_locked() const;
+    
+    mutable std::mutex mutex_;
+    std::condition_variable sleepers_changed_;
+    std::vector<Sleeper*> sleepers_;
+    
+    const SystemTime system_start_;
+    const SteadyTime steady_start_;
+    std::chrono::nanoseconds elapsed_;
+    size_t steps_;
+    
+    // Prevent copying
+    SimulatedClock(const SimulatedClock&) = delete;
+    SimulatedClock& operator=(const SimulatedClock&) = delete;
+};
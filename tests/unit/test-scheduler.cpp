@@ -1,11 +1,31 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cstdio>
 #include "scheduler-core.h"
 #include "playlist-manager.h"
 #include "media-controller.h"
 #include "time-trigger.h"
 #include "utils/config.h"
 #include "utils/logger.h"
+#include "utils/deadline-queue.h"
+#include "utils/latency-histogram.h"
+#include "utils/worker-pool.h"
+#include "schedule-parser.h"
+#include "schedule-cache.h"
+#include "media-probe.h"
+#include "channel.h"
+#include "frame-trigger.h"
+#include "command-queue.h"
+#include "source-registry.h"
+#include "scene-item-index.h"
+#include "item-transaction.h"
+#include "mocks/obs-mock.h"
+#include "mocks/simulated-clock.h"
 
 using ::testing::_;
 using ::testing::Return;
@@ -19,7 +39,7 @@ public:
     MOCK_METHOD(bool, load_schedule_file, (const std::string&), (override));
     MOCK_METHOD(void, unload_schedule_file, (const std::string&), (override));
     MOCK_METHOD(void, reload_schedules, (), (override));
-    MOCK_METHOD(std::shared_ptr<ScheduledItem>, get_item, (const std::string&), (override));
+    MOCK_METHOD(std::shared_ptr<const ScheduledItem>, get_item, (const std::string&), (const, override));
 };
 
 class MockMediaController : public MediaController {
@@ -153,9 +173,9 @@ TEST_F(TimeTriggerTest, TimeUtilitiesTest) {
     std::string current_day = time_trigger->get_current_day();
     EXPECT_FALSE(current_day.empty());
     
-    int current_minutes = time_trigger->get_current_minutes();
-    EXPECT_GE(current_minutes, 0);
-    EXPECT_LT(current_minutes, 24 * 60);
+    int32_t current_ms = time_trigger->get_current_ms();
+    EXPECT_GE(current_ms, 0);
+    EXPECT_LT(current_ms, ScheduleTimeline::MS_PER_DAY);
 }
 
 TEST_F(TimeTriggerTest, ScheduleManagementTest) {
@@ -187,6 +207,1231 @@ TEST_F(TimeTriggerTest, CurrentItemsTest) {
     EXPECT_TRUE(upcoming_items.empty() || !upcoming_items.empty()); // Should not crash
 }
 
+TEST(DeadlineQueueTest, PopsInDeadlineOrder) {
+    DeadlineQueue deadlines;
+    auto now = std::chrono::steady_clock::now();
+    
+    for (int offset : {30, 10, 20}) {
+        Deadline deadline;
+        deadline.when = now + std::chrono::milliseconds(offset);
+        deadline.slot_ms = offset;
+        deadlines.push(deadline);
+    }
+    
+    EXPECT_EQ(deadlines.top().slot_ms, 10);
+    EXPECT_TRUE(deadlines.pop_due(now).empty());
+    
+    auto due = deadlines.pop_due(now + std::chrono::milliseconds(25));
+    ASSERT_EQ(due.size(), 2);
+    EXPECT_EQ(due[0].slot_ms, 10);
+    EXPECT_EQ(due[1].slot_ms, 20);
+    EXPECT_EQ(deadlines.size(), 1);
+}
+
+TEST(DeadlineQueueTest, WaitWakesAtDeadline) {
+    DeadlineQueue deadlines;
+    std::condition_variable cv;
+    std::mutex mutex;
+    
+    Deadline deadline;
+    deadline.when = std::chrono::steady_clock::now() + std::chrono::milliseconds(50);
+    deadlines.push(deadline);
+    
+    std::unique_lock<std::mutex> lock(mutex);
+    EXPECT_TRUE(deadlines.wait(cv, lock, [] { return false; }));
+    
+    auto lateness = std::chrono::steady_clock::now() - deadline.when;
+    EXPECT_GE(lateness.count(), 0);
+    EXPECT_LT(lateness, std::chrono::milliseconds(1));
+    EXPECT_EQ(deadlines.get_wakeup_count(), 1);
+}
+
+TEST(DeadlineQueueTest, WaitReturnsOnInterrupt) {
+    DeadlineQueue deadlines;
+    std::condition_variable cv;
+    std::mutex mutex;
+    
+    std::unique_lock<std::mutex> lock(mutex);
+    EXPECT_FALSE(deadlines.wait(cv, lock, [] { return true; }));
+}
+
+TEST(ChannelTest, StatusSnapshotIsImmutable) {
+    Channel channel("main", 0);
+    ASSERT_TRUE(channel.initialize());
+    FrameTrigger frame_trigger;
+    
+    auto before = channel.get_status_snapshot();
+    
+    Deadline deadline;
+    deadline.item_ids.push_back("item-1");
+    channel.handle_deadline(deadline, frame_trigger);
+    
+    // Readers holding the old snapshot keep a consistent view
+    EXPECT_EQ(before->current_item, "");
+    EXPECT_EQ(channel.get_status_snapshot()->current_item, "item-1");
+    EXPECT_NE(channel.get_status().last_trigger_time.time_since_epoch().count(), 0);
+}
+
+TEST(ChannelTest, ReloadPatchKeepsArmedItem) {
+    obs_mock::reset();
+    obs_mock::create_scene("Program");
+    obs_mock::set_current_scene("Program");
+    obs_mock::create_media_source("News");
+    obs_mock::create_media_source("Weather");
+    obs_mock::add_to_scene("Program", "News");
+    obs_mock::add_to_scene("Program", "Weather");
+    
+    // Monday 2024-01-01, 08:55 local time
+    std::tm start_tm = {};
+    start_tm.tm_year = 124;
+    start_tm.tm_mday = 1;
+    start_tm.tm_hour = 8;
+    start_tm.tm_min = 55;
+    start_tm.tm_isdst = -1;
+    auto clock = std::make_shared<SimulatedClock>(std::chrono::system_clock::from_time_t(std::mktime(&start_tm)));
+    
+    Channel channel("main", 0);
+    channel.set_clock(clock);
+    ASSERT_TRUE(channel.initialize());
+    FrameTrigger frame_trigger;
+    DeadlineQueue deadlines;
+    deadlines.set_clock(clock);
+    
+    Playlist playlist;
+    playlist.name = "Morning";
+    for (const auto& name : {"News", "Weather"}) {
+        ScheduledItem item;
+        item.name = name;
+        item.source = name;
+        item.time = item.name == "News" ? "09:00" : "10:00";
+        item.days = {"monday"};
+        playlist.items.push_back(item);
+    }
+    auto* playlist_manager = channel.get_playlist_manager();
+    playlist_manager->add_playlist("morning.json", playlist);
+    
+    // News is pre-rolled ten minutes ahead, i.e. right away
+    channel.arm_deadlines(deadlines, 600);
+    for (const auto& deadline : deadlines.pop_due(clock->steady_now())) {
+        channel.handle_deadline(deadline, frame_trigger);
+    }
+    std::string armed = channel.get_status_snapshot()->armed_item;
+    ASSERT_FALSE(armed.empty());
+    
+    // Another day's edit leaves today's deadlines as they are
+    Playlist tuesday;
+    tuesday.name = "Tuesday";
+    tuesday.items.push_back(playlist.items[0]);
+    tuesday.items[0].name = "Rerun";
+    tuesday.items[0].days = {"tuesday"};
+    playlist_manager->add_playlist("tuesday.json", tuesday);
+    size_t armed_count = deadlines.size();
+    channel.patch_deadlines(deadlines, 600, frame_trigger);
+    EXPECT_EQ(deadlines.size(), armed_count);
+    
+    // Moving Weather replaces its deadlines only; News stays armed
+    playlist.items[1].time = "10:30";
+    playlist_manager->add_playlist("morning.json", playlist);
+    channel.patch_deadlines(deadlines, 600, frame_trigger);
+    EXPECT_EQ(channel.get_status_snapshot()->armed_item, armed);
+    
+    std::vector<std::string> triggers;
+    for (const auto& deadline : deadlines.pop_due(Clock::SteadyTime::max())) {
+        if (deadline.kind == Deadline::Kind::Trigger) {
+            triggers.push_back(ScheduleTimeline::format_time(deadline.slot_ms));
+        }
+    }
+    EXPECT_EQ(triggers, (std::vector<std::string>{"09:00", "10:30"}));
+}
+
+TEST(FrameTriggerTest, FiresOnFirstFrameAtOrPastItsInstant) {
+    obs_mock::reset();
+    obs_mock::set_fps(60, 1);
+    uint64_t start_ns = 10000000000ULL;
+    obs_mock::set_time_ns(start_ns);
+    auto wall = std::chrono::system_clock::from_time_t(1704096000);
+    auto clock = std::make_shared<SimulatedClock>(wall);
+    
+    std::vector<std::pair<size_t, std::string>> fired;
+    std::vector<uint64_t> fired_ns;
+    FrameTrigger trigger;
+    trigger.set_clock(clock);
+    ASSERT_TRUE(trigger.initialize([&](size_t channel, const std::string& item_id) {
+        fired.emplace_back(channel, item_id);
+        fired_ns.push_back(obs_get_video_frame_time());
+    }));
+    
+    // Two channels, one instant on a frame boundary and one half a frame past it
+    const uint64_t frame_ns = 1000000000ULL / 60;
+    trigger.arm(0, "news", wall + std::chrono::nanoseconds(6 * frame_ns));
+    trigger.arm(1, "weather", wall + std::chrono::nanoseconds(7 * frame_ns + frame_ns / 2));
+    trigger.arm(0, "dropped", wall + std::chrono::milliseconds(50));
+    trigger.arm(0, "news", wall + std::chrono::nanoseconds(6 * frame_ns));     // Re-arming replaces
+    trigger.disarm(0, "dropped");
+    EXPECT_EQ(trigger.get_armed_count(), 2u);
+    
+    for (uint64_t frame = 1; frame <= 12; ++frame) {
+        obs_mock::set_time_ns(start_ns + frame * frame_ns);
+        obs_mock::tick();
+        if (frame == 5) {
+            EXPECT_TRUE(fired.empty());
+        }
+    }
+    trigger.cleanup();
+    
+    ASSERT_EQ(fired.size(), 2u);
+    EXPECT_EQ(fired[0], std::make_pair(size_t(0), std::string("news")));
+    EXPECT_EQ(fired[1], std::make_pair(size_t(1), std::string("weather")));
+    EXPECT_EQ(fired_ns[0], start_ns + 6 * frame_ns);
+    EXPECT_EQ(fired_ns[1], start_ns + 8 * frame_ns);
+    EXPECT_EQ(trigger.get_armed_count(), 0u);
+    
+    auto records = trigger.get_records();
+    ASSERT_EQ(records.size(), 2u);
+    EXPECT_EQ(records[0].target_ns, start_ns + 6 * frame_ns);
+    EXPECT_EQ(records[0].frame_ns, start_ns + 6 * frame_ns);
+    EXPECT_EQ(records[0].offset_ns, 0);
+    EXPECT_DOUBLE_EQ(records[0].offset_frames, 0.0);
+    EXPECT_EQ(records[1].channel, 1u);
+    EXPECT_EQ(records[1].offset_ns, static_cast<int64_t>(frame_ns - frame_ns / 2));
+    EXPECT_NEAR(records[1].offset_frames, 0.5, 1e-6);
+}
+
+TEST(CommandQueueTest, RunsBatchInOrderOnUiThread) {
+    obs_mock::reset();
+    CommandQueue queue;
+    std::vector<int> order;
+    
+    CommandBatch batch;
+    batch.add("first", [&order] { order.push_back(1); return true; });
+    batch.add("second", [&order] { order.push_back(2); return false; });
+    auto future = queue.submit("test", std::move(batch));
+    
+    // Nothing runs on the submitting thread
+    EXPECT_TRUE(order.empty());
+    EXPECT_EQ(queue.get_depth(), 1u);
+    
+    EXPECT_EQ(obs_mock::run_pending_tasks(), 1u);
+    BatchResult result = future.get();
+    
+    EXPECT_EQ(order, std::vector<int>({1, 2}));
+    EXPECT_TRUE(result.executed);
+    EXPECT_FALSE(result.ok);
+    ASSERT_EQ(result.commands.size(), 2u);
+    EXPECT_EQ(result.commands[0].name, "first");
+    EXPECT_TRUE(result.commands[0].ok);
+    EXPECT_FALSE(result.commands[1].ok);
+    EXPECT_EQ(queue.get_depth(), 0u);
+    EXPECT_EQ(queue.get_stats().completed, 1u);
+}
+
+TEST(CommandQueueTest, VideoTickBatchesQueueBehindUiBatches) {
+    obs_mock::reset();
+    CommandQueue queue;
+    std::vector<std::string> order;
+    
+    CommandBatch arm;
+    arm.add("hold", [&order] { order.push_back("hold"); return true; });
+    auto armed = queue.submit("arm", std::move(arm));
+    
+    // Submitted from the tick, the batch neither runs on the video thread nor jumps the queue
+    struct TickSubmit {
+        CommandQueue* queue;
+        std::vector<std::string>* order;
+        std::future<BatchResult> future;
+        bool on_graphics = false;
+    } submit{&queue, &order, {}};
+    auto on_tick = [](void* data, float) {
+        auto* tick = static_cast<TickSubmit*>(data);
+        CommandBatch fire;
+        fire.add("switch_scene", [tick] {
+            tick->on_graphics = obs_in_task_thread(OBS_TASK_GRAPHICS);
+            tick->order->push_back("switch_scene");
+            return true;
+        });
+        tick->future = tick->queue->submit("fire", std::move(fire));
+    };
+    obs_add_tick_callback(on_tick, &submit);
+    obs_mock::tick();
+    obs_remove_tick_callback(on_tick, &submit);
+    EXPECT_TRUE(order.empty());
+    EXPECT_EQ(queue.get_depth(), 2u);
+    
+    // A batch submitted from a running one waits for it instead of running inside it
+    std::future<BatchResult> nested;
+    CommandBatch outer;
+    outer.add("outer", [&queue, &order, &nested] {
+        CommandBatch inner;
+        inner.add("inner", [&order] { order.push_back("inner"); return true; });
+        nested = queue.submit("inner", std::move(inner));
+        order.push_back("outer");
+        return true;
+    });
+    auto outer_future = queue.submit("outer", std::move(outer));
+    
+    while (obs_mock::run_pending_tasks() > 0) {
+    }
+    EXPECT_TRUE(armed.get().ok);
+    EXPECT_TRUE(submit.future.get().ok);
+    EXPECT_TRUE(outer_future.get().ok);
+    EXPECT_TRUE(nested.get().ok);
+    EXPECT_EQ(order, std::vector<std::string>({"hold", "switch_scene", "outer", "inner"}));
+    EXPECT_FALSE(submit.on_graphics);
+}
+
+TEST(CommandQueueTest, ClosedQueueSkipsPendingBatches) {
+    obs_mock::reset();
+    bool ran = false;
+    std::future<BatchResult> future;
+    
+    {
+        CommandQueue queue;
+        CommandBatch batch;
+        batch.add("late", [&ran] { ran = true; return true; });
+        future = queue.submit("test", std::move(batch));
+    }
+    
+    obs_mock::run_pending_tasks();
+    EXPECT_FALSE(ran);
+    EXPECT_FALSE(future.get().executed);
+}
+
+TEST(SourceRegistryTest, FollowsSourcesCreatedRemovedAndRenamed) {
+    obs_mock::reset();
+    obs_mock::create_scene("Program");
+    obs_source_t* news = obs_mock::create_media_source("News");
+    
+    SourceRegistry registry;
+    std::vector<obs_source_t*> removed;
+    registry.set_removed_callback([&removed](obs_source_t* source) { removed.push_back(source); });
+    registry.start();
+    
+    EXPECT_EQ(registry.size(), 2u);
+    EXPECT_EQ(registry.find("News", SourceRegistry::Kind::Media), news);
+    EXPECT_EQ(registry.find("News", SourceRegistry::Kind::Scene), nullptr);
+    EXPECT_NE(registry.find_scene("Program"), nullptr);
+    EXPECT_EQ(registry.find_scene("News"), nullptr);
+    
+    obs_source_t* weather = obs_mock::create_media_source("Weather");
+    EXPECT_EQ(registry.find("Weather", SourceRegistry::Kind::Media), weather);
+    
+    ASSERT_TRUE(obs_mock::rename_source("News", "Headlines"));
+    EXPECT_EQ(registry.find("News", SourceRegistry::Kind::Media), nullptr);
+    EXPECT_EQ(registry.find("Headlines", SourceRegistry::Kind::Media), news);
+    
+    // source_remove and source_destroy both arrive, the source is reported once
+    ASSERT_TRUE(obs_mock::remove_source("Headlines"));
+    EXPECT_EQ(registry.find("Headlines", SourceRegistry::Kind::Media), nullptr);
+    EXPECT_EQ(removed, std::vector<obs_source_t*>({news}));
+    EXPECT_EQ(registry.size(), 2u);
+    
+    // The old name can be taken again
+    obs_source_t* news_again = obs_mock::create_media_source("News");
+    EXPECT_EQ(registry.find("News", SourceRegistry::Kind::Media), news_again);
+    
+    registry.stop();
+    EXPECT_EQ(registry.size(), 0u);
+    obs_mock::create_media_source("Sport");
+    EXPECT_EQ(registry.find("Sport", SourceRegistry::Kind::Media), nullptr);
+}
+
+TEST(SourceRegistryTest, ControllerFollowsRenamedAndRemovedSources) {
+    obs_mock::reset();
+    obs_mock::set_time_ns(1000000000ULL);
+    obs_mock::create_media_source("News");
+    obs_mock::set_media_duration("News", 500);
+    
+    MediaController controller;
+    ASSERT_TRUE(controller.initialize());
+    std::vector<std::string> events;
+    controller.set_media_event_callback([&events](const std::string& source_name, const std::string& event) {
+        events.push_back(source_name + " " + event);
+    });
+    
+    ASSERT_TRUE(controller.play_media("News"));
+    ASSERT_TRUE(obs_mock::rename_source("News", "Headlines"));
+    EXPECT_FALSE(controller.validate_media_source("News"));
+    EXPECT_TRUE(controller.validate_media_source("Headlines"));
+    
+    // Signals connected under the old name report the new one
+    obs_mock::set_time_ns(2000000000ULL);
+    obs_mock::tick();
+    EXPECT_EQ(events, std::vector<std::string>({"Headlines ended"}));
+    
+    ASSERT_TRUE(obs_mock::remove_source("Headlines"));
+    EXPECT_FALSE(controller.validate_media_source("Headlines"));
+    EXPECT_FALSE(controller.play_media("Headlines"));
+    
+    controller.cleanup();
+}
+
+TEST(SceneItemIndexTest, FollowsItemSignalsAndBatchesVisibility) {
+    obs_mock::reset();
+    obs_mock::create_scene("Program");
+    obs_mock::set_current_scene("Program");
+    for (const char* name : {"News", "Weather", "Sport"}) {
+        obs_mock::create_media_source(name);
+        obs_mock::add_to_scene("Program", name);
+    }
+    obs_scene_t* scene = obs_scene_from_source(obs_get_source_by_name("Program"));
+    
+    SceneItemIndex index;
+    index.start();
+    EXPECT_NE(index.find(scene, "News"), nullptr);
+    EXPECT_EQ(index.find(scene, "Missing"), nullptr);
+    EXPECT_TRUE(index.is_visible(scene, "News"));
+    
+    // Once indexed, lookups no longer walk the scene
+    obs_mock::reset_call_count();
+    for (int i = 0; i < 100; ++i) {
+        index.find(scene, "Sport");
+    }
+    EXPECT_EQ(obs_mock::get_call_count(), 0u);
+    
+    size_t updates = obs_mock::get_atomic_update_count();
+    EXPECT_EQ(index.set_visible(scene, {{"News", false}, {"Weather", false}, {"Missing", true}}), 2u);
+    EXPECT_EQ(obs_mock::get_atomic_update_count(), updates + 1);
+    EXPECT_FALSE(obs_mock::is_visible("Program", "News"));
+    EXPECT_FALSE(index.is_visible(scene, "Weather"));
+    
+    obs_mock::create_media_source("Traffic");
+    obs_mock::add_to_scene("Program", "Traffic");
+    EXPECT_NE(index.find(scene, "Traffic"), nullptr);
+    
+    ASSERT_TRUE(obs_mock::remove_from_scene("Program", "Sport"));
+    EXPECT_EQ(index.find(scene, "Sport"), nullptr);
+    
+    ASSERT_TRUE(obs_mock::rename_source("News", "Headlines"));
+    EXPECT_EQ(index.find(scene, "News"), nullptr);
+    bool found = false;
+    EXPECT_FALSE(index.is_visible(scene, "Headlines", &found));
+    EXPECT_TRUE(found);
+    
+    // Changes made behind the index's back arrive as item_visible
+    obs_sceneitem_set_visible(index.find(scene, "Headlines"), true);
+    EXPECT_TRUE(index.is_visible(scene, "Headlines"));
+    
+    index.forget(scene);
+    EXPECT_EQ(index.get_scene_count(), 0u);
+    index.stop();
+    
+    // The controller applies several changes to the current scene in one update
+    MediaController controller;
+    ASSERT_TRUE(controller.initialize());
+    updates = obs_mock::get_atomic_update_count();
+    EXPECT_TRUE(controller.set_sources_visibility({{"Headlines", false}, {"Traffic", false}}));
+    EXPECT_EQ(obs_mock::get_atomic_update_count(), updates + 1);
+    EXPECT_FALSE(controller.get_source_visibility("Headlines"));
+    EXPECT_FALSE(controller.get_source_visibility("Traffic"));
+    EXPECT_FALSE(controller.set_sources_visibility({{"Weather", true}, {"Sport", true}}));
+    EXPECT_TRUE(controller.get_source_visibility("Weather"));
+    controller.cleanup();
+}
+
+static std::string get_media_file(obs_source_t* source) {
+    obs_data_t* settings = obs_source_get_settings(source);
+    std::string file = obs_data_get_string(settings, "file");
+    obs_data_release(settings);
+    return file;
+}
+
+TEST(ItemTransactionTest, AppliesTogetherAndRollsBack) {
+    obs_mock::reset();
+    obs_mock::create_scene("Program");
+    obs_mock::create_scene("Studio");
+    obs_mock::set_current_scene("Program");
+    obs_source_t* promo = obs_mock::create_media_source("Promo");
+    obs_source_t* news = obs_mock::create_media_source("News");
+    obs_mock::add_to_scene("Program", "Promo");
+    obs_mock::add_to_scene("Studio", "News");
+    obs_scene_t* program = obs_scene_from_source(obs_get_source_by_name("Program"));
+    obs_scene_t* studio = obs_scene_from_source(obs_get_source_by_name("Studio"));
+    
+    SceneItemIndex index;
+    index.start();
+    ASSERT_TRUE(index.set_visible(studio, {{"News", false}}));
+    
+    // Prepared in the studio scene while the programme is still on air, then switched to
+    size_t updates = obs_mock::get_atomic_update_count();
+    ItemTransaction start(index);
+    start.set_scene(studio);
+    start.set_visible("News", true);
+    start.load_file(news, "/media/news.mp4");
+    start.play(news);
+    ASSERT_TRUE(start.commit());
+    EXPECT_EQ(obs_mock::get_current_scene(), "Studio");
+    EXPECT_TRUE(obs_mock::is_visible("Studio", "News"));
+    EXPECT_EQ(get_media_file(news), "/media/news.mp4");
+    EXPECT_EQ(obs_mock::get_media_state("News"), OBS_MEDIA_STATE_PLAYING);
+    EXPECT_EQ(obs_mock::get_atomic_update_count(), updates + 1);
+    EXPECT_EQ(start.get_frame_span(), 0);
+    EXPECT_FALSE(start.is_rolled_back());
+    
+    // A source missing from the scene stops the transaction before it changes anything
+    ItemTransaction missing(index);
+    missing.set_scene(program);
+    missing.set_visible("Missing", true);
+    missing.play(promo);
+    EXPECT_FALSE(missing.commit());
+    EXPECT_FALSE(missing.is_rolled_back());
+    EXPECT_EQ(obs_mock::get_current_scene(), "Studio");
+    EXPECT_EQ(obs_mock::get_media_state("Promo"), OBS_MEDIA_STATE_NONE);
+    EXPECT_EQ(missing.get_frame_span(), -1);
+    
+    // In studio mode the switch does not reach the programme, so every step is undone
+    obs_data_t* settings = obs_source_get_settings(promo);
+    obs_data_set_string(settings, "file", "/media/promo.mp4");
+    obs_source_update(promo, settings);
+    obs_data_release(settings);
+    obs_source_media_play_pause(promo, true);
+    obs_mock::set_studio_mode(true);
+    
+    ItemTransaction rejected(index);
+    rejected.set_scene(program);
+    rejected.set_visible("Promo", false);
+    rejected.load_file(promo, "/media/promo-2.mp4");
+    rejected.play(promo);
+    EXPECT_FALSE(rejected.commit());
+    EXPECT_TRUE(rejected.is_rolled_back());
+    EXPECT_FALSE(rejected.get_error().empty());
+    EXPECT_EQ(obs_mock::get_current_scene(), "Studio");
+    EXPECT_TRUE(obs_mock::is_visible("Program", "Promo"));
+    EXPECT_EQ(get_media_file(promo), "/media/promo.mp4");
+    EXPECT_EQ(obs_mock::get_media_state("Promo"), OBS_MEDIA_STATE_PAUSED);
+    obs_mock::set_studio_mode(false);
+    index.stop();
+    
+    // The controller runs an item as one transaction in its batch
+    MediaController controller;
+    ASSERT_TRUE(controller.initialize());
+    ScheduledItem item;
+    item.id = "promo";
+    item.name = "Promo";
+    item.source = "Promo";
+    item.scene = "Program";
+    item.file_path = "/media/promo-3.mp4";
+    auto result = controller.execute_item_async(item);
+    obs_mock::run_pending_tasks();
+    BatchResult batch = result.get();
+    EXPECT_TRUE(batch.ok);
+    ASSERT_FALSE(batch.commands.empty());
+    EXPECT_EQ(batch.commands[0].name, "apply");
+    EXPECT_EQ(obs_mock::get_current_scene(), "Program");
+    EXPECT_EQ(get_media_file(promo), "/media/promo-3.mp4");
+    EXPECT_EQ(obs_mock::get_media_state("Promo"), OBS_MEDIA_STATE_PLAYING);
+    controller.cleanup();
+}
+
+TEST(PrerollTest, HoldsTheFileHiddenUntilFired) {
+    obs_mock::reset();
+    obs_mock::create_scene("Program");
+    obs_mock::set_current_scene("Program");
+    obs_source_t* news_player = obs_mock::create_media_source("News");
+    obs_mock::create_media_source("Weather");
+    obs_mock::add_to_scene("Program", "News");
+    obs_mock::add_to_scene("Program", "Weather");
+    obs_mock::set_media_latency(std::chrono::milliseconds(200), std::chrono::milliseconds(0));
+    uint64_t now_ns = 1000000000ULL;
+    obs_mock::set_time_ns(now_ns);
+    
+    MediaController controller;
+    ASSERT_TRUE(controller.initialize());
+    ScheduledItem news;
+    news.id = "news";
+    news.name = "News";
+    news.source = "News";
+    news.scene = "Program";
+    news.file_path = "/media/news.mp4";
+    ScheduledItem weather = news;
+    weather.id = "weather";
+    weather.name = "Weather";
+    weather.source = "Weather";
+    weather.file_path = "/media/weather.mp4";
+    
+    // Armed: hidden, loaded, held on its first frame and kept showing
+    ASSERT_TRUE(controller.arm_item(news));
+    EXPECT_TRUE(controller.arm_item(news));     // Arming twice is a no-op
+    EXPECT_TRUE(controller.is_item_armed("news"));
+    obs_mock::run_pending_tasks();
+    EXPECT_FALSE(obs_mock::is_visible("Program", "News"));
+    EXPECT_EQ(get_media_file(news_player), "/media/news.mp4");
+    EXPECT_EQ(obs_mock::get_showing_count("News"), 1);
+    now_ns += 250000000ULL;
+    obs_mock::set_time_ns(now_ns);
+    EXPECT_EQ(obs_mock::get_media_state("News"), OBS_MEDIA_STATE_PAUSED);
+    
+    // A second file on the same source would replace the first
+    ScheduledItem rerun = news;
+    rerun.id = "rerun";
+    EXPECT_FALSE(controller.arm_item(rerun));
+    
+    // Fired: revealed and unpaused, and the hold lets go of the source
+    auto result = controller.execute_item_async(news);
+    obs_mock::run_pending_tasks();
+    EXPECT_TRUE(result.get().ok);
+    EXPECT_FALSE(controller.is_item_armed("news"));
+    EXPECT_TRUE(obs_mock::is_visible("Program", "News"));
+    EXPECT_EQ(obs_mock::get_media_state("News"), OBS_MEDIA_STATE_PLAYING);
+    EXPECT_EQ(obs_mock::get_showing_count("News"), 0);
+    for (int frame = 0; frame < 10 && controller.get_start_latency_records().empty(); ++frame) {
+        now_ns += 16666667ULL;
+        obs_mock::set_time_ns(now_ns);
+        obs_mock::tick();
+    }
+    auto records = controller.get_start_latency_records();
+    ASSERT_EQ(records.size(), 1u);
+    EXPECT_EQ(records[0].item_id, "news");
+    EXPECT_TRUE(records[0].prerolled);
+    
+    // Disarmed: the hold is released, the source stays hidden
+    ASSERT_TRUE(controller.arm_item(weather));
+    obs_mock::run_pending_tasks();
+    EXPECT_EQ(obs_mock::get_showing_count("Weather"), 1);
+    controller.disarm_all();
+    obs_mock::run_pending_tasks();
+    EXPECT_FALSE(controller.is_item_armed("weather"));
+    EXPECT_EQ(obs_mock::get_showing_count("Weather"), 0);
+    EXPECT_FALSE(obs_mock::is_visible("Program", "Weather"));
+    controller.cleanup();
+}
+
+TEST(PrerollTest, LeavesSourcesOnAirAlone) {
+    obs_mock::reset();
+    obs_mock::create_scene("Program");
+    obs_mock::set_current_scene("Program");
+    obs_source_t* news_player = obs_mock::create_media_source("News");
+    obs_source_t* weather_player = obs_mock::create_media_source("Weather");
+    obs_mock::add_to_scene("Program", "News");
+    obs_mock::add_to_scene("Program", "Weather");
+    uint64_t now_ns = 1000000000ULL;
+    obs_mock::set_time_ns(now_ns);
+    
+    MediaController controller;
+    ASSERT_TRUE(controller.initialize());
+    ScheduledItem news;
+    news.id = "news";
+    news.name = "News";
+    news.source = "News";
+    news.scene = "Program";
+    news.file_path = "/media/news.mp4";
+    ScheduledItem weather = news;
+    weather.id = "weather";
+    weather.name = "Weather";
+    weather.source = "Weather";
+    weather.file_path = "/media/weather.mp4";
+    
+    // Idle content playing on a visible source, which no item owns
+    obs_data_t* settings = obs_source_get_settings(news_player);
+    obs_data_set_string(settings, "file", "/media/idle.mp4");
+    obs_source_update(news_player, settings);
+    obs_data_release(settings);
+    obs_source_media_play_pause(news_player, false);
+    EXPECT_FALSE(controller.arm_item(news));
+    obs_mock::run_pending_tasks();
+    EXPECT_TRUE(obs_mock::is_visible("Program", "News"));
+    EXPECT_EQ(get_media_file(news_player), "/media/idle.mp4");
+    
+    // Once it has stopped, the source is free to pre-roll
+    obs_source_media_stop(news_player);
+    EXPECT_TRUE(controller.arm_item(news));
+    controller.disarm_all();
+    obs_mock::run_pending_tasks();
+    
+    // A join still seeking is not on air yet, but it owns its source
+    ASSERT_TRUE(controller.join_item(weather, 5000, now_ns));
+    EXPECT_FALSE(controller.arm_item(weather));
+    obs_mock::run_pending_tasks();
+    EXPECT_FALSE(controller.arm_item(weather));
+    EXPECT_EQ(get_media_file(weather_player), "/media/weather.mp4");
+    controller.cleanup();
+}
+
+TEST(PrerollTest, ArmingStateNamesTheArmedItem) {
+    obs_mock::reset();
+    obs_mock::create_scene("Program");
+    obs_mock::set_current_scene("Program");
+    obs_mock::create_media_source("News");
+    obs_mock::add_to_scene("Program", "News");
+    
+    SchedulerCore scheduler;
+    ASSERT_TRUE(scheduler.initialize());
+    EXPECT_EQ(scheduler.get_arming_state(), "None");
+    
+    Playlist playlist;
+    playlist.name = "Morning";
+    ScheduledItem news;
+    news.name = "News";
+    news.time = "09:00";
+    news.source = "News";
+    news.file_path = "/media/news.mp4";
+    news.days = {"monday"};
+    playlist.items.push_back(news);
+    Channel* channel = scheduler.get_channel(0);
+    channel->get_playlist_manager()->add_playlist("morning.json", playlist);
+    std::string item_id = channel->get_playlist_manager()->get_playlists()[0].items[0].id;
+    
+    FrameTrigger frame_trigger;
+    Deadline preroll;
+    preroll.kind = Deadline::Kind::Preroll;
+    preroll.item_ids.push_back(item_id);
+    channel->handle_deadline(preroll, frame_trigger);
+    obs_mock::run_pending_tasks();
+    EXPECT_EQ(channel->get_arming_state(), "Armed: " + item_id);
+    EXPECT_EQ(scheduler.get_arming_state(), "Armed: " + item_id);
+    EXPECT_EQ(obs_mock::get_showing_count("News"), 1);
+    
+    channel->disarm_items();
+    obs_mock::run_pending_tasks();
+    EXPECT_EQ(scheduler.get_arming_state(), "None");
+    EXPECT_EQ(obs_mock::get_showing_count("News"), 0);
+}
+
+TEST(TwinSourceTest, LoadsIntoHiddenTwinAndSwapsInOneUpdate) {
+    obs_mock::reset();
+    obs_mock::create_scene("Program");
+    obs_mock::set_current_scene("Program");
+    obs_source_t* player = obs_mock::create_media_source("Player");
+    obs_source_t* twin = obs_mock::create_media_source("Player (B)");
+    obs_mock::add_to_scene("Program", "Player");
+    obs_mock::add_to_scene("Program", "Player (B)");
+    obs_mock::set_media_latency(std::chrono::milliseconds(200), std::chrono::milliseconds(0));
+    uint64_t now_ns = 1000000000ULL;
+    obs_mock::set_time_ns(now_ns);
+    
+    MediaController controller;
+    ASSERT_TRUE(controller.initialize());
+    std::vector<std::string> events;
+    controller.set_media_event_callback([&events](const std::string& source_name, const std::string& event) {
+        events.push_back(source_name + " " + event);
+    });
+    EXPECT_TRUE(controller.has_twin_source("Player"));
+    EXPECT_FALSE(controller.has_twin_source("Player (B)"));
+    auto sources = controller.get_media_sources();
+    EXPECT_EQ(sources, std::vector<std::string>{"Player"});
+    
+    ScheduledItem first;
+    first.id = "first";
+    first.name = "First";
+    first.source = "Player";
+    first.scene = "Program";
+    first.file_path = "/media/first.mp4";
+    ScheduledItem second = first;
+    second.id = "second";
+    second.name = "Second";
+    second.file_path = "/media/second.mp4";
+    
+    // Each item pre-rolls into whichever of the pair is hidden, and goes on
+    // air by showing it and hiding the other in one update
+    auto play = [&](const ScheduledItem& item, obs_source_t* shown, const std::string& shown_name,
+                    const std::string& hidden_name) {
+        ASSERT_TRUE(controller.arm_item(item));
+        obs_mock::run_pending_tasks();
+        EXPECT_EQ(get_media_file(shown), item.file_path);
+        EXPECT_FALSE(obs_mock::is_visible("Program", shown_name));
+        
+        now_ns += 250000000ULL;
+        obs_mock::set_time_ns(now_ns);
+        EXPECT_EQ(obs_mock::get_media_state(shown_name), OBS_MEDIA_STATE_PAUSED);
+        
+        size_t updates = obs_mock::get_atomic_update_count();
+        auto result = controller.execute_item_async(item);
+        obs_mock::run_pending_tasks();
+        EXPECT_TRUE(result.get().ok);
+        EXPECT_EQ(obs_mock::get_atomic_update_count(), updates + 1);
+        EXPECT_TRUE(obs_mock::is_visible("Program", shown_name));
+        EXPECT_FALSE(obs_mock::is_visible("Program", hidden_name));
+        EXPECT_EQ(obs_mock::get_media_state(shown_name), OBS_MEDIA_STATE_PLAYING);
+        EXPECT_NE(obs_mock::get_media_state(hidden_name), OBS_MEDIA_STATE_PLAYING);
+    };
+    
+    play(first, twin, "Player (B)", "Player");
+    
+    // The twin keeps playing, untouched, while the next item loads into the source
+    ASSERT_TRUE(controller.arm_item(second));
+    obs_mock::run_pending_tasks();
+    EXPECT_EQ(get_media_file(twin), "/media/first.mp4");
+    EXPECT_EQ(obs_mock::get_media_state("Player (B)"), OBS_MEDIA_STATE_PLAYING);
+    EXPECT_TRUE(obs_mock::is_visible("Program", "Player (B)"));
+    controller.disarm_all();
+    obs_mock::run_pending_tasks();
+    
+    play(second, player, "Player", "Player (B)");
+    play(first, twin, "Player (B)", "Player");
+    
+    // Events of the pair come under the source's name, and only from the one on air
+    obs_mock::set_media_duration("Player (B)", 500);
+    obs_mock::set_media_duration("Player", 500);
+    obs_source_media_play_pause(player, false);
+    now_ns += 1000000000ULL;
+    obs_mock::set_time_ns(now_ns);
+    obs_mock::tick();
+    EXPECT_EQ(obs_mock::get_media_state("Player"), OBS_MEDIA_STATE_ENDED);
+    EXPECT_EQ(std::count(events.begin(), events.end(), "Player ended"), 1);
+    EXPECT_EQ(std::count(events.begin(), events.end(), "Player (B) ended"), 0);
+    controller.cleanup();
+}
+
+// Runs a week of playout against the OBS mock on a simulated clock and
+// compares the as-run log with what the schedule says should have aired
+TEST(LatencyHistogramTest, PercentilesWithinOnePercent) {
+    LatencyHistogram histogram;
+    EXPECT_EQ(histogram.get_percentile(99.0), 0);
+    
+    // 1us .. 10ms in 1us steps
+    for (int64_t us = 1; us <= 10000; ++us) {
+        histogram.record(us * 1000);
+    }
+    
+    EXPECT_EQ(histogram.get_count(), 10000u);
+    EXPECT_EQ(histogram.get_min(), 1000);
+    EXPECT_EQ(histogram.get_max(), 10000000);
+    EXPECT_NEAR(histogram.get_mean(), 5000500.0, 1.0);
+    EXPECT_NEAR(histogram.get_percentile(50.0), 5000000, 50000);
+    EXPECT_NEAR(histogram.get_percentile(99.0), 9900000, 99000);
+    EXPECT_NEAR(histogram.get_percentile(99.9), 9990000, 99900);
+    EXPECT_EQ(histogram.get_percentile(100.0), 10000000);
+    
+    // Small values are exact, huge ones only clamp the bucket
+    LatencyHistogram edges;
+    edges.record(-5);
+    edges.record(200);
+    edges.record(int64_t(1) << 40);
+    EXPECT_EQ(edges.get_min(), 0);
+    EXPECT_EQ(edges.get_percentile(50.0), 200);
+    EXPECT_EQ(edges.get_percentile(100.0), int64_t(1) << 40);
+}
+
+TEST(LatencyHistogramTest, MergeCombinesCounts) {
+    LatencyHistogram fast;
+    LatencyHistogram slow;
+    for (int i = 0; i < 90; ++i) {
+        fast.record(1000000);
+    }
+    for (int i = 0; i < 10; ++i) {
+        slow.record(50000000);
+    }
+    
+    fast.merge(slow);
+    EXPECT_EQ(fast.get_count(), 100u);
+    EXPECT_NEAR(fast.get_percentile(90.0), 1000000, 10000);
+    EXPECT_NEAR(fast.get_percentile(95.0), 50000000, 500000);
+    EXPECT_EQ(fast.get_max(), 50000000);
+}
+
+TEST(SimulationTest, TriggerLatencyIsRecordedPerStage) {
+    obs_mock::reset();
+    obs_mock::create_scene("Program");
+    obs_mock::set_current_scene("Program");
+    obs_mock::create_media_source("Media");
+    obs_mock::add_to_scene("Program", "Media");
+    
+    // Monday 2024-01-01, 07:59 local time, a minute before the news
+    std::tm start_tm = {};
+    start_tm.tm_year = 124;
+    start_tm.tm_mday = 1;
+    start_tm.tm_hour = 7;
+    start_tm.tm_min = 59;
+    start_tm.tm_isdst = -1;
+    auto start = std::chrono::system_clock::from_time_t(std::mktime(&start_tm));
+    auto clock = std::make_shared<SimulatedClock>(start);
+    
+    SchedulerCore scheduler;
+    scheduler.set_clock(clock);
+    ASSERT_TRUE(scheduler.initialize());
+    
+    Playlist playlist;
+    playlist.name = "Morning";
+    ScheduledItem news;
+    news.name = "News";
+    news.time = "08:00";
+    news.source = "Media";
+    news.file_path = "/media/news.mp4";
+    news.duration = 1800;
+    news.days = {"monday"};
+    playlist.items.push_back(news);
+    scheduler.get_channel(0)->get_playlist_manager()->add_playlist("morning.json", playlist);
+    
+    scheduler.start();
+    
+    auto trigger = start + std::chrono::minutes(1);
+    while (clock->now() < trigger) {
+        ASSERT_TRUE(clock->wait_for_sleepers(1, std::chrono::seconds(5)));
+        obs_mock::run_pending_tasks();
+        clock->advance_to(std::min(clock->get_next_wakeup(), trigger));
+    }
+    ASSERT_TRUE(clock->wait_for_sleepers(1, std::chrono::seconds(5)));
+    obs_mock::run_pending_tasks();
+    
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (scheduler.get_start_latency_records().empty() && std::chrono::steady_clock::now() < deadline) {
+        obs_mock::tick();
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    scheduler.stop();
+    
+    auto breakdowns = scheduler.get_latency_histograms();
+    ASSERT_EQ(breakdowns.size(), 1u);
+    EXPECT_EQ(breakdowns[0].source, "Media");
+    for (size_t stage = 0; stage < LATENCY_STAGE_COUNT; ++stage) {
+        EXPECT_EQ(breakdowns[0].stages[stage].get_count(), 1u) << latency_stage_name(static_cast<LatencyStage>(stage));
+    }
+    
+    // The simulated clock wakes the scheduler exactly on time
+    const auto& stages = breakdowns[0].stages;
+    EXPECT_EQ(stages[static_cast<size_t>(LatencyStage::Wakeup)].get_max(), 0);
+    EXPECT_EQ(stages[static_cast<size_t>(LatencyStage::Total)].get_max(),
+              scheduler.get_start_latency_records()[0].latency_ns);
+    
+    // No frame was rendered while the item's changes went out
+    EXPECT_EQ(scheduler.get_start_latency_records()[0].apply_frames, 0);
+    
+    std::string path = ::testing::TempDir() + "latency-histograms.csv";
+    ASSERT_TRUE(scheduler.dump_latency_histograms(path));
+    std::ifstream dump(path);
+    std::string header;
+    std::getline(dump, header);
+    EXPECT_EQ(header.rfind("channel,source,stage,count", 0), 0u);
+    size_t lines = 0;
+    for (std::string line; std::getline(dump, line);) {
+        lines++;
+    }
+    EXPECT_EQ(lines, 2 * LATENCY_STAGE_COUNT);     // "Media" and the merged "*"
+    std::remove(path.c_str());
+}
+
+TEST(SimulationTest, WeekOfPlayoutMatchesSchedule) {
+    obs_mock::reset();
+    obs_mock::create_scene("Program");
+    obs_mock::set_current_scene("Program");
+    obs_mock::create_media_source("Media");
+    obs_mock::add_to_scene("Program", "Media");
+    
+    // Monday 2024-01-01, 00:00 local time
+    std::tm start_tm = {};
+    start_tm.tm_year = 124;
+    start_tm.tm_mday = 1;
+    start_tm.tm_isdst = -1;
+    auto start = std::chrono::system_clock::from_time_t(std::mktime(&start_tm));
+    auto clock = std::make_shared<SimulatedClock>(start);
+    
+    SchedulerCore scheduler;
+    scheduler.set_clock(clock);
+    ASSERT_TRUE(scheduler.initialize());
+    
+    Playlist playlist;
+    playlist.name = "Week";
+    ScheduledItem news;
+    news.name = "News";
+    news.time = "08:00";
+    news.source = "Media";
+    news.file_path = "/media/news.mp4";
+    news.duration = 1800;
+    news.days = {"monday", "tuesday", "wednesday", "thursday", "friday"};
+    playlist.items.push_back(news);
+    ScheduledItem movie;
+    movie.name = "Movie";
+    movie.time = "20:00";
+    movie.source = "Media";
+    movie.file_path = "/media/movie.mp4";
+    movie.duration = 5400;
+    movie.days = {"saturday", "sunday"};
+    playlist.items.push_back(movie);
+    
+    auto* playlist_manager = scheduler.get_channel(0)->get_playlist_manager();
+    playlist_manager->add_playlist("week.json", playlist);
+    
+    scheduler.start();
+    
+    auto end = start + std::chrono::hours(24 * 7);
+    while (clock->now() < end) {
+        ASSERT_TRUE(clock->wait_for_sleepers(1, std::chrono::seconds(5)));
+        obs_mock::run_pending_tasks();
+        clock->advance_to(std::min(clock->get_next_wakeup(), end));
+    }
+    ASSERT_TRUE(clock->wait_for_sleepers(1, std::chrono::seconds(5)));
+    scheduler.stop();
+    
+    std::vector<std::pair<std::string, std::chrono::minutes>> expected;
+    for (int day = 0; day < 7; ++day) {
+        auto midnight = std::chrono::minutes(day * 24 * 60);
+        if (day < 5) {
+            expected.emplace_back("News", midnight + std::chrono::minutes(8 * 60));
+            expected.emplace_back("idle", midnight + std::chrono::minutes(8 * 60 + 30));
+        } else {
+            expected.emplace_back("Movie", midnight + std::chrono::minutes(20 * 60));
+            expected.emplace_back("idle", midnight + std::chrono::minutes(21 * 60 + 30));
+        }
+    }
+    
+    std::vector<std::pair<std::string, std::chrono::minutes>> as_run;
+    for (const auto& entry : scheduler.get_as_run_log()) {
+        auto item = playlist_manager->get_item(entry.item_id);
+        as_run.emplace_back(item ? item->name : entry.item_id,
+                            std::chrono::duration_cast<std::chrono::minutes>(entry.time - start));
+        EXPECT_EQ((entry.time - start) % std::chrono::minutes(1), std::chrono::system_clock::duration::zero());
+    }
+    
+    EXPECT_EQ(as_run, expected);
+}
+
+TEST(SimulationTest, StartupJoinsItemInProgress) {
+    obs_mock::reset();
+    obs_mock::create_scene("Program");
+    obs_mock::set_current_scene("Program");
+    obs_mock::create_media_source("Media");
+    obs_mock::add_to_scene("Program", "Media");
+    obs_mock::set_media_duration("Media", 1800 * 1000);
+    obs_mock::set_media_latency(std::chrono::milliseconds(100), std::chrono::milliseconds(50));
+    
+    // Monday 2024-01-01, 08:10 local time: ten minutes into the news
+    std::tm start_tm = {};
+    start_tm.tm_year = 124;
+    start_tm.tm_mday = 1;
+    start_tm.tm_hour = 8;
+    start_tm.tm_min = 10;
+    start_tm.tm_isdst = -1;
+    auto start = std::chrono::system_clock::from_time_t(std::mktime(&start_tm));
+    auto clock = std::make_shared<SimulatedClock>(start);
+    
+    SchedulerCore scheduler;
+    scheduler.set_clock(clock);
+    ASSERT_TRUE(scheduler.initialize());
+    
+    Playlist playlist;
+    playlist.name = "Morning";
+    ScheduledItem news;
+    news.name = "News";
+    news.time = "08:00";
+    news.source = "Media";
+    news.file_path = "/media/news.mp4";
+    news.duration = 1800;
+    news.days = {"monday"};
+    playlist.items.push_back(news);
+    
+    auto* playlist_manager = scheduler.get_channel(0)->get_playlist_manager();
+    playlist_manager->add_playlist("morning.json", playlist);
+    
+    scheduler.start();
+    ASSERT_TRUE(clock->wait_for_sleepers(1, std::chrono::seconds(5)));
+    obs_mock::run_pending_tasks();
+    
+    // Loaded and held out of sight until it sits on the right frame
+    EXPECT_FALSE(obs_mock::is_visible("Program", "Media"));
+    
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (scheduler.get_join_records().empty() && std::chrono::steady_clock::now() < deadline) {
+        obs_mock::tick();
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    scheduler.stop();
+    
+    auto records = scheduler.get_join_records();
+    ASSERT_EQ(records.size(), 1u);
+    EXPECT_TRUE(records[0].revealed);
+    EXPECT_GE(records[0].offset_ms, 600000);
+    EXPECT_LT(records[0].offset_ms, 605000);
+    EXPECT_LE(std::llabs(records[0].seek_error_ms), 20);
+    EXPECT_GT(records[0].recovery_ns, 0);
+    
+    EXPECT_TRUE(obs_mock::is_visible("Program", "Media"));
+    EXPECT_EQ(obs_mock::get_media_state("Media"), OBS_MEDIA_STATE_PLAYING);
+    EXPECT_GE(obs_mock::get_media_time("Media"), records[0].offset_ms);
+    EXPECT_EQ(scheduler.get_current_item(), playlist_manager->get_items_for_day("monday")[0]->id);
+}
+
+TEST(SimulationTest, MediaEndChainsNextItemGaplessly) {
+    obs_mock::reset();
+    obs_mock::create_scene("Program");
+    obs_mock::set_current_scene("Program");
+    obs_mock::create_media_source("Promo Player");
+    obs_mock::create_media_source("News Player");
+    obs_mock::add_to_scene("Program", "Promo Player");
+    obs_mock::add_to_scene("Program", "News Player");
+    
+    // The promo file runs 300ms short of its one minute slot
+    obs_mock::set_media_duration("Promo Player", 59700);
+    obs_mock::set_media_duration("News Player", 1800 * 1000);
+    
+    // Monday 2024-01-01, 07:59:50 local time
+    std::tm start_tm = {};
+    start_tm.tm_year = 124;
+    start_tm.tm_mday = 1;
+    start_tm.tm_hour = 7;
+    start_tm.tm_min = 59;
+    start_tm.tm_sec = 50;
+    start_tm.tm_isdst = -1;
+    auto start = std::chrono::system_clock::from_time_t(std::mktime(&start_tm));
+    auto clock = std::make_shared<SimulatedClock>(start);
+    
+    // Media runs on the mock's video clock, stepped along with the schedule
+    uint64_t video_ns = 1000000000ULL;
+    obs_mock::set_time_ns(video_ns);
+    
+    SchedulerCore scheduler;
+    scheduler.set_clock(clock);
+    ASSERT_TRUE(scheduler.initialize());
+    
+    Playlist playlist;
+    playlist.name = "Morning";
+    ScheduledItem promo;
+    promo.name = "Promo";
+    promo.time = "08:00";
+    promo.source = "Promo Player";
+    promo.file_path = "/media/promo.mp4";
+    promo.duration = 60;
+    promo.days = {"monday"};
+    playlist.items.push_back(promo);
+    ScheduledItem news = promo;
+    news.name = "News";
+    news.time = "08:01";
+    news.source = "News Player";
+    news.file_path = "/media/news.mp4";
+    news.duration = 1800;
+    playlist.items.push_back(news);
+    
+    auto* playlist_manager = scheduler.get_channel(0)->get_playlist_manager();
+    playlist_manager->add_playlist("morning.json", playlist);
+    
+    scheduler.start();
+    
+    // Render frame by frame until just past the news slot
+    const auto frame = std::chrono::nanoseconds(1000000000 / 60);
+    const auto end = start + std::chrono::seconds(70) + std::chrono::milliseconds(500);
+    uint64_t promo_ended_ns = 0;
+    uint64_t news_started_ns = 0;
+    while (clock->now() < end) {
+        ASSERT_TRUE(clock->wait_for_sleepers(1, std::chrono::seconds(5)));
+        obs_mock::run_pending_tasks();
+        
+        clock->advance(frame);
+        video_ns += frame.count();
+        obs_mock::set_time_ns(video_ns);
+        obs_mock::tick();
+        
+        if (!promo_ended_ns && obs_mock::get_media_state("Promo Player") == OBS_MEDIA_STATE_ENDED) {
+            promo_ended_ns = video_ns;
+        }
+        if (!news_started_ns && obs_mock::get_media_time("News Player") > 0) {
+            news_started_ns = video_ns;
+        }
+    }
+    ASSERT_TRUE(clock->wait_for_sleepers(1, std::chrono::seconds(5)));
+    scheduler.stop();
+    
+    // The news picks up on the end event, not 300ms later on the clock
+    ASSERT_NE(promo_ended_ns, 0u);
+    ASSERT_NE(news_started_ns, 0u);
+    int64_t gap_ns = static_cast<int64_t>(news_started_ns) - static_cast<int64_t>(promo_ended_ns);
+    EXPECT_GE(gap_ns, 0);
+    EXPECT_LE(gap_ns, 2 * frame.count());
+    
+    // Chained once, neither restarted by its own trigger nor cut by the promo's idle fallback
+    auto as_run = scheduler.get_as_run_log();
+    ASSERT_EQ(as_run.size(), 2u);
+    EXPECT_EQ(playlist_manager->get_item(as_run[0].item_id)->name, "Promo");
+    EXPECT_EQ(playlist_manager->get_item(as_run[1].item_id)->name, "News");
+    EXPECT_LT(as_run[1].time, start + std::chrono::seconds(70));
+    EXPECT_EQ(obs_mock::get_media_state("News Player"), OBS_MEDIA_STATE_PLAYING);
+    EXPECT_GE(obs_mock::get_media_time("News Player"), 700);
+}
+
+TEST(SimulationTest, FrameAndMinuteItemsShareASlot) {
+    obs_mock::reset();
+    obs_mock::set_fps(60, 1);
+    obs_mock::create_scene("Program");
+    obs_mock::set_current_scene("Program");
+    obs_mock::create_media_source("Promo Player");
+    obs_mock::create_media_source("Bug Player");
+    obs_mock::add_to_scene("Program", "Promo Player");
+    obs_mock::add_to_scene("Program", "Bug Player");
+    
+    // Monday 2024-01-01, 07:59:50 local time
+    std::tm start_tm = {};
+    start_tm.tm_year = 124;
+    start_tm.tm_mday = 1;
+    start_tm.tm_hour = 7;
+    start_tm.tm_min = 59;
+    start_tm.tm_sec = 50;
+    start_tm.tm_isdst = -1;
+    auto start = std::chrono::system_clock::from_time_t(std::mktime(&start_tm));
+    auto clock = std::make_shared<SimulatedClock>(start);
+    uint64_t video_ns = 1000000000ULL;
+    obs_mock::set_time_ns(video_ns);
+    
+    SchedulerCore scheduler;
+    scheduler.set_clock(clock);
+    ASSERT_TRUE(scheduler.initialize());
+    
+    Playlist playlist;
+    playlist.name = "Morning";
+    ScheduledItem promo;
+    promo.name = "Promo";
+    promo.time = "08:00";
+    promo.source = "Promo Player";
+    promo.file_path = "/media/promo.mp4";
+    promo.duration = 60;
+    promo.days = {"monday"};
+    playlist.items.push_back(promo);
+    ScheduledItem bug = promo;
+    bug.name = "Bug";
+    bug.source = "Bug Player";
+    bug.file_path = "/media/bug.mov";
+    bug.trigger_mode = TriggerMode::Frame;
+    playlist.items.push_back(bug);
+    
+    auto* playlist_manager = scheduler.get_channel(0)->get_playlist_manager();
+    playlist_manager->add_playlist("morning.json", playlist);
+    scheduler.start();
+    
+    // Frame by frame across 08:00; the bug goes on air on the crossing frame
+    // itself, before the UI thread runs anything
+    const uint64_t frame_ns = 1000000000ULL / 60;
+    const auto slot = start + std::chrono::seconds(10);
+    const auto end = slot + std::chrono::milliseconds(500);
+    uint64_t bug_shown_ns = 0;
+    while (clock->now() < end) {
+        ASSERT_TRUE(clock->wait_for_sleepers(1, std::chrono::seconds(5)));
+        obs_mock::run_pending_tasks();
+        
+        clock->advance(std::chrono::nanoseconds(frame_ns));
+        video_ns += frame_ns;
+        obs_mock::set_time_ns(video_ns);
+        obs_mock::tick();
+        
+        if (!bug_shown_ns && obs_mock::is_visible("Program", "Bug Player") &&
+            obs_mock::get_media_state("Bug Player") == OBS_MEDIA_STATE_PLAYING) {
+            bug_shown_ns = video_ns;
+        }
+    }
+    ASSERT_TRUE(clock->wait_for_sleepers(1, std::chrono::seconds(5)));
+    obs_mock::run_pending_tasks();
+    scheduler.stop();
+    
+    // Only the frame-mode item went through the frame trigger, on the first frame at or past 08:00
+    auto records = scheduler.get_frame_trigger_records();
+    ASSERT_EQ(records.size(), 1u);
+    EXPECT_EQ(playlist_manager->get_item(records[0].item_id)->name, "Bug");
+    EXPECT_GE(records[0].offset_ns, 0);
+    EXPECT_LT(records[0].offset_ns, static_cast<int64_t>(frame_ns));
+    EXPECT_GE(records[0].offset_frames, 0.0);
+    EXPECT_LT(records[0].offset_frames, 1.0);
+    EXPECT_EQ(bug_shown_ns, records[0].frame_ns);
+    
+    // Both went on air, the bug from its pre-rolled copy
+    auto as_run = scheduler.get_as_run_log();
+    ASSERT_EQ(as_run.size(), 2u);
+    EXPECT_EQ(obs_mock::get_media_state("Promo Player"), OBS_MEDIA_STATE_PLAYING);
+    EXPECT_EQ(obs_mock::get_media_state("Bug Player"), OBS_MEDIA_STATE_PLAYING);
+    EXPECT_EQ(obs_mock::get_showing_count("Bug Player"), 0);
+    bool bug_prerolled = false;
+    for (const auto& record : scheduler.get_start_latency_records()) {
+        if (playlist_manager->get_item(record.item_id)->name == "Bug") {
+            bug_prerolled = record.prerolled;
+        }
+    }
+    EXPECT_TRUE(bug_prerolled);
+}
+
 class PlaylistManagerTest : public ::testing::Test {
 protected:
     void SetUp() override {
@@ -244,6 +1489,1125 @@ TEST_F(PlaylistManagerTest, ValidationTest) {
     EXPECT_FALSE(playlist_manager->validate_item(invalid_item));
 }
 
+TEST(ScheduleSnapshotTest, ReloadPublishesWithoutTouchingReaders) {
+    // Monday 2024-01-01, 08:00 local time
+    std::tm start_tm = {};
+    start_tm.tm_year = 124;
+    start_tm.tm_mday = 1;
+    start_tm.tm_hour = 8;
+    start_tm.tm_isdst = -1;
+    auto clock = std::make_shared<SimulatedClock>(std::chrono::system_clock::from_time_t(std::mktime(&start_tm)));
+    
+    PlaylistManager manager;
+    manager.set_clock(clock);
+    TimeTrigger trigger;
+    trigger.set_clock(clock);
+    trigger.set_playlist_manager(&manager);
+    ASSERT_TRUE(trigger.initialize());
+    
+    Playlist playlist;
+    playlist.name = "Morning";
+    ScheduledItem news;
+    news.name = "News";
+    news.time = "09:00";
+    news.source = "Media";
+    news.days = {"monday"};
+    playlist.items.push_back(news);
+    manager.add_playlist("morning.json", playlist);
+    
+    auto before = manager.get_snapshot();
+    ASSERT_EQ(before->items.size(), 1u);
+    std::string old_id = before->items.begin()->first;
+    EXPECT_EQ(trigger.get_next_items(), std::vector<std::string>{old_id});
+    
+    // The file now holds a different item
+    playlist.items[0].name = "Weather";
+    playlist.items[0].time = "10:00";
+    manager.add_playlist("morning.json", playlist);
+    
+    auto after = manager.get_snapshot();
+    EXPECT_GT(after->version, before->version);
+    ASSERT_EQ(after->items.size(), 1u);
+    std::string new_id = after->items.begin()->first;
+    EXPECT_NE(new_id, old_id);
+    EXPECT_EQ(manager.get_item(old_id), nullptr);
+    
+    // A reader holding the old snapshot still sees the old schedule, in full
+    ASSERT_NE(before->find_item(old_id), nullptr);
+    EXPECT_EQ(before->find_item(old_id)->time, "09:00");
+    EXPECT_EQ(before->playlists[0]->items[0].name, "News");
+    
+    // The time trigger follows the new snapshot without a reload of its own
+    EXPECT_EQ(trigger.get_next_items(), std::vector<std::string>{new_id});
+}
+
+TEST(ScheduleTimelineTest, AnswersByWeekdayAndTime) {
+    // Monday 2024-01-01, 10:00 local time
+    std::tm start_tm = {};
+    start_tm.tm_year = 124;
+    start_tm.tm_mday = 1;
+    start_tm.tm_hour = 10;
+    start_tm.tm_isdst = -1;
+    auto clock = std::make_shared<SimulatedClock>(std::chrono::system_clock::from_time_t(std::mktime(&start_tm)));
+    
+    PlaylistManager manager;
+    manager.set_clock(clock);
+    TimeTrigger trigger;
+    trigger.set_clock(clock);
+    trigger.set_playlist_manager(&manager);
+    ASSERT_TRUE(trigger.initialize());
+    
+    auto make_item = [](const std::string& name, const std::string& time, DaySet days) {
+        ScheduledItem item;
+        item.name = name;
+        item.time = time;
+        item.source = "Media";
+        item.days = days;
+        return item;
+    };
+    Playlist playlist;
+    playlist.name = "Week";
+    playlist.items.push_back(make_item("Magazine", "09:30", {"monday"}));
+    playlist.items.push_back(make_item("News", "08:00", {"monday", "wednesday"}));
+    playlist.items.push_back(make_item("Weather", "08:00", {"monday"}));
+    playlist.items.push_back(make_item("Film", "23:00", {"friday"}));
+    playlist.items.push_back(make_item("Broken", "25:00", {"monday"}));
+    manager.add_playlist("week.json", playlist);
+    
+    auto snapshot = manager.get_snapshot();
+    const auto& timeline = snapshot->timeline;
+    EXPECT_EQ(timeline.get_item_count(), 4u);   // Not the one at 25:00
+    
+    auto names = [&timeline](ScheduleTimeline::Range range) {
+        std::vector<std::string> result;
+        for (const auto& entry : range) {
+            result.push_back(timeline.get_item(entry.item)->name);
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    };
+    auto at = [](const char* time) {
+        return ScheduleTimeline::time_to_ms(time);
+    };
+    const int monday = 1;
+    const int friday = 5;
+    
+    EXPECT_EQ(names(timeline.get_entries_at(monday, at("08:00"))), (std::vector<std::string>{"News", "Weather"}));
+    EXPECT_TRUE(timeline.get_entries_at(monday, at("08:00:00.001")).empty());
+    
+    // On air: the latest slot started, whole
+    EXPECT_TRUE(timeline.get_entries_on_air(monday, at("07:00")).empty());
+    EXPECT_EQ(names(timeline.get_entries_on_air(monday, at("09:00"))), (std::vector<std::string>{"News", "Weather"}));
+    EXPECT_EQ(names(timeline.get_entries_on_air(monday, at("23:00"))), std::vector<std::string>{"Magazine"});
+    
+    // Next after: whole slots until count is reached
+    EXPECT_EQ(names(timeline.get_entries_after(monday, 0, 1)), (std::vector<std::string>{"News", "Weather"}));
+    EXPECT_EQ(timeline.get_entries_after(monday, 0, 3).size(), 3u);
+    EXPECT_EQ(names(timeline.get_entries_after(monday, at("08:00"), 10)), std::vector<std::string>{"Magazine"});
+    
+    // Next trigger, looking into the following days and round the week
+    int32_t slot_ms = 0;
+    int days_ahead = 0;
+    ASSERT_TRUE(timeline.get_next_trigger(monday, at("10:00"), slot_ms, days_ahead));
+    EXPECT_EQ(slot_ms, at("08:00"));
+    EXPECT_EQ(days_ahead, 2);
+    ASSERT_TRUE(timeline.get_next_trigger(friday, at("23:00"), slot_ms, days_ahead));
+    EXPECT_EQ(slot_ms, at("08:00"));
+    EXPECT_EQ(days_ahead, 3);
+    
+    // The manager and trigger answer from the same timeline
+    EXPECT_EQ(manager.get_items_for_time("08:00", "wednesday").size(), 1u);
+    auto monday_items = manager.get_items_for_day("monday");
+    ASSERT_EQ(monday_items.size(), 3u);
+    EXPECT_EQ(monday_items[2]->name, "Magazine");
+    EXPECT_EQ(trigger.get_next_trigger_time(), "08:00 (wednesday)");
+}
+
+static const char* PARSER_SCHEDULE = R"({
+  "version": "1.0",
+  "timezone": "America/New_York",
+  "default_idle": "idle_video.mp4",
+  "trigger_mode": "frame",
+  "playlists": [
+    {
+      "name": "Morning \u2600 Show",
+      "enabled": true,
+      "days": ["Monday", "friday"],
+      "items": [
+        {"name": "News", "time": "08:00", "source": "Media", "file": "C:\\videos\\news.mp4",
+         "duration": 1800, "loop": false, "scene": "Main", "extra": {"ignored": [1, null]}},
+        {"name": "Weekend", "time": "09:00", "source": "Media", "days": ["saturday"]},
+        {"name": "Broken", "time": "25:00", "source": "Media"},
+        {"name": "Quiz", "time": "10:30", "source": "Media", "scene": null}
+      ]
+    },
+    {
+      "name": "Night",
+      "enabled": false,
+      "trigger_mode": "minute", "priority": 2,
+      "rrule": "FREQ=MONTHLY;BYDAY=-1FR", "dtstart": "2026-01-01", "except": ["2026-07-31"],
+      "items": [{"name": "Film", "time": "23:00", "source": "Movies"},
+                {"name": "Gala", "time": "20:00", "source": "Movies", "priority": -1, "dates": ["2026-12-24..2026-12-26", "2027-01-01"]}]
+    }
+  ]
+})";
+
+TEST(ScheduleTimelineTest, DaysAreAMaskAndIdsStayShort) {
+    DaySet days{"friday", "monday", "monday", "someday"};
+    EXPECT_EQ(days.size(), 2u);
+    EXPECT_TRUE(days.contains(ScheduleTimeline::day_index("monday")));
+    EXPECT_FALSE(days.contains(ScheduleTimeline::day_index("sunday")));
+    EXPECT_EQ(days.names(), (std::vector<std::string>{"monday", "friday"}));
+    EXPECT_FALSE(days.add("someday"));
+    EXPECT_EQ(DaySet::from_mask(0xff), DaySet::every_day());
+    
+    // Ids fit in a string without allocating, and still tell items apart
+    PlaylistManager manager;
+    manager.set_cache_directory("");
+    Playlist playlist;
+    playlist.name = "Ids";
+    for (const char* name : {"News", "Weather", "Sports"}) {
+        ScheduledItem item;
+        item.name = name;
+        item.time = "09:00";
+        item.source = "A rather long media source name";
+        item.days = days;
+        playlist.items.push_back(item);
+    }
+    manager.add_playlist("ids.json", playlist);
+    auto snapshot = manager.get_snapshot();
+    ASSERT_EQ(snapshot->items.size(), 3u);
+    for (const auto& pair : snapshot->items) {
+        EXPECT_LE(pair.first.size(), std::string().capacity());
+    }
+}
+
+TEST(ScheduleCalendarTest, DatesRecurrencesAndExceptions) {
+    auto on = [](const CalendarRule& rule, int year, int month, int mday) {
+        return rule.occurs_on(CalendarRule::from_civil(year, month, mday));
+    };
+    std::string error;
+    
+    EXPECT_EQ(CalendarRule::from_civil(1970, 1, 1), 0);
+    EXPECT_EQ(CalendarRule::weekday(CalendarRule::from_civil(2026, 12, 21)), 1);
+    EXPECT_EQ(CalendarRule::format_date(CalendarRule::from_civil(2024, 2, 29)), "2024-02-29");
+    CivilDay day = 0;
+    EXPECT_TRUE(CalendarRule::parse_date("20240229", day));
+    EXPECT_FALSE(CalendarRule::parse_date("2023-02-29", day));
+    
+    // Dates and ranges, with exceptions winning
+    CalendarRule dates;
+    ASSERT_TRUE(dates.add_dates("2026-12-20..2026-12-31", error));
+    ASSERT_TRUE(dates.add_dates("2027-01-01", error));
+    ASSERT_TRUE(dates.add_exception("2026-12-25", error));
+    ASSERT_TRUE(dates.finish(error));
+    EXPECT_TRUE(on(dates, 2026, 12, 24));
+    EXPECT_FALSE(on(dates, 2026, 12, 25));
+    EXPECT_TRUE(on(dates, 2027, 1, 1));
+    EXPECT_FALSE(on(dates, 2027, 1, 2));
+    EXPECT_FALSE(dates.add_dates("2026-12-31..2026-12-01", error));
+    
+    // Every other week on Monday and Thursday, weeks starting on Monday
+    CalendarRule biweekly;
+    ASSERT_TRUE(biweekly.set_recurrence("FREQ=WEEKLY;INTERVAL=2;BYDAY=MO,TH", error)) << error;
+    ASSERT_TRUE(biweekly.set_start("2026-01-05", error));
+    ASSERT_TRUE(biweekly.finish(error));
+    EXPECT_TRUE(on(biweekly, 2026, 1, 5));
+    EXPECT_TRUE(on(biweekly, 2026, 1, 8));
+    EXPECT_FALSE(on(biweekly, 2026, 1, 12));
+    EXPECT_TRUE(on(biweekly, 2026, 1, 19));
+    EXPECT_FALSE(on(biweekly, 2026, 1, 1));
+    
+    // Last Friday of the month, three times
+    CalendarRule last_friday;
+    ASSERT_TRUE(last_friday.set_recurrence("freq=monthly;byday=-1FR;count=3", error)) << error;
+    ASSERT_TRUE(last_friday.set_start("2026-01-01", error));
+    ASSERT_TRUE(last_friday.finish(error));
+    EXPECT_TRUE(on(last_friday, 2026, 1, 30));
+    EXPECT_FALSE(on(last_friday, 2026, 1, 23));
+    EXPECT_TRUE(on(last_friday, 2026, 3, 27));
+    EXPECT_FALSE(on(last_friday, 2026, 4, 24));
+    
+    // Yearly on a month day, until a date
+    CalendarRule yearly;
+    ASSERT_TRUE(yearly.set_recurrence("FREQ=YEARLY;BYMONTH=2;BYMONTHDAY=-1;UNTIL=20281231", error)) << error;
+    ASSERT_TRUE(yearly.set_start("2024-01-01", error));
+    ASSERT_TRUE(yearly.finish(error));
+    EXPECT_TRUE(on(yearly, 2024, 2, 29));
+    EXPECT_TRUE(on(yearly, 2025, 2, 28));
+    EXPECT_FALSE(on(yearly, 2025, 3, 31));
+    EXPECT_FALSE(on(yearly, 2029, 2, 28));
+    
+    // The canonical text reads back to the same rule
+    CalendarRule copy;
+    ASSERT_TRUE(CalendarRule::from_text(last_friday.to_text(), copy, error)) << error;
+    EXPECT_EQ(copy, last_friday);
+    EXPECT_TRUE(on(copy, 2026, 2, 27));
+    ASSERT_TRUE(CalendarRule::from_text(dates.to_text(), copy, error)) << error;
+    EXPECT_EQ(copy, dates);
+    EXPECT_NE(copy, last_friday);
+    
+    // Malformed or incomplete rules are refused
+    CalendarRule bad;
+    EXPECT_FALSE(bad.set_recurrence("INTERVAL=2", error));
+    EXPECT_FALSE(bad.set_recurrence("FREQ=WEEKLY;BYDAY=2MO", error));
+    EXPECT_FALSE(bad.set_recurrence("FREQ=DAILY;COUNT=2;UNTIL=20270101", error));
+    EXPECT_FALSE(bad.set_recurrence("FREQ=DAILY;BYHOUR=3", error));
+    ASSERT_TRUE(bad.set_recurrence("FREQ=DAILY", error));
+    EXPECT_FALSE(bad.finish(error));
+    EXPECT_EQ(error, "\"rrule\" needs \"dtstart\"");
+    EXPECT_TRUE(CalendarRule().empty());
+    EXPECT_TRUE(CalendarRule().occurs_on(0));
+}
+
+TEST(ScheduleTimelineTest, ExpandsCalendarItemsOverTheHorizon) {
+    auto make_item = [](const std::string& id, const std::string& time, const std::vector<std::string>& dates) {
+        auto item = std::make_shared<ScheduledItem>();
+        item->id = id;
+        item->name = id;
+        item->time = time;
+        item->source = "Media";
+        item->days = DaySet::every_day();
+        if (!dates.empty()) {
+            auto calendar = std::make_shared<CalendarRule>();
+            std::string error;
+            for (const auto& value : dates) {
+                EXPECT_TRUE(calendar->add_dates(value, error)) << error;
+            }
+            EXPECT_TRUE(calendar->finish(error));
+            item->calendar = calendar;
+        }
+        return std::shared_ptr<const ScheduledItem>(item);
+    };
+    std::vector<std::shared_ptr<const ScheduledItem>> items = {
+        make_item("daily", "09:00", {}),
+        make_item("gala", "08:00", {"2026-12-24..2026-12-26", "2027-01-01"}),
+        make_item("late", "21:00", {"2027-01-10"})
+    };
+    
+    const CivilDay first = CalendarRule::from_civil(2026, 12, 21);
+    const int monday = 1;
+    ScheduleTimeline timeline;
+    timeline.build(items, first, ScheduleTimeline::DEFAULT_HORIZON_DAYS);
+    EXPECT_EQ(timeline.get_horizon_days(), ScheduleTimeline::DEFAULT_HORIZON_DAYS);
+    
+    // Weekdays hold the weekly items only; dates add theirs in start order
+    EXPECT_EQ(timeline.get_entries(monday).size(), 1u);
+    EXPECT_EQ(timeline.share_slots_on(first), timeline.share_slots(monday));
+    const auto& christmas = timeline.get_entries_on(first + 4);
+    ASSERT_EQ(christmas.size(), 2u);
+    EXPECT_EQ(timeline.get_item(christmas[0].item)->id, "gala");
+    EXPECT_EQ(ScheduleTimeline::format_time(christmas[1].start_ms), "09:00");
+    EXPECT_EQ(timeline.get_slots_on(first + 11).size(), 2u);
+    
+    // Beyond the horizon a date answers with its weekday
+    const CivilDay tenth = CalendarRule::from_civil(2027, 1, 10);
+    EXPECT_EQ(timeline.get_entries_on(tenth).size(), 1u);
+    
+    // Next trigger crosses into the dates
+    int32_t slot_ms = 0;
+    int days_ahead = 0;
+    ASSERT_TRUE(timeline.get_next_trigger_on(first + 3, ScheduleTimeline::time_to_ms("10:00"), slot_ms, days_ahead));
+    EXPECT_EQ(ScheduleTimeline::format_time(slot_ms), "08:00");
+    EXPECT_EQ(days_ahead, 1);
+    
+    // Moving on keeps the dates already expanded and expands the new ones
+    auto kept = timeline.share_slots_on(first + 11);
+    timeline.advance(first + 7);
+    EXPECT_EQ(timeline.get_first_day(), first + 7);
+    EXPECT_EQ(timeline.share_slots_on(first + 11), kept);
+    EXPECT_EQ(timeline.get_entries_on(first + 4).size(), 1u);
+    EXPECT_EQ(timeline.get_entries_on(tenth).size(), 2u);
+    EXPECT_EQ(timeline.get_entries_on(first).size(), 1u);
+    
+    // A patch re-expands the dates of what it touched
+    ScheduleTimeline patched;
+    patched.patch(timeline, {items[1]}, {});
+    EXPECT_EQ(patched.get_item_count(), 2u);
+    EXPECT_EQ(patched.get_entries_on(first + 11).size(), 1u);
+    EXPECT_EQ(patched.get_entries_on(tenth).size(), 2u);
+    EXPECT_EQ(patched.get_first_day(), first + 7);
+}
+
+TEST(ScheduleTimelineTest, SettlesOverlapsOnASourceByPriority) {
+    auto make_item = [](const std::string& id, const std::string& time, const std::string& source, int duration,
+                        int playlist_priority, int priority) {
+        auto item = std::make_shared<ScheduledItem>();
+        item->id = id;
+        item->name = id;
+        item->time = time;
+        item->source = source;
+        item->duration = duration;
+        item->playlist_priority = playlist_priority;
+        item->priority = priority;
+        item->days = DaySet{"monday"};
+        return std::shared_ptr<const ScheduledItem>(item);
+    };
+    // In id order, like the manager hands them over
+    std::vector<std::shared_ptr<const ScheduledItem>> items = {
+        make_item("a", "09:00", "X", 3600, 0, 0),
+        make_item("b", "09:30", "X", 600, 0, 5),      // a never started: clear
+        make_item("c", "09:00", "X", 60, 1, 0),       // Higher playlist: a is dropped
+        make_item("d", "10:00", "Y", 1800, 2, 0),
+        make_item("e", "10:15", "Y", 60, 1, 9),       // Lower playlist: dropped, whatever its own priority
+        make_item("f", "10:20", "Y", 60, 2, 0),       // Same priority, later: cuts d short
+        make_item("g", "11:00", "Z", 0, 0, 0),
+        make_item("h", "11:00", "Z", 0, 0, 0),        // Same start and priority: the first id keeps it
+        make_item("i", "11:01", "Z", 0, 0, 0),
+        make_item("j", "12:00", "V", 3600, 0, 0),
+        make_item("k", "12:00", "W", 3600, 0, 0)      // Another source: no conflict
+    };
+    ScheduleTimeline timeline;
+    timeline.build(items);
+    const int monday = 1;
+    
+    auto describe = [&timeline](const ScheduleTimeline::Conflict& conflict) {
+        return timeline.get_item(conflict.winner)->id + ">" + timeline.get_item(conflict.loser)->id + "@" +
+               ScheduleTimeline::format_time(conflict.start_ms) + (conflict.dropped ? " dropped" : " cut");
+    };
+    std::vector<std::string> conflicts;
+    for (const auto& conflict : timeline.get_conflicts(monday)) {
+        conflicts.push_back(describe(conflict));
+    }
+    EXPECT_EQ(conflicts, (std::vector<std::string>{"c>a@09:00 dropped", "d>e@10:15 dropped", "f>d@10:20 cut",
+                                                   "g>h@11:00 dropped"}));
+    EXPECT_EQ(timeline.get_conflict_count(), 4u);
+    EXPECT_TRUE(timeline.get_conflicts(0).empty());
+    
+    // Dropped items stay scheduled but are left out of the slots that fire
+    EXPECT_EQ(timeline.get_entries(monday).size(), items.size());
+    std::vector<std::string> fired;
+    for (const auto& slot : timeline.get_slots(monday)) {
+        for (const auto& item_id : slot.item_ids) {
+            fired.push_back(slot.to_string() + " " + item_id);
+        }
+    }
+    EXPECT_EQ(fired, (std::vector<std::string>{"09:00 c", "09:30 b", "10:00 d", "10:20 f", "11:00 g", "11:01 i",
+                                               "12:00 j", "12:00 k"}));
+    
+    // The manager reports them, and a priority change alone is enough to settle them again
+    PlaylistManager manager;
+    manager.set_cache_directory("");
+    Playlist news;
+    news.name = "News";
+    news.priority = 1;
+    ScheduledItem bulletin;
+    bulletin.name = "Bulletin";
+    bulletin.time = "09:00";
+    bulletin.source = "Main";
+    bulletin.duration = 600;
+    bulletin.days = DaySet::every_day();
+    news.items.push_back(bulletin);
+    Playlist films = news;
+    films.name = "Films";
+    films.priority = 0;
+    films.items[0].name = "Matinee";
+    films.items[0].time = "08:30";
+    films.items[0].duration = 7200;
+    manager.add_playlist("news.json", news);
+    manager.add_playlist("films.json", films);
+    
+    auto reported = manager.get_conflicts();
+    ASSERT_EQ(reported.size(), 7u);
+    EXPECT_EQ(reported[0].weekday, 0);
+    EXPECT_EQ(reported[0].time, "09:00");
+    EXPECT_EQ(reported[0].winner->name, "Bulletin");
+    EXPECT_EQ(reported[0].loser->name, "Matinee");
+    EXPECT_FALSE(reported[0].dropped);
+    
+    films.priority = 2;
+    manager.add_playlist("films.json", films);
+    EXPECT_EQ(manager.get_snapshot()->changes.modified.size(), 1u);
+    reported = manager.get_conflicts();
+    ASSERT_EQ(reported.size(), 7u);
+    EXPECT_EQ(reported[0].winner->name, "Matinee");
+    EXPECT_TRUE(reported[0].dropped);
+    EXPECT_EQ(manager.get_snapshot()->timeline.get_slots(0).size(), 1u);
+}
+
+TEST(ScheduleTimelineTest, SettlesScenesAndOverlapsPastMidnight) {
+    auto make_item = [](const std::string& id, const std::string& day, const std::string& time,
+                        const std::string& source, const std::string& scene, int duration, int playlist_priority) {
+        auto item = std::make_shared<ScheduledItem>();
+        item->id = id;
+        item->name = id;
+        item->time = time;
+        item->source = source;
+        item->scene = scene;
+        item->duration = duration;
+        item->playlist_priority = playlist_priority;
+        item->days = DaySet{day};
+        return std::shared_ptr<const ScheduledItem>(item);
+    };
+    std::vector<std::shared_ptr<const ScheduledItem>> items = {
+        // Two playlists at 09:00 on different sources, switching to different scenes
+        make_item("a1", "monday", "09:00", "A", "Studio", 1800, 0),
+        make_item("a2", "monday", "09:00", "B", "Outside", 1800, 1),    // Higher playlist: a1 is dropped
+        make_item("a3", "monday", "09:10", "C", "Studio", 60, 0),       // Would take the programme from a2
+        make_item("a4", "monday", "09:20", "D", "Outside", 60, 0),      // Same scene as a2: clear
+        make_item("a5", "monday", "09:20", "E", "", 60, 0),             // No scene: clear
+        make_item("b1", "monday", "11:00", "F", "Studio", 3600, 0),
+        make_item("b2", "monday", "11:30", "G", "Outside", 600, 0),     // Same priority, later: takes the scene
+        make_item("b3", "monday", "11:40", "F", "", 60, 0),             // b1 still plays on F: cut short
+        // Past midnight, and past the end of the week
+        make_item("c1", "monday", "23:30", "M", "", 5400, 0),
+        make_item("c2", "tuesday", "00:15", "M", "", 600, 0),           // Same priority, later: cuts c1 short
+        make_item("c3", "tuesday", "00:45", "M", "", 600, 0),           // c1 is off by then
+        make_item("d1", "saturday", "23:00", "N", "", 3 * 3600, 1),
+        make_item("d2", "sunday", "01:00", "N", "", 600, 0)             // Lower playlist: dropped
+    };
+    ScheduleTimeline timeline;
+    timeline.build(items);
+    const int sunday = 0;
+    const int monday = 1;
+    const int tuesday = 2;
+    
+    auto describe = [&timeline](const std::vector<ScheduleTimeline::Conflict>& conflicts) {
+        std::vector<std::string> result;
+        for (const auto& conflict : conflicts) {
+            result.push_back(timeline.get_item(conflict.winner)->id + ">" + timeline.get_item(conflict.loser)->id +
+                             "@" + ScheduleTimeline::format_time(conflict.start_ms) +
+                             (conflict.dropped ? " dropped" : " cut"));
+        }
+        return result;
+    };
+    EXPECT_EQ(describe(timeline.get_conflicts(monday)),
+              (std::vector<std::string>{"a2>a1@09:00 dropped", "a2>a3@09:10 dropped", "b2>b1@11:30 cut",
+                                        "b3>b1@11:40 cut"}));
+    EXPECT_EQ(describe(timeline.get_conflicts(tuesday)), (std::vector<std::string>{"c2>c1@00:15 cut"}));
+    EXPECT_EQ(describe(timeline.get_conflicts(sunday)), (std::vector<std::string>{"d1>d2@01:00 dropped"}));
+    EXPECT_TRUE(timeline.get_slots(sunday).empty());
+    EXPECT_EQ(timeline.get_slots(tuesday).size(), 2u);
+    
+    // A patch settles the days after the one it touched as well
+    ScheduleTimeline patched;
+    patched.patch(timeline, {items[8]}, {});
+    EXPECT_TRUE(patched.get_conflicts(tuesday).empty());
+    ScheduleTimeline restored;
+    restored.patch(patched, {}, {items[8]});
+    EXPECT_EQ(restored.get_conflicts(tuesday).size(), 1u);
+    patched.patch(timeline, {items[11]}, {});
+    EXPECT_TRUE(patched.get_conflicts(sunday).empty());
+    EXPECT_EQ(patched.get_slots(sunday).size(), 1u);
+    
+    // A dated item carries into the next date, which has none of its own
+    auto eve = std::make_shared<ScheduledItem>(*make_item("e1", "thursday", "23:00", "M", "", 2 * 3600, 0));
+    auto calendar = std::make_shared<CalendarRule>();
+    std::string error;
+    EXPECT_TRUE(calendar->add_dates("2026-12-31", error)) << error;
+    EXPECT_TRUE(calendar->finish(error));
+    eve->calendar = calendar;
+    auto morning = make_item("e2", "friday", "00:30", "M", "", 600, 0);
+    ScheduleTimeline dated;
+    const CivilDay first = CalendarRule::from_civil(2026, 12, 28);
+    dated.build({eve, morning}, first, ScheduleTimeline::DEFAULT_HORIZON_DAYS);
+    const int friday = 5;
+    EXPECT_TRUE(dated.get_conflicts(friday).empty());
+    EXPECT_EQ(dated.get_conflicts_on(first + 4).size(), 1u);
+    EXPECT_EQ(dated.get_conflicts_on(first + 4)[0].start_ms, 30 * 60 * 1000);
+    EXPECT_EQ(dated.get_item(dated.get_conflicts_on(first + 4)[0].winner)->id, "e2");
+    EXPECT_EQ(dated.share_slots_on(first + 11), dated.share_slots(friday));
+}
+
+TEST(ScheduleTimelineTest, StartsBetweenMinutes) {
+    auto at = [](const char* time, double frame_rate = 0.0) {
+        return ScheduleTimeline::time_to_ms(time, frame_rate);
+    };
+    EXPECT_EQ(at("09:00"), 9 * 3600 * 1000);
+    EXPECT_EQ(at("9:00"), at("09:00"));
+    EXPECT_EQ(at("09:00:15"), at("09:00") + 15000);
+    EXPECT_EQ(at("09:00:15.5"), at("09:00:15") + 500);
+    EXPECT_EQ(at("09:00:15.025"), at("09:00:15") + 25);
+    for (const char* invalid : {"24:00", "09:60", "09:00:60", "09:00.5", "09:00:15.", "09:00:15.1234", "09:00:15x"}) {
+        EXPECT_EQ(at(invalid), -1) << invalid;
+    }
+    
+    // Timecode: the millisecond the frame starts in, only with a rate it fits
+    EXPECT_EQ(at("09:00:15:12", 25.0), at("09:00:15.480"));
+    EXPECT_EQ(at("00:00:01:29", 29.97), 1967);
+    EXPECT_EQ(at("09:00:15:12"), -1);
+    EXPECT_EQ(at("09:00:15:25", 25.0), -1);
+    EXPECT_TRUE(ScheduleTimeline::is_timecode("09:00:15:25"));
+    EXPECT_FALSE(ScheduleTimeline::is_timecode("09:00:15.250"));
+    
+    EXPECT_EQ(ScheduleTimeline::format_time(at("09:00")), "09:00");
+    EXPECT_EQ(ScheduleTimeline::format_time(at("09:00:15")), "09:00:15");
+    EXPECT_EQ(ScheduleTimeline::format_time(at("09:00:15.5")), "09:00:15.500");
+    
+    // Lookups tell apart starts a millisecond apart
+    std::vector<std::shared_ptr<const ScheduledItem>> items;
+    for (const char* time : {"09:00", "09:00:15", "09:00:15.250", "09:00:15.251"}) {
+        auto item = std::make_shared<ScheduledItem>();
+        item->id = time;
+        item->name = time;
+        item->time = time;
+        item->source = time;
+        item->days = DaySet{"monday"};
+        items.push_back(item);
+    }
+    ScheduleTimeline timeline;
+    timeline.build(items);
+    const int monday = 1;
+    
+    ASSERT_EQ(timeline.get_slots(monday).size(), 4u);
+    EXPECT_EQ(timeline.get_slots(monday)[2].to_string(), "09:00:15.250");
+    EXPECT_EQ(timeline.get_entries_at(monday, at("09:00:15.250")).size(), 1u);
+    auto on_air = timeline.get_entries_on_air(monday, at("09:00:15.100"));
+    ASSERT_EQ(on_air.size(), 1u);
+    EXPECT_EQ(timeline.get_item(on_air.begin()->item)->time, "09:00:15");
+    int32_t slot_ms = 0;
+    int days_ahead = 0;
+    ASSERT_TRUE(timeline.get_next_trigger(monday, at("09:00:15.250"), slot_ms, days_ahead));
+    EXPECT_EQ(slot_ms, at("09:00:15.251"));
+    
+    // The trigger places a slot on the wall clock to the millisecond
+    std::tm start_tm = {};
+    start_tm.tm_year = 124;
+    start_tm.tm_mday = 1;
+    start_tm.tm_isdst = -1;
+    auto midnight = std::chrono::system_clock::from_time_t(std::mktime(&start_tm));
+    auto clock = std::make_shared<SimulatedClock>(midnight);
+    clock->advance(std::chrono::milliseconds(at("09:00:15.100")));
+    
+    TimeTrigger trigger;
+    trigger.set_clock(clock);
+    EXPECT_EQ(trigger.get_current_ms(), at("09:00:15.100"));
+    EXPECT_EQ(trigger.get_slot_time(timeline.get_slots(monday)[2]) - midnight,
+              std::chrono::milliseconds(at("09:00:15.250")));
+}
+
+TEST(ScheduleParserTest, ReadsPlaylistsWithInheritedFields) {
+    ScheduleParser parser;
+    ParsedSchedule schedule;
+    ASSERT_TRUE(parser.parse_string(PARSER_SCHEDULE, schedule)) << parser.get_error();
+    
+    EXPECT_EQ(schedule.version, "1.0");
+    EXPECT_EQ(schedule.timezone, "America/New_York");
+    ASSERT_EQ(schedule.playlists.size(), 2u);
+    
+    const auto& morning = schedule.playlists[0];
+    EXPECT_EQ(morning.name, "Morning \xE2\x98\x80 Show");
+    EXPECT_EQ(morning.days, (DaySet{"monday", "friday"}));
+    EXPECT_EQ(morning.trigger_mode, TriggerMode::Frame);
+    EXPECT_EQ(morning.default_idle, "idle_video.mp4");
+    ASSERT_EQ(morning.items.size(), 3u);
+    EXPECT_EQ(morning.items[0].file_path, "C:\\videos\\news.mp4");
+    EXPECT_EQ(morning.items[0].duration, 1800);
+    EXPECT_EQ(morning.items[0].scene, "Main");
+    EXPECT_EQ(morning.items[0].days, morning.days);
+    EXPECT_EQ(morning.items[0].trigger_mode, TriggerMode::Frame);
+    EXPECT_EQ(morning.items[1].days, DaySet{"saturday"});
+    EXPECT_EQ(morning.items[2].name, "Quiz");
+    
+    // The item at 25:00 is left out, saying where it was
+    ASSERT_EQ(schedule.warnings.size(), 1u);
+    EXPECT_EQ(schedule.warnings[0], "line 15, column 9: item skipped, invalid \"time\" \"25:00\"");
+    
+    const auto& night = schedule.playlists[1];
+    EXPECT_FALSE(night.enabled);
+    EXPECT_EQ(night.days.size(), 7u);
+    EXPECT_EQ(night.items[0].trigger_mode, TriggerMode::Minute);
+    
+    // Night runs on the last Friday of the month, July's excepted; Gala on its own dates
+    ASSERT_TRUE(night.calendar);
+    ASSERT_EQ(night.items.size(), 2u);
+    EXPECT_EQ(night.items[0].calendar, night.calendar);
+    EXPECT_TRUE(night.calendar->occurs_on(CalendarRule::from_civil(2026, 1, 30)));
+    EXPECT_FALSE(night.calendar->occurs_on(CalendarRule::from_civil(2026, 1, 23)));
+    EXPECT_FALSE(night.calendar->occurs_on(CalendarRule::from_civil(2026, 7, 31)));
+    EXPECT_TRUE(night.items[1].calendar->occurs_on(CalendarRule::from_civil(2026, 12, 25)));
+    EXPECT_TRUE(night.items[1].calendar->occurs_on(CalendarRule::from_civil(2027, 1, 1)));
+    EXPECT_FALSE(night.items[1].calendar->occurs_on(CalendarRule::from_civil(2026, 12, 27)));
+    EXPECT_FALSE(morning.items[0].calendar);
+    EXPECT_EQ(night.priority, 2);
+    EXPECT_EQ(night.items[1].priority, -1);
+    EXPECT_EQ(morning.priority, 0);
+    
+    // Reading through a buffer smaller than most tokens gives the same schedule
+    std::string path = "test_parser_schedule.json";
+    std::ofstream(path) << PARSER_SCHEDULE;
+    ScheduleParser small_parser(7);
+    ParsedSchedule streamed;
+    ASSERT_TRUE(small_parser.parse_file(path, streamed)) << small_parser.get_error();
+    EXPECT_EQ(small_parser.get_bytes_read(), std::string(PARSER_SCHEDULE).size());
+    ASSERT_EQ(streamed.playlists.size(), 2u);
+    EXPECT_EQ(streamed.playlists[0].name, morning.name);
+    EXPECT_EQ(streamed.playlists[0].items[0].file_path, morning.items[0].file_path);
+    EXPECT_EQ(streamed.warnings, schedule.warnings);
+    
+    // Loaded, the disabled playlist stays out of the schedule
+    PlaylistManager manager;
+    ASSERT_TRUE(manager.load_schedule_file(path));
+    EXPECT_EQ(manager.get_snapshot()->timeline.get_item_count(), 3u);
+    std::remove(path.c_str());
+}
+
+TEST(ScheduleParserTest, ConvertsTimecodeAtTheFileFrameRate) {
+    // The frame rate may come after the items it applies to
+    const std::string json =
+        "{\"version\": \"1.0\", \"playlists\": [{\"name\": \"Frames\", \"items\": [\n"
+        "  {\"name\": \"A\", \"time\": \"09:00:15:12\", \"source\": \"S\"},\n"
+        "  {\"name\": \"B\", \"time\": \"09:00:15:25\", \"source\": \"S\"},\n"
+        "  {\"name\": \"C\", \"time\": \"09:00:15.5\", \"source\": \"S\"}]}],\n"
+        " \"frame_rate\": 25}";
+    ScheduleParser parser;
+    ParsedSchedule schedule;
+    ASSERT_TRUE(parser.parse_string(json, schedule)) << parser.get_error();
+    ASSERT_EQ(schedule.playlists[0].items.size(), 2u);
+    EXPECT_EQ(schedule.playlists[0].items[0].time, "09:00:15.480");
+    EXPECT_EQ(schedule.playlists[0].items[1].time, "09:00:15.5");
+    EXPECT_EQ(schedule.warnings, std::vector<std::string>{
+        "line 3, column 3: item skipped, frame past \"frame_rate\" in \"time\" \"09:00:15:25\""});
+    
+    std::string without_rate = json.substr(0, json.rfind(','));
+    ASSERT_TRUE(parser.parse_string(without_rate + "}", schedule)) << parser.get_error();
+    EXPECT_EQ(schedule.playlists[0].items.size(), 1u);
+    ASSERT_EQ(schedule.warnings.size(), 2u);
+    EXPECT_EQ(schedule.warnings[0],
+              "line 2, column 3: item skipped, timecode \"time\" \"09:00:15:12\" without a \"frame_rate\"");
+}
+
+TEST(ScheduleParserTest, ReportsLineAndColumn) {
+    ScheduleParser parser;
+    ParsedSchedule schedule;
+    
+    EXPECT_FALSE(parser.parse_string("{\n  \"version\": \"1.0\"\n  \"playlists\": []\n}", schedule));
+    EXPECT_EQ(parser.get_error(), "line 3, column 3: expected ',' or '}' in object");
+    
+    EXPECT_FALSE(parser.parse_string(
+        "{\"version\": \"1.0\", \"playlists\": [\n"
+        "  {\"name\": \"A\", \"items\": [{\"name\": \"B\", \"duration\": \"30\"}]}]}", schedule));
+    EXPECT_EQ(parser.get_error(), "line 2, column 53: \"duration\" must be a number");
+    
+    EXPECT_FALSE(parser.parse_string("{\"version\": \"1.0\", \"playlists\": [{\"days\": [\"funday\"]}]}", schedule));
+    EXPECT_EQ(parser.get_error(), "line 1, column 44: unknown day \"funday\"");
+    
+    EXPECT_FALSE(parser.parse_string("{\"version\": \"1.0\"}", schedule));
+    EXPECT_EQ(parser.get_error(), "line 1, column 18: missing \"playlists\"");
+    
+    EXPECT_FALSE(parser.parse_string(
+        "{\"version\": \"1.0\", \"playlists\": [{\"rrule\": \"FREQ=WEEKLY\", \"items\": []}]}", schedule));
+    EXPECT_NE(parser.get_error().find("\"dtstart\""), std::string::npos) << parser.get_error();
+    
+    EXPECT_FALSE(parser.parse_string("{\"version\": \"1.0\", \"playlists\": [{\"dates\": [\"2026-02-30\"]}]}", schedule));
+    EXPECT_NE(parser.get_error().find("2026-02-30"), std::string::npos) << parser.get_error();
+    
+    EXPECT_FALSE(parser.parse_string("{\"version\": \"1.0\", \"playlists\": [{\"priority\": 1.5}]}", schedule));
+    EXPECT_EQ(parser.get_error(), "line 1, column 47: \"priority\" must be a whole number from -1000000 to 1000000");
+    
+    EXPECT_FALSE(parser.parse_string(
+        "{\"version\": \"1.0\", \"playlists\": [{\"items\": [{\"duration\": 1e20}]}]}", schedule));
+    EXPECT_EQ(parser.get_error(), "line 1, column 58: \"duration\" must be from 0 to 604800 seconds");
+    
+    EXPECT_FALSE(parser.parse_string("{\"version\": \"1.0\", \"frame_rate\": 0, \"playlists\": []}", schedule));
+    EXPECT_EQ(parser.get_error(), "line 1, column 34: \"frame_rate\" must be above 0 and at most 1000");
+    
+    EXPECT_FALSE(parser.parse_string("{\"version\": \"1.0\", \"playlists\": [] ", schedule));
+    EXPECT_NE(parser.get_error().find("line 1, column 36"), std::string::npos);
+}
+
+TEST(ScheduleCacheTest, WarmLoadMatchesParseUntilSourceChanges) {
+    std::string path = "test_cached_schedule.json";
+    std::string directory = "test_schedule_cache";
+    std::filesystem::remove_all(directory);
+    std::ofstream(path) << PARSER_SCHEDULE;
+    
+    ScheduleCache cache(directory);
+    ParsedSchedule cached;
+    EXPECT_FALSE(cache.load(path, cached));
+    
+    SourceStamp stamp;
+    ASSERT_TRUE(ScheduleCache::stat_source(path, stamp));
+    ScheduleParser parser;
+    ParsedSchedule parsed;
+    ASSERT_TRUE(parser.parse_file(path, parsed));
+    ASSERT_TRUE(cache.store(path, stamp, parsed));
+    
+    ASSERT_TRUE(cache.load(path, cached));
+    EXPECT_EQ(cached.version, parsed.version);
+    EXPECT_EQ(cached.default_idle, parsed.default_idle);
+    EXPECT_EQ(cached.warnings, parsed.warnings);
+    ASSERT_EQ(cached.playlists.size(), 2u);
+    auto calendar_text = [](const std::shared_ptr<const CalendarRule>& calendar) {
+        return calendar ? calendar->to_text() : std::string();
+    };
+    EXPECT_FALSE(calendar_text(parsed.playlists[1].calendar).empty());
+    EXPECT_EQ(cached.playlists[1].items[0].calendar, cached.playlists[1].calendar);
+    for (size_t p = 0; p < parsed.playlists.size(); ++p) {
+        const auto& expected = parsed.playlists[p];
+        const auto& actual = cached.playlists[p];
+        EXPECT_EQ(actual.name, expected.name);
+        EXPECT_EQ(actual.days, expected.days);
+        EXPECT_EQ(actual.enabled, expected.enabled);
+        EXPECT_EQ(actual.trigger_mode, expected.trigger_mode);
+        EXPECT_EQ(calendar_text(actual.calendar), calendar_text(expected.calendar));
+        EXPECT_EQ(actual.priority, expected.priority);
+        ASSERT_EQ(actual.items.size(), expected.items.size());
+        for (size_t i = 0; i < expected.items.size(); ++i) {
+            EXPECT_EQ(actual.items[i].name, expected.items[i].name);
+            EXPECT_EQ(actual.items[i].time, expected.items[i].time);
+            EXPECT_EQ(actual.items[i].file_path, expected.items[i].file_path);
+            EXPECT_EQ(actual.items[i].scene, expected.items[i].scene);
+            EXPECT_EQ(actual.items[i].duration, expected.items[i].duration);
+            EXPECT_EQ(actual.items[i].days, expected.items[i].days);
+            EXPECT_EQ(actual.items[i].trigger_mode, expected.items[i].trigger_mode);
+            EXPECT_EQ(calendar_text(actual.items[i].calendar), calendar_text(expected.items[i].calendar));
+            EXPECT_EQ(actual.items[i].priority, expected.items[i].priority);
+        }
+    }
+    
+    // Same size and time, different contents: caught by the hash
+    std::string edited = PARSER_SCHEDULE;
+    edited.replace(edited.find("08:00"), 5, "08:05");
+    auto mtime = std::filesystem::last_write_time(path);
+    std::ofstream(path) << edited;
+    std::filesystem::last_write_time(path, mtime);
+    EXPECT_FALSE(cache.load(path, cached));
+    
+    // A damaged entry is ignored, not trusted
+    ASSERT_TRUE(ScheduleCache::stat_source(path, stamp));
+    ASSERT_TRUE(parser.parse_file(path, parsed));
+    ASSERT_TRUE(cache.store(path, stamp, parsed));
+    std::filesystem::resize_file(cache.get_entry_path(path), 64);
+    EXPECT_FALSE(cache.load(path, cached));
+    
+    // The manager writes the entry on its first load and reads it on the next
+    PlaylistManager manager;
+    manager.set_cache_directory(directory);
+    ASSERT_TRUE(manager.load_schedule_file(path));
+    ASSERT_TRUE(cache.load(path, cached));
+    EXPECT_EQ(cached.playlists[0].items[0].time, "08:05");
+    manager.unload_schedule_file(path);
+    ASSERT_TRUE(manager.load_schedule_file(path));
+    EXPECT_EQ(manager.get_snapshot()->timeline.get_item_count(), 3u);
+    
+    std::remove(path.c_str());
+    std::filesystem::remove_all(directory);
+}
+
+TEST(MediaProbeTest, ProbesInBackgroundAndFeedsDurations) {
+    std::string directory = "test_media_probe";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    std::string intro = directory + "/intro.mp4";
+    std::string feature = directory + "/feature.mp4";
+    std::string broken = directory + "/broken.mp4";
+    std::ofstream(intro) << "intro";
+    std::ofstream(feature) << "feature";
+    std::ofstream(broken) << "broken";
+    
+    // Stands in for libavformat: a minute of 29.97 fps stereo per byte.
+    // Held back while hold is set.
+    std::atomic<int> probes{0};
+    std::atomic<bool> hold{false};
+    auto fake_probe = [&probes, &hold](const std::string& path, MediaInfo& info, std::string& error) {
+        while (hold) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        probes++;
+        SourceStamp stamp;
+        if (path.find("broken") != std::string::npos || !ScheduleCache::stat_source(path, stamp)) {
+            error = "Invalid data found when processing input";
+            return false;
+        }
+        info.duration_ms = static_cast<int64_t>(stamp.size) * 60000;
+        info.width = 1920;
+        info.height = 1080;
+        info.fps_num = 30000;
+        info.fps_den = 1001;
+        info.audio_channels = 2;
+        info.sample_rate = 48000;
+        return true;
+    };
+    
+    auto probe = std::make_shared<MediaProbe>(directory);
+    probe->set_probe_function(fake_probe);
+    EXPECT_EQ(probe->request({intro, feature, intro, broken, directory + "/missing.mp4"}), 3u);
+    probe->wait_idle();
+    EXPECT_EQ(probes, 3);
+    MediaInfo info;
+    ASSERT_TRUE(probe->lookup(intro, info));
+    EXPECT_EQ(info.duration_ms, 5 * 60000);
+    EXPECT_EQ(info.fps_num, 30000u);
+    EXPECT_TRUE(info.has_video() && info.has_audio());
+    EXPECT_FALSE(probe->lookup(broken, info));
+    EXPECT_EQ(probe->request({intro, feature, broken}), 0u);
+    
+    // A restart reads the results back, failures included, instead of probing again
+    auto restarted = std::make_shared<MediaProbe>(directory);
+    restarted->set_probe_function(fake_probe);
+    EXPECT_EQ(restarted->load(), 3u);
+    EXPECT_EQ(restarted->request({intro, feature, broken}), 0u);
+    ASSERT_TRUE(restarted->lookup(feature, info));
+    EXPECT_EQ(info.duration_ms, 7 * 60000);
+    EXPECT_EQ(info.sample_rate, 48000u);
+    EXPECT_EQ(probes, 3);
+    
+    // A changed file is forgotten until it was probed again
+    std::ofstream(intro) << "intro, longer";
+    EXPECT_EQ(restarted->request({intro}), 1u);
+    restarted->wait_idle();
+    ASSERT_TRUE(restarted->lookup(intro, info));
+    EXPECT_EQ(info.duration_ms, 13 * 60000);
+    
+    // Items without a duration are published with what the probe knows, and
+    // again once their files were probed
+    std::ofstream(feature) << "feature!";
+    hold = true;
+    PlaylistManager manager;
+    manager.set_media_probe(restarted);
+    Playlist playlist;
+    playlist.name = "Probed";
+    auto add_item = [&playlist](const std::string& name, const std::string& time, const std::string& file,
+                                int duration, bool loop) {
+        ScheduledItem item;
+        item.name = name;
+        item.time = time;
+        item.source = "Screen";
+        item.file_path = file;
+        item.duration = duration;
+        item.loop = loop;
+        item.days = DaySet{"monday"};
+        playlist.items.push_back(item);
+    };
+    add_item("Intro", "09:00", intro, 0, false);
+    add_item("Feature", "08:55", feature, 0, false);
+    add_item("Looped", "10:00", intro, 0, true);
+    add_item("Fixed", "11:00", feature, 60, false);
+    manager.add_playlist("probed.json", playlist);
+    
+    auto find = [&manager](const std::string& name) {
+        for (const auto& pair : manager.get_snapshot()->items) {
+            if (pair.second->name == name) {
+                return pair.second;
+            }
+        }
+        return std::shared_ptr<const ScheduledItem>();
+    };
+    EXPECT_EQ(find("Intro")->get_duration_ms(), 13 * 60000);
+    EXPECT_EQ(find("Feature")->get_duration_ms(), 0);
+    EXPECT_TRUE(manager.get_conflicts().empty());
+    
+    hold = false;
+    restarted->wait_idle();
+    EXPECT_EQ(find("Feature")->get_duration_ms(), 8 * 60000);
+    EXPECT_EQ(find("Looped")->get_duration_ms(), 0);
+    EXPECT_EQ(find("Fixed")->get_duration_ms(), 60000);
+    EXPECT_EQ(manager.get_snapshot()->changes.modified.size(), 1u);
+    
+    // Feature now runs until 09:03, into Intro, which cuts it short
+    auto conflicts = manager.get_conflicts();
+    ASSERT_EQ(conflicts.size(), 1u);
+    EXPECT_EQ(conflicts[0].winner->name, "Intro");
+    EXPECT_EQ(conflicts[0].loser->name, "Feature");
+    EXPECT_FALSE(conflicts[0].dropped);
+    
+    manager.cleanup();
+    std::filesystem::remove_all(directory);
+}
+
+TEST(ScheduleReloadTest, PatchesOnlyWhatChanged) {
+    auto write_file = [](const std::string& path, const std::string& day, const std::vector<std::string>& items) {
+        std::ofstream out(path);
+        out << "{\"version\": \"1.0\", \"playlists\": [{\"name\": \"" << path << "\", \"days\": [\"" << day
+            << "\"], \"items\": [";
+        for (size_t i = 0; i < items.size(); ++i) {
+            out << (i ? ", " : "") << items[i];
+        }
+        out << "]}]}";
+    };
+    auto item = [](const std::string& name, const std::string& time, const std::string& file) {
+        return "{\"name\": \"" + name + "\", \"time\": \"" + time + "\", \"source\": \"Media\", \"file\": \"" +
+               file + "\"}";
+    };
+    auto slots_of = [](const ScheduleTimeline& timeline, int weekday) {
+        std::vector<std::string> slots;
+        for (const auto& slot : timeline.get_slots(weekday)) {
+            for (const auto& item_id : slot.item_ids) {
+                slots.push_back(slot.to_string() + " " + item_id);
+            }
+        }
+        return slots;
+    };
+    
+    std::string monday_path = "test_reload_monday.json";
+    std::string tuesday_path = "test_reload_tuesday.json";
+    // Evening items never change; a patch is only used while most of the schedule stays
+    std::vector<std::string> evening;
+    for (int hour = 18; hour < 24; ++hour) {
+        evening.push_back(item("Evening " + std::to_string(hour), std::to_string(hour) + ":00", "evening.mp4"));
+    }
+    auto monday_items = [&evening](std::vector<std::string> items) {
+        items.insert(items.end(), evening.begin(), evening.end());
+        return items;
+    };
+    write_file(monday_path, "monday", monday_items({item("A", "09:00", "a.mp4"), item("B", "10:00", "b.mp4"),
+                                                    item("C", "11:00", "c.mp4")}));
+    write_file(tuesday_path, "tuesday", {item("D", "12:00", "d.mp4")});
+    // Items of files read again count towards the patch limit too
+    std::string weekend_path = "test_reload_weekend.json";
+    std::vector<std::string> weekend;
+    for (int hour = 6; hour < 18; ++hour) {
+        weekend.push_back(item("Weekend " + std::to_string(hour), std::to_string(hour) + ":00", "weekend.mp4"));
+    }
+    write_file(weekend_path, "saturday", weekend);
+    
+    PlaylistManager manager;
+    manager.set_cache_directory("");
+    ASSERT_TRUE(manager.reload_files({monday_path, tuesday_path, weekend_path}));
+    auto before = manager.get_snapshot();
+    EXPECT_EQ(before->changes.added.size(), 22u);
+    
+    // Nothing changed, or only the modification time: nothing is published
+    EXPECT_FALSE(manager.reload_files({monday_path, tuesday_path, weekend_path}));
+    std::filesystem::last_write_time(monday_path, std::filesystem::last_write_time(monday_path) + std::chrono::hours(1));
+    EXPECT_FALSE(manager.reload_files({monday_path, tuesday_path, weekend_path}));
+    EXPECT_EQ(manager.get_snapshot()->version, before->version);
+    
+    // A dropped, B moved, C given another file, E new
+    write_file(monday_path, "monday", monday_items({item("B", "10:30", "b.mp4"), item("C", "11:00", "c2.mp4"),
+                                                    item("E", "13:00", "e.mp4")}));
+    ASSERT_TRUE(manager.reload_files({monday_path, tuesday_path, weekend_path}));
+    auto after = manager.get_snapshot();
+    const auto& changes = after->changes;
+    ASSERT_EQ(changes.removed.size(), 1u);
+    EXPECT_EQ(changes.removed[0]->name, "A");
+    ASSERT_EQ(changes.retimed.size(), 1u);
+    EXPECT_EQ(changes.retimed[0].first->time, "10:00");
+    EXPECT_EQ(changes.retimed[0].second->time, "10:30");
+    ASSERT_EQ(changes.modified.size(), 1u);
+    EXPECT_EQ(changes.modified[0].second->file_path, "c2.mp4");
+    ASSERT_EQ(changes.added.size(), 1u);
+    EXPECT_EQ(changes.added[0]->name, "E");
+    EXPECT_EQ(changes.unchanged.size(), 6u);
+    EXPECT_EQ(after->items.size(), 22u);
+    
+    // The patched timeline answers like a freshly built one; Tuesday is shared, not copied
+    std::vector<std::shared_ptr<const ScheduledItem>> items;
+    for (const auto& pair : after->items) {
+        items.push_back(pair.second);
+    }
+    ScheduleTimeline built;
+    built.build(items);
+    int monday = ScheduleTimeline::day_index("monday");
+    int tuesday = ScheduleTimeline::day_index("tuesday");
+    EXPECT_EQ(slots_of(after->timeline, monday), slots_of(built, monday));
+    EXPECT_EQ(slots_of(after->timeline, tuesday), slots_of(built, tuesday));
+    EXPECT_EQ(after->timeline.get_item_count(), built.get_item_count());
+    EXPECT_EQ(after->timeline.share_slots(tuesday), before->timeline.share_slots(tuesday));
+    EXPECT_NE(after->timeline.share_slots(monday), before->timeline.share_slots(monday));
+    
+    // Unchanged items are the same objects in both snapshots
+    auto d = before->items.begin();
+    while (d != before->items.end() && d->second->name != "D") {
+        ++d;
+    }
+    ASSERT_NE(d, before->items.end());
+    EXPECT_EQ(after->find_item(d->first), d->second);
+    
+    // Unless their file was read again: then they point into its new playlist
+    std::weak_ptr<const Playlist> old_monday;
+    for (const auto& playlist : before->playlists) {
+        if (playlist->name == monday_path) {
+            old_monday = playlist;
+        }
+    }
+    const auto& evening_item = changes.unchanged[0].second;
+    EXPECT_EQ(after->find_item(evening_item->id), evening_item);
+    EXPECT_NE(changes.unchanged[0].first, evening_item);
+    
+    // A file no longer listed is dropped
+    ASSERT_TRUE(manager.reload_files({monday_path, weekend_path}));
+    EXPECT_EQ(manager.get_snapshot()->changes.removed.size(), 1u);
+    EXPECT_TRUE(manager.get_snapshot()->timeline.get_slots(tuesday).empty());
+    
+    // Nothing published holds the first Monday playlist any more
+    before.reset();
+    after.reset();
+    EXPECT_TRUE(old_monday.expired());
+    
+    std::remove(monday_path.c_str());
+    std::remove(tuesday_path.c_str());
+    std::remove(weekend_path.c_str());
+}
+
+TEST(ScheduleReloadTest, ReadsFilesSideBySideAndPublishesOnce) {
+    // The pool itself: every index once, the first error passed on
+    WorkerPool pool(4);
+    std::vector<std::atomic<int>> seen(100);
+    pool.for_each(seen.size(), [&seen](size_t index) { seen[index]++; });
+    EXPECT_TRUE(std::all_of(seen.begin(), seen.end(), [](const std::atomic<int>& count) { return count == 1; }));
+    EXPECT_THROW(pool.for_each(8, [](size_t index) {
+        if (index == 5) {
+            throw std::runtime_error("bad file");
+        }
+    }), std::runtime_error);
+    std::atomic<int> submitted{0};
+    for (int i = 0; i < 10; ++i) {
+        pool.submit([&submitted]() { submitted++; });
+    }
+    pool.wait_idle();
+    EXPECT_EQ(submitted, 10);
+    
+    std::string directory = "test_parallel_load";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    std::vector<std::string> paths;
+    for (int f = 0; f < 12; ++f) {
+        paths.push_back(directory + "/show-" + std::to_string(f) + ".json");
+        std::ofstream out(paths.back());
+        out << "{\"version\": \"1.0\", \"playlists\": [{\"name\": \"Show " << f << "\", \"items\": [";
+        for (int i = 0; i <= f; ++i) {
+            out << (i ? ", " : "") << "{\"name\": \"Part " << i << "\", \"time\": \"" << 10 + i
+                << ":" << 10 + f << "\", \"source\": \"Media\"}";
+        }
+        out << "]}]}";
+    }
+    paths.push_back(directory + "/missing.json");
+    
+    PlaylistManager manager;
+    manager.set_cache_directory("");
+    manager.set_load_threads(4);
+    uint64_t version = manager.get_snapshot()->version;
+    EXPECT_TRUE(manager.reload_files(paths));
+    
+    // One publish for all of them, the same schedule as reading them one by one
+    auto snapshot = manager.get_snapshot();
+    EXPECT_EQ(snapshot->version, version + 1);
+    EXPECT_EQ(snapshot->items.size(), 78u);
+    PlaylistManager serial;
+    serial.set_cache_directory("");
+    for (size_t f = 0; f + 1 < paths.size(); ++f) {
+        ASSERT_TRUE(serial.load_schedule_file(paths[f]));
+    }
+    auto expected = serial.get_snapshot();
+    ASSERT_EQ(expected->items.size(), snapshot->items.size());
+    for (int weekday = 0; weekday < ScheduleTimeline::DAYS_PER_WEEK; ++weekday) {
+        const auto& slots = snapshot->timeline.get_slots(weekday);
+        const auto& expected_slots = expected->timeline.get_slots(weekday);
+        ASSERT_EQ(slots.size(), expected_slots.size());
+        for (size_t s = 0; s < slots.size(); ++s) {
+            EXPECT_EQ(slots[s].item_ids, expected_slots[s].item_ids);
+        }
+    }
+    
+    // Each file read is timed, in the order given; the missing one is not
+    auto times = manager.get_load_times();
+    ASSERT_EQ(times.size(), 12u);
+    for (size_t f = 0; f < times.size(); ++f) {
+        EXPECT_EQ(times[f].path, paths[f]);
+        EXPECT_EQ(times[f].items, f + 1);
+        EXPECT_FALSE(times[f].cached);
+    }
+    
+    // Nothing changed: nothing read, nothing published
+    EXPECT_FALSE(manager.reload_files(paths));
+    EXPECT_TRUE(manager.get_load_times().empty());
+    EXPECT_EQ(manager.get_snapshot(), snapshot);
+    
+    std::filesystem::remove_all(directory);
+}
+
 class ConfigTest : public ::testing::Test {
 protected:
     void SetUp() override {